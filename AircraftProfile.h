@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "FleetCatalog.h"
+
+
+/*
+* Per-session metrics of an aircraft, computed from the spec of its manufacturer.
+*
+* The profile is a literal type and every calculation is constexpr, so the metrics inline into whatever
+* loop aggregates them instead of going through a virtual call per value, and fold to constants for a
+* profile known at build time (see BuiltinCatalog.h). The expressions are kept exactly as the simulation
+* has always evaluated them, so recorded and logged figures are unchanged to the last bit.
+*/
+
+struct AircraftProfile {
+	int cruiseSpeed;						// Cruise speed in miles per hour
+	int passengerCount;						// Maximum passengers per flight
+	double faultsPerHour;					// Probability of a fault per hour of flight
+	std::size_t fleetSize;					// Aircraft of the same manufacturer in the fleet
+
+	static constexpr AircraftProfile of(const ManufacturerSpec& spec, std::size_t fleetSize = 1) {
+		return AircraftProfile{ spec.cruiseSpeed, spec.passengerCount, spec.faultsPerHour, fleetSize };
+	}
+
+	/* ----------------- Recorded metrics, per aircraft ----------------- */
+	constexpr double miles(double airTime) const {
+		return cruiseSpeed * (airTime / 3600.0);
+	}
+
+	constexpr double passengerMiles(double airTime) const {
+		return cruiseSpeed * (airTime / 3600.0) * passengerCount;
+	}
+
+	constexpr double faults(double airTime) const {
+		return faultsPerHour * (airTime / 3600.0);
+	}
+
+	/* ----------------- Logged session summary ----------------- */
+	constexpr double milesPerSession(double airTime) const {
+		// Rounded to 2 decimal places
+		return roundHalfAway(cruiseSpeed * (airTime / 3600.0) * 100.0) / 100.0;
+	}
+
+	constexpr double fleetPassengerMiles(double airTime) const {
+		// Passenger miles the manufacturer's whole fleet would fly in the same session
+		return (airTime * cruiseSpeed * passengerCount * fleetSize) / 3600.0;
+	}
+
+	constexpr double faultsPerSession(double airTime) const {
+		return airTime / 3600.0;
+	}
+
+private:
+	static constexpr double roundHalfAway(double value) {
+		// std::round is not constexpr before C++23; at run time it is used as before
+		if (std::is_constant_evaluated()) {
+			double truncated = static_cast<double>(static_cast<long long>(value));
+			if (value - truncated >= 0.5) return truncated + 1.0;
+			if (truncated - value >= 0.5) return truncated - 1.0;
+			return truncated;
+		}
+		return std::round(value);
+	}
+};
@@ -0,0 +1,431 @@
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+
+#include "evTOL.h"
+#include "Benchmark.h"
+#include "Scheduler.h"
+#include "Simulation.h"
+#include "Vertiport.h"
+#include "FleetCatalog.h"
+#include "FleetManager.h"
+#include "ChargingTrace.h"
+#include "RequestManager.h"
+#include "ChargingStation.h"
+#include "BuiltinCatalog.h"
+#include "AircraftProfile.h"
+#include "ParallelScheduler.h"
+
+
+namespace {
+
+	/*
+	* The session summary as it used to be dispatched: pure virtual functions of the aircraft, implemented
+	* by the fleet manager on top of the aircraft's out-of-line accessors, with the model number returned
+	* by value. Kept here only as the baseline of the metrics benchmark.
+	*/
+
+	class VirtualSessionSummary {
+	public:
+		virtual ~VirtualSessionSummary() = default;
+
+		virtual double getPassengerMiles() const = 0;
+		virtual double getMilesPerSession() const = 0;
+		virtual double getFaultsPerSession() const = 0;
+		virtual std::string getManufacturerName() const = 0;
+	};
+
+
+	class FleetSessionSummary : public VirtualSessionSummary {
+	public:
+		FleetSessionSummary(const evTOL& aircraft, std::size_t fleetSize) : aircraft(aircraft), fleetSize(fleetSize) {}
+
+		double getPassengerMiles() const override {
+			return (aircraft.getAirTime().count() * aircraft.getCruiseSpeed() * aircraft.getMaxPassengerCount() * fleetSize) / 3600.0;
+		}
+
+		double getMilesPerSession() const override {
+			double MilesTravelled = aircraft.getCruiseSpeed() * (aircraft.getAirTime().count() / 3600.0);
+			double factor = std::pow(10, 2);
+
+			return std::round(MilesTravelled * factor) / factor;
+		}
+
+		double getFaultsPerSession() const override {
+			return aircraft.getAirTime().count() / 3600.0;
+		}
+
+		std::string getManufacturerName() const override {
+			return aircraft.getManufacturerName();
+		}
+
+	private:
+		const evTOL& aircraft;
+		std::size_t fleetSize;
+	};
+
+
+	// Summary of a built-in manufacturer, selected among compile-time profiles
+	template <std::size_t... Manufacturer>
+	double builtinSummary(std::size_t manufacturer, double airTime, std::size_t fleetSize, std::index_sequence<Manufacturer...>) {
+		double total = 0.0;
+
+		((manufacturer == Manufacturer ? (total = [&] {
+			constexpr AircraftProfile profile = BuiltinAircraft<Manufacturer>::profile;
+			AircraftProfile sized = profile;
+			sized.fleetSize = fleetSize;
+			return sized.milesPerSession(airTime) + sized.faultsPerSession(airTime) + sized.fleetPassengerMiles(airTime);
+			}()) : 0.0), ...);
+
+		return total;
+	}
+
+
+	struct ReplayState {
+		std::vector<std::shared_ptr<RequestManager>> inFlight;		// Requests not yet seen completed
+		std::vector<double> latencies;								// Simulated seconds between request and charger, per completed request
+		std::size_t maxQueueDepth = 0;								// Most requests waiting across all vertiports at once
+	};
+
+
+	// Move completed requests out of the in-flight list and record their queue latency
+	void collectCompleted(ReplayState& state) {
+		std::vector<std::shared_ptr<RequestManager>>::iterator kept = std::remove_if(state.inFlight.begin(), state.inFlight.end(),
+			[&state](std::shared_ptr<RequestManager>& request) {
+				if (!request->chargingCompleted().isSet()) return false;
+				state.latencies.push_back(std::chrono::duration<double>(request->getStartTime() - request->getRequestTime()).count());
+				return true;
+			});
+
+		state.inFlight.erase(kept, state.inFlight.end());
+	}
+
+
+	Task replayArrivals(Simulation& simulation, Scheduler& scheduler, const std::vector<TraceArrival>& trace, double acceleration, ReplayState& state) {
+		/*
+		* Stands in for the whole fleet: each arrival is a fresh aircraft of the traced manufacturer whose
+		* charge time is the traced one, queued the same way an aircraft coroutine queues its request.
+		* With an acceleration, the coroutine also waits for the wall clock to catch up with the trace.
+		*/
+
+		const FleetCatalog& catalog = simulation.getCatalog();
+		std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+		std::size_t collectAt = 1024;
+
+		for (std::size_t i = 0; i < trace.size(); ++i) {
+			const TraceArrival& arrival = trace[i];
+
+			co_await scheduler.sleepFor(arrival.arrival - scheduler.elapsed());
+			if (acceleration > 0.0) {
+				std::this_thread::sleep_until(wallStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<double>(arrival.arrival) / acceleration));
+			}
+
+			ManufacturerSpec spec = catalog.getSpec(arrival.manufacturer);
+			spec.timeToCharge = std::chrono::duration<double, std::ratio<3600>>(arrival.chargeTime).count();
+
+			std::shared_ptr<evTOL> aircraft = std::allocate_shared<FleetManager>(TrackedAllocator<FleetManager, MemorySubsystem::Fleet>(), spec,
+				i + 1, arrival.manufacturer, i, 1, simulation, "REPLAY");
+			state.inFlight.push_back(RequestManager::queueChargingRequest(aircraft, scheduler));
+
+			std::size_t queueDepth = 0;
+			for (std::size_t site = 0; site < simulation.getSiteCount(); ++site) queueDepth += simulation.getSite(site).getQueueDepth();
+			state.maxQueueDepth = std::max(state.maxQueueDepth, queueDepth);
+
+			// Collected whenever the list doubles, so the sweep stays amortised constant per request
+			if (state.inFlight.size() >= collectAt) {
+				collectCompleted(state);
+				collectAt = std::max<std::size_t>(1024, 2 * state.inFlight.size());
+			}
+		}
+	}
+
+}
+
+
+RunDigest Benchmark::digestFleet(const Simulation& simulation, std::size_t events, double wallSeconds) {
+	RunDigest digest{};
+	digest.events = events;
+	digest.wallSeconds = wallSeconds;
+
+	for (const std::shared_ptr<evTOL>& aircraft : simulation.getFleet()) {
+		digest.sessions += aircraft->getCompletedSessions();
+		digest.airTime += aircraft->getTotalAirTime().count();
+	}
+
+	return digest;
+}
+
+
+RunDigest Benchmark::runCooperative(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario) {
+	Simulation simulation(catalog);
+	simulation.setSeed(scenario.seed);
+
+	Scheduler scheduler;
+
+	ChargingStation::InitializeChargers(simulation, scenario.chargers, scenario.sites, scheduler);
+	FleetManager::InitializeFleet(simulation, scenario.aircraft, scheduler);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::size_t events = scheduler.runFor(scenario.duration);
+	std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - start;
+
+	FleetManager::stopSimulation(simulation);
+
+	return Benchmark::digestFleet(simulation, events, wallTime.count());
+}
+
+
+RunDigest Benchmark::runParallel(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t workers) {
+	Simulation simulation(catalog);
+	simulation.setSeed(scenario.seed);
+
+	ParallelScheduler scheduler(workers);
+
+	ChargingStation::InitializeChargers(simulation, scenario.chargers, scenario.sites, scheduler.partition(0));
+	FleetManager::InitializeFleet(simulation, scenario.aircraft, scheduler);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::size_t events = scheduler.runFor(scenario.duration, FleetManager::getLookahead(simulation));
+	std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - start;
+
+	FleetManager::stopSimulation(simulation);
+
+	return Benchmark::digestFleet(simulation, events, wallTime.count());
+}
+
+
+int Benchmark::runParallelScaling(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t maxWorkers) {
+	/*
+	* The serial cooperative run is the reference. Every parallel run must reproduce its digest exactly;
+	* speedup is reported against the serial wall-clock time.
+	*/
+
+	RunDigest serial = Benchmark::runCooperative(catalog, scenario);
+
+	bool allMatch = true;
+
+	std::cout << std::left << std::setw(10) << "workers" << std::setw(14) << "seconds" << std::setw(12) << "speedup"
+		<< std::setw(14) << "events/sec" << "matches serial" << "\n";
+	std::cout << std::left << std::setw(10) << "serial" << std::setw(14) << serial.wallSeconds << std::setw(12) << 1.0
+		<< std::setw(14) << static_cast<std::size_t>(serial.events / serial.wallSeconds) << "-" << "\n";
+
+	for (std::size_t workers = 1; workers <= maxWorkers; ++workers) {
+		RunDigest parallel = Benchmark::runParallel(catalog, scenario, workers);
+
+		bool match = parallel.events == serial.events && parallel.sessions == serial.sessions && parallel.airTime == serial.airTime;
+		allMatch = allMatch && match;
+
+		std::cout << std::left << std::setw(10) << workers << std::setw(14) << parallel.wallSeconds
+			<< std::setw(12) << serial.wallSeconds / parallel.wallSeconds
+			<< std::setw(14) << static_cast<std::size_t>(parallel.events / parallel.wallSeconds)
+			<< (match ? "yes" : "NO") << "\n";
+	}
+
+	return allMatch ? 0 : 2;
+}
+
+
+int Benchmark::runConcurrentBatch(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t runs) {
+	/*
+	* Runs seeds seed .. seed + runs - 1 as independent simulations, one per hardware thread at a time.
+	* Each run is then repeated on its own; any difference would mean the simulations leak state into
+	* each other.
+	*/
+
+	std::size_t numThreads = std::max<std::size_t>(1, std::min<std::size_t>(runs, std::thread::hardware_concurrency()));
+	std::vector<RunDigest> concurrent(runs);
+	std::atomic<std::size_t> nextRun{ 0 };
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		std::vector<std::thread> threads;
+		for (std::size_t i = 0; i < numThreads; ++i) {
+			threads.emplace_back([&] {
+				for (std::size_t run = nextRun.fetch_add(1); run < runs; run = nextRun.fetch_add(1)) {
+					Scenario seeded = scenario;
+					seeded.seed = scenario.seed + run;
+					concurrent[run] = Benchmark::runCooperative(catalog, seeded);
+				}
+				});
+		}
+		for (std::thread& thread : threads) thread.join();
+	}
+	std::chrono::duration<double> batchTime = std::chrono::steady_clock::now() - start;
+
+	bool allMatch = true;
+	double serialSeconds = 0.0;
+
+	for (std::size_t run = 0; run < runs; ++run) {
+		Scenario seeded = scenario;
+		seeded.seed = scenario.seed + run;
+		RunDigest serial = Benchmark::runCooperative(catalog, seeded);
+
+		serialSeconds += serial.wallSeconds;
+		allMatch = allMatch && serial.events == concurrent[run].events && serial.sessions == concurrent[run].sessions
+			&& serial.airTime == concurrent[run].airTime;
+	}
+
+	std::cout << std::left << std::setw(8) << "runs" << std::setw(10) << "threads" << std::setw(16) << "batch seconds"
+		<< std::setw(16) << "serial seconds" << std::setw(12) << "speedup" << std::setw(12) << "runs/sec" << "matches serial" << "\n";
+	std::cout << std::left << std::setw(8) << runs << std::setw(10) << numThreads << std::setw(16) << batchTime.count()
+		<< std::setw(16) << serialSeconds << std::setw(12) << serialSeconds / batchTime.count()
+		<< std::setw(12) << runs / batchTime.count() << (allMatch ? "yes" : "NO") << "\n";
+
+	return allMatch ? 0 : 2;
+}
+
+
+int Benchmark::runSessionMetrics(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t passes) {
+	/*
+	* Runs the scenario once so that every aircraft holds a real session, then evaluates the session summary
+	* of the whole fleet the given number of times, once through the former virtual dispatch and once through
+	* the inlined profile. With the built-in catalog the compile-time profiles are measured as well.
+	*/
+
+	Simulation simulation(catalog);
+	simulation.setSeed(scenario.seed);
+
+	Scheduler scheduler;
+
+	ChargingStation::InitializeChargers(simulation, scenario.chargers, scenario.sites, scheduler);
+	FleetManager::InitializeFleet(simulation, scenario.aircraft, scheduler);
+	scheduler.runFor(scenario.duration);
+	FleetManager::stopSimulation(simulation);
+
+	const Simulation::FleetList& fleet = simulation.getFleet();
+
+	std::vector<std::size_t> fleetSizes(catalog->size(), 0);
+	for (const std::shared_ptr<evTOL>& aircraft : fleet) ++fleetSizes[aircraft->getManufacturerIndex()];
+
+	std::vector<std::unique_ptr<VirtualSessionSummary>> summaries;
+	for (const std::shared_ptr<evTOL>& aircraft : fleet) {
+		summaries.push_back(std::make_unique<FleetSessionSummary>(*aircraft, fleetSizes[aircraft->getManufacturerIndex()]));
+	}
+
+	struct Measurement {
+		const char* variant;
+		double seconds;
+		double checksum;
+		std::size_t nameLength;
+	};
+
+	auto measure = [&](const char* variant, auto&& summarize) {
+		// The name lengths are summed so that the name lookup cannot be optimised away
+		Measurement measurement{ variant, 0.0, 0.0, 0 };
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (std::size_t pass = 0; pass < passes; ++pass) {
+			for (std::size_t i = 0; i < fleet.size(); ++i) measurement.checksum += summarize(i, measurement.nameLength);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		measurement.seconds = elapsed.count();
+		return measurement;
+	};
+
+	std::vector<Measurement> measurements;
+
+	measurements.push_back(measure("virtual", [&](std::size_t i, std::size_t& nameLength) {
+		const VirtualSessionSummary& summary = *summaries[i];
+		nameLength += summary.getManufacturerName().size();
+		return summary.getMilesPerSession() + summary.getFaultsPerSession() + summary.getPassengerMiles();
+		}));
+
+	measurements.push_back(measure("profile", [&](std::size_t i, std::size_t& nameLength) {
+		const evTOL& aircraft = *fleet[i];
+		nameLength += aircraft.getManufacturerName().size();
+		return aircraft.getMilesPerSession() + aircraft.getFaultsPerSession() + aircraft.getPassengerMiles();
+		}));
+
+	if (catalog->isBuiltin()) {
+		measurements.push_back(measure("constexpr", [&](std::size_t i, std::size_t& nameLength) {
+			const evTOL& aircraft = *fleet[i];
+			std::size_t manufacturer = aircraft.getManufacturerIndex();
+			nameLength += aircraft.getManufacturerName().size();
+			return builtinSummary(manufacturer, aircraft.getAirTime().count(), fleetSizes[manufacturer], std::make_index_sequence<BuiltinManufacturerCount>{});
+			}));
+	}
+
+	std::size_t sessions = passes * fleet.size();
+	bool allMatch = true;
+
+	std::cout << std::left << std::setw(12) << "variant" << std::setw(14) << "sessions" << std::setw(14) << "ns/session"
+		<< std::setw(12) << "speedup" << "matches virtual" << "\n";
+
+	for (const Measurement& measurement : measurements) {
+		bool match = measurement.checksum == measurements.front().checksum && measurement.nameLength == measurements.front().nameLength;
+		allMatch = allMatch && match;
+
+		std::cout << std::left << std::setw(12) << measurement.variant << std::setw(14) << sessions
+			<< std::setw(14) << measurement.seconds * 1e9 / std::max<std::size_t>(sessions, 1)
+			<< std::setw(12) << measurements.front().seconds / measurement.seconds
+			<< (match ? "yes" : "NO") << "\n";
+	}
+
+	return allMatch ? 0 : 2;
+}
+
+
+int Benchmark::runChargingReplay(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, const std::vector<TraceArrival>& trace,
+	double acceleration) {
+	/*
+	* Drives only the charging network: the chargers of the scenario serve the traced requests on a
+	* cooperative scheduler, without any flights. The scheduler runs until the last charge completes.
+	* Latencies are in simulated time; requests/sec is sustained wall-clock throughput.
+	*/
+
+	Simulation simulation(catalog);
+	simulation.getMetrics().registerManufacturers(catalog->getManufacturerNames());
+
+	Scheduler scheduler;
+	ReplayState state;
+
+	ChargingStation::InitializeChargers(simulation, scenario.chargers, scenario.sites, scheduler);
+	scheduler.spawn(replayArrivals(simulation, scheduler, trace, acceleration, state), Scheduler::makeKey(TaskGroup::Aircraft, 0));
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::size_t events = 0;
+	do {
+		events += scheduler.runFor(std::chrono::hours(24));
+	} while (scheduler.pendingEvents() > 0);
+	std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - start;
+
+	collectCompleted(state);
+	FleetManager::stopSimulation(simulation);
+
+	std::vector<double>& latencies = state.latencies;
+	auto percentile = [&latencies](double fraction) {
+		if (latencies.empty()) return 0.0;
+		std::vector<double>::iterator nth = latencies.begin() + static_cast<std::ptrdiff_t>(fraction * (latencies.size() - 1));
+		std::nth_element(latencies.begin(), nth, latencies.end());
+		return *nth;
+	};
+
+	double meanLatency = 0.0;
+	for (double latency : latencies) meanLatency += latency / latencies.size();
+
+	std::cout << "Replaying " << trace.size() << " requests over " << std::chrono::duration<double, std::ratio<3600>>(trace.back().arrival).count()
+		<< " simulated hours on " << scenario.chargers << " chargers at " << scenario.sites << " vertiports, ";
+	if (acceleration > 0.0) std::cout << acceleration << "x real time\n";
+	else std::cout << "as fast as possible\n";
+
+	std::cout << std::left << std::setw(12) << "requests" << std::setw(12) << "completed" << std::setw(14) << "seconds"
+		<< std::setw(14) << "requests/sec" << std::setw(12) << "events" << "max queue" << "\n";
+	std::cout << std::left << std::setw(12) << trace.size() << std::setw(12) << latencies.size() << std::setw(14) << wallTime.count()
+		<< std::setw(14) << static_cast<std::size_t>(latencies.size() / wallTime.count()) << std::setw(12) << events << state.maxQueueDepth << "\n";
+
+	std::cout << std::left << std::setw(12) << "latency (s)" << std::setw(12) << "mean" << std::setw(12) << "p50"
+		<< std::setw(12) << "p99" << "max" << "\n";
+	std::cout << std::left << std::setw(12) << "" << std::setw(12) << meanLatency << std::setw(12) << percentile(0.5)
+		<< std::setw(12) << percentile(0.99) << percentile(1.0) << "\n";
+
+	return latencies.size() == trace.size() ? 0 : 2;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+struct FleetCatalog;
+class Simulation;
+struct TraceArrival;
+
+/*
+* Benchmarks and run digests for the event-driven simulation modes.
+*
+* A run digest summarises the outcome of a simulation (events processed, flight sessions and airtime
+* over the whole fleet); the benchmarks compare digests, and every run reports them through the library API.
+* Each benchmark run is its own Simulation in this process, sharing one parsed catalog, so no run pays
+* for a process launch or for reading the input data again.
+*/
+
+struct RunDigest {
+	std::size_t events = 0;					// Events processed by the scheduler(s)
+	std::size_t sessions = 0;				// Flight sessions completed across the fleet
+	double airTime = 0.0;					// Airtime in seconds accumulated across the fleet
+	double wallSeconds = 0.0;				// Wall-clock time taken by the run
+};
+
+
+struct Scenario {
+	std::size_t aircraft = 20;				// Aircraft in the fleet
+	std::size_t chargers = 3;				// Chargers in the network
+	std::size_t sites = 1;					// Vertiports the chargers are spread over
+	std::chrono::microseconds duration = std::chrono::hours(24);	// Simulated duration
+	std::uint64_t seed = 1;					// Seed of the fleet composition
+};
+
+
+class Benchmark {
+public:
+	static RunDigest digestFleet(const Simulation& simulation, std::size_t events, double wallSeconds);	// Build the digest of a fleet that has run
+
+	static RunDigest runCooperative(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario);						// Run a scenario on one scheduler
+	static RunDigest runParallel(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t workers);	// Run a scenario on a parallel scheduler
+
+	static int runParallelScaling(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t maxWorkers);	// Compare serial and 1..N worker runs
+	static int runConcurrentBatch(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t runs);		// Run independent simulations side by side
+	static int runSessionMetrics(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, std::size_t passes);		// Cost of the per-session summary per dispatch
+
+	// Feed the chargers of the scenario from an arrival trace; acceleration is simulated seconds per wall second, 0 for as fast as possible
+	static int runChargingReplay(const std::shared_ptr<const FleetCatalog>& catalog, const Scenario& scenario, const std::vector<TraceArrival>& trace, double acceleration);
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+#include "FleetCatalog.h"
+#include "AircraftProfile.h"
+
+
+/*
+* The manufacturers of Manufacturer.json, compiled into the program.
+*
+* Runs that use this catalog (catalog path "builtin") need no input file at all. Because the specs are
+* constexpr, a profile built from them is a compile-time constant and its metrics fold away entirely;
+* BuiltinAircraft<M> exposes that profile for manufacturer M.
+*
+* The table is kept in step with Manufacturer.json by hand. Building SimpleSimulator checks the two with
+* "--check-builtin Manufacturer.json" once it is linked, and fails on the first field that differs.
+*/
+
+inline constexpr ManufacturerSpec BuiltinManufacturers[] = {
+	//	Name		Speed	Seats	Battery		Reserved	kWh/mile	Faults/h	Charge (h)
+	{ "Alpha",		120,	4,		320,		0,			1.6,		0.25,		0.6 },
+	{ "Bravo",		100,	5,		100,		0,			1.5,		0.10,		0.2 },
+	{ "Charlie",	160,	3,		220,		0,			2.2,		0.05,		0.8 },
+	{ "Delta",		90,		2,		120,		0,			0.8,		0.22,		0.62 },
+	{ "Echo",		30,		2,		150,		0,			5.8,		0.61,		0.3 }
+};
+
+inline constexpr std::size_t BuiltinManufacturerCount = sizeof(BuiltinManufacturers) / sizeof(BuiltinManufacturers[0]);
+
+
+template <std::size_t Manufacturer>
+struct BuiltinAircraft {
+	static_assert(Manufacturer < BuiltinManufacturerCount, "No such built-in manufacturer");
+
+	static constexpr const ManufacturerSpec& spec = BuiltinManufacturers[Manufacturer];
+	static constexpr AircraftProfile profile = AircraftProfile::of(BuiltinManufacturers[Manufacturer]);
+};
+
+// One hour of flight of Alpha covers its cruise speed in miles
+static_assert(BuiltinAircraft<0>::profile.milesPerSession(3600.0) == 120.0, "Built-in profiles evaluate at compile time");
@@ -0,0 +1,192 @@
+#include <string>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Vertiport.h"
+#include "Simulation.h"
+#include "ChargerPool.h"
+#include "ChargingStation.h"
+
+
+namespace {
+
+	constexpr Scheduler::SimDuration Day = std::chrono::hours(24);		// Period of the capacity schedule
+
+}
+
+
+ChargerPool::ChargerPool(Simulation& simulation, const ChargerPoolConfig& config) :
+	simulation(simulation),
+	config(config)
+{
+	const std::size_t numSites = simulation.getSiteCount();
+	std::size_t numChargers = 0;
+
+	initialChargers.reserve(numSites);
+	for (std::size_t s = 0; s < numSites; ++s) {
+		initialChargers.push_back(simulation.getSite(s).getChargerCount());
+		numChargers += initialChargers.back();
+	}
+
+	for (std::size_t step = 0; step < config.schedule.size(); ++step) {
+		const CapacityStep& current = config.schedule[step];
+
+		if (current.timeOfDay < Scheduler::SimDuration::zero() || current.timeOfDay >= Day) throw std::invalid_argument("Capacity steps must fall within a day.");
+		if (step > 0 && current.timeOfDay <= config.schedule[step - 1].timeOfDay) throw std::invalid_argument("Capacity steps must be in order of time.");
+		if (current.chargers < numSites) throw std::invalid_argument("Every vertiport needs at least one charger.");
+	}
+
+	if (config.scaleUpWait > Scheduler::SimDuration::zero()) {
+		if (config.checkInterval <= Scheduler::SimDuration::zero()) throw std::invalid_argument("Scaling on load needs a positive check interval.");
+		if (config.maxChargers < numChargers) throw std::invalid_argument("The maximum number of chargers is below the current pool.");
+	}
+	else if (config.schedule.empty()) {
+		throw std::invalid_argument("The charger pool needs a schedule or a wait to scale on.");
+	}
+}
+
+
+void ChargerPool::Initialize(Simulation& simulation, const ChargerPoolConfig& config) {
+	if (simulation.chargerPool) throw std::logic_error("The charger pool already has a controller.");
+
+	Scheduler& scheduler = simulation.getChargingScheduler();
+	simulation.chargerPool = std::make_unique<ChargerPool>(simulation, config);
+
+	scheduler.spawn(simulation.chargerPool->controlTask(scheduler), Scheduler::makeKey(TaskGroup::Capacity, 0));
+}
+
+
+void ChargerPool::resize(Simulation& simulation, std::size_t siteID, std::size_t chargers, std::chrono::time_point<std::chrono::system_clock> now) {
+	if (siteID >= simulation.getSiteCount()) throw std::out_of_range("The charging network has no such vertiport.");
+	if (chargers == 0) throw std::invalid_argument("Every vertiport needs at least one charger.");
+
+	Vertiport& site = simulation.getSite(siteID);
+	std::size_t current = site.getChargerCount();
+
+	for (std::size_t charger = current; charger < chargers; ++charger) ChargingStation::addCharger(simulation, site);
+	for (std::size_t charger = chargers; charger < current; ++charger) ChargingStation::retireCharger(simulation, site);
+
+	if (chargers != current) site.recordResize((chargers > current) ? chargers - current : 0, (current > chargers) ? current - chargers : 0, now);
+}
+
+
+bool ChargerPool::isResized(const Simulation& simulation) {
+	if (simulation.chargerPool) return true;
+
+	for (std::size_t s = 0; s < simulation.getSiteCount(); ++s) {
+		CapacityStats stats = simulation.getSite(s).getCapacityStats();
+		if (stats.added > 0 || stats.retired > 0) return true;
+	}
+
+	return false;
+}
+
+
+void ChargerPool::printReport(const Simulation& simulation, std::ostream& out) {
+	CapacityStats network;
+	std::size_t numChargers = 0;
+
+	auto printRow = [&out](const std::string& name, std::size_t chargers, const CapacityStats& stats) {
+		double drains = static_cast<double>(std::max<std::size_t>(stats.drains, 1));
+
+		out << std::left << std::setw(12) << name << std::right << std::setw(10) << chargers << std::setw(10) << stats.added
+			<< std::setw(10) << stats.retired << std::setw(10) << stats.drains << std::fixed << std::setprecision(2)
+			<< std::setw(20) << stats.drainSeconds / drains / 60.0 << std::setw(20) << stats.maxDrainSeconds / 60.0 << std::defaultfloat << "\n";
+	};
+
+	out << "\n" << "Charger pool" << "\n";
+	out << std::left << std::setw(12) << "Vertiport" << std::right << std::setw(10) << "Chargers" << std::setw(10) << "Added"
+		<< std::setw(10) << "Retired" << std::setw(10) << "Drains" << std::setw(20) << "Mean drain (min)" << std::setw(20) << "Max drain (min)" << "\n";
+
+	for (std::size_t s = 0; s < simulation.getSiteCount(); ++s) {
+		const Vertiport& site = simulation.getSite(s);
+		CapacityStats stats = site.getCapacityStats();
+
+		printRow(std::to_string(s), site.getChargerCount(), stats);
+
+		numChargers += site.getChargerCount();
+		network.added += stats.added;
+		network.retired += stats.retired;
+		network.drains += stats.drains;
+		network.drainSeconds += stats.drainSeconds;
+		network.maxDrainSeconds = std::max(network.maxDrainSeconds, stats.maxDrainSeconds);
+	}
+
+	printRow("Network", numChargers, network);
+}
+
+
+Task ChargerPool::controlTask(Scheduler& scheduler) {
+	while (!simulation.chargersStopped.load()) {
+		adjust(scheduler);
+		co_await scheduler.sleepFor(nextCheck(scheduler.elapsed()) - scheduler.elapsed());
+	}
+}
+
+
+void ChargerPool::adjust(Scheduler& scheduler) {
+	/*
+	* A vertiport below its scheduled capacity is brought up to it at once. Above it, a vertiport on a
+	* schedule alone is brought down at once too, its busy chargers retiring as they finish. When scaling
+	* on load, the chargers added for the load are kept until the queue is empty, and then retired one per
+	* check while another charger would still be idle, so that a short lull does not undo a scale-up.
+	*/
+
+	const bool scaling = config.scaleUpWait > Scheduler::SimDuration::zero();
+	const Scheduler::SimDuration now = scheduler.elapsed();
+
+	std::size_t numChargers = 0;
+	for (std::size_t s = 0; s < simulation.getSiteCount(); ++s) numChargers += simulation.getSite(s).getChargerCount();
+
+	for (std::size_t s = 0; s < simulation.getSiteCount(); ++s) {
+		Vertiport& site = simulation.getSite(s);
+		std::size_t current = site.getChargerCount();
+		std::size_t baseline = baselineOf(s, now);
+		std::size_t target = current;
+
+		if (current < baseline) target = baseline;
+		else if (scaling && site.getExpectedWait() > config.scaleUpWait && numChargers < config.maxChargers) target = current + 1;
+		else if (current > baseline && !scaling) target = baseline;
+		else if (current > baseline && site.getQueueDepth() == 0 && site.getBusyChargers() + 1 < current) target = current - 1;
+
+		if (target == current) continue;
+
+		numChargers = numChargers + target - current;
+		resize(simulation, s, target, scheduler.now());
+	}
+}
+
+
+std::size_t ChargerPool::baselineOf(std::size_t siteID, Scheduler::SimDuration now) const {
+	if (config.schedule.empty()) return initialChargers[siteID];
+
+	// Before the first step of a day the last step of the previous day still holds
+	Scheduler::SimDuration timeOfDay = now % Day;
+	const CapacityStep* step = &config.schedule.back();
+	for (const CapacityStep& candidate : config.schedule) {
+		if (candidate.timeOfDay <= timeOfDay) step = &candidate;
+	}
+
+	// Dealt like the initial pool: the vertiports differ by at most one charger, the lower IDs getting more
+	std::size_t numSites = initialChargers.size();
+	return step->chargers / numSites + ((siteID < step->chargers % numSites) ? 1 : 0);
+}
+
+
+Scheduler::SimDuration ChargerPool::nextCheck(Scheduler::SimDuration now) const {
+	Scheduler::SimDuration next = Scheduler::SimDuration::max();
+
+	if (config.scaleUpWait > Scheduler::SimDuration::zero()) next = (now / config.checkInterval + 1) * config.checkInterval;
+
+	if (!config.schedule.empty()) {
+		Scheduler::SimDuration startOfDay = now - now % Day;
+		auto step = std::find_if(config.schedule.begin(), config.schedule.end(), [&](const CapacityStep& candidate) {
+			return startOfDay + candidate.timeOfDay > now;
+			});
+
+		next = std::min(next, (step != config.schedule.end()) ? startOfDay + step->timeOfDay : startOfDay + Day + config.schedule.front().timeOfDay);
+	}
+
+	return next;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+#include "Scheduler.h"
+
+
+class Simulation;
+
+/*
+* Elastic pool of chargers.
+*
+* The chargers of a vertiport can be added and retired while the simulation runs. An added charger starts
+* taking requests from the queue of its vertiport right away. A retired charger finishes the ticket it
+* holds and takes no further ones, so resizing never drops or restarts a charge in progress.
+*
+* In the event-driven modes a controller on the charging scheduler can resize the pool on its own:
+*   - a schedule sets the chargers of the network by time of day, counted from the start of the run and
+*     repeated every simulated day, and dealt over the vertiports like the initial pool;
+*   - scaling on load adds a charger to a vertiport whose expected wait is above a threshold, up to a
+*     maximum for the network, and retires chargers above the scheduled capacity one at a time once the
+*     queue of their vertiport is empty.
+* The controller resizes the pool between events on the same scheduler as the chargers, so a seeded run
+* gives the same result on any number of workers.
+*/
+
+struct CapacityStep {
+	Scheduler::SimDuration timeOfDay;			// Time into the simulated day the step starts at
+	std::size_t chargers;						// Chargers of the network from then on
+};
+
+
+struct ChargerPoolConfig {
+	std::vector<CapacityStep> schedule;			// Capacity by time of day, in order of time; empty keeps the initial pool
+	Scheduler::SimDuration scaleUpWait;			// Expected wait at a vertiport that adds a charger there, zero to not scale on load
+	std::size_t maxChargers;					// Chargers the network may scale up to on load
+	Scheduler::SimDuration checkInterval;		// Simulated time between two checks of the queues when scaling on load
+};
+
+
+class ChargerPool {
+public:
+	ChargerPool(Simulation& simulation, const ChargerPoolConfig& config);	// Validate the config against the network
+
+	ChargerPool(const ChargerPool& other) = delete;						// Copy constructor
+	ChargerPool& operator=(const ChargerPool& other) = delete;			// Copy assignment
+
+	// Create the controller of a simulation and start it on the charging scheduler
+	static void Initialize(Simulation& simulation, const ChargerPoolConfig& config);
+
+	// Add or retire chargers until a vertiport has the given number; the time is that of the simulation
+	static void resize(Simulation& simulation, std::size_t siteID, std::size_t chargers, std::chrono::time_point<std::chrono::system_clock> now);
+
+	static bool isResized(const Simulation& simulation);						// Check if the pool has been resized or is controlled
+	static void printReport(const Simulation& simulation, std::ostream& out);	// Print the resizes and queue drains of every vertiport
+
+private:
+	Task controlTask(Scheduler& scheduler);								// Apply the schedule and the load checks
+	void adjust(Scheduler& scheduler);									// Resize every vertiport for the time of the scheduler
+	std::size_t baselineOf(std::size_t siteID, Scheduler::SimDuration now) const;	// Chargers a vertiport has without load
+	Scheduler::SimDuration nextCheck(Scheduler::SimDuration now) const;	// Simulated time of the next step or load check
+
+	Simulation& simulation;												// Simulation the pool belongs to
+	ChargerPoolConfig config;											// Schedule and scaling of the pool
+	std::vector<std::size_t> initialChargers;							// Chargers of every vertiport when the controller started
+};
@@ -1,16 +1,14 @@
 #include <chrono>
 #include <random>
 #include <algorithm>
+#include <stdexcept>
 
 #include "DataLogger.h"
+#include "TimerWheel.h"
+#include "Simulation.h"
+#include "ScopeTimers.h"
 #include "ChargingStation.h"
-
-
-std::mutex ChargingStation::chargerMtx;
-std::once_flag ChargingStation::initialized;
-std::atomic<bool> ChargingStation::simulationComplete{ false };
-std::condition_variable ChargingStation::requestManagerNotification;
-std::vector<std::unique_ptr<ChargingStation>> ChargingStation::chargerInstances = {};
+#include "ThreadPlacement.h"
 
 
 template<typename ...Args>
@@ -25,65 +23,154 @@ inline std::unique_ptr<ChargingStation> ChargingStation::createInstance(Args &&
 }
 
 
-void ChargingStation::InitializeChargers(std::size_t numChargers) {
-	ChargingStation::chargerInstances.reserve(numChargers);
+void ChargingStation::InitializeChargers(Simulation& simulation, std::size_t numChargers, std::size_t numSites) {
+	/*
+	* Chargers are dealt round-robin over the vertiports, so that every site gets its own pool
+	* and the pools differ in size by at most one charger.
+	*/
+
+	simulation.chargerInstances.reserve(numChargers);
+
+	std::call_once(simulation.chargersInitialized, [&simulation, &numChargers, &numSites] {
+		simulation.getTimerWheel();
+		Vertiport::InitializeNetwork(simulation, numSites, nullptr);
+
+		for (std::size_t charger = 0; charger < numChargers; charger++) {
+			Vertiport& site = simulation.getSite(charger % numSites);
+			site.addCharger();
+			simulation.chargerInstances.emplace_back(ChargingStation::createInstance(charger, site, simulation));
+		}
+		});
+}
+
+
+void ChargingStation::InitializeChargers(Simulation& simulation, std::size_t numChargers, std::size_t numSites, Scheduler& scheduler) {
+	simulation.chargerInstances.reserve(numChargers);
+
+	std::call_once(simulation.chargersInitialized, [&simulation, &numChargers, &numSites, &scheduler] {
+		simulation.chargingScheduler = &scheduler;
+		Vertiport::InitializeNetwork(simulation, numSites, &scheduler);
 
-	std::call_once(ChargingStation::initialized, [&numChargers] {
 		for (std::size_t charger = 0; charger < numChargers; charger++) {
-			ChargingStation::chargerInstances.emplace_back(ChargingStation::createInstance(charger));
+			Vertiport& site = simulation.getSite(charger % numSites);
+			site.addCharger();
+			simulation.chargerInstances.emplace_back(ChargingStation::createInstance(charger, site, simulation, scheduler));
 		}
 		});
 }
 
 
-void ChargingStation::stopSimulation() {
-	ChargingStation::simulationComplete.store(true);
+void ChargingStation::stopSimulation(Simulation& simulation) {
+	simulation.chargersStopped.store(true);
 
-	ChargingStation::requestManagerNotification.notify_all();
+	Vertiport::notifyAll(simulation);
+	if (simulation.timerWheel) simulation.timerWheel->expireAll();
 
-	for (std::unique_ptr<ChargingStation>& charger : ChargingStation::chargerInstances) {
+	for (std::unique_ptr<ChargingStation>& charger : simulation.chargerInstances) {
 		if (charger->chargingThread.joinable()) charger->chargingThread.join();
 	}
 }
 
 
+void ChargingStation::addCharger(Simulation& simulation, Vertiport& site) {
+	/*
+	* Chargers are numbered in order of creation and never reused, so an added charger gets the next
+	* number and a timeline track and task key of its own. It runs like the chargers of the initial pool:
+	* on the charging scheduler if there is one, on a thread of its own otherwise.
+	*/
+
+	std::size_t chargerID = simulation.chargerInstances.size();
+	site.addCharger();
+
+	if (simulation.chargingScheduler != nullptr) {
+		simulation.chargerInstances.emplace_back(ChargingStation::createInstance(chargerID, site, simulation, *simulation.chargingScheduler));
+	}
+	else {
+		simulation.chargerInstances.emplace_back(ChargingStation::createInstance(chargerID, site, simulation));
+	}
+}
+
+
+void ChargingStation::retireCharger(Simulation& simulation, Vertiport& site) {
+	/*
+	* The most recently added idle charger of the site is retired, or the most recently added busy one
+	* if none is idle. A busy charger completes the ticket it holds before it stops, so no request is
+	* lost; the site counts one charger less from now on, so no new requests are routed to it.
+	*/
+
+	if (site.getChargerCount() <= 1) throw std::logic_error("Every vertiport needs at least one charger.");
+
+	ChargingStation* retired = nullptr;
+
+	for (auto charger = simulation.chargerInstances.rbegin(); charger != simulation.chargerInstances.rend(); ++charger) {
+		if (&(*charger)->site != &site || (*charger)->retiring.load()) continue;
+		if (retired == nullptr || !(*charger)->isCharging.load()) retired = charger->get();
+		if (!retired->isCharging.load()) break;
+	}
+
+	if (retired == nullptr) throw std::logic_error("The vertiport has no charger to retire.");
+
+	retired->retiring.store(true);
+	site.removeCharger();
+
+	// Waiting chargers of the site wake up, find nothing new to do and wait again, except the retired one
+	if (site.getScheduler() != nullptr) {
+		site.getRequestAvailable().set();
+	}
+	else {
+		std::lock_guard<std::mutex> lock(site.getChargerMutex());
+		site.getRequestNotification().notify_all();
+	}
+}
+
+
 void ChargingStation::lookForRequests() { 
-	while (!ChargingStation::simulationComplete.load()) {
+	ThreadPlacement::Scope placement(ThreadRole::Charger, chargingStationID);
+
+	while (!simulation.chargersStopped.load() && !retiring.load()) {
 		std::shared_ptr<RequestManager> request = nullptr;
 
 		{
-			std::unique_lock<std::mutex> lock(ChargingStation::chargerMtx);
-			ChargingStation::requestManagerNotification.wait(lock, [&] {
-				bool found = false;
-				std::size_t newRequests = RequestManager::newRequestAvailable();
-				if (newRequests > 0 && !isCharging.load()) found = true;
-
-				return (found || ChargingStation::simulationComplete.load());
-
-				});
+			TIMED_SCOPE(QueueHandling);
+			std::unique_lock<std::mutex> lock(site.getChargerMutex());
+			{
+				TIMED_SCOPE(Waiting);
+				site.getRequestNotification().wait(lock, [&] {
+					bool found = false;
+					std::size_t newRequests = site.newRequestAvailable();
+					if (newRequests > 0 && !isCharging.load()) found = true;
+
+					return (found || simulation.chargersStopped.load() || retiring.load());
+
+					});
+			}
 
-			if (!isCharging.load() && (RequestManager::newRequestAvailable() > 0)) {
-				request = RequestManager::fetchFirstInLIne();
+			if (!isCharging.load() && !retiring.load() && (site.newRequestAvailable() > 0)) {
+				request = site.fetchFirstInLine();
 				std::shared_ptr<DataLogger> logger = DataLogger::getInstance(request->getAircraft());
-				logger->logData("Charger " + std::to_string(chargingStationID)
+				logger->logData("Charger " + std::to_string(chargingStationID) + " at vertiport " + std::to_string(site.getSiteID())
 					+ " has received a request for ticket number: " + request->getTicketNumber());
 
 				isCharging.store(true);
 			}
 		}
 
-		if (ChargingStation::simulationComplete.load()) {
+		if (simulation.chargersStopped.load()) {
 			if (request) request->getAircraft()->getAircraftCV().notify_all();
 			break;
 		}
 
 		else if (isCharging.load() && request != nullptr) {
+			TIMED_SCOPE(Charging);
 			std::shared_ptr<DataLogger> logger = DataLogger::getInstance(request->getAircraft());
 			logger->logData("Charger " + std::to_string(chargingStationID) + " is now charging ticket number: " + request->getTicketNumber());
 
 			std::chrono::microseconds chargingTime = request->getAircraft()->getTimeToCharge();
 			logger->logData("Charging time for ticket number: " + request->getTicketNumber() + " is: " + std::to_string(chargingTime.count()) + " microseconds.");
-			std::this_thread::sleep_for(chargingTime);
+			{
+				TIMED_SCOPE(Waiting);
+				simulation.getTimerWheel().sleepFor(chargingTime, simulation.chargersStopped);
+			}
 
 			request->updateEndTime();
 			logger->logData("Time at charger has expired for ticket number: " + request->getTicketNumber());
@@ -91,6 +178,7 @@ void ChargingStation::lookForRequests() {
 			RequestManager::reportChargingStatus(request);
 			logger->logData("Charging status for ticket number: " + request->getTicketNumber() + " has been reported.");
 
+			site.chargingFinished(request, chargingStationID);
 			isCharging.store(false);
 			logger->logData("Charger " + std::to_string(chargingStationID) + " is now free.");
 		}
@@ -98,6 +186,69 @@ void ChargingStation::lookForRequests() {
 }
 
 
+Task ChargingStation::chargerTask(Scheduler& scheduler, bool resumeCharging) {
+	/*
+	* Cooperative counterpart of lookForRequests(). The charger suspends on requestAvailable while
+	* the queue is empty, and on the scheduler for the duration of each charge. Only one coroutine
+	* runs at a time, so taking a ticket from the queue needs no charger-side locking.
+	*
+	* A charger rebuilt from a checkpoint in the middle of a charge starts with resumeCharging set
+	* and its first resumption completes the charge of activeRequest. A retired charger returns once
+	* it is done with the charge it was on.
+	*/
+
+	while (resumeCharging || (!simulation.chargersStopped.load() && !retiring.load())) {
+		if (!resumeCharging) {
+			if (site.newRequestAvailable() == 0) {
+				site.getRequestAvailable().reset();
+				co_await site.getRequestAvailable();
+				continue;
+			}
+
+			// The charge is a co_await, so the queue handling is timed up to it and the charging from its end
+			Scheduler::SimDuration chargingTime{};
+			{
+				TIMED_SCOPE(QueueHandling);
+				activeRequest = site.fetchFirstInLine();
+				std::shared_ptr<DataLogger> logger = DataLogger::getInstance(activeRequest->getAircraft());
+				logger->logData("Charger " + std::to_string(chargingStationID) + " at vertiport " + std::to_string(site.getSiteID())
+					+ " has received a request for ticket number: " + activeRequest->getTicketNumber());
+
+				isCharging.store(true);
+				activeRequest->chargerAssigned().set();
+
+				chargingTime = activeRequest->getAircraft()->getChargeDuration();
+				logger->logData("Charging time for ticket number: " + activeRequest->getTicketNumber() + " is: " + std::to_string(chargingTime.count()) + " simulated microseconds.");
+			}
+			co_await scheduler.sleepFor(chargingTime);
+		}
+
+		{
+			TIMED_SCOPE(Charging);
+			std::shared_ptr<RequestManager> request = std::move(activeRequest);
+			std::shared_ptr<DataLogger> logger = DataLogger::getInstance(request->getAircraft());
+
+			request->completeCharging();
+			logger->logData("Charging status for ticket number: " + request->getTicketNumber() + " has been reported.");
+
+			site.chargingFinished(request, chargingStationID);
+			isCharging.store(false);
+			logger->logData("Charger " + std::to_string(chargingStationID) + " is now free.");
+		}
+
+		resumeCharging = false;
+	}
+}
+
+
+ChargingStation& ChargingStation::restoreCharger(Simulation& simulation, std::size_t chargingStationID, Vertiport& site) {
+	site.addCharger();
+	simulation.chargerInstances.emplace_back(ChargingStation::createInstance(chargingStationID, site, simulation, nullptr));
+
+	return *simulation.chargerInstances.back();
+}
+
+
 int ChargingStation::randomChargeTimeGenerator() {
 	std::random_device rd;
 	std::mt19937 gen(rd());
@@ -109,9 +260,33 @@ int ChargingStation::randomChargeTimeGenerator() {
 }
 
 
-ChargingStation::ChargingStation(const std::size_t chargingStationID) : 
-	chargingStationID(chargingStationID) 
+ChargingStation::ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation) : 
+	chargingStationID(chargingStationID),
+	site(site),
+	simulation(simulation)
 {
 	isCharging.store(false);
+	retiring.store(false);
 	chargingThread = std::thread(&ChargingStation::lookForRequests, this);
-}
\ No newline at end of file
+}
+
+
+ChargingStation::ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation, Scheduler& scheduler) :
+	chargingStationID(chargingStationID),
+	site(site),
+	simulation(simulation)
+{
+	isCharging.store(false);
+	retiring.store(false);
+	scheduler.spawn(chargerTask(scheduler), Scheduler::makeKey(TaskGroup::Charger, chargingStationID));
+}
+
+
+ChargingStation::ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation, std::nullptr_t) :
+	chargingStationID(chargingStationID),
+	site(site),
+	simulation(simulation)
+{
+	isCharging.store(false);
+	retiring.store(false);
+}
@@ -10,17 +10,23 @@
 #include <condition_variable>
 
 #include "evTOL.h"
+#include "Scheduler.h"
+#include "Vertiport.h"
 #include "RequestManager.h"
 
 
+class Simulation;
+class Checkpoint;
 class RequestManager;
  
 class ChargingStation {
 public:
-	static void InitializeChargers(std::size_t numChargers);			// Initialize the charging stations
-	static void stopSimulation();										// Stop the simulation
+	static void InitializeChargers(Simulation& simulation, std::size_t numChargers, std::size_t numSites = 1);							// Initialize the charging stations
+	static void InitializeChargers(Simulation& simulation, std::size_t numChargers, std::size_t numSites, Scheduler& scheduler);		// Initialize the charging stations as coroutines
+	static void stopSimulation(Simulation& simulation);					// Stop the simulation
 
-	static std::condition_variable requestManagerNotification;			// Condition variable to notify the charging station of incoming requests
+	static void addCharger(Simulation& simulation, Vertiport& site);		// Start another charger at a vertiport while the simulation runs
+	static void retireCharger(Simulation& simulation, Vertiport& site);		// Retire a charger of a vertiport once it has finished its charge
 
 protected:
 	// ChargingStation Class object control methods
@@ -30,20 +36,25 @@ protected:
 	ChargingStation& operator= (const ChargingStation& other) = delete;		// Copy assignment operator
 
 	void lookForRequests();													// Look for incoming requests
+	Task chargerTask(Scheduler& scheduler, bool resumeCharging = false);	// Look for incoming requests as a coroutine
 	int randomChargeTimeGenerator();										// Generate random charging time
 
+	static ChargingStation& restoreCharger(Simulation& simulation, std::size_t chargingStationID, Vertiport& site);	// Add a charger rebuilt from a checkpoint, without a coroutine
+
 private:
-	ChargingStation(const std::size_t chargingStationID);			// Parametrized constructor
+	friend class Checkpoint;
+
+	ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation);							// Parametrized constructor
+	ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation, Scheduler& scheduler);	// Parametrized constructor for cooperative simulations
+	ChargingStation(const std::size_t chargingStationID, Vertiport& site, Simulation& simulation, std::nullptr_t);			// Parametrized constructor for a charger restored from a checkpoint
 	
 	std::thread chargingThread;						// Thread object that would manage the charging process
 	std::atomic<bool> isCharging;					// Flag to indicate if the charging station is in use
+	std::atomic<bool> retiring;						// Flag to indicate that the charger takes no further requests
 	std::size_t chargingStationID;					// Unique ID for each charging station	
-	
-	// Static data members
-	static std::mutex chargerMtx;											// Mutex to lock the charging station
-	static std::once_flag initialized;										// Flag to ensure that the charging station is initialized only once
-	static std::atomic<bool> simulationComplete;							// Flag to indicate that the simulation is complete
-	static std::vector<std::unique_ptr<ChargingStation>> chargerInstances;	// Vector of unique pointers to charging stations
+	Vertiport& site;								// Vertiport the charging station belongs to
+	Simulation& simulation;							// Simulation the charging station belongs to
+	std::shared_ptr<RequestManager> activeRequest;	// Request being charged by the charger coroutine, if any
 
 	// Template function to create unique pointer instance of ChargingStation class
 	template <typename... Args>
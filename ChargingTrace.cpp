@@ -0,0 +1,224 @@
+#include <array>
+#include <cmath>
+#include <cctype>
+#include <random>
+#include <string>
+#include <istream>
+#include <charconv>
+#include <fstream>
+#include <string_view>
+#include <algorithm>
+#include <stdexcept>
+
+#include "DataExport.h"
+#include "FleetCatalog.h"
+#include "ChargingTrace.h"
+
+
+namespace {
+
+	constexpr char TraceHeader[] = "arrival_seconds,manufacturer,charge_seconds";
+
+
+	// Split a CSV line into at most N fields; returns the number of fields found
+	template <std::size_t N>
+	std::size_t splitFields(const std::string& line, std::array<std::string_view, N>& fields) {
+		std::size_t count = 0;
+		std::size_t begin = 0;
+
+		while (count < N) {
+			std::size_t end = line.find(',', begin);
+			fields[count++] = std::string_view(line).substr(begin, (end == std::string::npos) ? std::string::npos : end - begin);
+			if (end == std::string::npos) break;
+			begin = end + 1;
+		}
+
+		return count;
+	}
+
+
+	template <typename T>
+	T parseNumber(std::string_view field, std::size_t lineNumber) {
+		while (!field.empty() && (field.back() == '\r' || field.back() == ' ')) field.remove_suffix(1);
+		while (!field.empty() && field.front() == ' ') field.remove_prefix(1);
+
+		T value{};
+		std::from_chars_result result = std::from_chars(field.data(), field.data() + field.size(), value);
+		if (result.ec != std::errc() || result.ptr != field.data() + field.size()) {
+			throw std::runtime_error("Trace line " + std::to_string(lineNumber) + ": invalid number '" + std::string(field) + "'");
+		}
+
+		return value;
+	}
+
+
+	std::chrono::microseconds secondsToMicroseconds(double seconds, std::size_t lineNumber) {
+		if (!std::isfinite(seconds) || seconds < 0.0) throw std::runtime_error("Trace line " + std::to_string(lineNumber) + ": times must be non-negative");
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>(seconds));
+	}
+
+}
+
+
+std::vector<TraceArrival> ChargingTrace::load(const std::filesystem::path& path, const FleetCatalog& catalog) {
+	if (path.extension() == ".evcol") return ChargingTrace::loadTicketsColumnar(path, catalog);
+
+	std::ifstream input(path);
+	if (!input.is_open()) throw std::runtime_error("Unable to open trace " + path.string());
+
+	std::string header;
+	std::getline(input, header);
+	if (!header.empty() && header.back() == '\r') header.pop_back();
+
+	std::vector<TraceArrival> arrivals;
+	if (header == TraceHeader) arrivals = ChargingTrace::loadTraceCsv(input, catalog);
+	else if (header.rfind("requested,started,finished", 0) == 0) arrivals = ChargingTrace::loadTicketsCsv(input, catalog);
+	else throw std::runtime_error(path.string() + " is neither a trace nor exported tickets");
+
+	if (arrivals.empty()) throw std::runtime_error("Trace " + path.string() + " has no arrivals");
+
+	ChargingTrace::normalize(arrivals);
+	return arrivals;
+}
+
+
+void ChargingTrace::write(const std::filesystem::path& path, const std::vector<TraceArrival>& arrivals, const FleetCatalog& catalog) {
+	std::ofstream output(path, std::ios::trunc);
+	if (!output.is_open()) throw std::runtime_error("Unable to create trace " + path.string());
+
+	// Microsecond times are written exactly, so a trace reads back as it was generated
+	std::array<char, 32> field;
+	auto seconds = [&field](std::chrono::microseconds time) {
+		std::to_chars_result result = std::to_chars(field.data(), field.data() + field.size(), std::chrono::duration<double>(time).count());
+		return std::string_view(field.data(), result.ptr - field.data());
+	};
+
+	output << TraceHeader << "\n";
+	for (const TraceArrival& arrival : arrivals) {
+		output << seconds(arrival.arrival) << ',' << catalog.getManufacturerNames().at(arrival.manufacturer) << ',';
+		output << seconds(arrival.chargeTime) << "\n";
+	}
+
+	if (!output) throw std::runtime_error("Unable to write trace " + path.string());
+}
+
+
+std::vector<TraceArrival> ChargingTrace::synthesize(const FleetCatalog& catalog, std::size_t count, double arrivalsPerHour, std::uint64_t seed) {
+	if (!(arrivalsPerHour > 0.0)) throw std::invalid_argument("The arrival rate must be positive.");
+
+	std::mt19937_64 gen(seed);
+	std::exponential_distribution<double> gap(arrivalsPerHour / 3600.0);
+	std::uniform_int_distribution<std::size_t> manufacturer(0, catalog.size() - 1);
+
+	std::vector<TraceArrival> arrivals;
+	arrivals.reserve(count);
+
+	double clock = 0.0;
+	for (std::size_t i = 0; i < count; ++i) {
+		std::size_t index = manufacturer(gen);
+		std::chrono::duration<double, std::ratio<3600>> chargeTime(catalog.getSpec(index).timeToCharge);
+
+		arrivals.push_back(TraceArrival{
+			std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>(clock)),
+			std::chrono::duration_cast<std::chrono::microseconds>(chargeTime),
+			static_cast<std::uint32_t>(index) });
+
+		clock += gap(gen);
+	}
+
+	return arrivals;
+}
+
+
+double ChargingTrace::capacityPerHour(const FleetCatalog& catalog, std::size_t chargers) {
+	double meanChargeHours = 0.0;
+	for (std::size_t i = 0; i < catalog.size(); ++i) meanChargeHours += catalog.getSpec(i).timeToCharge / catalog.size();
+
+	return chargers / meanChargeHours;
+}
+
+
+std::vector<TraceArrival> ChargingTrace::loadTraceCsv(std::istream& input, const FleetCatalog& catalog) {
+	std::vector<TraceArrival> arrivals;
+	std::array<std::string_view, 3> fields;
+	std::string line;
+
+	for (std::size_t lineNumber = 2; std::getline(input, line); ++lineNumber) {
+		if (line.empty() || line == "\r" || line.front() == '#') continue;
+		if (splitFields(line, fields) != 3) throw std::runtime_error("Trace line " + std::to_string(lineNumber) + ": expected 3 fields");
+
+		// The manufacturer is given by name, or by position for traces produced elsewhere
+		std::string name(fields[1]);
+		const std::vector<std::string>& names = catalog.getManufacturerNames();
+		std::size_t manufacturer = (!name.empty() && std::isdigit(static_cast<unsigned char>(name.front())))
+			? parseNumber<std::size_t>(fields[1], lineNumber) : std::find(names.begin(), names.end(), name) - names.begin();
+		if (manufacturer >= catalog.size()) throw std::runtime_error("Trace line " + std::to_string(lineNumber) + ": unknown manufacturer " + name);
+
+		arrivals.push_back(TraceArrival{
+			secondsToMicroseconds(parseNumber<double>(fields[0], lineNumber), lineNumber),
+			secondsToMicroseconds(parseNumber<double>(fields[2], lineNumber), lineNumber),
+			static_cast<std::uint32_t>(manufacturer) });
+	}
+
+	return arrivals;
+}
+
+
+std::vector<TraceArrival> ChargingTrace::loadTicketsCsv(std::istream& input, const FleetCatalog& catalog) {
+	// requested,started,finished,aircraft,manufacturer,site in microseconds, as written by DataExport
+	std::vector<TraceArrival> arrivals;
+	std::array<std::string_view, 6> fields;
+	std::string line;
+
+	for (std::size_t lineNumber = 2; std::getline(input, line); ++lineNumber) {
+		if (line.empty() || line == "\r") continue;
+		if (splitFields(line, fields) != 6) throw std::runtime_error("Ticket line " + std::to_string(lineNumber) + ": expected 6 fields");
+
+		std::int64_t requested = parseNumber<std::int64_t>(fields[0], lineNumber);
+		std::int64_t started = parseNumber<std::int64_t>(fields[1], lineNumber);
+		std::int64_t finished = parseNumber<std::int64_t>(fields[2], lineNumber);
+		std::uint32_t manufacturer = parseNumber<std::uint32_t>(fields[4], lineNumber);
+		if (manufacturer >= catalog.size() || finished < started) throw std::runtime_error("Ticket line " + std::to_string(lineNumber) + " is inconsistent");
+
+		arrivals.push_back(TraceArrival{ std::chrono::microseconds(requested), std::chrono::microseconds(finished - started), manufacturer });
+	}
+
+	return arrivals;
+}
+
+
+std::vector<TraceArrival> ChargingTrace::loadTicketsColumnar(const std::filesystem::path& path, const FleetCatalog& catalog) {
+	ColumnarReader reader(path);
+	if (reader.getTable() != "tickets") throw std::runtime_error(path.string() + " does not hold exported tickets");
+
+	std::vector<TraceArrival> arrivals;
+	arrivals.reserve(static_cast<std::size_t>(reader.getRowCount()));
+
+	for (std::size_t chunk = 0; chunk < reader.getChunkCount(); ++chunk) {
+		const std::int64_t* requested = reader.column<std::int64_t>(chunk, "requested");
+		const std::int64_t* started = reader.column<std::int64_t>(chunk, "started");
+		const std::int64_t* finished = reader.column<std::int64_t>(chunk, "finished");
+		const std::uint16_t* manufacturer = reader.column<std::uint16_t>(chunk, "manufacturer");
+
+		for (std::uint64_t row = 0; row < reader.getChunkRows(chunk); ++row) {
+			if (manufacturer[row] >= catalog.size() || finished[row] < started[row]) throw std::runtime_error(path.string() + " has an inconsistent ticket");
+			arrivals.push_back(TraceArrival{ std::chrono::microseconds(requested[row]), std::chrono::microseconds(finished[row] - started[row]), manufacturer[row] });
+		}
+	}
+
+	if (arrivals.empty()) throw std::runtime_error("Trace " + path.string() + " has no arrivals");
+
+	ChargingTrace::normalize(arrivals);
+	return arrivals;
+}
+
+
+void ChargingTrace::normalize(std::vector<TraceArrival>& arrivals) {
+	// Exported tickets are in completion order; requests that arrived together keep their recorded order
+	std::stable_sort(arrivals.begin(), arrivals.end(), [](const TraceArrival& lhs, const TraceArrival& rhs) {
+		return lhs.arrival < rhs.arrival;
+		});
+
+	std::chrono::microseconds first = arrivals.front().arrival;
+	for (TraceArrival& arrival : arrivals) arrival.arrival -= first;
+}
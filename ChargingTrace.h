@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <filesystem>
+
+
+class FleetCatalog;
+
+/*
+* Arrival trace of charging requests, replayed against the charging network without simulating flights
+* (see Benchmark::runChargingReplay()).
+*
+* A trace is read from either of:
+*   - a trace file, CSV with the header "arrival_seconds,manufacturer,charge_seconds", one request per
+*     line; the manufacturer is its name or its position in the catalog, lines starting with '#' are skipped;
+*   - the tickets of a data export (tickets.csv or tickets.evcol), which records the arrivals and charge
+*     times of a full simulation.
+*
+* Arrivals are kept sorted and relative to the first one, so recorded and synthetic traces replay alike.
+*/
+
+struct TraceArrival {
+	std::chrono::microseconds arrival;		// Time the request is raised, from the start of the trace
+	std::chrono::microseconds chargeTime;	// Time a charger needs for the request
+	std::uint32_t manufacturer;				// Position of the manufacturer in the catalog
+};
+
+
+class ChargingTrace {
+public:
+	static std::vector<TraceArrival> load(const std::filesystem::path& path, const FleetCatalog& catalog);		// Read a trace file or exported tickets
+	static void write(const std::filesystem::path& path, const std::vector<TraceArrival>& arrivals, const FleetCatalog& catalog);	// Write a trace file
+
+	// Poisson arrivals of uniformly drawn manufacturers, each charging for its catalog charge time
+	static std::vector<TraceArrival> synthesize(const FleetCatalog& catalog, std::size_t count, double arrivalsPerHour, std::uint64_t seed);
+
+	static double capacityPerHour(const FleetCatalog& catalog, std::size_t chargers);	// Arrivals per hour the chargers can serve, averaged over the catalog
+
+private:
+	static std::vector<TraceArrival> loadTraceCsv(std::istream& input, const FleetCatalog& catalog);		// Parse a trace file after its header
+	static std::vector<TraceArrival> loadTicketsCsv(std::istream& input, const FleetCatalog& catalog);	// Parse exported tickets after their header
+	static std::vector<TraceArrival> loadTicketsColumnar(const std::filesystem::path& path, const FleetCatalog& catalog);	// Read exported columnar tickets
+
+	static void normalize(std::vector<TraceArrival>& arrivals);			// Sort the arrivals and make them relative to the first one
+};
@@ -0,0 +1,493 @@
+#include <queue>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "evTOL.h"
+#include "Vertiport.h"
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include "Simulation.h"
+#include "ChargerPool.h"
+#include "FleetManager.h"
+#include "SegmentedLog.h"
+#include "RequestManager.h"
+#include "ChargingStation.h"
+
+
+namespace {
+
+	constexpr std::size_t padded(std::size_t size) {
+		return (size + 7) & ~static_cast<std::size_t>(7);
+	}
+
+
+	std::int64_t ticksOf(const std::chrono::time_point<std::chrono::system_clock>& timePoint) {
+		return static_cast<std::int64_t>(timePoint.time_since_epoch().count());
+	}
+
+
+	std::chrono::time_point<std::chrono::system_clock> timePointOf(std::int64_t ticks) {
+		return std::chrono::time_point<std::chrono::system_clock>(std::chrono::system_clock::duration(ticks));
+	}
+
+
+	constexpr std::int64_t ClockTicksPerSecond = static_cast<std::int64_t>(std::chrono::system_clock::period::den / std::chrono::system_clock::period::num);
+
+}
+
+
+Checkpoint::Checkpoint(const std::filesystem::path& path) :
+	mapping(std::make_unique<MappedFile>(path)),
+	header(static_cast<const CheckpointHeader*>(mapping->data())),
+	layout{}
+{
+	std::size_t mappedSize = mapping->size();
+
+	if (mappedSize < sizeof(CheckpointHeader) || std::memcmp(header->magic, CheckpointHeader::Magic, sizeof(header->magic)) != 0) {
+		throw std::runtime_error(path.string() + " is not a checkpoint");
+	}
+	if (header->version != CheckpointHeader::Version || header->headerSize != sizeof(CheckpointHeader) || header->clockTicksPerSecond != ClockTicksPerSecond) {
+		throw std::runtime_error("Checkpoint " + path.string() + " was written by an incompatible version");
+	}
+	// Bounded first, so that the section offsets below cannot overflow
+	if (header->numSessions > mappedSize / (6 * sizeof(std::int64_t))) {
+		throw std::runtime_error("Checkpoint " + path.string() + " is truncated or corrupt");
+	}
+
+	layout = Checkpoint::layoutOf(*header);
+
+	if (mappedSize != layout.size || header->numAircraft == 0 || header->numChargers == 0 || header->numSites == 0) {
+		throw std::runtime_error("Checkpoint " + path.string() + " is truncated or corrupt");
+	}
+}
+
+
+Checkpoint::~Checkpoint() = default;
+
+
+void Checkpoint::write(const std::filesystem::path& path, Simulation& simulation, const std::vector<Scheduler*>& schedulers, const RunProgress& progress) {
+	/*
+	* Every task has at most one event pending, on one of the timelines or posted between them, so the
+	* pending events are looked up by task key. Anything not pending is suspended on a SimEvent, which
+	* the state of the aircraft and the chargers identifies unambiguously.
+	*/
+
+	if (schedulers.empty() || simulation.chargingScheduler == nullptr) throw std::logic_error("Only event-driven simulations can be checkpointed.");
+	if (simulation.fleet.empty()) throw std::logic_error("The simulation has not been started.");
+	if (simulation.dispatcher) throw std::logic_error("Simulations with trip demand cannot be checkpointed.");
+	if (ChargerPool::isResized(simulation)) throw std::logic_error("Simulations whose charger pool has been resized cannot be checkpointed.");
+
+	std::unordered_map<std::uint64_t, std::int64_t> pending;
+	for (const Scheduler* scheduler : schedulers) {
+		for (const Scheduler::PendingEvent& event : scheduler->getPendingEvents()) {
+			pending.emplace(event.key, event.at.count());
+		}
+	}
+
+	auto pendingAt = [&pending](std::uint64_t key, std::uint8_t& flag, std::int64_t& at) {
+		std::unordered_map<std::uint64_t, std::int64_t>::const_iterator found = pending.find(key);
+		flag = (found != pending.end()) ? 1 : 0;
+		at = (found != pending.end()) ? found->second : -1;
+	};
+
+	const FleetCatalog& catalog = simulation.getCatalog();
+
+	CheckpointHeader header{};
+	std::memcpy(header.magic, CheckpointHeader::Magic, sizeof(header.magic));
+	header.version = CheckpointHeader::Version;
+	header.headerSize = static_cast<std::uint32_t>(sizeof(CheckpointHeader));
+	header.catalogFingerprint = Checkpoint::fingerprint(catalog);
+	header.clockTicksPerSecond = ClockTicksPerSecond;
+	header.epoch = ticksOf(schedulers.front()->getEpoch());
+	header.simulated = progress.simulated.count();
+	header.events = progress.events;
+	header.wallSeconds = progress.wallSeconds;
+	header.seed = simulation.randomSeed.value_or(0);
+	header.hasSeed = simulation.randomSeed.has_value() ? 1 : 0;
+	header.numManufacturers = static_cast<std::uint32_t>(catalog.size());
+	header.numAircraft = static_cast<std::uint32_t>(simulation.fleet.size());
+	header.numChargers = static_cast<std::uint32_t>(simulation.chargerInstances.size());
+	header.numSites = static_cast<std::uint32_t>(simulation.sites.size());
+
+	// The serial stamp is the part of the model number after the last underscore
+	const std::string& modelNumber = simulation.fleet.front()->modelNumber;
+	std::string serialStamp = modelNumber.substr(modelNumber.rfind('_') + 1);
+	std::memcpy(header.serialStamp, serialStamp.data(), std::min(serialStamp.size(), sizeof(header.serialStamp) - 1));
+
+	// The restored simulation logs under the same run, so reading the log shows the two as one
+	std::optional<std::uint64_t> logRun = simulation.log ? std::optional<std::uint64_t>(simulation.log->getRun()) : simulation.resumedLogRun;
+	header.logRun = logRun.value_or(0);
+	header.hasLogRun = logRun.has_value() ? 1 : 0;
+
+	/* ----------------- Aircraft ----------------- */
+	std::vector<AircraftState> aircraft(simulation.fleet.size());
+	std::vector<std::uint32_t> serialNumbers(catalog.size(), 0);
+
+	for (std::size_t i = 0; i < simulation.fleet.size(); ++i) {
+		const evTOL& source = *simulation.fleet[i];
+		AircraftState& state = aircraft[i];
+
+		// Aircraft of one manufacturer occupy consecutive slots, numbered from 1
+		state.manufacturerIndex = static_cast<std::uint32_t>(source.ManufacturerIndex);
+		state.serialNumber = ++serialNumbers[source.ManufacturerIndex];
+		state.fleetSize = static_cast<std::uint32_t>(source.Profile.fleetSize);
+		state.batteryLevel = source.currentBatteryLevel;
+		state.phase = static_cast<std::uint8_t>(source.flightPhase);
+		state.charging = source.chargingStatus.load() ? 1 : 0;
+		pendingAt(Scheduler::makeKey(TaskGroup::Aircraft, i), state.pending, state.pendingAt);
+		state.start = ticksOf(source.StartOperationTime);
+		state.end = ticksOf(source.EndOperationTime);
+		state.airTime = source.airTime.count();
+		state.totalAirTime = source.totalAirTime.count();
+		state.completedSessions = source.completedSessions;
+	}
+
+	/* ----------------- Charging network ----------------- */
+	std::vector<ChargerState> chargers(simulation.chargerInstances.size());
+	std::vector<SiteState> sites(simulation.sites.size());
+	std::vector<RequestState> requests;
+
+	auto requestOf = [](const RequestManager& request, std::int32_t charger) {
+		RequestState state{};
+		state.aircraftID = static_cast<std::uint32_t>(request.aircraft->getAircraftID());
+		state.siteID = static_cast<std::uint32_t>(request.site->getSiteID());
+		state.charger = charger;
+		state.requestTime = ticksOf(request.requestTime);
+		state.startTime = ticksOf(request.startTime);
+		state.endTime = ticksOf(request.endTime);
+		return state;
+	};
+
+	for (std::size_t s = 0; s < simulation.sites.size(); ++s) {
+		Vertiport& site = *simulation.sites[s];
+
+		sites[s].chargers = static_cast<std::uint32_t>(site.chargers.load());
+		sites[s].queued = static_cast<std::uint32_t>(site.queued.load());
+		sites[s].busy = static_cast<std::uint32_t>(site.busy.load());
+		sites[s].requestAvailable = site.requestAvailable.isSet() ? 1 : 0;
+		sites[s].pendingWork = site.pendingWork.load();
+
+		// std::queue only exposes its front, so a copy of it is drained
+		Vertiport::RequestQueue queue = site.incomingRequests;
+		for (; !queue.empty(); queue.pop()) requests.push_back(requestOf(*queue.front(), -1));
+	}
+
+	for (std::size_t c = 0; c < simulation.chargerInstances.size(); ++c) {
+		const ChargingStation& charger = *simulation.chargerInstances[c];
+
+		chargers[c].siteID = static_cast<std::uint32_t>(charger.site.getSiteID());
+		chargers[c].charging = charger.isCharging.load() ? 1 : 0;
+		pendingAt(Scheduler::makeKey(TaskGroup::Charger, c), chargers[c].pending, chargers[c].pendingAt);
+
+		if (charger.activeRequest) requests.push_back(requestOf(*charger.activeRequest, static_cast<std::int32_t>(c)));
+	}
+
+	header.numRequests = static_cast<std::uint32_t>(requests.size());
+
+	/* ----------------- Results so far ----------------- */
+	std::vector<ManufacturerTotals> totals = simulation.metrics.collect();
+	std::vector<ManufacturerState> manufacturers(catalog.size());
+
+	for (std::size_t m = 0; m < catalog.size(); ++m) {
+		manufacturers[m].fleetSize = simulation.fleetSizes.at(catalog.getManufacturerNames()[m]);
+		manufacturers[m].flights = totals[m].flights;
+		manufacturers[m].charges = totals[m].charges;
+		manufacturers[m].airTime = totals[m].airTime;
+		manufacturers[m].miles = totals[m].miles;
+		manufacturers[m].passengerMiles = totals[m].passengerMiles;
+		manufacturers[m].faults = totals[m].faults;
+		manufacturers[m].chargeTime = totals[m].chargeTime;
+	}
+
+	const SessionColumns& sessions = simulation.sessions.columns();
+	header.numSessions = sessions.size();
+
+	/* ----------------- File ----------------- */
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) throw std::runtime_error("Unable to create checkpoint " + temporary.string());
+
+		auto put = [&file](const void* data, std::size_t size) {
+			static const char zeros[8] = {};
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			file.write(zeros, static_cast<std::streamsize>(padded(size) - size));
+		};
+
+		put(&header, sizeof(header));
+		put(aircraft.data(), aircraft.size() * sizeof(AircraftState));
+		put(chargers.data(), chargers.size() * sizeof(ChargerState));
+		put(sites.data(), sites.size() * sizeof(SiteState));
+		put(requests.data(), requests.size() * sizeof(RequestState));
+		put(manufacturers.data(), manufacturers.size() * sizeof(ManufacturerState));
+
+		put(sessions.start.data(), sessions.size() * sizeof(std::int64_t));
+		put(sessions.end.data(), sessions.size() * sizeof(std::int64_t));
+		put(sessions.airTime.data(), sessions.size() * sizeof(double));
+		put(sessions.miles.data(), sessions.size() * sizeof(double));
+		put(sessions.passengerMiles.data(), sessions.size() * sizeof(double));
+		put(sessions.faults.data(), sessions.size() * sizeof(double));
+		put(sessions.aircraft.data(), sessions.size() * sizeof(std::uint32_t));
+		put(sessions.manufacturer.data(), sessions.size() * sizeof(std::uint16_t));
+
+		file.close();
+		if (!file) throw std::runtime_error("Unable to write checkpoint " + temporary.string());
+	}
+
+	// A run resumed from the snapshot starts a segment of its own, so everything logged up to here has to be indexed
+	if (simulation.log) simulation.log->seal();
+
+	std::filesystem::rename(temporary, path);
+}
+
+
+std::unique_ptr<const Checkpoint> Checkpoint::load(const std::filesystem::path& path) {
+	return std::unique_ptr<const Checkpoint>(new Checkpoint(path));
+}
+
+
+const CheckpointHeader& Checkpoint::getHeader() const {
+	return *header;
+}
+
+
+std::chrono::time_point<std::chrono::system_clock> Checkpoint::getEpoch() const {
+	return timePointOf(header->epoch);
+}
+
+
+RunProgress Checkpoint::getProgress() const {
+	return RunProgress{ std::chrono::microseconds(header->simulated), header->events, header->wallSeconds };
+}
+
+
+void Checkpoint::restore(Simulation& simulation, const std::vector<Scheduler*>& schedulers) const {
+	/*
+	* The fleet and the charging network are rebuilt in place of FleetManager::InitializeFleet() and
+	* ChargingStation::InitializeChargers(), under the same once-flags. Every coroutine is adopted by the
+	* scheduler that would have spawned it and then either put back on the timeline it was waiting on,
+	* at the time it was due, or back on the SimEvent it was waiting for.
+	*/
+
+	if (schedulers.empty()) throw std::logic_error("Only event-driven simulations can be restored from a checkpoint.");
+
+	const FleetCatalog& catalog = simulation.getCatalog();
+	if (header->numManufacturers != catalog.size() || header->catalogFingerprint != Checkpoint::fingerprint(catalog)) {
+		throw std::runtime_error("Checkpoint was written for another manufacturer catalog");
+	}
+
+	const AircraftState* aircraft = section<AircraftState>(layout.aircraft);
+	const ChargerState* chargers = section<ChargerState>(layout.chargers);
+	const SiteState* sites = section<SiteState>(layout.sites);
+	const RequestState* requests = section<RequestState>(layout.requests);
+	const ManufacturerState* manufacturers = section<ManufacturerState>(layout.manufacturers);
+
+	auto corrupt = []() {
+		return std::runtime_error("Checkpoint is inconsistent");
+	};
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	Scheduler& chargingNetwork = *schedulers.front();
+	bool restored = false;
+
+	std::call_once(simulation.chargersInitialized, [&] {
+		simulation.chargingScheduler = &chargingNetwork;
+		Vertiport::InitializeNetwork(simulation, header->numSites, &chargingNetwork);
+
+		simulation.chargerInstances.reserve(header->numChargers);
+		for (std::size_t c = 0; c < header->numChargers; ++c) {
+			if (chargers[c].siteID >= header->numSites) throw corrupt();
+			ChargingStation::restoreCharger(simulation, c, simulation.getSite(chargers[c].siteID));
+		}
+		});
+
+	std::call_once(simulation.fleetInitialized, [&] {
+		restored = true;
+		simulation.resumed = true;
+		if (header->hasSeed != 0) simulation.setSeed(header->seed);
+		if (header->hasLogRun != 0) simulation.resumedLogRun = header->logRun;
+
+		/* ----------------- Fleet ----------------- */
+		const std::vector<std::string>& manufacturerNames = catalog.getManufacturerNames();
+		std::vector<ManufacturerTotals> totals(catalog.size());
+
+		// Inserted in catalog order, as FleetManager::readInputData() does, so the map iterates the same way
+		simulation.fleetSizes.reserve(manufacturerNames.size());
+		for (std::size_t m = 0; m < catalog.size(); ++m) {
+			simulation.fleetSizes.emplace(manufacturerNames[m], static_cast<std::size_t>(manufacturers[m].fleetSize));
+
+			totals[m].manufacturer = manufacturerNames[m];
+			totals[m].flights = manufacturers[m].flights;
+			totals[m].charges = manufacturers[m].charges;
+			totals[m].airTime = manufacturers[m].airTime;
+			totals[m].miles = manufacturers[m].miles;
+			totals[m].passengerMiles = manufacturers[m].passengerMiles;
+			totals[m].faults = manufacturers[m].faults;
+			totals[m].chargeTime = manufacturers[m].chargeTime;
+		}
+
+		simulation.metrics.registerManufacturers(manufacturerNames);
+		simulation.metrics.restore(totals);
+
+		std::string serialStamp(header->serialStamp, strnlen(header->serialStamp, sizeof(header->serialStamp)));
+		simulation.fleet.reserve(header->numAircraft);
+
+		for (std::size_t i = 0; i < header->numAircraft; ++i) {
+			const AircraftState& state = aircraft[i];
+			if (state.manufacturerIndex >= catalog.size() || state.phase > static_cast<std::uint8_t>(FlightPhase::Charging)) throw corrupt();
+
+			std::shared_ptr<FleetManager> restoredAircraft = std::allocate_shared<FleetManager>(TrackedAllocator<FleetManager, MemorySubsystem::Fleet>(),
+				catalog.getSpec(state.manufacturerIndex), state.serialNumber, state.manufacturerIndex, i, state.fleetSize, simulation, serialStamp);
+
+			restoredAircraft->currentBatteryLevel = state.batteryLevel;
+			restoredAircraft->chargingStatus.store(state.charging != 0);
+			restoredAircraft->airTime = std::chrono::duration<double>(state.airTime);
+			restoredAircraft->totalAirTime = std::chrono::duration<double>(state.totalAirTime);
+			restoredAircraft->completedSessions = static_cast<std::size_t>(state.completedSessions);
+			restoredAircraft->flightPhase = static_cast<FlightPhase>(state.phase);
+			restoredAircraft->StartOperationTime = timePointOf(state.start);
+			restoredAircraft->EndOperationTime = timePointOf(state.end);
+
+			simulation.fleet.push_back(std::move(restoredAircraft));
+		}
+
+		/* ----------------- Sessions ----------------- */
+		SessionColumns sessions;
+		const char* columns = section<char>(layout.sessions);
+		std::size_t numSessions = static_cast<std::size_t>(header->numSessions);
+
+		auto column = [&columns, numSessions](auto& target) {
+			using Value = typename std::remove_reference_t<decltype(target)>::value_type;
+			const Value* values = reinterpret_cast<const Value*>(columns);
+			target.assign(values, values + numSessions);
+			columns += padded(numSessions * sizeof(Value));
+		};
+
+		column(sessions.start);
+		column(sessions.end);
+		column(sessions.airTime);
+		column(sessions.miles);
+		column(sessions.passengerMiles);
+		column(sessions.faults);
+		column(sessions.aircraft);
+		column(sessions.manufacturer);
+
+		simulation.sessions.restore(std::move(sessions));
+
+		/* ----------------- Charging network ----------------- */
+		for (std::size_t s = 0; s < header->numSites; ++s) {
+			Vertiport& site = simulation.getSite(s);
+			if (site.chargers.load() != sites[s].chargers) throw corrupt();
+
+			site.queued.store(sites[s].queued);
+			site.busy.store(sites[s].busy);
+			site.pendingWork.store(sites[s].pendingWork);
+			if (sites[s].requestAvailable != 0) site.requestAvailable.set();
+		}
+
+		// Queued requests of an aircraft, which its coroutine waits on
+		std::unordered_map<std::size_t, std::shared_ptr<RequestManager>> queuedRequests;
+
+		for (std::size_t r = 0; r < header->numRequests; ++r) {
+			const RequestState& state = requests[r];
+			if (state.aircraftID >= header->numAircraft || state.siteID >= header->numSites || state.charger >= static_cast<std::int64_t>(header->numChargers)) throw corrupt();
+
+			Vertiport& site = simulation.getSite(state.siteID);
+			std::shared_ptr<RequestManager> request = RequestManager::restoreRequest(simulation.fleet[state.aircraftID], chargingNetwork, site, timePointOf(state.requestTime));
+			request->startTime = timePointOf(state.startTime);
+			request->endTime = timePointOf(state.endTime);
+
+			if (state.charger < 0) {
+				site.incomingRequests.push(request);
+				queuedRequests.emplace(state.aircraftID, request);
+			}
+			else {
+				request->assignedEvent.set();
+				simulation.chargerInstances[state.charger]->activeRequest = std::move(request);
+			}
+		}
+
+		/* ----------------- Coroutines ----------------- */
+		for (std::size_t c = 0; c < header->numChargers; ++c) {
+			ChargingStation& charger = *simulation.chargerInstances[c];
+			const ChargerState& state = chargers[c];
+
+			// A charger is only ever charging while it sleeps for the duration of the charge
+			if ((state.charging != 0) != (charger.activeRequest != nullptr) || (state.charging != 0 && state.pending == 0)) throw corrupt();
+
+			charger.isCharging.store(state.charging != 0);
+			Scheduler::TaskHandle handle = chargingNetwork.adopt(charger.chargerTask(chargingNetwork, state.charging != 0), Scheduler::makeKey(TaskGroup::Charger, c));
+
+			if (state.pending != 0) chargingNetwork.schedule(handle, Scheduler::SimDuration(state.pendingAt));
+			else charger.site.requestAvailable.addWaiter(chargingNetwork, handle);
+		}
+
+		for (std::size_t i = 0; i < header->numAircraft; ++i) {
+			const AircraftState& state = aircraft[i];
+			FlightPhase phase = static_cast<FlightPhase>(state.phase);
+			Scheduler& home = *schedulers[i % schedulers.size()];
+
+			Scheduler::TaskHandle handle = home.adopt(simulation.fleet[i]->flightTask(home, phase), Scheduler::makeKey(TaskGroup::Aircraft, i));
+
+			if (state.pending != 0) {
+				// Flights end and charger assignments resume on the charging network, everything else at home
+				Scheduler& target = (phase == FlightPhase::Flying || phase == FlightPhase::Queued) ? chargingNetwork : home;
+				target.schedule(handle, Scheduler::SimDuration(state.pendingAt));
+			}
+			else {
+				std::unordered_map<std::size_t, std::shared_ptr<RequestManager>>::iterator queued = queuedRequests.find(i);
+				if (phase != FlightPhase::Queued || queued == queuedRequests.end()) throw corrupt();
+
+				queued->second->assignedEvent.addWaiter(chargingNetwork, handle);
+			}
+		}
+
+		simulation.startupTime = std::chrono::steady_clock::now() - begin;
+		});
+
+	if (!restored) throw std::logic_error("A checkpoint can only be restored into a simulation that has not been started.");
+}
+
+
+std::uint64_t Checkpoint::fingerprint(const FleetCatalog& catalog) {
+	// FNV-1a over the raw specs; their padding is always zero, so equal catalogs hash equally
+	std::uint64_t hash = 14695981039346656037ull;
+
+	for (std::size_t m = 0; m < catalog.size(); ++m) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&catalog.getSpec(m));
+		for (std::size_t b = 0; b < sizeof(ManufacturerSpec); ++b) {
+			hash = (hash ^ bytes[b]) * 1099511628211ull;
+		}
+	}
+
+	return hash;
+}
+
+
+Checkpoint::Layout Checkpoint::layoutOf(const CheckpointHeader& header) {
+	std::size_t numSessions = static_cast<std::size_t>(header.numSessions);
+
+	Layout layout{};
+	layout.aircraft = sizeof(CheckpointHeader);
+	layout.chargers = layout.aircraft + header.numAircraft * sizeof(AircraftState);
+	layout.sites = layout.chargers + header.numChargers * sizeof(ChargerState);
+	layout.requests = layout.sites + header.numSites * sizeof(SiteState);
+	layout.manufacturers = layout.requests + header.numRequests * sizeof(RequestState);
+	layout.sessions = layout.manufacturers + header.numManufacturers * sizeof(ManufacturerState);
+	layout.size = layout.sessions + 2 * numSessions * sizeof(std::int64_t) + 4 * numSessions * sizeof(double)
+		+ padded(numSessions * sizeof(std::uint32_t)) + padded(numSessions * sizeof(std::uint16_t));
+
+	return layout;
+}
+
+
+template <typename T>
+const T* Checkpoint::section(std::size_t offset) const {
+	return reinterpret_cast<const T*>(static_cast<const char*>(mapping->data()) + offset);
+}
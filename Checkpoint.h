@@ -0,0 +1,191 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+
+
+class Scheduler;
+class Simulation;
+class MappedFile;
+class FleetCatalog;
+
+/*
+* Binary snapshot of an event-driven simulation, taken between two runs of its schedulers.
+*
+* At that point every aircraft and charger coroutine is suspended at one of a handful of known waits, so
+* the snapshot records which wait (the flight phase, or whether a charger is charging) together with the
+* simulated time it resumes at, instead of the coroutine frames themselves. Restoring builds the fleet,
+* the chargers and the open charging requests from the records and starts fresh coroutines at those
+* waits; their first resumption carries on exactly where the original ones would have, so a restored
+* run continues bit for bit like the run that wrote the snapshot.
+*
+* The fleet composition is the only random draw of a simulation and is made once at startup; the
+* snapshot keeps its outcome (the manufacturer of every aircraft) along with the seed.
+*
+* Layout (native byte order and alignment of the writer, every section 8-byte aligned):
+*
+*   CheckpointHeader
+*   AircraftState    x numAircraft		in fleet order
+*   ChargerState     x numChargers		in charger order
+*   SiteState        x numSites			in vertiport order
+*   RequestState     x numRequests		open charging requests, queued ones in queue order
+*   ManufacturerState x numManufacturers	fleet sizes and metric totals, in catalog order
+*   Sessions							numSessions completed sessions, one zero-padded array per column
+*
+* A snapshot is written to a temporary file and renamed into place, so an interrupted write never
+* replaces a good snapshot. Loading maps the file and uses the records in place.
+*/
+
+struct CheckpointHeader {
+	static constexpr char Magic[8] = { 'E', 'V', 'T', 'O', 'L', 'C', 'H', 'K' };
+	static constexpr std::uint32_t Version = 2;
+
+	char magic[8];						// Identifies a checkpoint
+	std::uint32_t version;				// Layout version of the file
+	std::uint32_t headerSize;			// sizeof(CheckpointHeader) of the writer
+	std::uint64_t catalogFingerprint;	// Hash of the manufacturer specs the run was built from
+	std::int64_t clockTicksPerSecond;	// Resolution of the writer's system clock
+	std::int64_t epoch;					// Wall-clock timestamp of simulated time zero, in system clock ticks
+	std::int64_t simulated;				// Simulated microseconds covered so far
+	std::uint64_t events;				// Events processed so far
+	double wallSeconds;					// Wall-clock time spent running so far
+	std::uint64_t seed;					// Seed of the fleet composition
+	std::uint32_t hasSeed;				// Zero if the composition was drawn from a random device
+	std::uint32_t numManufacturers;		// Manufacturers in the catalog
+	std::uint32_t numAircraft;			// Aircraft in the fleet
+	std::uint32_t numChargers;			// Chargers in the network
+	std::uint32_t numSites;				// Vertiports in the network
+	std::uint32_t numRequests;			// Open charging requests
+	std::uint64_t numSessions;			// Completed flight sessions
+	char serialStamp[16];				// Serial number suffix shared by the fleet
+	std::uint64_t logRun;				// Run of the log segments, continued by the restored simulation
+	std::uint32_t hasLogRun;			// Zero if nothing had been logged
+	std::uint32_t reserved;				// Padding, always zero
+};
+
+
+struct AircraftState {
+	std::uint32_t manufacturerIndex;	// Position of the manufacturer in the catalog
+	std::uint32_t serialNumber;			// Position among the aircraft of the same manufacturer, from 1
+	std::uint32_t fleetSize;			// Aircraft of the same manufacturer
+	std::int32_t batteryLevel;			// Battery level in percent
+	std::uint8_t phase;					// FlightPhase the coroutine is suspended at
+	std::uint8_t charging;				// Charging status
+	std::uint8_t pending;				// Non-zero if the coroutine resumes at pendingAt rather than on an event
+	std::uint8_t reserved[5];			// Padding, always zero
+	std::int64_t pendingAt;				// Simulated microseconds at which the coroutine resumes
+	std::int64_t start;					// Take-off of the current session, in system clock ticks
+	std::int64_t end;					// Landing of the current session, in system clock ticks
+	double airTime;						// Airtime of the current session in seconds
+	double totalAirTime;				// Airtime of all completed sessions in seconds
+	std::uint64_t completedSessions;	// Completed flight sessions
+};
+
+
+struct ChargerState {
+	std::uint32_t siteID;				// Vertiport of the charger
+	std::uint8_t charging;				// Non-zero while a request is being charged
+	std::uint8_t pending;				// Non-zero if the coroutine resumes at pendingAt rather than on an event
+	std::uint8_t reserved[2];			// Padding, always zero
+	std::int64_t pendingAt;				// Simulated microseconds at which the coroutine resumes
+};
+
+
+struct SiteState {
+	std::uint32_t chargers;				// Chargers at the vertiport
+	std::uint32_t queued;				// Requests waiting in the queue
+	std::uint32_t busy;					// Chargers currently charging
+	std::uint32_t requestAvailable;		// Signal state of the chargers' wake-up event
+	std::int64_t pendingWork;			// Charge time queued or in progress, in simulated microseconds
+};
+
+
+struct RequestState {
+	std::uint32_t aircraftID;			// Aircraft that raised the request
+	std::uint32_t siteID;				// Vertiport the request was routed to
+	std::int32_t charger;				// Charger charging the request, -1 while queued
+	std::uint32_t reserved;				// Padding, always zero
+	std::int64_t requestTime;			// Time the request was raised, in system clock ticks
+	std::int64_t startTime;				// Time a charger picked it up, in system clock ticks
+	std::int64_t endTime;				// Time the charger released it, in system clock ticks
+};
+
+
+struct ManufacturerState {
+	std::uint64_t fleetSize;			// Aircraft of the manufacturer
+	std::uint64_t flights;				// Completed flight sessions
+	std::uint64_t charges;				// Completed charge sessions
+	double airTime;						// Airtime in seconds
+	double miles;						// Miles flown
+	double passengerMiles;				// Passenger miles flown
+	double faults;						// Expected faults
+	double chargeTime;					// Time spent charging in seconds
+};
+
+static_assert(std::is_trivially_copyable_v<CheckpointHeader> && sizeof(CheckpointHeader) == 136, "CheckpointHeader is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<AircraftState> && sizeof(AircraftState) == 72, "AircraftState is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<ChargerState> && sizeof(ChargerState) == 16, "ChargerState is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<SiteState> && sizeof(SiteState) == 24, "SiteState is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<RequestState> && sizeof(RequestState) == 40, "RequestState is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<ManufacturerState> && sizeof(ManufacturerState) == 64, "ManufacturerState is stored as raw bytes");
+
+
+// Progress of the runs that led up to a checkpoint, kept by whoever drives the schedulers
+struct RunProgress {
+	std::chrono::microseconds simulated{ 0 };	// Simulated time covered
+	std::uint64_t events = 0;					// Events processed
+	double wallSeconds = 0.0;					// Wall-clock time spent running
+};
+
+
+class Checkpoint {
+public:
+	~Checkpoint();																		// Unmaps the snapshot
+
+	Checkpoint(const Checkpoint& other) = delete;										// Copy constructor
+	Checkpoint& operator=(const Checkpoint& other) = delete;							// Copy assignment
+
+	/*
+	* The schedulers are the partitions the simulation runs on: the chargers on the first one and aircraft i
+	* on partition i modulo their number, as ParallelScheduler::partitionFor() assigns them. A cooperative
+	* simulation passes its only scheduler. None of them may be running.
+	*/
+	static void write(const std::filesystem::path& path, Simulation& simulation, const std::vector<Scheduler*>& schedulers, const RunProgress& progress);
+	static std::unique_ptr<const Checkpoint> load(const std::filesystem::path& path);	// Map and validate a snapshot
+
+	const CheckpointHeader& getHeader() const;											// Header of the snapshot
+	std::chrono::time_point<std::chrono::system_clock> getEpoch() const;				// Simulated time zero of the run that wrote it
+	RunProgress getProgress() const;													// Progress of the run that wrote it
+
+	// Rebuild a fresh simulation from the snapshot; the schedulers must have been created with getEpoch() and set to the simulated time
+	void restore(Simulation& simulation, const std::vector<Scheduler*>& schedulers) const;
+
+	static std::uint64_t fingerprint(const FleetCatalog& catalog);						// Hash of the manufacturer specs of a catalog
+
+private:
+	explicit Checkpoint(const std::filesystem::path& path);								// Maps the snapshot
+
+	struct Layout {
+		std::size_t aircraft;					// Offset of the aircraft records
+		std::size_t chargers;					// Offset of the charger records
+		std::size_t sites;						// Offset of the vertiport records
+		std::size_t requests;					// Offset of the request records
+		std::size_t manufacturers;				// Offset of the manufacturer records
+		std::size_t sessions;					// Offset of the session columns
+		std::size_t size;						// Size of the whole snapshot
+	};
+
+	static Layout layoutOf(const CheckpointHeader& header);								// Section offsets implied by the counts of a header
+
+	template <typename T>
+	const T* section(std::size_t offset) const;											// Records of a section of the mapped snapshot
+
+	std::unique_ptr<MappedFile> mapping;												// Mapped snapshot
+	const CheckpointHeader* header;														// Header at the start of the mapping
+	Layout layout;																		// Section offsets of the snapshot
+};
@@ -0,0 +1,458 @@
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <charconv>
+#include <stdexcept>
+
+#include "DataExport.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace {
+	constexpr char ColumnarMagic[8] = { 'E', 'V', 'T', 'O', 'L', 'C', 'O', 'L' };
+	constexpr std::uint32_t ColumnarVersion = 1;
+	constexpr std::size_t FileHeaderSize = 64;
+	constexpr std::size_t ColumnHeaderSize = 32;
+	constexpr std::size_t ChunkHeaderSize = 16;
+
+	std::size_t columnWidth(ColumnType type) {
+		switch (type) {
+		case ColumnType::Int64: return sizeof(std::int64_t);
+		case ColumnType::Float64: return sizeof(double);
+		case ColumnType::UInt32: return sizeof(std::uint32_t);
+		case ColumnType::UInt16: return sizeof(std::uint16_t);
+		default: throw std::invalid_argument("Unknown column type");
+		}
+	}
+
+	std::size_t padded(std::size_t bytes) {
+		return (bytes + 7) & ~static_cast<std::size_t>(7);
+	}
+
+	template <typename T>
+	void put(unsigned char* destination, T value) {
+		std::memcpy(destination, &value, sizeof(T));
+	}
+
+	template <typename T>
+	T get(const unsigned char* source) {
+		T value;
+		std::memcpy(&value, source, sizeof(T));
+		return value;
+	}
+}
+
+
+/* ----------------- ColumnarFileWriter ----------------- */
+
+ColumnarFileWriter::ColumnarFileWriter(const std::filesystem::path& path, const std::string& table, const std::vector<ColumnSpec>& schema, std::size_t rowSize) :
+	path(path),
+	file(path, std::ios::binary | std::ios::trunc),
+	schema(schema),
+	rowSize(rowSize),
+	rowCount(0),
+	chunkCount(0)
+{
+	if (!file.is_open()) throw std::runtime_error("Unable to open export file " + path.string());
+
+	std::vector<unsigned char> header(FileHeaderSize + schema.size() * ColumnHeaderSize, 0);
+
+	std::memcpy(header.data(), ColumnarMagic, sizeof(ColumnarMagic));
+	put<std::uint32_t>(header.data() + 8, ColumnarVersion);
+	put<std::uint32_t>(header.data() + 12, static_cast<std::uint32_t>(schema.size()));
+	std::memcpy(header.data() + 32, table.c_str(), std::min<std::size_t>(table.size(), 31));
+
+	for (std::size_t i = 0; i < schema.size(); ++i) {
+		unsigned char* column = header.data() + FileHeaderSize + i * ColumnHeaderSize;
+		std::memcpy(column, schema[i].name, std::min<std::size_t>(std::strlen(schema[i].name), 23));
+		put<std::uint32_t>(column + 24, static_cast<std::uint32_t>(schema[i].type));
+		put<std::uint32_t>(column + 28, static_cast<std::uint32_t>(columnWidth(schema[i].type)));
+	}
+
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+}
+
+
+void ColumnarFileWriter::writeChunk(const unsigned char* rows, std::size_t count) {
+	/*
+	* Rows arrive as structs and leave as one array per column: the chunk is transposed into
+	* the scratch buffer and written with a single call.
+	*/
+
+	if (count == 0) return;
+
+	std::size_t payloadBytes = 0;
+	for (const ColumnSpec& spec : schema) payloadBytes += padded(count * columnWidth(spec.type));
+
+	payload.assign(ChunkHeaderSize + payloadBytes, 0);
+	put<std::uint64_t>(payload.data(), count);
+	put<std::uint64_t>(payload.data() + 8, payloadBytes);
+
+	unsigned char* out = payload.data() + ChunkHeaderSize;
+	for (const ColumnSpec& spec : schema) {
+		std::size_t width = columnWidth(spec.type);
+
+		for (std::size_t row = 0; row < count; ++row) {
+			std::memcpy(out + row * width, rows + row * rowSize + spec.offset, width);
+		}
+		out += padded(count * width);
+	}
+
+	file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+	rowCount += count;
+	++chunkCount;
+}
+
+
+void ColumnarFileWriter::close() {
+	if (!file.is_open()) return;
+
+	// Totals are only known at the end; a reader falls back to walking the chunks if they are missing
+	unsigned char totals[16];
+	put<std::uint64_t>(totals, rowCount);
+	put<std::uint64_t>(totals + 8, chunkCount);
+
+	file.seekp(16);
+	file.write(reinterpret_cast<const char*>(totals), sizeof(totals));
+	file.close();
+
+	if (!file) throw std::runtime_error("Unable to write export file " + path.string());
+}
+
+
+/* ----------------- CsvFileWriter ----------------- */
+
+CsvFileWriter::CsvFileWriter(const std::filesystem::path& path, const std::vector<ColumnSpec>& schema, std::size_t rowSize) :
+	path(path),
+	file(path, std::ios::binary | std::ios::trunc),
+	schema(schema),
+	rowSize(rowSize)
+{
+	if (!file.is_open()) throw std::runtime_error("Unable to open export file " + path.string());
+
+	for (std::size_t i = 0; i < schema.size(); ++i) {
+		file << (i == 0 ? "" : ",") << schema[i].name;
+	}
+	file << "\n";
+}
+
+
+void CsvFileWriter::writeChunk(const unsigned char* rows, std::size_t count) {
+	std::array<char, 32> field;
+	text.clear();
+
+	for (std::size_t row = 0; row < count; ++row) {
+		const unsigned char* values = rows + row * rowSize;
+
+		for (std::size_t i = 0; i < schema.size(); ++i) {
+			const unsigned char* value = values + schema[i].offset;
+			std::to_chars_result result{};
+
+			switch (schema[i].type) {
+			case ColumnType::Int64: result = std::to_chars(field.data(), field.data() + field.size(), get<std::int64_t>(value)); break;
+			case ColumnType::Float64: result = std::to_chars(field.data(), field.data() + field.size(), get<double>(value)); break;
+			case ColumnType::UInt32: result = std::to_chars(field.data(), field.data() + field.size(), get<std::uint32_t>(value)); break;
+			case ColumnType::UInt16: result = std::to_chars(field.data(), field.data() + field.size(), get<std::uint16_t>(value)); break;
+			}
+
+			if (i != 0) text.push_back(',');
+			text.append(field.data(), result.ptr);
+		}
+		text.push_back('\n');
+	}
+
+	file.write(text.data(), text.size());
+}
+
+
+void CsvFileWriter::close() {
+	if (!file.is_open()) return;
+
+	file.close();
+	if (!file) throw std::runtime_error("Unable to write export file " + path.string());
+}
+
+
+/* ----------------- ColumnarReader ----------------- */
+
+ColumnarReader::ColumnarReader(const std::filesystem::path& path) :
+	data(nullptr),
+	size(0),
+	mappingHandle(nullptr),
+	rowCount(0)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Unable to open " + path.string());
+
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(file, &fileSize);
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+
+	HANDLE mapping = size == 0 ? nullptr : CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) throw std::runtime_error("Unable to map " + path.string());
+
+	data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	mappingHandle = mapping;
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		throw std::runtime_error("Unable to map " + path.string());
+	}
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) throw std::runtime_error("Unable to open " + path.string());
+
+	struct stat status {};
+	fstat(descriptor, &status);
+	size = static_cast<std::size_t>(status.st_size);
+
+	void* view = size == 0 ? MAP_FAILED : mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (view == MAP_FAILED) throw std::runtime_error("Unable to map " + path.string());
+
+	data = static_cast<const unsigned char*>(view);
+#endif
+
+	try {
+		validate(path);
+	}
+	catch (...) {
+		unmap();
+		throw;
+	}
+}
+
+
+ColumnarReader::~ColumnarReader() {
+	unmap();
+}
+
+
+void ColumnarReader::validate(const std::filesystem::path& path) {
+	/*
+	* Every size in the file is checked against the mapping before it is used, and the payload of every
+	* chunk must hold exactly the padded arrays of its columns, so the arrays handed out by column() lie
+	* inside the file whatever the file claims. An export that finished records its totals and must end
+	* with its last chunk; one that was interrupted has none, and its truncated trailing chunk is ignored.
+	*/
+
+	auto corrupt = [&path] { return std::runtime_error("Columnar export " + path.string() + " is truncated or corrupt"); };
+
+	if (size < FileHeaderSize || std::memcmp(data, ColumnarMagic, sizeof(ColumnarMagic)) != 0) {
+		throw std::runtime_error(path.string() + " is not a columnar export");
+	}
+	if (get<std::uint32_t>(data + 8) != ColumnarVersion) {
+		throw std::runtime_error("Columnar export " + path.string() + " was written by an incompatible version");
+	}
+
+	std::uint32_t columnCount = get<std::uint32_t>(data + 12);
+	std::uint64_t totalRows = get<std::uint64_t>(data + 16);
+	std::uint64_t totalChunks = get<std::uint64_t>(data + 24);
+	table = std::string(reinterpret_cast<const char*>(data + 32), strnlen(reinterpret_cast<const char*>(data + 32), 32));
+
+	if (columnCount > (size - FileHeaderSize) / ColumnHeaderSize) throw corrupt();
+
+	for (std::uint32_t i = 0; i < columnCount; ++i) {
+		const unsigned char* column = data + FileHeaderSize + i * ColumnHeaderSize;
+		std::uint32_t type = get<std::uint32_t>(column + 24);
+		std::uint32_t width = get<std::uint32_t>(column + 28);
+
+		if (type < static_cast<std::uint32_t>(ColumnType::Int64) || type > static_cast<std::uint32_t>(ColumnType::UInt16)) throw corrupt();
+		if (width != columnWidth(static_cast<ColumnType>(type))) throw corrupt();
+
+		columns.push_back({ std::string(reinterpret_cast<const char*>(column), strnlen(reinterpret_cast<const char*>(column), 24)),
+			static_cast<ColumnType>(type), width });
+	}
+
+	std::size_t offset = FileHeaderSize + columnCount * ColumnHeaderSize;
+	while (size - offset >= ChunkHeaderSize) {
+		std::uint64_t rows = get<std::uint64_t>(data + offset);
+		std::uint64_t payloadBytes = get<std::uint64_t>(data + offset + 8);
+		if (payloadBytes > size - offset - ChunkHeaderSize) break;
+
+		// Each array is bounded by what is left of the payload before its size is computed
+		std::uint64_t expected = 0;
+		for (const Column& column : columns) {
+			if (rows > (payloadBytes - expected) / column.width) throw corrupt();
+			expected += padded(rows * column.width);
+			if (expected > payloadBytes) throw corrupt();
+		}
+		if (expected != payloadBytes) throw corrupt();
+
+		chunks.push_back(data + offset);
+		rowCount += rows;
+		offset += ChunkHeaderSize + payloadBytes;
+	}
+
+	bool finished = totalChunks != 0;
+	if (finished && (offset != size || chunks.size() != totalChunks || rowCount != totalRows)) throw corrupt();
+}
+
+
+void ColumnarReader::unmap() {
+	if (data == nullptr) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle(static_cast<HANDLE>(mappingHandle));
+#else
+	munmap(const_cast<unsigned char*>(data), size);
+#endif
+
+	data = nullptr;
+}
+
+
+const std::string& ColumnarReader::getTable() const {
+	return table;
+}
+
+
+const std::vector<ColumnarReader::Column>& ColumnarReader::getColumns() const {
+	return columns;
+}
+
+
+std::uint64_t ColumnarReader::getRowCount() const {
+	return rowCount;
+}
+
+
+std::size_t ColumnarReader::getChunkCount() const {
+	return chunks.size();
+}
+
+
+std::uint64_t ColumnarReader::getChunkRows(std::size_t chunk) const {
+	return get<std::uint64_t>(chunks.at(chunk));
+}
+
+
+template <typename T>
+const T* ColumnarReader::column(std::size_t chunk, const std::string& name) const {
+	return reinterpret_cast<const T*>(columnData(chunk, name, sizeof(T)));
+}
+
+template const std::int64_t* ColumnarReader::column<std::int64_t>(std::size_t, const std::string&) const;
+template const double* ColumnarReader::column<double>(std::size_t, const std::string&) const;
+template const std::uint32_t* ColumnarReader::column<std::uint32_t>(std::size_t, const std::string&) const;
+template const std::uint16_t* ColumnarReader::column<std::uint16_t>(std::size_t, const std::string&) const;
+
+
+const unsigned char* ColumnarReader::columnData(std::size_t chunk, const std::string& name, std::size_t width) const {
+	std::uint64_t rows = getChunkRows(chunk);
+	const unsigned char* position = chunks.at(chunk) + ChunkHeaderSize;
+
+	for (const Column& column : columns) {
+		if (column.name == name) {
+			if (column.width != width) throw std::invalid_argument("Column " + name + " has a different element type");
+			return position;
+		}
+		position += padded(rows * column.width);
+	}
+
+	throw std::out_of_range("No column " + name + " in table " + table);
+}
+
+
+/* ----------------- DataExport ----------------- */
+
+DataExport::DataExport(const std::filesystem::path& directory, ExportFormat format) :
+	finished(false)
+{
+	std::filesystem::create_directories(directory);
+
+	if (format == ExportFormat::Columnar) {
+		sessions.sink = std::make_unique<ColumnarFileWriter>(directory / "sessions.evcol", "sessions", sessionSchema(), sizeof(SessionRow));
+		tickets.sink = std::make_unique<ColumnarFileWriter>(directory / "tickets.evcol", "tickets", ticketSchema(), sizeof(TicketRow));
+	}
+	else {
+		sessions.sink = std::make_unique<CsvFileWriter>(directory / "sessions.csv", sessionSchema(), sizeof(SessionRow));
+		tickets.sink = std::make_unique<CsvFileWriter>(directory / "tickets.csv", ticketSchema(), sizeof(TicketRow));
+	}
+}
+
+
+void DataExport::finish() {
+	std::lock_guard<std::mutex> lock(finishMtx);
+	if (finished) return;
+
+	sessions.rows.flush([this](const SessionRow* rows, std::size_t count) { sessions.write(rows, count); });
+	tickets.rows.flush([this](const TicketRow* rows, std::size_t count) { tickets.write(rows, count); });
+
+	sessions.sink->close();
+	tickets.sink->close();
+	finished = true;
+}
+
+
+void DataExport::recordSession(const SessionRow& row) {
+	record(sessions, row);
+}
+
+
+void DataExport::recordTicket(const TicketRow& row) {
+	record(tickets, row);
+}
+
+
+const std::vector<ColumnSpec>& DataExport::sessionSchema() {
+	static const std::vector<ColumnSpec> schema = {
+		{ "start", ColumnType::Int64, offsetof(SessionRow, start) },
+		{ "end", ColumnType::Int64, offsetof(SessionRow, end) },
+		{ "air_time", ColumnType::Float64, offsetof(SessionRow, airTime) },
+		{ "miles", ColumnType::Float64, offsetof(SessionRow, miles) },
+		{ "passenger_miles", ColumnType::Float64, offsetof(SessionRow, passengerMiles) },
+		{ "faults", ColumnType::Float64, offsetof(SessionRow, faults) },
+		{ "aircraft", ColumnType::UInt32, offsetof(SessionRow, aircraft) },
+		{ "manufacturer", ColumnType::UInt16, offsetof(SessionRow, manufacturer) }
+	};
+
+	return schema;
+}
+
+
+const std::vector<ColumnSpec>& DataExport::ticketSchema() {
+	static const std::vector<ColumnSpec> schema = {
+		{ "requested", ColumnType::Int64, offsetof(TicketRow, requested) },
+		{ "started", ColumnType::Int64, offsetof(TicketRow, started) },
+		{ "finished", ColumnType::Int64, offsetof(TicketRow, finished) },
+		{ "aircraft", ColumnType::UInt32, offsetof(TicketRow, aircraft) },
+		{ "manufacturer", ColumnType::UInt16, offsetof(TicketRow, manufacturer) },
+		{ "site", ColumnType::UInt16, offsetof(TicketRow, site) }
+	};
+
+	return schema;
+}
+
+
+template <typename Row>
+void DataExport::record(Table<Row>& table, const Row& row) {
+	table.rows.record(row, [&table](const Row* rows, std::size_t count) { table.write(rows, count); });
+}
+
+
+template <typename Row>
+DataExport::Table<Row>::Table() :
+	rows(DataExport::ChunkRows)
+{
+}
+
+
+template <typename Row>
+void DataExport::Table<Row>::write(const Row* rows, std::size_t count) {
+	std::lock_guard<std::mutex> lock(sinkMtx);
+	sink->writeChunk(reinterpret_cast<const unsigned char*>(rows), count);
+}
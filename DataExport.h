@@ -0,0 +1,203 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+#include "ThreadSlots.h"
+
+
+/*
+* Streaming export of flight sessions and charging tickets for offline analysis.
+*
+* Rows are buffered per recording thread and handed to the output file one chunk at a time, so the
+* export never holds more than a chunk per thread in memory however long the simulation runs. Every
+* simulation owns its export, so concurrent simulations write their own files.
+*
+* Columnar layout (.evcol, little-endian, every array 8-byte aligned so a mapped file can be read in place):
+*
+*   File header, 64 bytes:   char magic[8] = "EVTOLCOL", u32 version, u32 columnCount,
+*                            u64 rowCount, u64 chunkCount (both 0 if the export did not finish), char table[32]
+*   Column headers:          columnCount x 32 bytes: char name[24], u32 type (ColumnType), u32 width in bytes
+*   Chunks, until EOF:       u64 rowCount, u64 payloadBytes, then for each column in header order
+*                            rowCount x width bytes, zero-padded to a multiple of 8
+*
+* Timestamps are microseconds since the Unix epoch (simulated time when running on a scheduler).
+* The CSV fallback writes the same columns with a header line.
+*/
+
+enum class ColumnType : std::uint32_t {
+	Int64 = 1,
+	Float64 = 2,
+	UInt32 = 3,
+	UInt16 = 4
+};
+
+
+enum class ExportFormat {
+	Columnar,			// Typed column chunks, see above
+	Csv					// Comma-separated text
+};
+
+
+struct ColumnSpec {
+	const char* name;						// Column name, at most 23 characters
+	ColumnType type;						// Element type
+	std::size_t offset;						// Offset of the field in the row struct
+};
+
+
+struct SessionRow {
+	std::int64_t start;						// Take-off time
+	std::int64_t end;						// Landing time
+	double airTime;							// Airtime in seconds
+	double miles;							// Miles flown
+	double passengerMiles;					// Passenger miles flown
+	double faults;							// Expected faults
+	std::uint32_t aircraft;					// Position of the aircraft in the fleet
+	std::uint16_t manufacturer;				// Index of the manufacturer
+};
+
+
+struct TicketRow {
+	std::int64_t requested;					// Time the request joined the queue
+	std::int64_t started;					// Time a charger picked up the request
+	std::int64_t finished;					// Time the charger released the aircraft
+	std::uint32_t aircraft;					// Position of the aircraft in the fleet
+	std::uint16_t manufacturer;				// Index of the manufacturer
+	std::uint16_t site;						// Vertiport that served the request
+};
+
+
+/* ----------------- Output files ----------------- */
+
+class ExportSink {
+public:
+	virtual ~ExportSink() = default;
+
+	virtual void writeChunk(const unsigned char* rows, std::size_t count) = 0;		// Append a chunk of rows
+	virtual void close() = 0;														// Finish the file; throws if any of it could not be written
+};
+
+
+class ColumnarFileWriter : public ExportSink {
+public:
+	ColumnarFileWriter(const std::filesystem::path& path, const std::string& table, const std::vector<ColumnSpec>& schema, std::size_t rowSize);
+
+	void writeChunk(const unsigned char* rows, std::size_t count) override;
+	void close() override;
+
+private:
+	std::filesystem::path path;					// Path of the output file
+	std::ofstream file;							// Output file
+	std::vector<ColumnSpec> schema;				// Columns of the table
+	std::size_t rowSize;						// Size of the row struct
+	std::uint64_t rowCount;						// Rows written so far
+	std::uint64_t chunkCount;					// Chunks written so far
+	std::vector<unsigned char> payload;			// Scratch buffer for one transposed chunk
+};
+
+
+class CsvFileWriter : public ExportSink {
+public:
+	CsvFileWriter(const std::filesystem::path& path, const std::vector<ColumnSpec>& schema, std::size_t rowSize);
+
+	void writeChunk(const unsigned char* rows, std::size_t count) override;
+	void close() override;
+
+private:
+	std::filesystem::path path;					// Path of the output file
+	std::ofstream file;							// Output file
+	std::vector<ColumnSpec> schema;				// Columns of the table
+	std::size_t rowSize;						// Size of the row struct
+	std::string text;							// Scratch buffer for one formatted chunk
+};
+
+
+/* ----------------- Reader ----------------- */
+
+class ColumnarReader {
+public:
+	struct Column {
+		std::string name;						// Column name
+		ColumnType type;						// Element type
+		std::uint32_t width;					// Element size in bytes
+	};
+
+	explicit ColumnarReader(const std::filesystem::path& path);		// Map a columnar file; throws if it is not one or does not fit its size
+	~ColumnarReader();
+
+	ColumnarReader(const ColumnarReader& other) = delete;				// Copy constructor
+	ColumnarReader& operator=(const ColumnarReader& other) = delete;	// Copy assignment
+
+	const std::string& getTable() const;								// Name of the table
+	const std::vector<Column>& getColumns() const;						// Columns in file order
+	std::uint64_t getRowCount() const;									// Rows over all chunks
+	std::size_t getChunkCount() const;									// Number of chunks
+	std::uint64_t getChunkRows(std::size_t chunk) const;				// Rows in a chunk
+
+	// Template function to get the array of a column within a chunk, pointing into the mapped file
+	template <typename T>
+	const T* column(std::size_t chunk, const std::string& name) const;
+
+private:
+	const unsigned char* columnData(std::size_t chunk, const std::string& name, std::size_t width) const;
+	void validate(const std::filesystem::path& path);	// Read the headers and walk the chunks, throws if they do not fit the file
+	void unmap();								// Release the mapping of the file
+
+	const unsigned char* data;					// Start of the mapped file
+	std::size_t size;							// Size of the mapped file
+	void* mappingHandle;						// Platform handle of the mapping, if any
+
+	std::string table;
+	std::vector<Column> columns;
+	std::vector<const unsigned char*> chunks;	// Start of each chunk header
+	std::uint64_t rowCount;
+};
+
+
+/* ----------------- Export stage ----------------- */
+
+class DataExport {
+public:
+	DataExport(const std::filesystem::path& directory, ExportFormat format);			// Open the export files; call before the simulation starts
+
+	DataExport(const DataExport& other) = delete;									// Copy constructor
+	DataExport& operator=(const DataExport& other) = delete;						// Copy assignment
+
+	void finish();																	// Flush all buffered rows and close the files
+	void recordSession(const SessionRow& row);										// Export a completed flight session
+	void recordTicket(const TicketRow& row);										// Export a closed charging ticket
+
+	static const std::vector<ColumnSpec>& sessionSchema();							// Columns of the sessions table
+	static const std::vector<ColumnSpec>& ticketSchema();							// Columns of the tickets table
+
+	static constexpr std::size_t ChunkRows = 8192;									// Rows buffered per thread and table
+
+private:
+	// Template struct of an exported table: its file and the rows not yet written to it
+	template <typename Row>
+	struct Table {
+		Table();																// Default constructor
+
+		void write(const Row* rows, std::size_t count);							// Write a chunk of rows to the file
+
+		std::mutex sinkMtx;														// Mutex to control access to the file
+		std::unique_ptr<ExportSink> sink;										// Output file of the table
+		ChunkBuffers<Row> rows;													// Rows not yet written, per thread
+	};
+
+	// Template function to append a row to the buffer of the calling thread, written out once the buffer is full
+	template <typename Row>
+	static void record(Table<Row>& table, const Row& row);
+
+	Table<SessionRow> sessions;													// Sessions table
+	Table<TicketRow> tickets;													// Tickets table
+
+	std::mutex finishMtx;														// Mutex to close the files once
+	bool finished;																// Flag to indicate that the files have been closed
+};
@@ -1,37 +1,36 @@
-#include <filesystem>
 #include <nlohmann/json.hpp>
 
 #include "DataLogger.h"
+#include "Simulation.h"
+#include "ScopeTimers.h"
 
 
-std::mutex DataLogger::instancesMtx;
-std::unordered_map<std::string, std::shared_ptr<DataLogger>> DataLogger::instances = {};
+void DataLogger::logData(const std::string& data) {
+	if (!aircraft->getSimulation().isLogging()) return;
 
+	TIMED_SCOPE(Logging);
 
-void DataLogger::logData(const std::string& data) {
-	std::string timeStamp = "[" + aircraft->getTimeForLogs(std::chrono::system_clock::now()) + "]";
+	Scheduler* scheduler = Scheduler::current();
+	std::chrono::time_point<std::chrono::system_clock> now = (scheduler != nullptr) ? scheduler->now() : std::chrono::system_clock::now();
+
+	std::string timeStamp = "[" + aircraft->getTimeForLogs(now) + "]";
 	std::string logData = timeStamp + " : " + data;
 
-	if (this->isFilePresent(logFile)) {
-		std::lock_guard<std::mutex> lock(fileMtx);
-		writeToFile(logData);
-	}
+	openLog(aircraft->getSimulation()).append(aircraft->getAircraftID(), LogRecordKind::Event, aircraft->getManufacturerName(), logData);
 }
 
 
 void DataLogger::performanceSummary(const std::shared_ptr<evTOL>& aircraft) {
-	json AircraftLog{};
-	
-	if (isFilePresent(summaryFile)) {
-		std::ifstream AircraftLogFile(summaryFile);
-		
-		if (!isFileEmpty(summaryFile)) AircraftLogFile >> AircraftLog;
-		else AircraftLog["Sessions"] = json::array();
-		
-		AircraftLogFile.close();
-	}
-	
-	json SessionData{};
+	/*
+	* Every session is a record of its own rather than an entry of a per-aircraft document, which had to
+	* be read and written back whole at the end of every session; the records of an aircraft together
+	* make up its summary.
+	*/
+
+	if (!aircraft->getSimulation().isLogging()) return;
+
+	TIMED_SCOPE(Summary);
+	SummaryJson SessionData{};
 
 	SessionData["Start_Time"] = aircraft->getTimeForLogs(aircraft->getStartOperationTime());
 	SessionData["End_Time"] = aircraft->getTimeForLogs(aircraft->getEndOperationTime());
@@ -39,30 +38,26 @@ void DataLogger::performanceSummary(const std::shared_ptr<evTOL>& aircraft) {
 	SessionData["Faults"] = aircraft->getFaultsPerSession();
 	SessionData["Passenger_Miles"] = aircraft->getPassengerMiles();
 
-	AircraftLog["Sessions"].emplace_back(SessionData);
-
-	if (isFilePresent(summaryFile)) {
-		std::lock_guard<std::mutex> lock(fileMtx);
-		writeToFile(AircraftLog);
-	}
+	openLog(aircraft->getSimulation()).append(aircraft->getAircraftID(), LogRecordKind::Session, aircraft->getManufacturerName(), SessionData.dump());
 }
 
 
 std::shared_ptr<DataLogger> DataLogger::getInstance(const std::shared_ptr<evTOL>& aircraft) {
-	std::string aircraftName = aircraft->getManufacturerName();
-	std::unordered_map<std::string, std::shared_ptr<DataLogger>>::iterator locate;
-	std::pair< std::unordered_map<std::string, std::shared_ptr<DataLogger>>::iterator, bool> inserter;
+	Simulation& simulation = aircraft->getSimulation();
+	const std::string& aircraftName = aircraft->getManufacturerName();
+	Simulation::LoggerMap::iterator locate;
+	std::pair<Simulation::LoggerMap::iterator, bool> inserter;
 	
-	std::lock_guard<std::mutex> lock(DataLogger::instancesMtx);
-	locate = DataLogger::instances.find(aircraftName);
-	if (locate == DataLogger::instances.end()) {
+	std::lock_guard<std::mutex> lock(simulation.loggersMtx);
+	locate = simulation.loggers.find(aircraftName);
+	if (locate == simulation.loggers.end()) {
 		std::shared_ptr<DataLogger> instance = createInstance(aircraft);
 			
 		std::pair<std::string, std::shared_ptr<DataLogger>> instanceMapData(aircraftName, std::move(instance));
-		inserter = DataLogger::instances.insert(instanceMapData);
+		inserter = simulation.loggers.insert(instanceMapData);
 			
 		if (inserter.second) {
-			inserter.first->second->logData("Log file created");
+			inserter.first->second->logData(simulation.resumed ? "Log file reopened from a checkpoint" : "Log file created");
 			return inserter.first->second;
 		}
 	}
@@ -71,48 +66,24 @@ std::shared_ptr<DataLogger> DataLogger::getInstance(const std::shared_ptr<evTOL>
 }
 
 
-bool DataLogger::isFilePresent(const std::filesystem::path& filepath) const {
-	return std::filesystem::exists(filepath);
-}
-
+SegmentedLog& DataLogger::openLog(Simulation& simulation) {
+	/*
+	* The log is opened on the first record, or by the library before the simulation starts, rather than
+	* with the simulation, so a run with logging disabled touches no files at all. A run resumed from a
+	* checkpoint continues the run of the segments that wrote it.
+	*/
 
-void DataLogger::writeToFile(const std::string& data) const {
-	std::ofstream file;
+	std::call_once(simulation.logOpened, [&simulation] {
+		simulation.log = std::make_unique<SegmentedLog>(simulation.logDirectory, simulation.resumedLogRun);
+		});
 
-	file.open(logFile, std::ios::out | std::ios::app);
-
-	if (!file) throw std::runtime_error("Unable to open file for writing");
-
-	file << data << "\n";
-
-	file.close();
-}
-
-
-bool DataLogger::isFileEmpty(const std::filesystem::path& filepath) const {
-	return (std::filesystem::file_size(filepath) == 0);
+	return *simulation.log;
 }
 
 
-void DataLogger::writeToFile(const json& LogData) const {
-	std::ofstream LogFile(summaryFile, std::ios::out | std::ios::trunc);
-
-	if (LogFile.is_open()) {
-		LogFile << LogData.dump(4);
-		LogFile.close();
-	}
-}
-
-
-DataLogger::DataLogger(const std::shared_ptr<evTOL>& aircraft) : aircraft(aircraft)
+DataLogger::DataLogger(const std::shared_ptr<evTOL>& aircraft) :
+	aircraft(aircraft)
 {
-	std::filesystem::create_directory("Logs");
-	logFile = "Logs/" + (aircraft->getManufacturerName() + "_DataLogger.txt");
-    std::ofstream log(logFile, std::ios::out | std::ios::trunc);
-
-	std::filesystem::create_directory("Summary");
-	summaryFile = "Summary/" + (aircraft->getManufacturerName() + "_Summary.json");
-	std::ofstream summary(summaryFile, std::ios::out | std::ios::trunc);
 }
 
 
@@ -124,5 +95,5 @@ inline std::shared_ptr<DataLogger> DataLogger::createInstance(Args && ...args)
 		make_shared_enabler(Args &&... args) : DataLogger(std::forward<Args>(args)...) {}
 	};
 
-	return std::make_shared<make_shared_enabler>(std::forward<Args>(args)...);
+	return std::allocate_shared<make_shared_enabler>(TrackedAllocator<make_shared_enabler, MemorySubsystem::Logging>(), std::forward<Args>(args)...);
 }
\ No newline at end of file
@@ -1,13 +1,22 @@
 #pragma once
 
+#include <map>
 #include <mutex>
 #include <string>
 #include <memory>
-#include <fstream>
-#include <filesystem>
 #include <unordered_map>
+#include <nlohmann/json.hpp>
 
 #include "evTOL.h"	
+#include "SegmentedLog.h"
+#include "MemoryAccounting.h"
+
+using json = nlohmann::json;
+
+// Summary documents allocate their objects and arrays through the memory accounting
+template <typename T>
+using SummaryAllocator = TrackedAllocator<T, MemorySubsystem::Summaries>;
+using SummaryJson = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, SummaryAllocator>;
 
 
 class DataLogger {
@@ -19,27 +28,14 @@ public:
 	DataLogger& operator= (DataLogger&& other) noexcept = default;		// Default move assignment operator
 	
 	// DataLogger public APIs
-	void logData(const std::string& data);								// Log data to the file
-	void performanceSummary(const std::shared_ptr<evTOL>& aircraft);	// Log performance summary to the file
+	void logData(const std::string& data);								// Log data to the segments of the simulation
+	void performanceSummary(const std::shared_ptr<evTOL>& aircraft);	// Log performance summary to the segments of the simulation
 
 	// Static member functions
-	static std::shared_ptr<DataLogger> getInstance(const std::shared_ptr<evTOL>& aircraft);	// Get the instance of the DataLogger	
-
-protected:
-	void writeToFile(const json& LogData) const;						// Write data to the file
-	void writeToFile(const std::string& data) const;					// Write data to the file
-	bool isFileEmpty(const std::filesystem::path& filepath) const;		// Check if the file is empty
-	bool isFilePresent(const std::filesystem::path& filepath) const;	// Check if the file exists
+	static std::shared_ptr<DataLogger> getInstance(const std::shared_ptr<evTOL>& aircraft);	// Get the instance of the DataLogger, one per aircraft of a simulation
+	static SegmentedLog& openLog(Simulation& simulation);									// Get the log of a simulation, opening it on first use
 
 private:	
-	// Static data members
-	static std::mutex instancesMtx;													// Mutex to lock the instances map
-	static std::unordered_map<std::string, std::shared_ptr<DataLogger>> instances;	// Map to store instances of the DataLogger
-
-	std::mutex fileMtx;								// Mutex to lock the file
-	std::filesystem::path logFile;					// File stream object to write data to the file
-	std::filesystem::path summaryFile;				// File stream object to write data to the file
-
 	std::shared_ptr<evTOL> aircraft;				// Aircraft object to log data
 	
 	// DataLogger Class object control methods
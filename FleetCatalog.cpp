@@ -0,0 +1,285 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+#include "MappedFile.h"
+#include "FleetCatalog.h"
+#include "BuiltinCatalog.h"
+
+using json = nlohmann::json;
+
+
+FleetCatalog::FleetCatalog() :
+	specs(nullptr),
+	numSpecs(0)
+{
+}
+
+
+FleetCatalog::~FleetCatalog() = default;
+
+
+template<typename ...Args>
+inline std::shared_ptr<FleetCatalog> FleetCatalog::createInstance(Args && ...args)
+{
+	class make_shared_enabler : public FleetCatalog {
+	public:
+		make_shared_enabler(Args &&... args) : FleetCatalog(std::forward<Args>(args)...) {}
+	};
+
+	return std::make_shared<make_shared_enabler>(std::forward<Args>(args)...);
+}
+
+
+std::shared_ptr<const FleetCatalog> FleetCatalog::load(const std::filesystem::path& path) {
+	if (path == FleetCatalog::BuiltinPath) return FleetCatalog::builtin();
+
+	std::ifstream input(path, std::ios::binary);
+	if (!input.is_open()) throw std::runtime_error("Unable to open input data json");
+
+	// A compiled catalog is recognised by its magic, whatever the file is called
+	char magic[sizeof(CatalogHeader::Magic)] = {};
+	input.read(magic, sizeof(magic));
+	bool compiled = input.gcount() == sizeof(magic) && std::memcmp(magic, CatalogHeader::Magic, sizeof(magic)) == 0;
+	input.close();
+
+	return compiled ? FleetCatalog::mapCompiled(path) : FleetCatalog::parseJson(path);
+}
+
+
+std::shared_ptr<const FleetCatalog> FleetCatalog::builtin() {
+	// The specs are constants of the program and are used in place, like a mapped catalog
+	std::shared_ptr<FleetCatalog> catalog = createInstance();
+	catalog->specs = BuiltinManufacturers;
+	catalog->numSpecs = BuiltinManufacturerCount;
+	catalog->buildIndex();
+
+	return catalog;
+}
+
+
+void FleetCatalog::compile(const std::filesystem::path& input, const std::filesystem::path& output) {
+	std::shared_ptr<const FleetCatalog> catalog = FleetCatalog::load(input);
+
+	CatalogHeader header{};
+	std::memcpy(header.magic, CatalogHeader::Magic, sizeof(header.magic));
+	header.version = CatalogHeader::Version;
+	header.specSize = static_cast<std::uint32_t>(sizeof(ManufacturerSpec));
+	header.numSpecs = catalog->numSpecs;
+
+	std::ofstream file(output, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) throw std::runtime_error("Unable to create compiled catalog " + output.string());
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(catalog->specs), static_cast<std::streamsize>(catalog->numSpecs * sizeof(ManufacturerSpec)));
+
+	if (!file) throw std::runtime_error("Unable to write compiled catalog " + output.string());
+}
+
+
+void FleetCatalog::checkBuiltin(const std::filesystem::path& input) {
+	/*
+	* BuiltinCatalog.h is a copy of Manufacturer.json made by hand. The build runs this check against the
+	* json after linking, so that a change to either file without the other fails the build.
+	*/
+
+	std::shared_ptr<const FleetCatalog> catalog = FleetCatalog::load(input);
+	std::string source = input.string();
+
+	if (catalog->numSpecs != BuiltinManufacturerCount) {
+		throw std::runtime_error(source + " has " + std::to_string(catalog->numSpecs) + " manufacturers, BuiltinCatalog.h has " + std::to_string(BuiltinManufacturerCount));
+	}
+
+	for (std::size_t i = 0; i < BuiltinManufacturerCount; ++i) {
+		const ManufacturerSpec& loaded = catalog->specs[i];
+		const ManufacturerSpec& builtin = BuiltinManufacturers[i];
+		std::string where = "Manufacturer " + std::to_string(i) + " (" + builtin.name + ") of BuiltinCatalog.h differs from " + source + " in ";
+
+		if (std::strcmp(loaded.name, builtin.name) != 0) throw std::runtime_error(where + "Name");
+		if (loaded.cruiseSpeed != builtin.cruiseSpeed) throw std::runtime_error(where + "Cruise_Speed");
+		if (loaded.passengerCount != builtin.passengerCount) throw std::runtime_error(where + "Passenger_Count");
+		if (loaded.batteryCapacity != builtin.batteryCapacity) throw std::runtime_error(where + "Battery_Capacity");
+		if (loaded.energyUseAtCruise != builtin.energyUseAtCruise) throw std::runtime_error(where + "Energy_use_at_Cruise");
+		if (loaded.faultsPerHour != builtin.faultsPerHour) throw std::runtime_error(where + "Probability_of_fault_per_hour");
+		if (loaded.timeToCharge != builtin.timeToCharge) throw std::runtime_error(where + "Time_to_Charge");
+	}
+}
+
+
+std::size_t FleetCatalog::size() const {
+	return numSpecs;
+}
+
+
+const ManufacturerSpec& FleetCatalog::getSpec(std::size_t index) const {
+	if (index >= numSpecs) throw std::out_of_range("Manufacturer index out of range.");
+	return specs[index];
+}
+
+
+std::size_t FleetCatalog::indexOf(const std::string& name) const {
+	return indices.at(name);
+}
+
+
+const std::vector<std::string>& FleetCatalog::getManufacturerNames() const {
+	return manufacturerNames;
+}
+
+
+bool FleetCatalog::isMapped() const {
+	return mapping != nullptr;
+}
+
+
+bool FleetCatalog::isBuiltin() const {
+	return specs == BuiltinManufacturers;
+}
+
+
+std::shared_ptr<FleetCatalog> FleetCatalog::parseJson(const std::filesystem::path& path) {
+	json InputData = {};
+
+	std::ifstream InputDataFile(path);
+
+	if (!InputDataFile.is_open()) throw std::runtime_error("Unable to open input data json");
+
+	InputDataFile >> InputData;
+
+	if (!InputData.contains("Manufacturers") || !InputData["Manufacturers"].is_array() || InputData["Manufacturers"].empty()) {
+		throw std::runtime_error("Input data has no manufacturers");
+	}
+
+	std::shared_ptr<FleetCatalog> catalog = createInstance();
+	const json& manufacturers = InputData["Manufacturers"];
+
+	catalog->ownedSpecs.reserve(manufacturers.size());
+
+	for (std::size_t i = 0; i < manufacturers.size(); ++i) {
+		catalog->ownedSpecs.push_back(FleetCatalog::validate(manufacturers[i], i));
+	}
+
+	catalog->specs = catalog->ownedSpecs.data();
+	catalog->numSpecs = catalog->ownedSpecs.size();
+	catalog->buildIndex();
+
+	return catalog;
+}
+
+
+ManufacturerSpec FleetCatalog::validate(const json& manufacturer, std::size_t position) {
+	/*
+	* Every field is checked here, once per manufacturer, so that nothing downstream has to look at the
+	* json again or guard against missing or nonsensical values. The json only has to hold the right
+	* types; the ranges are those of checkRanges(), which a compiled catalog goes through as well.
+	*/
+
+	std::string where = "Manufacturer " + std::to_string(position);
+
+	auto field = [&](const char* key) -> const json& {
+		if (!manufacturer.contains(key)) throw std::runtime_error(where + " has no " + key);
+		return manufacturer.at(key);
+	};
+
+	auto integer = [&](const char* key) {
+		const json& value = field(key);
+		if (!value.is_number_integer() || value.get<std::int64_t>() < INT32_MIN || value.get<std::int64_t>() > INT32_MAX) {
+			throw std::runtime_error(where + ": " + key + " must be a 32-bit integer");
+		}
+		return value.get<std::int32_t>();
+	};
+
+	auto number = [&](const char* key) {
+		const json& value = field(key);
+		if (!value.is_number()) throw std::runtime_error(where + ": " + key + " must be a number");
+		return value.get<double>();
+	};
+
+	const json& name = field("Name");
+	if (!name.is_string() || name.get<std::string>().empty() || name.get<std::string>().size() >= ManufacturerSpec::NameLength) {
+		throw std::runtime_error(where + ": Name must be a string of 1 to " + std::to_string(ManufacturerSpec::NameLength - 1) + " characters");
+	}
+
+	ManufacturerSpec spec{};
+	std::string manufacturerName = name.get<std::string>();
+	std::memcpy(spec.name, manufacturerName.c_str(), manufacturerName.size());
+
+	where = manufacturerName;
+	spec.cruiseSpeed = integer("Cruise_Speed");
+	spec.passengerCount = integer("Passenger_Count");
+	spec.batteryCapacity = integer("Battery_Capacity");
+	spec.energyUseAtCruise = number("Energy_use_at_Cruise");
+	spec.faultsPerHour = number("Probability_of_fault_per_hour");
+	spec.timeToCharge = number("Time_to_Charge");
+
+	FleetCatalog::checkRanges(spec);
+	return spec;
+}
+
+
+void FleetCatalog::checkRanges(const ManufacturerSpec& spec) {
+	// Speeds, capacities and charge times are divided by and cast to durations downstream, so none may be zero or not finite
+	std::string where(spec.name, strnlen(spec.name, ManufacturerSpec::NameLength));
+
+	auto integer = [&](const char* key, std::int32_t value, std::int32_t minimum) {
+		if (value < minimum) throw std::runtime_error(where + ": " + key + " must be an integer of at least " + std::to_string(minimum));
+	};
+
+	auto number = [&](const char* key, double value, bool positive) {
+		if (!std::isfinite(value) || value < 0.0 || (positive && value == 0.0)) {
+			throw std::runtime_error(where + ": " + key + (positive ? " must be a positive number" : " must be a non-negative number"));
+		}
+	};
+
+	integer("Cruise_Speed", spec.cruiseSpeed, 1);
+	integer("Passenger_Count", spec.passengerCount, 0);
+	integer("Battery_Capacity", spec.batteryCapacity, 1);
+	number("Energy_use_at_Cruise", spec.energyUseAtCruise, true);
+	number("Probability_of_fault_per_hour", spec.faultsPerHour, false);
+	number("Time_to_Charge", spec.timeToCharge, true);
+}
+
+
+void FleetCatalog::buildIndex() {
+	manufacturerNames.reserve(numSpecs);
+	indices.reserve(numSpecs);
+
+	for (std::size_t i = 0; i < numSpecs; ++i) {
+		const ManufacturerSpec& spec = specs[i];
+
+		std::size_t length = strnlen(spec.name, ManufacturerSpec::NameLength);
+		if (length == 0 || length == ManufacturerSpec::NameLength) throw std::runtime_error("Manufacturer " + std::to_string(i) + " has an invalid name");
+
+		manufacturerNames.emplace_back(spec.name, length);
+		if (!indices.emplace(manufacturerNames.back(), i).second) throw std::runtime_error("Manufacturer " + manufacturerNames.back() + " is listed twice");
+	}
+}
+
+
+std::shared_ptr<FleetCatalog> FleetCatalog::mapCompiled(const std::filesystem::path& path) {
+	// The catalog owns the mapping from here on and releases it if any check below fails
+	std::shared_ptr<FleetCatalog> catalog = createInstance();
+	catalog->mapping = std::make_unique<MappedFile>(path);
+
+	const CatalogHeader* header = static_cast<const CatalogHeader*>(catalog->mapping->data());
+	std::size_t mappedSize = catalog->mapping->size();
+
+	if (mappedSize < sizeof(CatalogHeader) || header->version != CatalogHeader::Version || header->specSize != sizeof(ManufacturerSpec)) {
+		throw std::runtime_error("Compiled catalog " + path.string() + " was written by an incompatible version");
+	}
+	if (header->numSpecs == 0 || header->numSpecs > mappedSize / sizeof(ManufacturerSpec)
+		|| mappedSize != sizeof(CatalogHeader) + header->numSpecs * sizeof(ManufacturerSpec)) {
+		throw std::runtime_error("Compiled catalog " + path.string() + " is truncated or corrupt");
+	}
+
+	catalog->specs = reinterpret_cast<const ManufacturerSpec*>(static_cast<const char*>(catalog->mapping->data()) + sizeof(CatalogHeader));
+	catalog->numSpecs = static_cast<std::size_t>(header->numSpecs);
+	catalog->buildIndex();
+
+	// The numbers are read in place like the names, but a corrupt or edited file must not carry values json would be refused for
+	for (std::size_t i = 0; i < catalog->numSpecs; ++i) FleetCatalog::checkRanges(catalog->specs[i]);
+
+	return catalog;
+}
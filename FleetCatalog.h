@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+#include <unordered_map>
+#include <nlohmann/json_fwd.hpp>
+
+
+/*
+* Manufacturer input data, validated once and shared read-only by any number of simulations.
+*
+* Every manufacturer is a fixed-size ManufacturerSpec in a flat table, referenced by its position in the
+* input. Aircraft copy the few numbers they need from their spec instead of looking up json fields by name.
+*
+* The table is either built from the json input or, for a compiled catalog written by compile(), mapped
+* straight from the file and used in place: loading then does no parsing at all, only a size check and
+* the range checks the json goes through. A compiled catalog uses the byte order and layout of the
+* machine that wrote it and is rejected elsewhere.
+*
+* The path "builtin" selects the manufacturers compiled into the program (see BuiltinCatalog.h).
+*/
+
+struct ManufacturerSpec {
+	static constexpr std::size_t NameLength = 32;		// Including the terminating null
+
+	char name[NameLength];				// Name of the manufacturer
+	std::int32_t cruiseSpeed;			// Cruise speed in miles per hour
+	std::int32_t passengerCount;		// Maximum passengers per flight
+	std::int32_t batteryCapacity;		// Net capacity of the battery in kWh
+	std::int32_t reserved;				// Padding, always zero
+	double energyUseAtCruise;			// Energy used at cruise speed in kWh per mile
+	double faultsPerHour;				// Probability of a fault per hour of flight
+	double timeToCharge;				// Hours to charge the battery back to 100%
+};
+
+static_assert(std::is_trivially_copyable_v<ManufacturerSpec> && sizeof(ManufacturerSpec) == 72, "ManufacturerSpec is stored as raw bytes");
+
+
+struct CatalogHeader {
+	static constexpr char Magic[8] = { 'E', 'V', 'T', 'O', 'L', 'C', 'A', 'T' };
+	static constexpr std::uint32_t Version = 1;
+
+	char magic[8];						// Identifies a compiled catalog
+	std::uint32_t version;				// Layout version of the file
+	std::uint32_t specSize;				// sizeof(ManufacturerSpec) of the writer
+	std::uint64_t numSpecs;				// Number of specs following the header
+};
+
+static_assert(sizeof(CatalogHeader) == 24, "CatalogHeader is stored as raw bytes");
+
+
+class MappedFile;
+
+
+class FleetCatalog {
+public:
+	~FleetCatalog();													// Unmaps a compiled catalog
+
+	FleetCatalog(const FleetCatalog& other) = delete;					// Copy constructor
+	FleetCatalog& operator=(const FleetCatalog& other) = delete;		// Copy assignment
+
+	static constexpr char BuiltinPath[] = "builtin";					// Catalog path of the built-in manufacturers
+
+	static std::shared_ptr<const FleetCatalog> load(const std::filesystem::path& path);		// Load a json or a compiled catalog
+	static std::shared_ptr<const FleetCatalog> builtin();										// Catalog of the built-in manufacturers
+	static void compile(const std::filesystem::path& input, const std::filesystem::path& output);	// Write a catalog as a compiled catalog
+	static void checkBuiltin(const std::filesystem::path& input);								// Throw unless a catalog holds exactly the built-in manufacturers
+
+	std::size_t size() const;												// Number of manufacturers
+	const ManufacturerSpec& getSpec(std::size_t index) const;				// Get the spec of a manufacturer by position
+	std::size_t indexOf(const std::string& name) const;						// Get the position of a manufacturer by name
+	const std::vector<std::string>& getManufacturerNames() const;			// Names of the manufacturers in input order
+	bool isMapped() const;													// Check if the specs are used in place from a compiled catalog
+	bool isBuiltin() const;													// Check if the specs are the built-in manufacturers
+
+private:
+	FleetCatalog();														// Default constructor
+
+	template<typename ...Args>
+	static std::shared_ptr<FleetCatalog> createInstance(Args &&... args);
+
+	static std::shared_ptr<FleetCatalog> parseJson(const std::filesystem::path& path);		// Validate a json catalog into an owned table
+	static std::shared_ptr<FleetCatalog> mapCompiled(const std::filesystem::path& path);		// Map a compiled catalog
+	static ManufacturerSpec validate(const nlohmann::json& manufacturer, std::size_t position);	// Check one json manufacturer and build its spec
+	static void checkRanges(const ManufacturerSpec& spec);											// Throw unless the numbers of a spec are usable, json or compiled
+
+	void buildIndex();													// Fill the names and the name index from the table
+
+	std::vector<ManufacturerSpec> ownedSpecs;							// Specs parsed from json, empty when mapped
+	const ManufacturerSpec* specs;										// First spec of the table in use
+	std::size_t numSpecs;												// Number of specs in the table
+	std::vector<std::string> manufacturerNames;							// Names of the manufacturers in input order
+	std::unordered_map<std::string, std::size_t> indices;				// Position of each manufacturer by name
+
+	std::unique_ptr<MappedFile> mapping;								// Mapped compiled catalog, null when parsed from json
+};
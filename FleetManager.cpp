@@ -1,114 +1,285 @@
 #include <random>
 #include <chrono>
-#include <fstream>
-#include <sstream>
+#include <thread>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
 #include <algorithm>
 
 #include "FleetManager.h"
+#include "SegmentedLog.h"
+#include "ThreadPlacement.h"
 
 
-std::once_flag FleetManager::initialized;
-std::size_t FleetManager::numManufacturers = 0;
-std::vector<std::thread> FleetManager::fleetThreads = {};
-std::unique_ptr<FleetManager> FleetManager::instance = nullptr;
-std::unordered_map<std::string, json> FleetManager::fleetData = {};
-std::unordered_map<std::string, std::size_t> FleetManager::fleetSizes = {};
+void FleetManager::InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts) {
+    if (simulation.tripDemand) throw std::logic_error("Trip demand needs a cooperative simulation.");
 
+    std::call_once(simulation.fleetInitialized, [&simulation, &numAircrafts] {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-void FleetManager::InitializeFleet(const std::size_t& numAircrafts) {
-    std::call_once(FleetManager::initialized, [&numAircrafts] {
-        instance = std::make_unique<FleetManager>();
+        simulation.getTimerWheel();
+        FleetManager::readInputData(simulation);
+        FleetManager::assignCapacity(simulation, numAircrafts);
         
-        instance->readInputData();
-        instance->assignCapacity(numAircrafts);
-        
-        FleetManager::fleetThreads.reserve(numAircrafts);
+        simulation.fleetThreads.reserve(numAircrafts);
 		
-		instance->constructFleet(numAircrafts);
+		FleetManager::constructFleet(simulation, numAircrafts);
+
+        for (std::shared_ptr<evTOL>& aircraft : simulation.fleet) {
+            simulation.fleetThreads.emplace_back(&evTOL::startSimulation, aircraft);
+        }
+
+        simulation.startupTime = std::chrono::steady_clock::now() - begin;
+        });
+}
+
+
+void FleetManager::InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, Scheduler& scheduler) {
+    std::call_once(simulation.fleetInitialized, [&simulation, &numAircrafts, &scheduler] {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        FleetManager::readInputData(simulation);
+        FleetManager::assignCapacity(simulation, numAircrafts);
+        FleetManager::constructFleet(simulation, numAircrafts);
+
+        if (simulation.tripDemand) {
+            // With demand the aircraft serve the trips of the dispatcher instead of flying until depleted
+            TripDispatcher::Initialize(simulation, scheduler);
+
+            for (std::size_t i = 0; i < simulation.fleet.size(); ++i) {
+                scheduler.spawn(simulation.fleet[i]->tripTask(scheduler, *simulation.dispatcher), Scheduler::makeKey(TaskGroup::Aircraft, i));
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < simulation.fleet.size(); ++i) {
+                scheduler.spawn(simulation.fleet[i]->flightTask(scheduler), Scheduler::makeKey(TaskGroup::Aircraft, i));
+            }
+        }
+
+        simulation.startupTime = std::chrono::steady_clock::now() - begin;
         });
 }
 
 
-void FleetManager::stopSimulation() {
-	evTOL::retireSimulation();
-    RequestManager::stopSimulation();
-    ChargingStation::stopSimulation();
+void FleetManager::InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, ParallelScheduler& scheduler) {
+    if (simulation.tripDemand) throw std::logic_error("Trip demand needs a cooperative simulation.");
 
-    for (std::thread& _thread : FleetManager::fleetThreads) {
+    std::call_once(simulation.fleetInitialized, [&simulation, &numAircrafts, &scheduler] {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        FleetManager::readInputData(simulation);
+        FleetManager::assignCapacity(simulation, numAircrafts);
+        FleetManager::constructFleet(simulation, numAircrafts);
+
+        // Aircraft i runs on partition i modulo the number of partitions; each worker allocates the coroutines it will run
+        ThreadPlacement::onWorkers(scheduler.numPartitions(), [&simulation, &scheduler](std::size_t p) {
+            Scheduler& partition = scheduler.partition(p);
+            for (std::size_t i = p; i < simulation.fleet.size(); i += scheduler.numPartitions()) {
+                partition.spawn(simulation.fleet[i]->flightTask(partition), Scheduler::makeKey(TaskGroup::Aircraft, i));
+            }
+            });
+
+        simulation.startupTime = std::chrono::steady_clock::now() - begin;
+        });
+}
+
+
+void FleetManager::InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, ShardedScheduler& scheduler) {
+    if (simulation.tripDemand) throw std::logic_error("Trip demand needs a cooperative simulation.");
+
+    std::call_once(simulation.fleetInitialized, [&simulation, &numAircrafts, &scheduler] {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        FleetManager::readInputData(simulation);
+        FleetManager::assignCapacity(simulation, numAircrafts);
+        FleetManager::constructFleet(simulation, numAircrafts);
+
+        // The whole fleet is built before forking, so every shard holds the same aircraft; aircraft i flies in shard i modulo the number of shards
+        scheduler.launch([&simulation, &scheduler](std::size_t shard) {
+            // The log belongs to the coordinator, which records the charges and the sessions of every aircraft
+            simulation.logging.store(false, std::memory_order_relaxed);
+
+            for (std::size_t i = shard; i < simulation.fleet.size(); i += scheduler.numShards()) {
+                scheduler.fleet().spawn(simulation.fleet[i]->shardTask(scheduler), Scheduler::makeKey(TaskGroup::Aircraft, i));
+            }
+            },
+            [&simulation](std::size_t aircraft, ShardedScheduler::TimePoint start, ShardedScheduler::TimePoint end) {
+                simulation.fleet[aircraft]->mergeSession(start, end);
+            });
+
+        // The coordinator only charges the aircraft, under the same keys as in a cooperative run
+        for (std::size_t i = 0; i < simulation.fleet.size(); ++i) {
+            scheduler.attach(i, scheduler.network().adopt(simulation.fleet[i]->networkTask(scheduler), Scheduler::makeKey(TaskGroup::Aircraft, i)));
+        }
+
+        simulation.startupTime = std::chrono::steady_clock::now() - begin;
+        });
+}
+
+
+void FleetManager::stopSimulation(Simulation& simulation) {
+	evTOL::retireSimulation(simulation);
+    RequestManager::stopSimulation(simulation);
+    ChargingStation::stopSimulation(simulation);
+
+    for (std::thread& _thread : simulation.fleetThreads) {
 		if (_thread.joinable()) _thread.join();
 	}
+
+    // Aircraft that requested a charge while winding down have spawned monitor threads after the first sweep
+    RequestManager::stopSimulation(simulation);
+
+    // Nothing logs once the threads are joined; the open segment is indexed for the readers of the log
+    if (simulation.log) simulation.log->seal();
 }
 
 
-void FleetManager::readInputData() {
-    json InputData = {};
+Scheduler::SimDuration FleetManager::getLookahead(const Simulation& simulation) {
+    /*
+    * An aircraft only hands itself to another scheduler at the start of a full flight or a full charge,
+    * so the shortest of those across the catalog bounds how far ahead any cross-scheduler event lands.
+    * One tick of slack absorbs the rounding of the per-aircraft duration casts.
+    */
 
-    std::ifstream InputDataFile("Manufacturer.json");
-    
-    if (!InputDataFile.is_open()) throw std::runtime_error("Unable to open input data json");
+    const FleetCatalog& catalog = simulation.getCatalog();
+    std::chrono::duration<double> shortest = std::chrono::duration<double>::max();
 
-    InputDataFile >> InputData;
+    for (std::size_t i = 0; i < catalog.size(); ++i) {
+        const ManufacturerSpec& spec = catalog.getSpec(i);
 
-    FleetManager::numManufacturers = InputData["Manufacturers"].size();
+        double consumptionPerHour = spec.cruiseSpeed * spec.energyUseAtCruise;
+        std::chrono::duration<double> flight(3600.0 * spec.batteryCapacity / consumptionPerHour);
+        std::chrono::duration<double> charge(3600.0 * spec.timeToCharge);
 
-    FleetManager::fleetData.reserve(FleetManager::numManufacturers);
-    FleetManager::fleetSizes.reserve(FleetManager::numManufacturers);
+        shortest = std::min({ shortest, flight, charge });
+    }
 
-    for (std::size_t i = 0; i < FleetManager::numManufacturers; ++i) {
-		json manufacturerData = InputData["Manufacturers"][i];
-		std::string key = manufacturerData.at("Name").get<std::string>();
-        
-        FleetManager::fleetSizes.emplace(key, 0);
-        FleetManager::fleetData.emplace(key, manufacturerData);
-        
+    if (catalog.size() == 0) throw std::runtime_error("Fleet data has not been loaded");
+
+    return std::chrono::duration_cast<Scheduler::SimDuration>(shortest) - Scheduler::SimDuration(1);
+}
+
+
+void FleetManager::readInputData(Simulation& simulation) {
+    /*
+    * The input is validated once into the catalog's spec table, which simulations share. Only the
+    * per-run bookkeeping is set up here, in the same order the input file lists the manufacturers.
+    */
+
+    const std::vector<std::string>& manufacturerNames = simulation.getManufacturerNames();
+
+    simulation.fleetSizes.reserve(manufacturerNames.size());
+
+    for (const std::string& key : manufacturerNames) {
+        simulation.fleetSizes.emplace(key, 0);
 	}
 
-    InputDataFile.close();
+    simulation.metrics.registerManufacturers(manufacturerNames);
 }
 
 
-void FleetManager::constructFleet(const std::size_t& numVehicles) {
-    for_each(FleetManager::fleetData.begin(), FleetManager::fleetData.end(), [&](const std::pair<const std::string, json>& data) {
-		std::string manufacturerName = data.first;
-        std::size_t fleetSize = FleetManager::fleetSizes.at(manufacturerName);
+void FleetManager::constructFleet(Simulation& simulation, const std::size_t& numVehicles) {
+    /*
+    * Manufacturers are visited in the order their capacity was assigned, so that a seed keeps
+    * producing the same fleet; each aircraft is built from the spec at its manufacturer's index.
+    *
+    * Every aircraft has a fixed slot in the fleet, so large fleets are built in contiguous ranges of
+    * slots on several threads and come out exactly as a serial build would. The serial number is
+    * formatted once for the whole fleet.
+    */
 
-        for (std::size_t j = 0; j < fleetSize; ++j) {
-            std::shared_ptr<evTOL> newAircraft = std::make_shared<FleetManager>(data.second, (j + 1));
-            FleetManager::fleetThreads.emplace_back(&evTOL::startSimulation, newAircraft);
+    struct FleetRange {
+        std::size_t first;                  // Slot of the first aircraft of the manufacturer
+        std::size_t fleetSize;              // Aircraft of the manufacturer
+        std::size_t manufacturerIndex;      // Position of the manufacturer in the catalog
+    };
+
+    const FleetCatalog& catalog = simulation.getCatalog();
+    std::vector<FleetRange> ranges;
+    std::size_t numAircraft = 0;
+
+    for (const std::pair<const std::string, std::size_t>& data : simulation.fleetSizes) {
+        ranges.push_back(FleetRange{ numAircraft, data.second, catalog.indexOf(data.first) });
+        numAircraft += data.second;
+    }
+
+    std::string serialStamp = FleetManager::generateSerialNumber(std::chrono::system_clock::now());
+    simulation.fleet.reserve(std::max(numVehicles, numAircraft));
+    simulation.fleet.resize(numAircraft);
+
+    auto build = [&](std::size_t begin, std::size_t end) {
+        for (const FleetRange& range : ranges) {
+            const ManufacturerSpec& spec = catalog.getSpec(range.manufacturerIndex);
+
+            for (std::size_t slot = std::max(begin, range.first); slot < std::min(end, range.first + range.fleetSize); ++slot) {
+                simulation.fleet[slot] = std::allocate_shared<FleetManager>(TrackedAllocator<FleetManager, MemorySubsystem::Fleet>(), spec,
+                    (slot - range.first + 1), range.manufacturerIndex, slot, range.fleetSize, simulation, serialStamp);
+            }
         }
-
-        });
+    };
+
+    std::size_t numThreads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), numAircraft / FleetManager::MinAircraftPerThread);
+
+    if (numThreads <= 1) {
+        build(0, numAircraft);
+        return;
+    }
+
+    std::vector<std::thread> builders;
+    std::vector<std::exception_ptr> failures(numThreads);
+
+    for (std::size_t t = 0; t < numThreads; ++t) {
+        builders.emplace_back([&, t] {
+            try {
+                build(numAircraft * t / numThreads, numAircraft * (t + 1) / numThreads);
+            }
+            catch (...) {
+                failures[t] = std::current_exception();
+            }
+            });
+    }
+
+    for (std::thread& builder : builders) builder.join();
+
+    for (const std::exception_ptr& failure : failures) {
+        if (failure) std::rethrow_exception(failure);
+    }
 }
 
 
-std::string FleetManager::generateSerialNumber() const {
-    std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
+std::string FleetManager::generateSerialNumber(const std::chrono::system_clock::time_point& buildTime) {
+    std::time_t t = std::chrono::system_clock::to_time_t(buildTime);
     std::tm tm;
     localtime_s(&tm, &t);
 
     const char* months[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
     const char* days[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
 
-    std::ostringstream oss;
-
-    oss << months[tm.tm_mon]
-        << std::setw(2) << std::setfill('0') << tm.tm_mday
-        << days[tm.tm_wday] 
-        << std::setw(2) << std::setfill('0') << tm.tm_hour
-        << std::setw(2) << std::setfill('0') << tm.tm_min
-        << std::setw(2) << std::setfill('0') << tm.tm_sec;
-
-    return oss.str();
+    // MMMddDDDhhmmss, written in place
+    char serial[14];
+    auto twoDigits = [](char* out, int value) {
+        out[0] = static_cast<char>('0' + value / 10);
+        out[1] = static_cast<char>('0' + value % 10);
+    };
+
+    std::memcpy(serial, months[tm.tm_mon], 3);
+    twoDigits(serial + 3, tm.tm_mday);
+    std::memcpy(serial + 5, days[tm.tm_wday], 3);
+    twoDigits(serial + 8, tm.tm_hour);
+    twoDigits(serial + 10, tm.tm_min);
+    twoDigits(serial + 12, tm.tm_sec);
+
+    return std::string(serial, sizeof(serial));
 }
 
 
-void FleetManager::assignCapacity(const std::size_t& fleetSize) {
+void FleetManager::assignCapacity(Simulation& simulation, const std::size_t& fleetSize) {
 	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937 gen(simulation.randomSeed.has_value() ? static_cast<std::mt19937::result_type>(*simulation.randomSeed) : rd());
 
+	std::size_t numManufacturers = simulation.fleetSizes.size();
 	std::size_t remainingCapacity = fleetSize;
-    std::unordered_map<std::string, std::size_t>::iterator position = FleetManager::fleetSizes.begin();
+    Simulation::FleetSizeMap::iterator position = simulation.fleetSizes.begin();
 
 	for (std::size_t i = 0; i < numManufacturers && remainingCapacity > 0; ++i) {
 		std::uniform_int_distribution<std::size_t> dist(1, remainingCapacity - (numManufacturers - 1 - i));
@@ -121,45 +292,16 @@ void FleetManager::assignCapacity(const std::size_t& fleetSize) {
 }
 
 
-void FleetManager::setManufacturerName(const std::size_t sNo) {
+void FleetManager::setManufacturerName(const std::size_t sNo, const std::string& serialStamp) {
     std::string serialNumber = (sNo < 10) ? "0" + std::to_string(sNo) : std::to_string(sNo);
-	modelNumber = evTOL::get_manufacturer() + serialNumber + "_" + generateSerialNumber();
-}
-
-
-double FleetManager::getPassengerMiles() const {
-    std::string manufacturerName = evTOL::get_manufacturer();
-    std::size_t fleetSize = FleetManager::fleetSizes.at(manufacturerName);
-	
-    return (getAirTime().count() * getCruiseSpeed() * getMaxPassengerCount() * fleetSize) / 3600.0;
+	modelNumber = evTOL::get_manufacturer() + serialNumber + "_" + serialStamp;
 }
 
 
-double FleetManager::getMilesPerSession() const {
-    /*
-    * This function is written for logging the Miles travelled per session.
-    * The result is rounded off and then truncated to 2 decimal places
-    */
-
-    double MilesTravelled = getCruiseSpeed() * (getAirTime().count() / 3600.0);
-    double factor = std::pow(10, 2);
-
-    return std::round(MilesTravelled * factor) / factor;
-}
-
-
-double FleetManager::getFaultsPerSession() const {
-    return getAirTime().count() / 3600.0;
-}
-
-
-std::string FleetManager::getManufacturerName() const {
-    return modelNumber;
-}
-
-FleetManager::FleetManager::FleetManager(const json& AircraftData, const std::size_t sNo) :
-    evTOL(AircraftData)
+FleetManager::FleetManager::FleetManager(const ManufacturerSpec& spec, const std::size_t sNo, const std::size_t manufacturerIndex, const std::size_t aircraftID, const std::size_t fleetSize,
+    Simulation& simulation, const std::string& serialStamp) :
+    evTOL(spec, manufacturerIndex, aircraftID, &simulation, fleetSize)
 {
-	setManufacturerName(sNo);
+	setManufacturerName(sNo, serialStamp);
 }
 
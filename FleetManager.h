@@ -2,52 +2,46 @@
 
 #include <string>
 #include <vector>
-#include <thread>
 #include <memory>
-#include <unordered_map>
-#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
 
 #include "evTOL.h"
+#include "Scheduler.h"
+#include "Simulation.h"
 #include "RequestManager.h"
+#include "ParallelScheduler.h"
+#include "ShardedScheduler.h"
 #include "ChargingStation.h"
 
-using json = nlohmann::json;
-
 class FleetManager : public evTOL {
 public:
-	static void InitializeFleet(const std::size_t& numAircrafts);	// Initialize the fleet
-	static void stopSimulation();									// Stop the simulation
+	static void InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts);	// Initialize the fleet
+	static void InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, Scheduler& scheduler);	// Initialize the fleet as coroutines
+	static void InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, ParallelScheduler& scheduler);	// Initialize the fleet across partitions
+	static void InitializeFleet(Simulation& simulation, const std::size_t& numAircrafts, ShardedScheduler& scheduler);	// Initialize the fleet across shard processes
+	static void stopSimulation(Simulation& simulation);				// Stop the simulation
 
-	void setManufacturerName(const std::size_t sNo);				// Set the manufacturer name
+	static Scheduler::SimDuration getLookahead(const Simulation& simulation);	// Shortest full flight or charge across all manufacturers
 
-	double getPassengerMiles() const override;						// Get the passenger miles
-	double getMilesPerSession() const override; 					// Get the miles per session
-	double getFaultsPerSession() const override;					// Get the faults per session
-	std::string getManufacturerName() const override;				// Get the manufacturer name
+	void setManufacturerName(const std::size_t sNo, const std::string& serialStamp);	// Set the manufacturer name
 
-	FleetManager() = default;										// Default constructor
-    FleetManager(const json& AircraftData, const std::size_t sNo);	// Parametrized constructor
+    FleetManager(const ManufacturerSpec& spec, const std::size_t sNo, const std::size_t manufacturerIndex, const std::size_t aircraftID, const std::size_t fleetSize,
+		Simulation& simulation, const std::string& serialStamp);	// Parametrized constructor
 
 protected:
-	void readInputData();											// Read input data
-	std::string generateSerialNumber() const;						// Generate serial number
-	void assignCapacity(const std::size_t& fleetSize);				// Assign capacity to the fleet
-	void constructFleet(const std::size_t& numVehicles);			// Construct the fleet
+	static constexpr std::size_t MinAircraftPerThread = 4096;		// Smallest share of the fleet worth building on its own thread
+
+	static std::string generateSerialNumber(const std::chrono::system_clock::time_point& buildTime);	// Generate the serial number shared by a fleet
+
+	static void readInputData(Simulation& simulation);											// Prepare the fleet sizes and metrics for the catalog
+	static void assignCapacity(Simulation& simulation, const std::size_t& fleetSize);			// Assign capacity to the fleet
+	static void constructFleet(Simulation& simulation, const std::size_t& numVehicles);		// Construct the fleet
 
 private:
 	FleetManager(const FleetManager& other) = delete;				// Copy constructor
 	FleetManager& operator= (const FleetManager& other) = delete;	// Copy assignment operator
 	FleetManager(FleetManager&& other) = delete;					// Move constructor
 	FleetManager& operator= (FleetManager&& other) = delete;		// Move assignment operator
-
-	std::string modelNumber;									// Name of the manufacturer
-
-	static std::unique_ptr<FleetManager> instance;					// Unique pointer to the FleetManager instance
-	
-	static std::once_flag initialized;									// Flag to ensure that the fleet is initialized only once
-	static std::size_t numManufacturers;								// Number of manufacturers
-	static std::vector<std::thread> fleetThreads;						// Vector of threads to manage the fleet
-	static std::unordered_map<std::string, json> fleetData;				// Map to record fleet json data
-	static std::unordered_map<std::string, std::size_t> fleetSizes;		// Map to record fleet sizes
 };
 
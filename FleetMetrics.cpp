@@ -0,0 +1,172 @@
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+
+#include "FleetMetrics.h"
+
+
+template <typename T>
+inline void FleetMetrics::accumulate(std::atomic<T>& counter, T value) {
+	// Only the owning thread writes a shard, so a load and a store replace the read-modify-write
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+
+std::int64_t FleetMetrics::toFixed(double value) {
+	return std::llround(value * FixedScale);
+}
+
+
+double FleetMetrics::fromFixed(std::int64_t units) {
+	return static_cast<double>(units) / FixedScale;
+}
+
+
+FleetMetrics::Shard::Shard(std::size_t numManufacturers) :
+	counters(std::make_unique<Counters[]>(numManufacturers)),
+	next(nullptr)
+{}
+
+
+FleetMetrics::FleetMetrics() :
+	shards(nullptr)
+{}
+
+
+FleetMetrics::~FleetMetrics() {
+	Shard* shard = shards.load();
+
+	while (shard != nullptr) {
+		Shard* next = shard->next;
+		delete shard;
+		shard = next;
+	}
+}
+
+
+void FleetMetrics::registerManufacturers(const std::vector<std::string>& names) {
+	if (shards.load() != nullptr) throw std::logic_error("Manufacturers must be registered before metrics are recorded.");
+	manufacturers = names;
+}
+
+
+void FleetMetrics::recordSession(std::size_t manufacturer, double airTime, double miles, double passengerMiles, double faults) {
+	Counters& counters = localShard().counters[manufacturer];
+
+	accumulate(counters.flights, std::uint64_t{ 1 });
+	accumulate(counters.airTime, toFixed(airTime));
+	accumulate(counters.miles, toFixed(miles));
+	accumulate(counters.passengerMiles, toFixed(passengerMiles));
+	accumulate(counters.faults, toFixed(faults));
+}
+
+
+void FleetMetrics::recordCharge(std::size_t manufacturer, double chargeTime) {
+	Counters& counters = localShard().counters[manufacturer];
+
+	accumulate(counters.charges, std::uint64_t{ 1 });
+	accumulate(counters.chargeTime, toFixed(chargeTime));
+}
+
+
+void FleetMetrics::restore(const std::vector<ManufacturerTotals>& totals) {
+	/*
+	* The totals become the starting values of the calling thread's shard. A cooperative simulation records
+	* on the thread that runs it, so its sums continue exactly as if the run had never been interrupted.
+	*/
+
+	if (totals.size() != manufacturers.size()) throw std::invalid_argument("Restored metrics do not match the registered manufacturers.");
+
+	Shard& shard = localShard();
+
+	for (std::size_t i = 0; i < totals.size(); ++i) {
+		Counters& counters = shard.counters[i];
+
+		counters.flights.store(totals[i].flights, std::memory_order_relaxed);
+		counters.airTime.store(toFixed(totals[i].airTime), std::memory_order_relaxed);
+		counters.miles.store(toFixed(totals[i].miles), std::memory_order_relaxed);
+		counters.passengerMiles.store(toFixed(totals[i].passengerMiles), std::memory_order_relaxed);
+		counters.faults.store(toFixed(totals[i].faults), std::memory_order_relaxed);
+		counters.charges.store(totals[i].charges, std::memory_order_relaxed);
+		counters.chargeTime.store(toFixed(totals[i].chargeTime), std::memory_order_relaxed);
+	}
+}
+
+
+std::vector<ManufacturerTotals> FleetMetrics::collect() const {
+	std::vector<ManufacturerTotals> totals(manufacturers.size());
+
+	for (std::size_t i = 0; i < totals.size(); ++i) {
+		std::int64_t airTime = 0, miles = 0, passengerMiles = 0, faults = 0, chargeTime = 0;
+
+		for (Shard* shard = shards.load(std::memory_order_acquire); shard != nullptr; shard = shard->next) {
+			const Counters& counters = shard->counters[i];
+
+			totals[i].flights += counters.flights.load(std::memory_order_relaxed);
+			airTime += counters.airTime.load(std::memory_order_relaxed);
+			miles += counters.miles.load(std::memory_order_relaxed);
+			passengerMiles += counters.passengerMiles.load(std::memory_order_relaxed);
+			faults += counters.faults.load(std::memory_order_relaxed);
+			totals[i].charges += counters.charges.load(std::memory_order_relaxed);
+			chargeTime += counters.chargeTime.load(std::memory_order_relaxed);
+		}
+
+		totals[i].manufacturer = manufacturers[i];
+		totals[i].airTime = fromFixed(airTime);
+		totals[i].miles = fromFixed(miles);
+		totals[i].passengerMiles = fromFixed(passengerMiles);
+		totals[i].faults = fromFixed(faults);
+		totals[i].chargeTime = fromFixed(chargeTime);
+	}
+
+	return totals;
+}
+
+
+void FleetMetrics::printReport(std::ostream& out) const {
+	std::vector<ManufacturerTotals> totals = collect();
+	ManufacturerTotals fleet{};
+	fleet.manufacturer = "Fleet";
+
+	out << "\n" << std::left << std::setw(14) << "Manufacturer" << std::right
+		<< std::setw(10) << "Flights" << std::setw(14) << "Airtime (h)" << std::setw(14) << "Miles"
+		<< std::setw(18) << "Passenger miles" << std::setw(10) << "Faults"
+		<< std::setw(10) << "Charges" << std::setw(14) << "Charging (h)" << "\n";
+
+	for (const ManufacturerTotals& total : totals) {
+		fleet.flights += total.flights;
+		fleet.airTime += total.airTime;
+		fleet.miles += total.miles;
+		fleet.passengerMiles += total.passengerMiles;
+		fleet.faults += total.faults;
+		fleet.charges += total.charges;
+		fleet.chargeTime += total.chargeTime;
+	}
+	totals.push_back(fleet);
+
+	out << std::fixed << std::setprecision(2);
+	for (const ManufacturerTotals& total : totals) {
+		out << std::left << std::setw(14) << total.manufacturer << std::right
+			<< std::setw(10) << total.flights << std::setw(14) << total.airTime / 3600.0 << std::setw(14) << total.miles
+			<< std::setw(18) << total.passengerMiles << std::setw(10) << total.faults
+			<< std::setw(10) << total.charges << std::setw(14) << total.chargeTime / 3600.0 << "\n";
+	}
+	out << std::defaultfloat;
+}
+
+
+FleetMetrics::Shard& FleetMetrics::localShard() {
+	std::size_t slot = ThreadSlots::current();
+
+	Shard* shard = shardSlots.find(slot);
+	if (shard != nullptr) return *shard;
+
+	// Shards live as long as the registry: a thread may exit before the report is printed
+	shard = new Shard(manufacturers.size());
+
+	shard->next = shards.load(std::memory_order_relaxed);
+	while (!shards.compare_exchange_weak(shard->next, shard, std::memory_order_release, std::memory_order_relaxed));
+
+	shardSlots.install(slot, shard);
+	return *shard;
+}
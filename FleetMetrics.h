@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+#include "ThreadSlots.h"
+
+
+/*
+* In-process registry of fleet-level statistics, broken down by manufacturer.
+*
+* Every thread that records a metric gets its own shard of counters the first time it does so. A shard
+* is only ever written by its owning thread, using plain relaxed loads and stores, so recording costs a
+* few uncontended memory writes and never takes a lock. Readers walk the lock-free list of shards and
+* sum them up; a read taken while the simulation is running is a consistent-enough point-in-time view,
+* a read taken after the threads have been joined is exact.
+*
+* Each simulation owns its own registry. A registry finds the shard of a thread through the thread's slot
+* (ThreadSlots.h), so the first record of a thread costs the same whether ten threads or a hundred thousand
+* have recorded before it.
+*
+* Durations, miles and faults are summed in fixed point, in millionths, rather than as doubles. Integer
+* sums do not depend on the order they are added in, so the totals come out bit for bit the same however
+* the sessions are spread over threads, partitions or shards, and in whatever order the shards are merged.
+*/
+
+struct ManufacturerTotals {
+	std::string manufacturer;			// Name of the manufacturer
+	std::uint64_t flights = 0;			// Completed flight sessions
+	double airTime = 0.0;				// Airtime in seconds
+	double miles = 0.0;					// Miles flown
+	double passengerMiles = 0.0;		// Passenger miles flown
+	double faults = 0.0;				// Expected faults given the manufacturer's fault rate
+	std::uint64_t charges = 0;			// Completed charge sessions
+	double chargeTime = 0.0;			// Time spent charging in seconds
+};
+
+
+class FleetMetrics {
+public:
+	FleetMetrics();											// Default constructor
+	~FleetMetrics();										// Frees the shards of all threads
+
+	FleetMetrics(const FleetMetrics& other) = delete;				// Copy constructor
+	FleetMetrics& operator=(const FleetMetrics& other) = delete;	// Copy assignment
+
+	void registerManufacturers(const std::vector<std::string>& names);		// Set the manufacturers metrics are recorded for
+
+	void recordSession(std::size_t manufacturer, double airTime, double miles, double passengerMiles, double faults);	// Record a completed flight
+	void recordCharge(std::size_t manufacturer, double chargeTime);														// Record a completed charge
+	void restore(const std::vector<ManufacturerTotals>& totals);			// Carry totals over from a checkpoint into the calling thread's counters
+
+	std::vector<ManufacturerTotals> collect() const;						// Merge all shards into per-manufacturer totals
+	void printReport(std::ostream& out) const;								// Print the end-of-run fleet report
+
+private:
+	static constexpr double FixedScale = 1e6;						// Fixed-point units per unit of a summed value
+
+	// Sums in fixed-point units, except the counts
+	struct Counters {
+		std::atomic<std::uint64_t> flights{ 0 };
+		std::atomic<std::int64_t> airTime{ 0 };
+		std::atomic<std::int64_t> miles{ 0 };
+		std::atomic<std::int64_t> passengerMiles{ 0 };
+		std::atomic<std::int64_t> faults{ 0 };
+		std::atomic<std::uint64_t> charges{ 0 };
+		std::atomic<std::int64_t> chargeTime{ 0 };
+	};
+
+	struct Shard {
+		explicit Shard(std::size_t numManufacturers);
+
+		std::unique_ptr<Counters[]> counters;			// One set of counters per manufacturer
+		Shard* next;									// Next shard in the registry
+	};
+
+	Shard& localShard();											// Get the shard of the calling thread, creating it on first use
+
+	// Template function to add to a counter owned by the calling thread
+	template <typename T>
+	static void accumulate(std::atomic<T>& counter, T value);
+
+	static std::int64_t toFixed(double value);						// Round a value to fixed-point units
+	static double fromFixed(std::int64_t units);					// Value of a number of fixed-point units
+
+	std::vector<std::string> manufacturers;							// Names of the manufacturers, indexed like the counters
+	std::atomic<Shard*> shards;										// Lock-free list of all shards of this registry
+	SlotTable<Shard> shardSlots;									// Shard of every thread slot that has recorded
+};
@@ -0,0 +1,349 @@
+#include <bit>
+#include <limits>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "evTOL.h"
+#include "Vertiport.h"
+#include "Simulation.h"
+#include "FleetSampler.h"
+
+
+namespace {
+
+	// Differences of either sign become small unsigned values: 0, -1, 1, -2, 2, ... map to 0, 1, 2, 3, 4, ...
+	std::uint64_t zigzag(std::int64_t value) {
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+
+	std::int64_t unzigzag(std::uint64_t value) {
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+
+	template <typename T>
+	void encodeChannel(const std::vector<T>& values, const std::vector<T>& reference, std::vector<std::uint8_t>& out) {
+		/*
+		* Each group is a width byte followed by its differences, packed least significant bit first at
+		* that width and padded to a whole byte. A group without a change is the width byte alone.
+		*/
+
+		std::uint64_t deltas[TimeSeriesStore::GroupSize];
+
+		for (std::size_t begin = 0; begin < values.size(); begin += TimeSeriesStore::GroupSize) {
+			std::size_t count = std::min(TimeSeriesStore::GroupSize, values.size() - begin);
+
+			std::uint64_t combined = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				deltas[i] = zigzag(static_cast<std::int64_t>(values[begin + i]) - static_cast<std::int64_t>(reference[begin + i]));
+				combined |= deltas[i];
+			}
+
+			int width = std::bit_width(combined);
+			out.push_back(static_cast<std::uint8_t>(width));
+
+			// At most 7 bits are pending before a value is added, and values of 32-bit channels take at most 33
+			std::uint64_t buffer = 0;
+			int bits = 0;
+
+			for (std::size_t i = 0; i < count; ++i) {
+				buffer |= deltas[i] << bits;
+				bits += width;
+
+				for (; bits >= 8; bits -= 8, buffer >>= 8) out.push_back(static_cast<std::uint8_t>(buffer));
+			}
+			if (bits > 0) out.push_back(static_cast<std::uint8_t>(buffer));
+		}
+	}
+
+
+	template <typename T>
+	const std::uint8_t* decodeChannel(const std::uint8_t* in, const std::uint8_t* end, std::vector<T>& values) {
+		constexpr int MaxWidth = 8 * sizeof(T) + 1;
+
+		for (std::size_t begin = 0; begin < values.size(); begin += TimeSeriesStore::GroupSize) {
+			std::size_t count = std::min(TimeSeriesStore::GroupSize, values.size() - begin);
+
+			if (in == end) throw std::runtime_error("Time series frame is truncated.");
+			int width = *in++;
+			if (width > MaxWidth) throw std::runtime_error("Time series frame is corrupt.");
+			if (static_cast<std::size_t>(end - in) < (count * width + 7) / 8) throw std::runtime_error("Time series frame is truncated.");
+
+			std::uint64_t mask = (std::uint64_t(1) << width) - 1;
+			std::uint64_t buffer = 0;
+			int bits = 0;
+
+			for (std::size_t i = 0; i < count; ++i) {
+				for (; bits < width; bits += 8) buffer |= static_cast<std::uint64_t>(*in++) << bits;
+
+				values[begin + i] = static_cast<T>(static_cast<std::int64_t>(values[begin + i]) + unzigzag(buffer & mask));
+				buffer >>= width;
+				bits -= width;
+			}
+		}
+
+		return in;
+	}
+
+}
+
+
+/* ----------------- Time series ----------------- */
+
+TimeSeriesStore::TimeSeriesStore(std::size_t aircraft, std::size_t sites, std::chrono::microseconds interval) :
+	aircraft(aircraft),
+	sites(sites),
+	interval(interval),
+	previous(emptySample()),
+	encodedBytes(0)
+{
+	if (interval <= std::chrono::microseconds::zero()) throw std::invalid_argument("Sampling interval must be positive.");
+}
+
+
+void TimeSeriesStore::append(const FleetSample& sample) {
+	if (sample.batteryLevels.size() != aircraft || sample.phases.size() != aircraft
+		|| sample.busyChargers.size() != sites || sample.queuedRequests.size() != sites) {
+		throw std::invalid_argument("Sample does not match the fleet of the time series.");
+	}
+	if (!frames.empty() && sample.time <= frames.back().time) throw std::logic_error("Samples must be appended in order of time.");
+
+	scratch.clear();
+	encode(sample, frames.size() % KeyframeInterval == 0, scratch);
+
+	// Copied out at its exact size, so the frames hold no spare capacity however many there are
+	frames.push_back(Frame{ sample.time, Bytes(scratch.begin(), scratch.end()) });
+	encodedBytes += scratch.size();
+
+	previous.time = sample.time;
+	previous.batteryLevels.assign(sample.batteryLevels.begin(), sample.batteryLevels.end());
+	previous.phases.assign(sample.phases.begin(), sample.phases.end());
+	previous.busyChargers.assign(sample.busyChargers.begin(), sample.busyChargers.end());
+	previous.queuedRequests.assign(sample.queuedRequests.begin(), sample.queuedRequests.end());
+}
+
+
+void TimeSeriesStore::decode(std::int64_t from, std::int64_t to, const std::function<bool(const FleetSample&)>& visit) const {
+	if (frames.empty() || from > to) return;
+
+	// Decoding starts at the keyframe before the first frame in range
+	std::size_t first = static_cast<std::size_t>(std::lower_bound(frames.begin(), frames.end(), from,
+		[](const Frame& frame, std::int64_t time) { return frame.time < time; }) - frames.begin());
+	if (first == frames.size()) return;
+
+	FleetSample sample = emptySample();
+
+	for (std::size_t i = first - first % KeyframeInterval; i < frames.size() && frames[i].time <= to; ++i) {
+		decodeFrame(frames[i], i % KeyframeInterval == 0, sample);
+		if (i >= first && !visit(sample)) return;
+	}
+}
+
+
+std::size_t TimeSeriesStore::getFrameCount() const {
+	return frames.size();
+}
+
+
+std::size_t TimeSeriesStore::getAircraftCount() const {
+	return aircraft;
+}
+
+
+std::size_t TimeSeriesStore::getSiteCount() const {
+	return sites;
+}
+
+
+std::chrono::microseconds TimeSeriesStore::getInterval() const {
+	return interval;
+}
+
+
+std::size_t TimeSeriesStore::getEncodedBytes() const {
+	return encodedBytes;
+}
+
+
+std::size_t TimeSeriesStore::getRawBytes() const {
+	std::size_t frameBytes = sizeof(std::int64_t) + aircraft * 2 * sizeof(std::uint8_t) + sites * 2 * sizeof(std::uint32_t);
+	return frames.size() * frameBytes;
+}
+
+
+void TimeSeriesStore::write(const std::filesystem::path& path) const {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) throw std::runtime_error("Unable to create time series " + path.string());
+
+	TimeSeriesHeader header{};
+	std::memcpy(header.magic, TimeSeriesHeader::Magic, sizeof(header.magic));
+	header.version = TimeSeriesHeader::Version;
+	header.headerSize = static_cast<std::uint32_t>(sizeof(TimeSeriesHeader));
+	header.aircraft = static_cast<std::uint32_t>(aircraft);
+	header.sites = static_cast<std::uint32_t>(sites);
+	header.interval = interval.count();
+	header.frameCount = frames.size();
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (const Frame& frame : frames) {
+		std::uint64_t size = frame.bytes.size();
+		file.write(reinterpret_cast<const char*>(&frame.time), sizeof(frame.time));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char*>(frame.bytes.data()), static_cast<std::streamsize>(size));
+	}
+
+	file.close();
+	if (!file) throw std::runtime_error("Unable to write time series " + path.string());
+}
+
+
+TimeSeriesStore TimeSeriesStore::load(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) throw std::runtime_error("Unable to open time series " + path.string());
+
+	TimeSeriesHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, TimeSeriesHeader::Magic, sizeof(header.magic)) != 0) {
+		throw std::runtime_error(path.string() + " is not a time series file.");
+	}
+	if (header.version != TimeSeriesHeader::Version || header.headerSize != sizeof(TimeSeriesHeader)) {
+		throw std::runtime_error(path.string() + " was written by another version of the simulator.");
+	}
+
+	TimeSeriesStore store(header.aircraft, header.sites, std::chrono::microseconds(header.interval));
+	std::uint64_t fileSize = std::filesystem::file_size(path);
+
+	for (std::uint64_t f = 0; f < header.frameCount; ++f) {
+		std::int64_t time = 0;
+		std::uint64_t size = 0;
+		if (!file.read(reinterpret_cast<char*>(&time), sizeof(time)) || !file.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > fileSize) {
+			throw std::runtime_error(path.string() + " is truncated.");
+		}
+
+		Bytes bytes(static_cast<std::size_t>(size));
+		if (!file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size))) throw std::runtime_error(path.string() + " is truncated.");
+
+		store.frames.push_back(Frame{ time, std::move(bytes) });
+		store.encodedBytes += static_cast<std::size_t>(size);
+	}
+
+	// Every frame is decoded once, which checks the file and leaves the last frame as the reference of the next
+	std::int64_t last = store.frames.empty() ? 0 : store.frames.back().time;
+	store.decode(std::numeric_limits<std::int64_t>::min(), last, [&](const FleetSample& sample) {
+		if (sample.time == last) store.previous = sample;
+		return true;
+		});
+
+	return store;
+}
+
+
+void TimeSeriesStore::encode(const FleetSample& sample, bool keyframe, std::vector<std::uint8_t>& out) const {
+	FleetSample zeros;
+	const FleetSample* reference = &previous;
+
+	if (keyframe) {
+		zeros = emptySample();
+		reference = &zeros;
+	}
+
+	encodeChannel(sample.batteryLevels, reference->batteryLevels, out);
+	encodeChannel(sample.phases, reference->phases, out);
+	encodeChannel(sample.busyChargers, reference->busyChargers, out);
+	encodeChannel(sample.queuedRequests, reference->queuedRequests, out);
+}
+
+
+void TimeSeriesStore::decodeFrame(const Frame& frame, bool keyframe, FleetSample& sample) const {
+	if (keyframe) {
+		std::fill(sample.batteryLevels.begin(), sample.batteryLevels.end(), std::uint8_t(0));
+		std::fill(sample.phases.begin(), sample.phases.end(), std::uint8_t(0));
+		std::fill(sample.busyChargers.begin(), sample.busyChargers.end(), 0u);
+		std::fill(sample.queuedRequests.begin(), sample.queuedRequests.end(), 0u);
+	}
+
+	const std::uint8_t* in = frame.bytes.data();
+	const std::uint8_t* end = in + frame.bytes.size();
+
+	in = decodeChannel(in, end, sample.batteryLevels);
+	in = decodeChannel(in, end, sample.phases);
+	in = decodeChannel(in, end, sample.busyChargers);
+	in = decodeChannel(in, end, sample.queuedRequests);
+	if (in != end) throw std::runtime_error("Time series frame is corrupt.");
+
+	sample.time = frame.time;
+}
+
+
+FleetSample TimeSeriesStore::emptySample() const {
+	return FleetSample{ 0, std::vector<std::uint8_t>(aircraft), std::vector<std::uint8_t>(aircraft),
+		std::vector<std::uint32_t>(sites), std::vector<std::uint32_t>(sites) };
+}
+
+
+/* ----------------- Sampler ----------------- */
+
+FleetSampler::FleetSampler(const Simulation& simulation, std::chrono::microseconds interval, std::chrono::microseconds simulated) :
+	simulation(simulation),
+	store(simulation.getFleet().size(), simulation.getSiteCount(), interval),
+	nextSample(((simulated + interval - std::chrono::microseconds(1)) / interval) * interval)
+{
+	current.batteryLevels.resize(simulation.getFleet().size());
+	current.phases.resize(simulation.getFleet().size());
+	current.busyChargers.resize(simulation.getSiteCount());
+	current.queuedRequests.resize(simulation.getSiteCount());
+}
+
+
+std::chrono::microseconds FleetSampler::getNextSample() const {
+	return nextSample;
+}
+
+
+void FleetSampler::sample(std::chrono::microseconds simulated, std::chrono::time_point<std::chrono::system_clock> now) {
+	/*
+	* Called between two runs of the schedulers, when no coroutine is running, so the aircraft and the
+	* vertiports are read directly.
+	*/
+
+	if (simulated < nextSample) return;
+
+	const Simulation::FleetList& fleet = simulation.getFleet();
+	for (std::size_t i = 0; i < fleet.size(); ++i) {
+		current.batteryLevels[i] = static_cast<std::uint8_t>(fleet[i]->getBatteryLevelAt(now));
+		current.phases[i] = static_cast<std::uint8_t>(fleet[i]->getFlightPhase());
+	}
+
+	for (std::size_t i = 0; i < simulation.getSiteCount(); ++i) {
+		const Vertiport& site = simulation.getSite(i);
+		current.busyChargers[i] = static_cast<std::uint32_t>(site.getBusyChargers());
+		current.queuedRequests[i] = static_cast<std::uint32_t>(site.getQueueDepth());
+	}
+
+	current.time = simulated.count();
+	store.append(current);
+
+	nextSample = (simulated / store.getInterval() + 1) * store.getInterval();
+}
+
+
+const TimeSeriesStore& FleetSampler::getStore() const {
+	return store;
+}
+
+
+void FleetSampler::printReport(std::ostream& out) const {
+	double raw = static_cast<double>(std::max<std::size_t>(store.getRawBytes(), 1));
+
+	out << "\n" << "Fleet state sampled every " << std::chrono::duration<double, std::ratio<60>>(store.getInterval()).count() << " simulated minutes" << "\n";
+	out << std::left << std::setw(12) << "Frames" << std::setw(12) << "Aircraft" << std::setw(12) << "Sites"
+		<< std::setw(16) << "Encoded bytes" << std::setw(16) << "Raw bytes" << std::setw(12) << "Encoded %" << "\n";
+	out << std::setw(12) << store.getFrameCount() << std::setw(12) << store.getAircraftCount() << std::setw(12) << store.getSiteCount()
+		<< std::setw(16) << store.getEncodedBytes() << std::setw(16) << store.getRawBytes()
+		<< std::fixed << std::setprecision(2) << std::setw(12) << 100.0 * static_cast<double>(store.getEncodedBytes()) / raw
+		<< std::defaultfloat << std::right << "\n";
+}
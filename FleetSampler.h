@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <functional>
+#include <filesystem>
+
+#include "MemoryAccounting.h"
+
+
+class Simulation;
+
+/*
+* Time series of the state of a fleet, sampled at a fixed interval of simulated time.
+*
+* A frame holds the battery level and flight phase of every aircraft and the busy chargers and queued
+* requests of every vertiport. Frames are kept encoded: every value is stored as the zigzagged
+* difference to the same value in the previous frame, and the differences are bit-packed in groups of
+* GroupSize at the width of the largest one in the group. Between two samples most aircraft keep their
+* phase and lose a few percent of battery at most, so a group of 128 aircraft usually packs into a few
+* bytes per channel, and a group where nothing changed into its width byte alone.
+*
+* Every KeyframeInterval-th frame is encoded against zero instead of its predecessor, so a time range is
+* decoded from the keyframe before it rather than from the start of the run.
+*
+* File layout (native byte order of the writer):
+*
+*   TimeSeriesHeader
+*   frameCount x { i64 time, u64 size, size bytes of the encoded frame }
+*/
+
+struct FleetSample {
+	std::int64_t time;								// Simulated microseconds since the start of the run
+	std::vector<std::uint8_t> batteryLevels;		// Battery level in percent, per aircraft
+	std::vector<std::uint8_t> phases;				// FlightPhase, per aircraft
+	std::vector<std::uint32_t> busyChargers;		// Chargers charging, per vertiport
+	std::vector<std::uint32_t> queuedRequests;		// Requests waiting for a charger, per vertiport
+};
+
+
+struct TimeSeriesHeader {
+	static constexpr char Magic[8] = { 'E', 'V', 'T', 'O', 'L', 'T', 'S', 'S' };
+	static constexpr std::uint32_t Version = 1;
+
+	char magic[8];						// Identifies a time series file
+	std::uint32_t version;				// Layout version of the file
+	std::uint32_t headerSize;			// sizeof(TimeSeriesHeader) of the writer
+	std::uint32_t aircraft;				// Aircraft per frame
+	std::uint32_t sites;				// Vertiports per frame
+	std::int64_t interval;				// Simulated microseconds between two frames
+	std::uint64_t frameCount;			// Frames in the file
+};
+
+
+class TimeSeriesStore {
+public:
+	static constexpr std::size_t GroupSize = 128;			// Values packed at a common width
+	static constexpr std::size_t KeyframeInterval = 64;		// Frames from one keyframe to the next
+
+	TimeSeriesStore(std::size_t aircraft, std::size_t sites, std::chrono::microseconds interval);
+
+	void append(const FleetSample& sample);					// Encode a frame; frames are appended in order of time
+
+	// Call visit for every frame with from <= time <= to, in order of time, until it returns false
+	void decode(std::int64_t from, std::int64_t to, const std::function<bool(const FleetSample&)>& visit) const;
+
+	std::size_t getFrameCount() const;						// Get the number of frames
+	std::size_t getAircraftCount() const;					// Get the number of aircraft per frame
+	std::size_t getSiteCount() const;						// Get the number of vertiports per frame
+	std::chrono::microseconds getInterval() const;			// Get the simulated time between two frames
+	std::size_t getEncodedBytes() const;					// Get the bytes of the encoded frames
+	std::size_t getRawBytes() const;						// Get the bytes the frames would take unencoded
+
+	void write(const std::filesystem::path& path) const;				// Write all frames to a file
+	static TimeSeriesStore load(const std::filesystem::path& path);		// Read a file written by write()
+
+private:
+	using Bytes = TrackedVector<std::uint8_t, MemorySubsystem::Samples>;
+
+	struct Frame {
+		std::int64_t time;					// Time of the sample
+		Bytes bytes;						// Encoded channels of the sample
+	};
+
+	void encode(const FleetSample& sample, bool keyframe, std::vector<std::uint8_t>& out) const;	// Encode a frame against the previous one
+	void decodeFrame(const Frame& frame, bool keyframe, FleetSample& sample) const;					// Decode a frame over the one before it
+	FleetSample emptySample() const;																// Frame of zeros, the reference of a keyframe
+
+	std::size_t aircraft;										// Aircraft per frame
+	std::size_t sites;											// Vertiports per frame
+	std::chrono::microseconds interval;							// Simulated time between two frames
+
+	TrackedVector<Frame, MemorySubsystem::Samples> frames;		// Encoded frames in order of time
+	FleetSample previous;										// Last frame appended, the reference of the next one
+	std::vector<std::uint8_t> scratch;							// Buffer a frame is encoded into
+	std::size_t encodedBytes;									// Bytes of the encoded frames
+};
+
+
+class FleetSampler {
+public:
+	FleetSampler(const Simulation& simulation, std::chrono::microseconds interval, std::chrono::microseconds simulated);	// First sample at the next multiple of the interval
+
+	std::chrono::microseconds getNextSample() const;			// Get the simulated time the next sample is due at
+	void sample(std::chrono::microseconds simulated, std::chrono::time_point<std::chrono::system_clock> now);	// Record the fleet if a sample is due
+
+	const TimeSeriesStore& getStore() const;					// Get the samples recorded so far
+	void printReport(std::ostream& out) const;					// Print the size of the time series
+
+private:
+	const Simulation& simulation;								// Simulation being sampled
+	TimeSeriesStore store;										// Encoded samples
+	FleetSample current;										// Buffer the fleet is sampled into
+	std::chrono::microseconds nextSample;						// Simulated time the next sample is due at
+};
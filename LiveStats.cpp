@@ -0,0 +1,259 @@
+#include <new>
+#include <set>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include "evTOL.h"
+#include "LiveStats.h"
+#include "Scheduler.h"
+#include "Vertiport.h"
+#include "Simulation.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+namespace {
+	// Segments published by the simulations of this process; two publishers of one segment would overwrite each other
+	std::mutex segmentsMtx;
+	std::set<std::string> segmentsInUse;
+}
+
+
+std::unique_ptr<LiveStats> LiveStats::start(const std::string& name, const Simulation& simulation, const std::vector<const Scheduler*>& schedulers, std::chrono::milliseconds interval) {
+	{
+		std::lock_guard<std::mutex> lock(segmentsMtx);
+		if (!segmentsInUse.insert(name).second) {
+			std::cerr << "Live statistics disabled: shared memory segment " << name << " is published by another simulation" << "\n";
+			return nullptr;
+		}
+	}
+
+	std::unique_ptr<LiveStats> stats(new LiveStats(simulation, schedulers, interval));
+	stats->segmentName = name;
+
+	if (!stats->mapSegment(name)) {
+		std::cerr << "Live statistics disabled: shared memory segment " << name << " could not be created" << "\n";
+
+		std::lock_guard<std::mutex> lock(segmentsMtx);
+		segmentsInUse.erase(name);
+		return nullptr;
+	}
+
+	stats->publish(true);
+	stats->publisher = std::thread(&LiveStats::publisherLoop, stats.get());
+
+	return stats;
+}
+
+
+LiveStats::LiveStats(const Simulation& simulation, const std::vector<const Scheduler*>& schedulers, std::chrono::milliseconds interval) :
+	block(nullptr),
+	segmentHandle(nullptr),
+	simulation(simulation),
+	schedulers(schedulers),
+	interval(interval),
+	stopping(false),
+	lastEvents(0),
+	lastPublish(std::chrono::steady_clock::now())
+{
+}
+
+
+LiveStats::~LiveStats() {
+	stop();
+}
+
+
+void LiveStats::stop() {
+	if (block == nullptr) return;
+
+	{
+		std::lock_guard<std::mutex> lock(publisherMtx);
+		stopping = true;
+	}
+	stopNotification.notify_all();
+
+	if (publisher.joinable()) publisher.join();
+
+	// Viewers still attached keep their mapping and see the simulation as stopped
+	publish(false);
+	unmapSegment();
+
+	std::lock_guard<std::mutex> lock(segmentsMtx);
+	segmentsInUse.erase(segmentName);
+}
+
+
+void LiveStats::publisherLoop() {
+	std::unique_lock<std::mutex> lock(publisherMtx);
+
+	while (!stopNotification.wait_for(lock, interval, [this] { return stopping; })) {
+		lock.unlock();
+		publish(true);
+		lock.lock();
+	}
+}
+
+
+void LiveStats::publish(bool running) {
+	/*
+	* The snapshot is sampled into local memory first so that the sequence stays odd only for the
+	* duration of a single copy; readers retry for at most that long.
+	*/
+
+	LiveStatsSnapshot snapshot{};
+	sample(snapshot);
+	snapshot.running = running ? 1 : 0;
+
+	std::uint64_t sequence = block->sequence.load(std::memory_order_relaxed);
+	snapshot.publishCount = sequence / 2 + 1;
+
+	block->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	std::memcpy(&block->snapshot, &snapshot, sizeof(snapshot));
+
+	block->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+
+void LiveStats::sample(LiveStatsSnapshot& snapshot) {
+	/*
+	* Only atomic counters of the simulation are read here; the simulation threads are never locked.
+	*/
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	snapshot.magic = LiveStatsMagic;
+	snapshot.version = LiveStatsVersion;
+	snapshot.processID = static_cast<std::uint32_t>(getpid());
+	snapshot.publishedAt = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	std::vector<ManufacturerTotals> totals = simulation.getMetrics().collect();
+	snapshot.numManufacturers = static_cast<std::uint32_t>(std::min(totals.size(), LiveStatsSnapshot::MaxManufacturers));
+
+	std::uint64_t completed = 0;
+	for (std::size_t i = 0; i < totals.size(); ++i) {
+		completed += totals[i].flights + totals[i].charges;
+		if (i >= snapshot.numManufacturers) continue;
+
+		LiveStatsSnapshot::Manufacturer& manufacturer = snapshot.manufacturers[i];
+		std::strncpy(manufacturer.name, totals[i].manufacturer.c_str(), LiveStatsSnapshot::NameLength - 1);
+		manufacturer.flights = totals[i].flights;
+		manufacturer.charges = totals[i].charges;
+		manufacturer.airTime = totals[i].airTime;
+		manufacturer.miles = totals[i].miles;
+		manufacturer.passengerMiles = totals[i].passengerMiles;
+		manufacturer.faults = totals[i].faults;
+		manufacturer.chargeTime = totals[i].chargeTime;
+	}
+
+	snapshot.events = 0;
+	for (const Scheduler* scheduler : schedulers) {
+		snapshot.events += scheduler->getProcessedEvents();
+	}
+	if (schedulers.empty()) snapshot.events = completed;
+
+	double seconds = std::chrono::duration<double>(now - lastPublish).count();
+	if (seconds > 0.0) snapshot.eventsPerSecond = (snapshot.events - lastEvents) / seconds;
+	lastEvents = snapshot.events;
+	lastPublish = now;
+
+	snapshot.numSites = static_cast<std::uint32_t>(std::min(simulation.getSiteCount(), LiveStatsSnapshot::MaxSites));
+	for (std::size_t i = 0; i < simulation.getSiteCount(); ++i) {
+		Vertiport& site = simulation.getSite(i);
+
+		snapshot.waiting += static_cast<std::uint32_t>(site.getQueueDepth());
+		snapshot.charging += static_cast<std::uint32_t>(site.getBusyChargers());
+		if (i >= snapshot.numSites) continue;
+
+		snapshot.sites[i].chargers = static_cast<std::uint32_t>(site.getChargerCount());
+		snapshot.sites[i].busy = static_cast<std::uint32_t>(site.getBusyChargers());
+		snapshot.sites[i].queued = static_cast<std::uint32_t>(site.getQueueDepth());
+		snapshot.sites[i].expectedWait = site.getExpectedWait().count();
+	}
+
+	const Simulation::FleetList& fleet = simulation.getFleet();
+	snapshot.aircraft = static_cast<std::uint32_t>(fleet.size());
+	for (const std::shared_ptr<evTOL>& aircraft : fleet) {
+		if (!aircraft->getChargingStatus()) ++snapshot.flying;
+	}
+}
+
+
+#ifdef _WIN32
+
+bool LiveStats::mapSegment(const std::string& name) {
+	// Windows mapping names may not contain a leading slash
+	std::string mappingName = "Local\\" + name.substr(name.find_first_not_of('/'));
+
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+		static_cast<DWORD>(sizeof(LiveStatsBlock)), mappingName.c_str());
+	if (mapping == nullptr) return false;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LiveStatsBlock));
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	block = new (view) LiveStatsBlock{};
+	segmentHandle = mapping;
+
+	return true;
+}
+
+
+void LiveStats::unmapSegment() {
+	UnmapViewOfFile(block);
+	CloseHandle(static_cast<HANDLE>(segmentHandle));
+
+	block = nullptr;
+	segmentHandle = nullptr;
+}
+
+#else
+
+bool LiveStats::mapSegment(const std::string& name) {
+	int descriptor = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (descriptor < 0) return false;
+
+	if (ftruncate(descriptor, sizeof(LiveStatsBlock)) != 0) {
+		close(descriptor);
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	void* view = mmap(nullptr, sizeof(LiveStatsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+
+	if (view == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	block = new (view) LiveStatsBlock{};
+
+	return true;
+}
+
+
+void LiveStats::unmapSegment() {
+	munmap(block, sizeof(LiveStatsBlock));
+	shm_unlink(segmentName.c_str());
+
+	block = nullptr;
+}
+
+#endif
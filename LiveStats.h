@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+
+
+class Scheduler;
+class Simulation;
+
+/*
+* Live statistics of a running simulation, published into a named shared-memory segment so that
+* external tools can watch the simulation without touching its log files.
+*
+* The segment holds a single LiveStatsBlock guarded by a seqlock. The publisher thread of the simulator
+* is the only writer: it bumps the sequence to an odd value, copies a fresh snapshot in and bumps the
+* sequence to the next even value. Readers copy the snapshot out and retry if the sequence was odd or
+* changed while they were copying. Readers never write to the segment, so they can neither block nor
+* slow down the simulation.
+*
+* Every simulation that publishes has a publisher of its own. Simulations of one process publish to
+* different segments; a segment already published by another simulation of the process is refused.
+*/
+
+constexpr char LiveStatsDefaultName[] = "/evtolsim_stats";	// Default name of the shared-memory segment
+constexpr std::uint32_t LiveStatsMagic = 0x53544C45;			// Marks a segment written by the simulator
+constexpr std::uint32_t LiveStatsVersion = 1;					// Layout version of LiveStatsSnapshot
+
+
+struct LiveStatsSnapshot {
+	static constexpr std::size_t MaxSites = 64;					// Vertiports beyond this are not published
+	static constexpr std::size_t MaxManufacturers = 16;			// Manufacturers beyond this are not published
+	static constexpr std::size_t NameLength = 32;				// Including the terminating null
+
+	struct Site {
+		std::uint32_t chargers;									// Chargers at the vertiport
+		std::uint32_t busy;										// Chargers currently charging
+		std::uint32_t queued;									// Requests waiting for a charger
+		std::int64_t expectedWait;								// Expected wait of a new request in simulated microseconds
+	};
+
+	struct Manufacturer {
+		char name[NameLength];									// Name of the manufacturer
+		std::uint64_t flights;									// Completed flight sessions
+		std::uint64_t charges;									// Completed charge sessions
+		double airTime;											// Airtime in seconds
+		double miles;											// Miles flown
+		double passengerMiles;									// Passenger miles flown
+		double faults;											// Expected faults
+		double chargeTime;										// Time spent charging in seconds
+	};
+
+	std::uint32_t magic;										// LiveStatsMagic once the first snapshot is published
+	std::uint32_t version;										// LiveStatsVersion
+	std::uint32_t running;										// Zero once the simulation has stopped
+	std::uint32_t processID;									// Process ID of the simulator
+	std::uint64_t publishCount;									// Number of snapshots published so far
+	std::int64_t publishedAt;									// Wall-clock time of the snapshot in microseconds since the Unix epoch
+
+	std::uint64_t events;										// Scheduler events, or completed flights and charges on threads
+	double eventsPerSecond;										// Event rate since the previous snapshot
+
+	std::uint32_t aircraft;										// Aircraft in the fleet
+	std::uint32_t flying;										// Aircraft in the air
+	std::uint32_t waiting;										// Aircraft waiting for a charger
+	std::uint32_t charging;										// Aircraft at a charger
+
+	std::uint32_t numSites;										// Entries used in sites
+	std::uint32_t numManufacturers;								// Entries used in manufacturers
+	Site sites[MaxSites];
+	Manufacturer manufacturers[MaxManufacturers];
+};
+
+
+struct LiveStatsBlock {
+	std::atomic<std::uint64_t> sequence;						// Seqlock sequence, odd while the publisher is writing
+	LiveStatsSnapshot snapshot;									// Latest published snapshot
+};
+
+
+class LiveStats {
+public:
+	// Create the segment and start publishing every interval; returns null if the segment cannot be created
+	static std::unique_ptr<LiveStats> start(const std::string& name, const Simulation& simulation, const std::vector<const Scheduler*>& schedulers,
+		std::chrono::milliseconds interval = std::chrono::milliseconds(100));
+	~LiveStats();												// Stops publishing
+
+	LiveStats(const LiveStats& other) = delete;					// Copy constructor
+	LiveStats& operator=(const LiveStats& other) = delete;		// Copy assignment
+
+	void stop();												// Publish a final snapshot, stop the publisher and remove the segment
+
+private:
+	LiveStats(const Simulation& simulation, const std::vector<const Scheduler*>& schedulers, std::chrono::milliseconds interval);	// Parametrized constructor
+
+	void publisherLoop();										// Body of the publisher thread
+	void publish(bool running);									// Sample the simulation and write one snapshot
+	void sample(LiveStatsSnapshot& snapshot);					// Fill a snapshot from the simulation counters
+
+	bool mapSegment(const std::string& name);					// Create and map the shared-memory segment
+	void unmapSegment();										// Unmap and remove the shared-memory segment
+
+	LiveStatsBlock* block;										// Mapped segment, null when not publishing
+	std::string segmentName;									// Name of the mapped segment
+	void* segmentHandle;										// Platform handle of the segment, if any
+
+	const Simulation& simulation;								// Simulation being published
+	std::vector<const Scheduler*> schedulers;					// Schedulers whose event counts are published
+	std::chrono::milliseconds interval;							// Time between two snapshots
+	std::thread publisher;										// Thread publishing the snapshots
+
+	std::mutex publisherMtx;									// Mutex for the stop notification
+	std::condition_variable stopNotification;					// Wakes the publisher when stopping
+	bool stopping;												// Flag to stop the publisher
+
+	std::uint64_t lastEvents;									// Event count of the previous snapshot
+	std::chrono::steady_clock::time_point lastPublish;			// Time of the previous snapshot
+};
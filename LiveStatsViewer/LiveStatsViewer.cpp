@@ -0,0 +1,145 @@
+// LiveStatsViewer.cpp : Attaches to the live statistics of a running SimpleSimulator and prints them.
+
+#include "../LiveStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+/*
+* Usage: LiveStatsViewer [name] [--once] [--interval <ms>]
+*
+* The segment is mapped read-only. A snapshot is copied out under the seqlock of the simulator:
+* the copy is retried whenever the sequence was odd (a write in progress) or changed during the copy.
+* The viewer never writes to the segment, so it cannot stall the simulator.
+*/
+
+
+const LiveStatsBlock* attach(const std::string& name) {
+#ifdef _WIN32
+	std::string mappingName = "Local\\" + name.substr(name.find_first_not_of('/'));
+
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName.c_str());
+	if (mapping == nullptr) return nullptr;
+
+	// The view keeps the mapping alive after the handle is closed
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(LiveStatsBlock));
+	CloseHandle(mapping);
+
+	return static_cast<const LiveStatsBlock*>(view);
+#else
+	int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+	if (descriptor < 0) return nullptr;
+
+	void* view = mmap(nullptr, sizeof(LiveStatsBlock), PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+
+	return view == MAP_FAILED ? nullptr : static_cast<const LiveStatsBlock*>(view);
+#endif
+}
+
+
+bool readSnapshot(const LiveStatsBlock& block, LiveStatsSnapshot& snapshot) {
+	for (int attempt = 0; attempt < 1000; ++attempt) {
+		std::uint64_t before = block.sequence.load(std::memory_order_acquire);
+		if (before % 2 != 0) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::memcpy(&snapshot, &block.snapshot, sizeof(snapshot));
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (block.sequence.load(std::memory_order_relaxed) == before) return before != 0;
+	}
+
+	return false;
+}
+
+
+void printSnapshot(const LiveStatsSnapshot& snapshot) {
+	std::uint32_t chargers = 0;
+	for (std::uint32_t i = 0; i < snapshot.numSites; ++i) chargers += snapshot.sites[i].chargers;
+
+	std::cout << "\n" << "Simulator " << snapshot.processID << (snapshot.running ? " (running)" : " (stopped)")
+		<< ", snapshot " << snapshot.publishCount << "\n";
+	std::cout << "Events: " << snapshot.events << " (" << std::fixed << std::setprecision(0) << snapshot.eventsPerSecond << "/s)" << "\n";
+	std::cout << "Aircraft: " << snapshot.aircraft << " total, " << snapshot.flying << " flying, "
+		<< snapshot.waiting << " waiting, " << snapshot.charging << " charging" << "\n";
+	std::cout << "Chargers: " << snapshot.charging << " of " << chargers << " busy, queue depth " << snapshot.waiting << "\n";
+
+	std::cout << std::left << std::setw(8) << "Site" << std::right << std::setw(10) << "Chargers" << std::setw(8) << "Busy"
+		<< std::setw(8) << "Queued" << std::setw(18) << "Expected wait (s)" << "\n";
+	for (std::uint32_t i = 0; i < snapshot.numSites; ++i) {
+		const LiveStatsSnapshot::Site& site = snapshot.sites[i];
+		std::cout << std::left << std::setw(8) << i << std::right << std::setw(10) << site.chargers << std::setw(8) << site.busy
+			<< std::setw(8) << site.queued << std::setw(18) << std::setprecision(1) << site.expectedWait / 1e6 << "\n";
+	}
+
+	std::cout << std::left << std::setw(14) << "Manufacturer" << std::right << std::setw(10) << "Flights"
+		<< std::setw(14) << "Airtime (h)" << std::setw(14) << "Miles" << std::setw(18) << "Passenger miles"
+		<< std::setw(10) << "Faults" << std::setw(10) << "Charges" << "\n";
+	for (std::uint32_t i = 0; i < snapshot.numManufacturers; ++i) {
+		const LiveStatsSnapshot::Manufacturer& manufacturer = snapshot.manufacturers[i];
+		std::cout << std::left << std::setw(14) << manufacturer.name << std::right << std::setprecision(2)
+			<< std::setw(10) << manufacturer.flights << std::setw(14) << manufacturer.airTime / 3600.0
+			<< std::setw(14) << manufacturer.miles << std::setw(18) << manufacturer.passengerMiles
+			<< std::setw(10) << manufacturer.faults << std::setw(10) << manufacturer.charges << "\n";
+	}
+
+	std::cout << std::defaultfloat << std::flush;
+}
+
+
+int main(int argc, char* argv[]) {
+	std::string name = LiveStatsDefaultName;
+	std::chrono::milliseconds interval(1000);
+	bool once = false;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+
+		if (arg == "--once") once = true;
+		else if (arg == "--interval" && i + 1 < argc) interval = std::chrono::milliseconds(std::stoul(argv[++i]));
+		else name = arg;
+	}
+
+	const LiveStatsBlock* block = attach(name);
+	if (block == nullptr) {
+		std::cerr << "No live statistics found at " << name << "; start SimpleSimulator with --live-stats" << "\n";
+		return 1;
+	}
+
+	LiveStatsSnapshot snapshot{};
+
+	while (true) {
+		if (!readSnapshot(*block, snapshot)) {
+			std::cerr << "No consistent snapshot available yet" << "\n";
+		}
+		else if (snapshot.magic != LiveStatsMagic || snapshot.version != LiveStatsVersion) {
+			std::cerr << "Segment " << name << " was not written by a compatible simulator" << "\n";
+			return 1;
+		}
+		else {
+			printSnapshot(snapshot);
+			if (!snapshot.running) return 0;
+		}
+
+		if (once) return 0;
+		std::this_thread::sleep_for(interval);
+	}
+}
@@ -0,0 +1,83 @@
+#include <stdexcept>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+const void* MappedFile::data() const {
+	return view;
+}
+
+
+std::size_t MappedFile::size() const {
+	return length;
+}
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path) : view(nullptr), length(0), handle(nullptr) {
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Unable to open " + path.string());
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+		CloseHandle(file);
+		throw std::runtime_error("Unable to read " + path.string());
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) throw std::runtime_error("Unable to map " + path.string());
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		throw std::runtime_error("Unable to map " + path.string());
+	}
+
+	length = static_cast<std::size_t>(fileSize.QuadPart);
+	handle = mapping;
+}
+
+
+MappedFile::~MappedFile() {
+	UnmapViewOfFile(view);
+	CloseHandle(static_cast<HANDLE>(handle));
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path) : view(nullptr), length(0), handle(nullptr) {
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) throw std::runtime_error("Unable to open " + path.string());
+
+	struct stat status {};
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+		close(descriptor);
+		throw std::runtime_error("Unable to read " + path.string());
+	}
+
+	void* mapped = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (mapped == MAP_FAILED) throw std::runtime_error("Unable to map " + path.string());
+
+	view = mapped;
+	length = static_cast<std::size_t>(status.st_size);
+}
+
+
+MappedFile::~MappedFile() {
+	munmap(view, length);
+}
+
+#endif
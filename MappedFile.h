@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+
+/*
+* Read-only memory mapping of a whole file, released on destruction.
+*
+* Binary inputs (compiled catalogs, checkpoints) are used in place through a mapping instead of being
+* read into buffers, so that loading them costs little more than the page faults of the parts touched.
+*/
+
+class MappedFile {
+public:
+	explicit MappedFile(const std::filesystem::path& path);		// Map the file, throws if it cannot be opened or is empty
+	~MappedFile();												// Unmaps the file
+
+	MappedFile(const MappedFile& other) = delete;				// Copy constructor
+	MappedFile& operator=(const MappedFile& other) = delete;	// Copy assignment
+
+	const void* data() const;									// First byte of the mapping
+	std::size_t size() const;									// Size of the mapping in bytes
+
+private:
+	void* view;													// Mapped view of the file
+	std::size_t length;											// Size of the mapped view
+	void* handle;												// Platform handle of the mapping, if any
+};
@@ -0,0 +1,110 @@
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+
+#include "MemoryAccounting.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+
+namespace {
+	constexpr const char* SubsystemNames[MemorySubsystemCount] = { "fleet", "requests", "chargers", "logging", "summaries", "samples" };
+}
+
+
+std::array<MemoryAccounting::Counters, MemorySubsystemCount> MemoryAccounting::counters;
+
+
+void MemoryAccounting::allocated(MemorySubsystem subsystem, std::size_t bytes) {
+	Counters& counter = counters[static_cast<std::size_t>(subsystem)];
+
+	counter.allocations.fetch_add(1, std::memory_order_relaxed);
+	std::size_t current = counter.currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+	// Only an allocation that raises the peak writes it; below the peak this is a single load
+	std::size_t peak = counter.peakBytes.load(std::memory_order_relaxed);
+	while (current > peak && !counter.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {}
+}
+
+
+void MemoryAccounting::released(MemorySubsystem subsystem, std::size_t bytes) {
+	Counters& counter = counters[static_cast<std::size_t>(subsystem)];
+
+	counter.releases.fetch_add(1, std::memory_order_relaxed);
+	counter.currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+
+std::array<MemoryUsage, MemorySubsystemCount> MemoryAccounting::usage() {
+	std::array<MemoryUsage, MemorySubsystemCount> usage{};
+
+	for (std::size_t i = 0; i < MemorySubsystemCount; ++i) {
+		usage[i] = MemoryUsage{ SubsystemNames[i], counters[i].currentBytes.load(std::memory_order_relaxed),
+			counters[i].peakBytes.load(std::memory_order_relaxed), counters[i].allocations.load(std::memory_order_relaxed),
+			counters[i].releases.load(std::memory_order_relaxed) };
+	}
+
+	return usage;
+}
+
+
+std::size_t MemoryAccounting::residentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memory{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) return 0;
+	return memory.WorkingSetSize;
+#else
+	// Second field of statm: resident pages
+	std::ifstream statm("/proc/self/statm");
+	std::size_t totalPages = 0;
+	std::size_t residentPages = 0;
+	if (!(statm >> totalPages >> residentPages)) return 0;
+	return residentPages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+
+std::size_t MemoryAccounting::peakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memory{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) return 0;
+	return memory.PeakWorkingSetSize;
+#else
+	// ru_maxrss is in kilobytes and only sampled by the kernel, so it may trail the resident set just read
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return std::max(static_cast<std::size_t>(usage.ru_maxrss) * 1024, MemoryAccounting::residentBytes());
+#endif
+}
+
+
+void MemoryAccounting::printReport(std::ostream& out) {
+	auto megabytes = [](std::size_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::left << std::setw(12) << "Subsystem" << std::right << std::setw(14) << "Current (MB)" << std::setw(12) << "Peak (MB)"
+		<< std::setw(14) << "Allocations" << std::setw(14) << "Releases" << "\n";
+
+	out << std::fixed << std::setprecision(2);
+	for (const MemoryUsage& subsystem : MemoryAccounting::usage()) {
+		out << std::left << std::setw(12) << subsystem.subsystem << std::right << std::setw(14) << megabytes(subsystem.currentBytes)
+			<< std::setw(12) << megabytes(subsystem.peakBytes) << std::setw(14) << subsystem.allocations
+			<< std::setw(14) << subsystem.releases << "\n";
+	}
+
+	out << "Process resident " << megabytes(MemoryAccounting::residentBytes()) << " MB, peak "
+		<< megabytes(MemoryAccounting::peakResidentBytes()) << " MB" << "\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <functional>
+#include <unordered_map>
+
+
+/*
+* Allocation accounting by subsystem.
+*
+* The containers a simulation grows over a run allocate through TrackedAllocator, which charges every
+* allocation to the subsystem in its type. The counters are process-wide, so concurrent simulations add
+* up, and are kept in atomics: an allocation costs two relaxed increments and, while the subsystem is at
+* its peak, a compare-exchange on the peak.
+*
+* The report lists current and peak bytes and the number of allocations per subsystem, next to the
+* current and peak resident set of the whole process.
+*/
+
+enum class MemorySubsystem : std::size_t {
+	Fleet,					// Aircraft and the fleet tables
+	Requests,				// Charging requests, their queues and status maps
+	Chargers,				// Vertiports and chargers
+	Logging,				// Per-aircraft loggers and the index of the open log segment
+	Summaries,				// Session summaries being written to the log
+	Samples					// Encoded time series of the fleet state
+};
+
+constexpr std::size_t MemorySubsystemCount = 6;
+
+
+struct MemoryUsage {
+	const char* subsystem;					// Name of the subsystem
+	std::size_t currentBytes;				// Bytes allocated and not yet released
+	std::size_t peakBytes;					// Highest currentBytes seen
+	std::uint64_t allocations;				// Allocations made
+	std::uint64_t releases;					// Allocations released
+};
+
+
+class MemoryAccounting {
+public:
+	static void allocated(MemorySubsystem subsystem, std::size_t bytes);		// Charge an allocation to a subsystem
+	static void released(MemorySubsystem subsystem, std::size_t bytes);		// Credit a released allocation back
+
+	static std::array<MemoryUsage, MemorySubsystemCount> usage();				// Counters of all subsystems
+	static std::size_t residentBytes();											// Current resident set of the process, 0 if unknown
+	static std::size_t peakResidentBytes();										// Peak resident set of the process, 0 if unknown
+
+	static void printReport(std::ostream& out);									// Print the counters and the resident set
+
+private:
+	struct alignas(64) Counters {
+		std::atomic<std::size_t> currentBytes{ 0 };
+		std::atomic<std::size_t> peakBytes{ 0 };
+		std::atomic<std::uint64_t> allocations{ 0 };
+		std::atomic<std::uint64_t> releases{ 0 };
+	};
+
+	static std::array<Counters, MemorySubsystemCount> counters;					// One cache line per subsystem
+};
+
+
+// Standard allocator that charges its allocations to a subsystem
+template <typename T, MemorySubsystem Subsystem>
+class TrackedAllocator {
+public:
+	using value_type = T;
+
+	template <typename U>
+	struct rebind {
+		using other = TrackedAllocator<U, Subsystem>;
+	};
+
+	TrackedAllocator() noexcept = default;
+
+	template <typename U>
+	TrackedAllocator(const TrackedAllocator<U, Subsystem>&) noexcept {}
+
+	T* allocate(std::size_t count) {
+		if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+
+		T* memory = std::allocator<T>().allocate(count);
+		MemoryAccounting::allocated(Subsystem, count * sizeof(T));
+		return memory;
+	}
+
+	void deallocate(T* memory, std::size_t count) noexcept {
+		MemoryAccounting::released(Subsystem, count * sizeof(T));
+		std::allocator<T>().deallocate(memory, count);
+	}
+
+	template <typename U>
+	bool operator==(const TrackedAllocator<U, Subsystem>&) const noexcept { return true; }
+
+	template <typename U>
+	bool operator!=(const TrackedAllocator<U, Subsystem>&) const noexcept { return false; }
+};
+
+
+template <typename T, MemorySubsystem Subsystem>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Subsystem>>;
+
+template <typename Key, typename Value, MemorySubsystem Subsystem>
+using TrackedMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, TrackedAllocator<std::pair<const Key, Value>, Subsystem>>;
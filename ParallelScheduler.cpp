@@ -0,0 +1,144 @@
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <barrier>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ThreadPlacement.h"
+#include "ParallelScheduler.h"
+
+
+// All partitions share one epoch so that simulated timestamps agree across threads
+ParallelScheduler::ParallelScheduler(std::size_t numWorkers) : ParallelScheduler(numWorkers, std::chrono::system_clock::now()) {}
+
+
+ParallelScheduler::ParallelScheduler(std::size_t numWorkers, std::chrono::time_point<std::chrono::system_clock> epoch) :
+	windows(0),
+	clock(Scheduler::SimDuration::zero())
+{
+	if (numWorkers == 0) throw std::invalid_argument("A parallel simulation needs at least one worker.");
+
+	// Each partition is built on the core of its worker, so that its memory is local to that worker's node
+	partitions.resize(numWorkers);
+	ThreadPlacement::onWorkers(numWorkers, [&](std::size_t i) {
+		partitions[i] = std::make_unique<Scheduler>(epoch);
+		});
+}
+
+
+std::size_t ParallelScheduler::numPartitions() const {
+	return partitions.size();
+}
+
+
+Scheduler& ParallelScheduler::partition(std::size_t index) {
+	return *partitions.at(index);
+}
+
+
+Scheduler& ParallelScheduler::partitionFor(std::size_t index) {
+	return *partitions[index % partitions.size()];
+}
+
+
+std::size_t ParallelScheduler::runFor(Scheduler::SimDuration duration, Scheduler::SimDuration lookahead) {
+	/*
+	* Each worker loops over:
+	*   1. Run its partition up to the end of the current window.
+	*   2. Barrier, then accept coroutines posted to it during the window.
+	*   3. Barrier; the completion step picks the next window from the earliest pending event.
+	* The run ends when no partition has events before the deadline or a worker has failed.
+	* Like Scheduler::runFor(), a run continues from where the previous one ended.
+	*/
+
+	if (lookahead <= Scheduler::SimDuration::zero()) throw std::invalid_argument("Lookahead must be positive.");
+
+	const Scheduler::SimDuration deadline = clock + duration + Scheduler::SimDuration(1);	// runFor() includes events at the deadline
+	Scheduler::SimDuration windowEnd = clock;
+	bool finished = false;
+
+	std::mutex failureMtx;
+	std::exception_ptr failure = nullptr;
+	std::atomic<bool> failed{ false };
+	std::vector<std::size_t> processed(partitions.size(), 0);
+
+	windows = 0;
+
+	auto nextWindow = [&]() noexcept {
+		Scheduler::SimDuration earliest = Scheduler::SimDuration::max();
+		for (const std::unique_ptr<Scheduler>& scheduler : partitions) {
+			earliest = std::min(earliest, scheduler->nextEventTime());
+		}
+
+		finished = failed.load() || earliest >= deadline;
+		windowEnd = finished ? deadline : std::min(deadline, earliest + lookahead);
+
+		for (std::unique_ptr<Scheduler>& scheduler : partitions) {
+			scheduler->setHorizon(windowEnd);
+		}
+
+		if (!finished) ++windows;
+	};
+
+	std::barrier exchanged(static_cast<std::ptrdiff_t>(partitions.size()));
+	std::barrier planned(static_cast<std::ptrdiff_t>(partitions.size()), nextWindow);
+
+	auto worker = [&](std::size_t index) {
+		ThreadPlacement::Scope placement(ThreadRole::Worker, index);
+		Scheduler& scheduler = *partitions[index];
+
+		while (!finished) {
+			try {
+				processed[index] += scheduler.runUntil(windowEnd);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(failureMtx);
+				if (!failure) failure = std::current_exception();
+				failed.store(true);
+			}
+
+			exchanged.arrive_and_wait();
+			scheduler.acceptPosted();
+			planned.arrive_and_wait();
+		}
+	};
+
+	nextWindow();
+
+	std::vector<std::thread> workers;
+	workers.reserve(partitions.size());
+	for (std::size_t i = 0; i < partitions.size(); ++i) {
+		workers.emplace_back(worker, i);
+	}
+
+	for (std::thread& thread : workers) {
+		thread.join();
+	}
+
+	if (failure) std::rethrow_exception(failure);
+
+	clock += duration;
+
+	return std::accumulate(processed.begin(), processed.end(), std::size_t{ 0 });
+}
+
+
+std::size_t ParallelScheduler::getWindowCount() const {
+	return windows;
+}
+
+
+Scheduler::SimDuration ParallelScheduler::elapsed() const {
+	return clock;
+}
+
+
+void ParallelScheduler::setElapsed(Scheduler::SimDuration elapsed) {
+	clock = elapsed;
+
+	for (std::unique_ptr<Scheduler>& scheduler : partitions) {
+		scheduler->setElapsed(elapsed);
+	}
+}
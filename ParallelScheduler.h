@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <exception>
+
+#include "Scheduler.h"
+
+
+/*
+* Conservative parallel discrete-event simulation.
+*
+* The ParallelScheduler owns one Scheduler per worker thread. Tasks are partitioned across them and
+* only interact by transferring a coroutine to another partition with a delay of at least the lookahead.
+* The workers advance in lock-step windows [t, t + lookahead), where t is the earliest pending event on
+* any partition: nothing posted during a window can land inside it, so every partition can run its
+* window without looking at the others. Between windows the workers meet at a barrier and accept the
+* coroutines posted to them.
+*
+* Because events at equal times are ordered by task key on every partition, the run is identical to
+* the serial Scheduler given the same tasks, independent of the number of workers.
+*/
+
+class ParallelScheduler {
+public:
+	ParallelScheduler(std::size_t numWorkers);								// Parametrized constructor
+	ParallelScheduler(std::size_t numWorkers, std::chrono::time_point<std::chrono::system_clock> epoch);	// Partitions share the given simulated time zero
+
+	ParallelScheduler(const ParallelScheduler& other) = delete;				// Copy constructor
+	ParallelScheduler& operator=(const ParallelScheduler& other) = delete;	// Copy assignment
+
+	std::size_t numPartitions() const;										// Number of partitions and worker threads
+	Scheduler& partition(std::size_t index);								// Get the scheduler of a partition
+	Scheduler& partitionFor(std::size_t index);								// Get the partition a task index is assigned to
+
+	std::size_t runFor(Scheduler::SimDuration duration, Scheduler::SimDuration lookahead);	// Run all partitions; returns the number of events processed
+	std::size_t getWindowCount() const;										// Number of windows executed by the last run
+	Scheduler::SimDuration elapsed() const;									// Simulated time covered by all runs so far
+	void setElapsed(Scheduler::SimDuration elapsed);						// Continue from a point restored from a checkpoint
+
+private:
+	std::size_t windows;													// Number of windows executed by the last run
+	Scheduler::SimDuration clock;											// Simulated time covered by all runs so far
+	std::vector<std::unique_ptr<Scheduler>> partitions;						// One scheduler per worker thread
+};
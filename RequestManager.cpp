@@ -4,25 +4,15 @@
 #include <algorithm>
 
 #include "DataLogger.h"
+#include "Simulation.h"
+#include "ScopeTimers.h"
 #include "RequestManager.h"
 #include "ChargingStation.h"
 
 
-std::mutex RequestManager::updatesMtx;
-std::mutex RequestManager::requestsMtx;
-std::mutex RequestManager::instancesMtx;
-
-std::condition_variable RequestManager::chargingComplete;
-
-std::atomic<bool> RequestManager::simulationComplete{ false };
-std::queue<std::shared_ptr<RequestManager>> RequestManager::incomingRequests = {};
-std::unordered_map<std::string, std::atomic<bool>> RequestManager::processedRequests = {};
-std::unordered_map<std::string, std::shared_ptr<RequestManager>> RequestManager::instances = {};
-
-
 void RequestManager::updateEndTime() {
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
-	this->endTime = std::chrono::system_clock::now();
+	this->endTime = this->timeNow();
 	logger->logData("Charging process has ended for ticket number: " + this->getTicketNumber() + ".");
 }
 
@@ -30,19 +20,19 @@ void RequestManager::updateEndTime() {
 bool RequestManager::thankyou() const {
 	bool complete = false;
 	std::string servingTicketNumber = this->getTicketNumber();
-	std::unordered_map<std::string, std::shared_ptr<RequestManager>>::iterator locate;
+	Simulation::RequestMap::iterator locate;
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
 
-	std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-	locate = RequestManager::instances.find(servingTicketNumber);
-	if (locate != RequestManager::instances.end()) {
+	std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+	locate = simulation.requests.find(servingTicketNumber);
+	if (locate != simulation.requests.end()) {
 		if (locate->second->status.load()) {
 			logger->logData("Charging process has been completed for ticket number: " + servingTicketNumber + ".");
 			complete = locate->second->status.load();
 		}
 
 		/*if (complete) {
-			RequestManager::instances.erase(locate);
+			simulation.requests.erase(locate);
 			logger->logData("Request Manager instance for ticket number: " + servingTicketNumber + " has been removed.");
 		}*/
 	}
@@ -54,7 +44,28 @@ bool RequestManager::thankyou() const {
 void RequestManager::updateStartTime() {
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
 	logger->logData("Charging process has started for ticket number: " + this->ticketNumber + ".");
-	this->startTime = std::chrono::system_clock::now();
+	this->startTime = this->timeNow();
+}
+
+
+void RequestManager::completeCharging() {
+	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
+
+	this->updateEndTime();
+	this->status.store(true);
+	logger->logData("Charger has returned aircraft assigned to ticket number: " + this->getTicketNumber() + ".");
+
+	this->completedEvent.set();
+}
+
+
+SimEvent& RequestManager::chargerAssigned() {
+	return assignedEvent;
+}
+
+
+SimEvent& RequestManager::chargingCompleted() {
+	return completedEvent;
 }
 
 
@@ -63,60 +74,58 @@ std::string RequestManager::getTicketNumber() const {
 }
 
 
-std::shared_ptr<evTOL> RequestManager::getAircraft() const {
-	return aircraft;
+Vertiport* RequestManager::getSite() const {
+	return site;
 }
 
 
-void RequestManager::stopSimulation() {
-	RequestManager::simulationComplete.store(true);
-	RequestManager::chargingComplete.notify_all();	
+std::chrono::time_point<std::chrono::system_clock> RequestManager::getRequestTime() const {
+	return requestTime;
+}
+
 
-	std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-	for (std::pair<std::string, std::shared_ptr<RequestManager>> instance : RequestManager::instances) {
-		if (instance.second->statusThread.joinable()) instance.second->statusThread.join();
-	}
+std::chrono::time_point<std::chrono::system_clock> RequestManager::getStartTime() const {
+	return startTime;
 }
 
 
-std::size_t RequestManager::newRequestAvailable() {
-	std::lock_guard<std::mutex> lock(RequestManager::requestsMtx);
-	return (RequestManager::incomingRequests.empty()) ? 0 : RequestManager::incomingRequests.size();
+std::chrono::time_point<std::chrono::system_clock> RequestManager::getEndTime() const {
+	return endTime;
 }
 
 
-std::shared_ptr<RequestManager> RequestManager::fetchFirstInLIne() {
-	std::shared_ptr<RequestManager> firstInLine;
+std::shared_ptr<evTOL> RequestManager::getAircraft() const {
+	return aircraft;
+}
 
-	{
-		std::lock_guard<std::mutex> lock(RequestManager::requestsMtx);
-		if (RequestManager::incomingRequests.empty()) throw std::runtime_error("No requests in the queue.");
-		firstInLine = RequestManager::incomingRequests.front();
-		RequestManager::incomingRequests.pop();
-		ChargingStation::requestManagerNotification.notify_all();
-	}
 
-	firstInLine->updateStartTime();
+void RequestManager::stopSimulation(Simulation& simulation) {
+	simulation.requestsStopped.store(true);
+	simulation.chargingComplete.notify_all();	
 
-	return firstInLine;
+	std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+	for (std::pair<std::string, std::shared_ptr<RequestManager>> instance : simulation.requests) {
+		if (instance.second->statusThread.joinable()) instance.second->statusThread.join();
+	}
 }
 
 
 void RequestManager::reportChargingStatus(std::shared_ptr<RequestManager>& thisRequest) {
+	Simulation& simulation = thisRequest->simulation;
 	bool complete = false;
-	std::unordered_map<std::string, std::atomic<bool>>::iterator locate;
+	Simulation::StatusMap::iterator locate;
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(thisRequest->getAircraft());
 	 
 	{
-		std::lock_guard<std::mutex> lock(RequestManager::updatesMtx);
-		locate = RequestManager::processedRequests.find(thisRequest->getTicketNumber());
-		if (locate != RequestManager::processedRequests.end()) {
+		std::lock_guard<std::mutex> lock(simulation.updatesMtx);
+		locate = simulation.processedRequests.find(thisRequest->getTicketNumber());
+		if (locate != simulation.processedRequests.end()) {
 			complete = true;
 			locate->second.store(true);
 			logger->logData("Charger has returned aircraft assigned to ticket number: " + thisRequest->getTicketNumber() + ".");
 
 			// Notify the waiting threads
-			RequestManager::chargingComplete.notify_all();
+			simulation.chargingComplete.notify_all();
 		}
 	}
 
@@ -127,14 +136,14 @@ void RequestManager::reportChargingStatus(std::shared_ptr<RequestManager>& thisR
 }
 
 
-std::shared_ptr<RequestManager> RequestManager::getRequest(const std::string& ticketNumber) {
+std::shared_ptr<RequestManager> RequestManager::getRequest(Simulation& simulation, const std::string& ticketNumber) {
 	std::shared_ptr<RequestManager> thisRequest = nullptr;
-	std::unordered_map<std::string, std::shared_ptr<RequestManager>>::iterator locate;
+	Simulation::RequestMap::iterator locate;
 
 	{
-		std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-		locate = RequestManager::instances.find(ticketNumber);
-		if (locate != RequestManager::instances.end()) {
+		std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+		locate = simulation.requests.find(ticketNumber);
+		if (locate != simulation.requests.end()) {
 			thisRequest = locate->second;		
 		}
 	}
@@ -144,15 +153,17 @@ std::shared_ptr<RequestManager> RequestManager::getRequest(const std::string& ti
 
 
 std::string RequestManager::createChargingRequest(const std::shared_ptr<evTOL>& aircraft) {
+	TIMED_SCOPE(RequestCreation);
+	Simulation& simulation = aircraft->getSimulation();
 	std::string ticketNumber = RequestManager::createNewRequest(aircraft);
-	std::unordered_map<std::string, std::shared_ptr<RequestManager>>::iterator locate;
+	Simulation::RequestMap::iterator locate;
 	
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
 
 	{
-		std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-		locate = RequestManager::instances.find(ticketNumber);
-		if (locate != RequestManager::instances.end()) {
+		std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+		locate = simulation.requests.find(ticketNumber);
+		if (locate != simulation.requests.end()) {
 			locate->second->addToStatusMonitor();
 			locate->second->addToRequestQueue(locate->second);
 			locate->second->statusThread = std::thread(&RequestManager::monitorChargingRequest, locate->second, std::ref(locate->second->ticketNumber));
@@ -164,30 +175,47 @@ std::string RequestManager::createChargingRequest(const std::shared_ptr<evTOL>&
 }
 
 
-void RequestManager::addToRequestQueue(const std::shared_ptr<RequestManager>& thisRequest) const {
+std::shared_ptr<RequestManager> RequestManager::queueChargingRequest(const std::shared_ptr<evTOL>& aircraft, Scheduler& scheduler) {
+	/*
+	* Cooperative counterpart of createChargingRequest(). The request is queued for the chargers,
+	* but no monitor thread is spawned and the ticket is not recorded in the instances map:
+	* the aircraft coroutine holds on to the request and co_awaits its events directly.
+	*/
+
+	TIMED_SCOPE(RequestCreation);
+	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
+	std::shared_ptr<RequestManager> newRequest = RequestManager::createInstance(aircraft, &scheduler);
+
+	logger->logData("A new request has been created for the aircraft: " + aircraft->getManufacturerName() + ".");
+	logger->logData("The ticket number assigned to the request is: " + newRequest->getTicketNumber() + ".");
+
+	newRequest->addToRequestQueue(newRequest);
+
+	return newRequest;
+}
+
+
+void RequestManager::addToRequestQueue(const std::shared_ptr<RequestManager>& thisRequest) {
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(thisRequest->getAircraft());
 
-	{
-		std::lock_guard<std::mutex> lock(RequestManager::requestsMtx);
-		RequestManager::incomingRequests.push(thisRequest);
-		logger->logData("Request with ticket number: " + this->ticketNumber + " has been added to the queue.");
-		ChargingStation::requestManagerNotification.notify_all();
-		logger->logData("Notification sent to the charging station.");
-	}
+	this->site = &Vertiport::route(simulation);
+	logger->logData("Request with ticket number: " + this->ticketNumber + " has been routed to vertiport " + std::to_string(this->site->getSiteID()) + ".");
+
+	this->site->enqueue(thisRequest);
 }
 
 
 void RequestManager::addToStatusMonitor() const {
 	std::string ticketNumber = this->getTicketNumber();		//TODO: define enum class for states 
-	std::unordered_map<std::string, std::atomic<bool>>::iterator locate;
+	Simulation::StatusMap::iterator locate;
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
 
 	{
-		std::lock_guard<std::mutex> lock(RequestManager::updatesMtx);
-		locate = RequestManager::processedRequests.find(ticketNumber);
-		if (locate == RequestManager::processedRequests.end()) {
+		std::lock_guard<std::mutex> lock(simulation.updatesMtx);
+		locate = simulation.processedRequests.find(ticketNumber);
+		if (locate == simulation.processedRequests.end()) {
 			logger->logData("A new tracker flag for ticket number: " + ticketNumber + " has been created.");
-			RequestManager::processedRequests.emplace(std::move(ticketNumber), false);
+			simulation.processedRequests.emplace(std::move(ticketNumber), false);
 		}
 	}
 }
@@ -199,31 +227,37 @@ std::string RequestManager::generateTicketNumber() const {
 		ch = std::toupper(ch);
 		});
 
-	std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-	std::time_t now_time_t = std::chrono::system_clock::to_time_t(now);
-	std::string ticketNumber = prefix + '-' + std::to_string(now_time_t);
+	std::time_t now_time_t = std::chrono::system_clock::to_time_t(this->requestTime);
+	// Aircraft of one manufacturer request within the same second in real-time mode, so the ticket also names the aircraft and its session
+	std::string ticketNumber = prefix + '-' + std::to_string(now_time_t) + '-' + std::to_string(this->aircraft->getAircraftID())
+		+ '-' + std::to_string(this->aircraft->getCompletedSessions());
 
 	return ticketNumber;
 }
 
 
+std::chrono::time_point<std::chrono::system_clock> RequestManager::timeNow() const {
+	return (this->scheduler != nullptr) ? this->scheduler->now() : std::chrono::system_clock::now();
+}
+
+
 void RequestManager::monitorChargingRequest(const std::string& ticketNumber) const {
 	bool complete = false;
-	std::unordered_map<std::string, std::atomic<bool>>::iterator locate;
+	Simulation::StatusMap::iterator locate;
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
 		
 	while (!complete) {
-		std::unique_lock<std::mutex> lock(RequestManager::updatesMtx);
-		RequestManager::chargingComplete.wait(lock, [&] {
-			locate = RequestManager::processedRequests.find(ticketNumber);
-			return (locate != RequestManager::processedRequests.end() && locate->second.load()) ||
-				simulationComplete.load();
+		std::unique_lock<std::mutex> lock(simulation.updatesMtx);
+		simulation.chargingComplete.wait(lock, [&] {
+			locate = simulation.processedRequests.find(ticketNumber);
+			return (locate != simulation.processedRequests.end() && locate->second.load()) ||
+				simulation.requestsStopped.load();
 			});
 		
-		locate = RequestManager::processedRequests.find(ticketNumber);
+		locate = simulation.processedRequests.find(ticketNumber);
 
-		if (simulationComplete.load()) break;
-		else if (locate != RequestManager::processedRequests.end()) {
+		if (simulation.requestsStopped.load()) break;
+		else if (locate != simulation.processedRequests.end()) {
 			complete = locate->second.load();
 			logger->logData("Aircraft associated with ticket number: " + ticketNumber
 				+ "'s service status is now " + (complete ? "Complete" : "Charging"));
@@ -233,13 +267,13 @@ void RequestManager::monitorChargingRequest(const std::string& ticketNumber) con
 
 
 void RequestManager::markChargingProcessCompleted(const std::string& ticketNumber) const {
-	std::unordered_map<std::string, std::shared_ptr<RequestManager>>::iterator locate;
+	Simulation::RequestMap::iterator locate;
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->getAircraft());
 
-	std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-	locate = RequestManager::instances.find(ticketNumber);
+	std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+	locate = simulation.requests.find(ticketNumber);
 
-	if (locate != RequestManager::instances.end()) {
+	if (locate != simulation.requests.end()) {
 		locate->second->status.store(true);
 		if (locate->second->statusThread.joinable()) {
 			locate->second->statusThread.join();
@@ -254,6 +288,7 @@ void RequestManager::markChargingProcessCompleted(const std::string& ticketNumbe
 
 
 std::string RequestManager::createNewRequest(const std::shared_ptr<evTOL>& aircraft) {
+	Simulation& simulation = aircraft->getSimulation();
 	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
 
 	// Create a new request
@@ -262,12 +297,12 @@ std::string RequestManager::createNewRequest(const std::shared_ptr<evTOL>& aircr
 	logger->logData("A new request has been created for the aircraft: " + aircraft->getManufacturerName() + ".");
 	logger->logData("The ticket number assigned to the request is: " + newRequest->getTicketNumber() + ".");
 
-	std::unordered_map<std::string, std::shared_ptr<RequestManager>>::iterator locate;
+	Simulation::RequestMap::iterator locate;
 
-	std::lock_guard<std::mutex> lock(RequestManager::instancesMtx);
-	locate = RequestManager::instances.find(newRequest->getTicketNumber());
-	if (locate == RequestManager::instances.end()) {
-		RequestManager::instances.emplace(newRequest->getTicketNumber(), newRequest);
+	std::lock_guard<std::mutex> lock(simulation.instancesMtx);
+	locate = simulation.requests.find(newRequest->getTicketNumber());
+	if (locate == simulation.requests.end()) {
+		simulation.requests.emplace(newRequest->getTicketNumber(), newRequest);
 		logger->logData("The request has been added to the instances map.");
 	}
 
@@ -275,8 +310,26 @@ std::string RequestManager::createNewRequest(const std::shared_ptr<evTOL>& aircr
 }
 
 
-RequestManager::RequestManager(const std::shared_ptr<evTOL>& aircraft) : aircraft(aircraft) {
+std::shared_ptr<RequestManager> RequestManager::restoreRequest(const std::shared_ptr<evTOL>& aircraft, Scheduler& scheduler, Vertiport& site,
+	std::chrono::time_point<std::chrono::system_clock> requestTime) {
+	// The ticket is derived from the request time and the aircraft, so it comes out as originally issued
+	std::shared_ptr<RequestManager> request = RequestManager::createInstance(aircraft, &scheduler);
+	request->requestTime = requestTime;
+	request->ticketNumber = request->generateTicketNumber();
+	request->site = &site;
+
+	return request;
+}
+
+
+RequestManager::RequestManager(const std::shared_ptr<evTOL>& aircraft, Scheduler* scheduler) : 
+	aircraft(aircraft),
+	simulation(aircraft->getSimulation()),
+	site(nullptr),
+	scheduler(scheduler)
+{
 	status.store(false);
+	requestTime = this->timeNow();
 	ticketNumber = this->generateTicketNumber();
 	endTime = std::chrono::system_clock::time_point();
 	startTime = std::chrono::system_clock::time_point();
@@ -291,5 +344,5 @@ inline std::shared_ptr<RequestManager> RequestManager::createInstance(Args && ..
 		make_shared_enabler(Args &&... args) : RequestManager(std::forward<Args>(args)...) {}
 	};
 
-	return std::make_shared<make_shared_enabler>(std::forward<Args>(args)...);
+	return std::allocate_shared<make_shared_enabler>(TrackedAllocator<make_shared_enabler, MemorySubsystem::Requests>(), std::forward<Args>(args)...);
 }
\ No newline at end of file
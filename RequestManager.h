@@ -11,72 +11,82 @@
 #include <condition_variable>
 
 #include "evTOL.h"
+#include "Scheduler.h"
+#include "Vertiport.h"
 
 
+class Simulation;
+class Checkpoint;
+
 class RequestManager {
 public:
 	// RequestManager public APIs
 	void updateEndTime();							// Update end time of charging event
 	bool thankyou() const;							// Check if charging process is completed	
 	void updateStartTime();							// Update start time of charging event
+	void completeCharging();						// Close the ticket and release the aircraft in a cooperative simulation
+
+	SimEvent& chargerAssigned();					// Event signalled once a charger has picked up the request
+	SimEvent& chargingCompleted();					// Event signalled once the charger has released the aircraft
 
 	std::string getTicketNumber() const;			// Get ticket number of charging request
+	Vertiport* getSite() const;						// Get the vertiport the request has been routed to
 	std::shared_ptr<evTOL> getAircraft() const;		// Get aircraft associated with charging request
 
+	std::chrono::time_point<std::chrono::system_clock> getRequestTime() const;	// Get the time the request was raised
+	std::chrono::time_point<std::chrono::system_clock> getStartTime() const;	// Get the time a charger picked up the request
+	std::chrono::time_point<std::chrono::system_clock> getEndTime() const;		// Get the time the charger released the aircraft
+
 	// Static member functions
-	static void stopSimulation();															// Stop the simulation
-	static std::size_t newRequestAvailable();												// Check if new request is available
-	static std::shared_ptr<RequestManager> fetchFirstInLIne();								// Fetch the first request in the queue
+	static void stopSimulation(Simulation& simulation);										// Stop the simulation
 	static void reportChargingStatus(std::shared_ptr<RequestManager>& thisRequest);			// Report the status of charging
 	static std::string createChargingRequest(const std::shared_ptr<evTOL>& aircraft);		// Create a new charging request
-	static std::shared_ptr<RequestManager> getRequest(const std::string& ticketNumber);		// Get the request object for charging
+	static std::shared_ptr<RequestManager> getRequest(Simulation& simulation, const std::string& ticketNumber);	// Get the request object for charging
+	static std::shared_ptr<RequestManager> queueChargingRequest(const std::shared_ptr<evTOL>& aircraft, Scheduler& scheduler);	// Queue a request from a coroutine
 	
 
 protected:
 	// RequestManager class internal operations
 	void addToStatusMonitor() const;
 	std::string generateTicketNumber() const;
+	std::chrono::time_point<std::chrono::system_clock> timeNow() const;
 	void monitorChargingRequest(const std::string& ticketNumber) const;
 	void markChargingProcessCompleted(const std::string& ticketNumber) const;
-	void addToRequestQueue(const std::shared_ptr<RequestManager>& thisRequest) const;
+	void addToRequestQueue(const std::shared_ptr<RequestManager>& thisRequest);
 	
 	static std::string createNewRequest(const std::shared_ptr<evTOL>& aircraft);
+	static std::shared_ptr<RequestManager> restoreRequest(const std::shared_ptr<evTOL>& aircraft, Scheduler& scheduler, Vertiport& site,
+		std::chrono::time_point<std::chrono::system_clock> requestTime);	// Rebuild a request from a checkpoint, with its original ticket
 
 private:
+	friend class Checkpoint;
+
 	// RequestManager Class initialization
-	RequestManager(const std::shared_ptr<evTOL>& aircraft);			// Parametrized constructor
+	RequestManager(const std::shared_ptr<evTOL>& aircraft, Scheduler* scheduler = nullptr);		// Parametrized constructor
 	
 	// RequestManager Class object control methods
 	RequestManager(RequestManager&& other) noexcept = default;				// Move constructor
-	RequestManager& operator= (RequestManager&& other) noexcept = default;	// Move assignment operator
 
 	// RequestManager Class object prohibit methods
 	RequestManager(const RequestManager& other) = delete;					// Copy constructor
 	RequestManager& operator= (const RequestManager& other) = delete;		// Copy assignment operator
 
 	// Class object data members
-	static std::atomic<bool> simulationComplete; 					// Flag to indicate that the simulation is complete
-
 	std::string ticketNumber;										// Ticket number assigned to each charging request
 	std::atomic<bool> status;										// Completion status of the ticket
 	std::thread statusThread;										// Thread object that would manage the update from chargers
 	std::shared_ptr<evTOL> aircraft;								// Aircraft that is raising the request to be charged
+	Simulation& simulation;											// Simulation the aircraft belongs to
+	Vertiport* site;												// Vertiport the request has been routed to
+
+	Scheduler* scheduler;											// Scheduler driving the request, null when running on threads
+	SimEvent assignedEvent;											// Signalled when a charger picks up the request
+	SimEvent completedEvent;										// Signalled when the charger releases the aircraft
 	
+	std::chrono::time_point<std::chrono::system_clock> requestTime;	// Timestamp of creation of the charging request
 	std::chrono::time_point<std::chrono::system_clock> endTime;		// Timestamp of completion of charging event
 	std::chrono::time_point<std::chrono::system_clock> startTime;	// Timestamp of beginning of charging event
 
-	// Static data members
-	static std::mutex requestsMtx;											// Mutex to control access to queue for incoming requests
-	static std::queue<std::shared_ptr<RequestManager>> incomingRequests;	// Queue to store incoming requests
-
-	static std::mutex updatesMtx;													// Mutex to control access to map for status updates
-	static std::unordered_map<std::string, std::atomic<bool>> processedRequests;	// Map to indicate the status of charging
-
-	static std::mutex instancesMtx;														// Mutex to control access to map for status updates
-	static std::unordered_map<std::string, std::shared_ptr<RequestManager>> instances;	// Map to record all instances created for charging request
-
-	static std::condition_variable chargingComplete;		// Condition variable to receive notification from chargers
-
 	// Template function to create shared pointer instance of RequestManager class
 	template <typename... Args>
 	static std::shared_ptr<RequestManager> createInstance(Args &&... args);
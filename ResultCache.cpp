@@ -0,0 +1,112 @@
+#include <thread>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <functional>
+#include <system_error>
+
+#include "ResultCache.h"
+
+
+namespace {
+
+	constexpr std::uint64_t FnvOffset = 14695981039346656037ull;
+	constexpr std::uint64_t FnvPrime = 1099511628211ull;
+
+
+	std::uint64_t fnv1a(std::uint64_t hash, const void* data, std::size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t b = 0; b < size; ++b) hash = (hash ^ bytes[b]) * FnvPrime;
+		return hash;
+	}
+
+}
+
+
+ResultCache::ResultCache(const std::filesystem::path& directory) :
+	directory(directory)
+{
+	std::filesystem::create_directories(directory);
+}
+
+
+bool ResultCache::lookup(const ResultKey& key, void* results, std::size_t resultsSize, std::string& report) const {
+	std::filesystem::path path = entryPath(key);
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	ResultCacheHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+
+	// Anything that does not match exactly is a miss; the run that follows replaces the entry
+	if (std::memcmp(header.magic, ResultCacheHeader::Magic, sizeof(header.magic)) != 0 || header.version != ResultCacheHeader::Version
+		|| header.headerSize != sizeof(ResultCacheHeader) || std::memcmp(&header.key, &key, sizeof(ResultKey)) != 0
+		|| header.resultsSize != resultsSize || header.reportSize > (std::uint64_t(1) << 32)) {
+		return false;
+	}
+
+	std::string stored(static_cast<std::size_t>(header.resultsSize), '\0');
+	std::string text(static_cast<std::size_t>(header.reportSize), '\0');
+	if (!file.read(stored.data(), static_cast<std::streamsize>(stored.size())) || !file.read(text.data(), static_cast<std::streamsize>(text.size()))) return false;
+	if (file.peek() != std::char_traits<char>::eof()) return false;
+
+	if (ResultCache::checksumOf(header, stored.data(), text) != header.checksum) return false;
+
+	std::memcpy(results, stored.data(), resultsSize);
+	report = std::move(text);
+	return true;
+}
+
+
+void ResultCache::store(const ResultKey& key, const void* results, std::size_t resultsSize, const std::string& report) const {
+	std::filesystem::path path = entryPath(key);
+
+	ResultCacheHeader header{};
+	std::memcpy(header.magic, ResultCacheHeader::Magic, sizeof(header.magic));
+	header.version = ResultCacheHeader::Version;
+	header.headerSize = static_cast<std::uint32_t>(sizeof(ResultCacheHeader));
+	header.key = key;
+	header.resultsSize = resultsSize;
+	header.reportSize = report.size();
+	header.checksum = ResultCache::checksumOf(header, results, report);
+
+	// Concurrent runs of the same configuration each write their own temporary file; the last rename wins
+	std::filesystem::path temporary = path;
+	temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) throw std::runtime_error("Unable to create cache entry " + temporary.string());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(results), static_cast<std::streamsize>(resultsSize));
+		file.write(report.data(), static_cast<std::streamsize>(report.size()));
+
+		file.close();
+		if (!file) {
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			throw std::runtime_error("Unable to write cache entry " + temporary.string());
+		}
+	}
+
+	std::filesystem::rename(temporary, path);
+}
+
+
+std::filesystem::path ResultCache::entryPath(const ResultKey& key) const {
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(FnvOffset, &key, sizeof(key)) << ".evres";
+
+	return directory / name.str();
+}
+
+
+std::uint64_t ResultCache::checksumOf(const ResultCacheHeader& header, const void* results, const std::string& report) {
+	std::uint64_t hash = fnv1a(FnvOffset, &header, offsetof(ResultCacheHeader, checksum));
+	hash = fnv1a(hash, results, static_cast<std::size_t>(header.resultsSize));
+	return fnv1a(hash, report.data(), report.size());
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <type_traits>
+
+
+/*
+* On-disk cache of the aggregated results of event-driven simulations.
+*
+* With a seed, an event-driven run is a pure function of its configuration, the manufacturer specs and
+* the simulated duration, which together make up the key of an entry. Entries are named after a hash of
+* the key, so a repeated run finds its entry with a single file lookup instead of simulating again.
+*
+* Layout of an entry (native byte order of the writer):
+*
+*   ResultCacheHeader		with the full key the results were computed from
+*   Results					resultsSize bytes, as handed to store()
+*   Report					reportSize bytes of end-of-run report text
+*
+* An entry is only served if its header, key, sizes and checksum all match; anything else, a stale
+* entry of an older version or a truncated or corrupt file, counts as a miss and is overwritten by
+* the next run. Entries are written to a temporary file and renamed into place.
+*/
+
+struct ResultKey {
+	std::uint64_t catalogFingerprint;	// Hash of the manufacturer specs
+	std::uint64_t seed;					// Seed of the fleet composition
+	std::int64_t simulated;				// Simulated microseconds covered by the run
+	std::uint32_t mode;					// Mode of the simulation
+	std::uint32_t workers;				// Worker threads of the parallel mode
+	std::uint32_t aircraft;				// Aircraft in the fleet
+	std::uint32_t chargers;				// Chargers in the network
+	std::uint32_t sites;				// Vertiports the chargers are spread over
+	std::uint32_t builtinCatalog;		// Non-zero if the catalog was compiled into the program
+	double tripsPerHour;				// Rate of the trip demand, zero without demand
+	double serviceAreaMiles;			// Side of the service area of the demand
+	double maxTripWaitMinutes;			// Maximum wait of a trip
+};
+
+
+struct ResultCacheHeader {
+	static constexpr char Magic[8] = { 'E', 'V', 'T', 'O', 'L', 'R', 'E', 'S' };
+	static constexpr std::uint32_t Version = 2;		// Bump whenever a change to the simulation alters its results
+
+	char magic[8];						// Identifies a cache entry
+	std::uint32_t version;				// Version of the simulation that computed the results
+	std::uint32_t headerSize;			// sizeof(ResultCacheHeader) of the writer
+	ResultKey key;						// Configuration the results were computed from
+	std::uint64_t resultsSize;			// Bytes of results
+	std::uint64_t reportSize;			// Bytes of report text
+	std::uint64_t checksum;				// FNV-1a over the header up to here, the results and the report
+};
+
+static_assert(std::is_trivially_copyable_v<ResultKey> && sizeof(ResultKey) == 72, "ResultKey is stored as raw bytes");
+static_assert(std::is_trivially_copyable_v<ResultCacheHeader> && sizeof(ResultCacheHeader) == 112, "ResultCacheHeader is stored as raw bytes");
+
+
+class ResultCache {
+public:
+	explicit ResultCache(const std::filesystem::path& directory);	// Use a cache directory, created if missing
+
+	// Copy the results and report of an entry; false on a miss or an entry that does not verify
+	bool lookup(const ResultKey& key, void* results, std::size_t resultsSize, std::string& report) const;
+	void store(const ResultKey& key, const void* results, std::size_t resultsSize, const std::string& report) const;	// Write an entry
+
+	std::filesystem::path entryPath(const ResultKey& key) const;	// File of the entry of a key
+
+private:
+	static std::uint64_t checksumOf(const ResultCacheHeader& header, const void* results, const std::string& report);	// Checksum of an entry
+
+	std::filesystem::path directory;								// Cache directory
+};
@@ -0,0 +1,362 @@
+#include <utility>
+#include <stdexcept>
+
+#include "Scheduler.h"
+
+
+thread_local Scheduler* Scheduler::active = nullptr;
+
+
+/* ----------------- Task ----------------- */
+
+Task Task::promise_type::get_return_object() noexcept {
+	return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+
+Task::Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+
+Task::Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+
+Task& Task::operator=(Task&& other) noexcept {
+	if (this != &other) {
+		if (handle) handle.destroy();
+		handle = std::exchange(other.handle, nullptr);
+	}
+
+	return *this;
+}
+
+
+bool Task::done() const {
+	return !handle || handle.done();
+}
+
+
+void Task::rethrowIfFailed() const {
+	if (handle && handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+}
+
+
+std::coroutine_handle<Task::promise_type> Task::getHandle() const {
+	return handle;
+}
+
+
+Task::~Task() {
+	if (handle) handle.destroy();
+}
+
+
+/* ----------------- Scheduler ----------------- */
+
+Scheduler::Delay::Delay(Scheduler& scheduler, SimDuration duration) :
+	scheduler(scheduler),
+	duration(duration)
+{}
+
+
+bool Scheduler::Delay::await_ready() const noexcept {
+	return duration <= SimDuration::zero();
+}
+
+
+void Scheduler::Delay::await_suspend(TaskHandle handle) const {
+	scheduler.schedule(handle, scheduler.elapsed() + duration);
+}
+
+
+Scheduler::Transfer::Transfer(Scheduler& source, Scheduler& target, SimDuration delay) :
+	source(source),
+	target(target),
+	delay(delay)
+{}
+
+
+void Scheduler::Transfer::await_suspend(TaskHandle handle) const {
+	if (&source == &target) target.schedule(handle, source.elapsed() + delay);
+	else target.post(handle, source.elapsed() + delay);
+}
+
+
+bool Scheduler::Later::operator()(const Event& lhs, const Event& rhs) const {
+	if (lhs.at != rhs.at) return lhs.at > rhs.at;
+	if (lhs.key != rhs.key) return lhs.key > rhs.key;
+	return lhs.sequence > rhs.sequence;
+}
+
+
+Scheduler::Scheduler() : Scheduler(std::chrono::system_clock::now()) {}
+
+
+Scheduler::Scheduler(std::chrono::time_point<std::chrono::system_clock> epoch) :
+	stopped(false),
+	clock(SimDuration::zero()),
+	sequence(0),
+	processedEvents(0),
+	epoch(epoch),
+	horizon(SimDuration::zero())
+{}
+
+
+Scheduler::~Scheduler() {
+	// Frames are destroyed while still suspended; nothing on the timeline may be resumed afterwards
+	timeline = {};
+	tasks.clear();
+}
+
+
+void Scheduler::stop() {
+	stopped = true;
+}
+
+
+void Scheduler::spawn(Task&& task, std::uint64_t key) {
+	TaskHandle handle = task.getHandle();
+	handle.promise().key = key;
+
+	tasks.emplace_back(std::move(task));
+	schedule(handle, clock);
+}
+
+
+Scheduler::TaskHandle Scheduler::adopt(Task&& task, std::uint64_t key) {
+	// The caller decides where the task resumes: on a timeline or on a SimEvent
+	TaskHandle handle = task.getHandle();
+	handle.promise().key = key;
+
+	tasks.emplace_back(std::move(task));
+
+	return handle;
+}
+
+
+void Scheduler::schedule(TaskHandle handle, SimDuration at) {
+	if (at < clock) at = clock;
+	timeline.push(Event{ at, handle.promise().key, sequence++, handle });
+}
+
+
+void Scheduler::post(TaskHandle handle, SimDuration at) {
+	/*
+	* Called from the thread running another scheduler. The coroutine is parked until acceptPosted()
+	* runs between windows; landing before the horizon would mean this scheduler may already have
+	* run past the event, which is exactly what the lookahead is meant to rule out.
+	*/
+
+	std::lock_guard<std::mutex> lock(postedMtx);
+	if (at < horizon) throw std::logic_error("Event posted across schedulers falls inside the current lookahead window.");
+
+	posted.push_back(Event{ at, handle.promise().key, 0, handle });
+}
+
+
+std::size_t Scheduler::runFor(SimDuration duration) {
+	/*
+	* Pops the earliest event, advances the simulated clock to it and resumes the coroutine.
+	* The coroutine runs until its next co_await, which pushes it back onto the timeline
+	* (or onto a SimEvent) before control returns here.
+	*/
+
+	std::size_t processed = 0;
+	SimDuration deadline = clock + duration;
+	Scheduler* previous = std::exchange(Scheduler::active, this);
+
+	stopped = false;
+
+	while (!stopped && !timeline.empty() && timeline.top().at <= deadline) {
+		Event next = timeline.top();
+		timeline.pop();
+
+		clock = next.at;
+		next.handle.resume();
+		++processed;
+
+		// Single writer: published for monitoring without a read-modify-write
+		processedEvents.store(processedEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	if (!stopped) clock = deadline;
+	Scheduler::active = previous;
+
+	rethrowFailures();
+
+	return processed;
+}
+
+
+std::size_t Scheduler::runUntil(SimDuration horizon) {
+	std::size_t processed = 0;
+	Scheduler* previous = std::exchange(Scheduler::active, this);
+
+	while (!stopped && !timeline.empty() && timeline.top().at < horizon) {
+		Event next = timeline.top();
+		timeline.pop();
+
+		clock = next.at;
+		next.handle.resume();
+		++processed;
+
+		// Single writer: published for monitoring without a read-modify-write
+		processedEvents.store(processedEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	Scheduler::active = previous;
+
+	rethrowFailures();
+
+	return processed;
+}
+
+
+void Scheduler::acceptPosted() {
+	std::lock_guard<std::mutex> lock(postedMtx);
+
+	for (Event& event : posted) {
+		schedule(event.handle, event.at);
+	}
+
+	posted.clear();
+}
+
+
+void Scheduler::setHorizon(SimDuration horizon) {
+	std::lock_guard<std::mutex> lock(postedMtx);
+	this->horizon = horizon;
+}
+
+
+void Scheduler::setElapsed(SimDuration elapsed) {
+	if (!timeline.empty() && timeline.top().at < elapsed) throw std::logic_error("The clock cannot pass events still on the timeline.");
+	clock = elapsed;
+}
+
+
+Scheduler::Delay Scheduler::sleepFor(SimDuration duration) {
+	return Delay(*this, duration);
+}
+
+
+Scheduler::Transfer Scheduler::transferTo(Scheduler& target, SimDuration delay) {
+	return Transfer(*this, target, delay);
+}
+
+
+std::uint64_t Scheduler::makeKey(TaskGroup group, std::size_t index) {
+	return (static_cast<std::uint64_t>(group) << 48) | static_cast<std::uint64_t>(index);
+}
+
+
+Scheduler::SimDuration Scheduler::elapsed() const {
+	return clock;
+}
+
+
+Scheduler::SimDuration Scheduler::nextEventTime() const {
+	return timeline.empty() ? SimDuration::max() : timeline.top().at;
+}
+
+
+std::size_t Scheduler::pendingEvents() const {
+	return timeline.size();
+}
+
+
+std::vector<Scheduler::PendingEvent> Scheduler::getPendingEvents() const {
+	// The timeline only exposes its top, so a copy of it is drained
+	std::vector<PendingEvent> pending;
+	std::priority_queue<Event, std::vector<Event>, Later> remaining = timeline;
+
+	pending.reserve(remaining.size() + posted.size());
+
+	for (; !remaining.empty(); remaining.pop()) {
+		pending.push_back(PendingEvent{ remaining.top().at, remaining.top().key });
+	}
+
+	for (const Event& event : posted) {
+		pending.push_back(PendingEvent{ event.at, event.key });
+	}
+
+	return pending;
+}
+
+
+std::size_t Scheduler::getProcessedEvents() const {
+	return processedEvents.load(std::memory_order_relaxed);
+}
+
+
+std::chrono::time_point<std::chrono::system_clock> Scheduler::now() const {
+	return epoch + std::chrono::duration_cast<std::chrono::system_clock::duration>(clock);
+}
+
+
+std::chrono::time_point<std::chrono::system_clock> Scheduler::getEpoch() const {
+	return epoch;
+}
+
+
+Scheduler* Scheduler::current() {
+	return Scheduler::active;
+}
+
+
+void Scheduler::rethrowFailures() const {
+	for (const Task& task : tasks) {
+		if (task.done()) task.rethrowIfFailed();
+	}
+}
+
+
+/* ----------------- SimEvent ----------------- */
+
+SimEvent::SimEvent() : signalled(false) {}
+
+
+void SimEvent::set() {
+	signalled = true;
+
+	std::vector<Waiter> resumed = std::exchange(waiters, {});
+	for (const Waiter& waiter : resumed) {
+		waiter.scheduler->schedule(waiter.handle, waiter.scheduler->elapsed());
+	}
+}
+
+
+void SimEvent::addWaiter(Scheduler& scheduler, Scheduler::TaskHandle handle) {
+	if (signalled) throw std::logic_error("A signalled event has no waiters.");
+	waiters.push_back(Waiter{ &scheduler, handle });
+}
+
+
+void SimEvent::reset() {
+	signalled = false;
+}
+
+
+bool SimEvent::isSet() const {
+	return signalled;
+}
+
+
+SimEvent::Awaiter SimEvent::operator co_await() {
+	return Awaiter(*this);
+}
+
+
+SimEvent::Awaiter::Awaiter(SimEvent& event) : event(event) {}
+
+
+bool SimEvent::Awaiter::await_ready() const noexcept {
+	return event.signalled;
+}
+
+
+void SimEvent::Awaiter::await_suspend(Scheduler::TaskHandle handle) const {
+	Scheduler* scheduler = Scheduler::current();
+	if (scheduler == nullptr) throw std::runtime_error("SimEvent awaited outside of a running scheduler.");
+
+	event.waiters.push_back(Waiter{ scheduler, handle });
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <coroutine>
+
+
+/*
+* Cooperative, single-threaded discrete-event scheduler.
+*
+* Aircraft and chargers are written as coroutines returning a Task. Whenever they have to wait
+* (battery draining, charger being assigned, charge completing) they co_await on the scheduler
+* instead of blocking an OS thread. The scheduler keeps a timeline of suspended coroutines ordered
+* by simulated time and resumes them one at a time, jumping the simulated clock straight to the next
+* event. No wall-clock time is spent waiting, so one core can drive very large fleets.
+*
+* Every task carries a key that is unique within the simulation. Events at the same simulated time
+* are resumed in key order, which makes the outcome independent of how tasks are spread over
+* schedulers: a ParallelScheduler running the same tasks on several partitions reproduces the serial run.
+*/
+
+enum class TaskGroup : std::uint64_t {
+	Charger = 0,
+	Aircraft = 1,
+	Demand = 2,
+	Capacity = 3
+};
+
+class Task {
+public:
+	struct promise_type {
+		std::uint64_t key = 0;														// Stable key ordering simultaneous events
+		std::exception_ptr exception;												// Exception escaping the coroutine body, if any
+
+		Task get_return_object() noexcept;											// Build the Task owning this coroutine
+		std::suspend_always initial_suspend() const noexcept { return {}; }			// Tasks start suspended until spawned
+		std::suspend_always final_suspend() const noexcept { return {}; }			// Frame is destroyed by the owning Task
+		void return_void() const noexcept {}
+		void unhandled_exception() noexcept { exception = std::current_exception(); }
+	};
+
+	Task(Task&& other) noexcept;							// Move constructor
+	Task& operator=(Task&& other) noexcept;					// Move assignment
+
+	Task(const Task& other) = delete;						// Copy constructor
+	Task& operator=(const Task& other) = delete;			// Copy assignment
+
+	bool done() const;										// Check if the coroutine has run to completion
+	void rethrowIfFailed() const;							// Rethrow the exception that terminated the coroutine
+	std::coroutine_handle<promise_type> getHandle() const;	// Get the underlying coroutine handle
+
+	~Task();												// Destroys the coroutine frame
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> handle);
+
+	std::coroutine_handle<promise_type> handle;				// Handle to the coroutine frame owned by this task
+};
+
+
+class Scheduler {
+public:
+	using SimDuration = std::chrono::microseconds;			// Resolution of the simulated clock
+	using TaskHandle = std::coroutine_handle<Task::promise_type>;
+
+	// Coroutine waiting on the timeline, as seen from outside the scheduler
+	struct PendingEvent {
+		SimDuration at;										// Simulated time at which the coroutine is resumed
+		std::uint64_t key;									// Key of the task
+	};
+
+	// Awaitable returned by sleepFor(): suspends the caller and resumes it once the duration has elapsed
+	class Delay {
+	public:
+		Delay(Scheduler& scheduler, SimDuration duration);
+
+		bool await_ready() const noexcept;
+		void await_suspend(TaskHandle handle) const;
+		void await_resume() const noexcept {}
+
+	private:
+		Scheduler& scheduler;
+		SimDuration duration;
+	};
+
+	// Awaitable returned by transferTo(): moves the caller to another scheduler after a simulated delay
+	class Transfer {
+	public:
+		Transfer(Scheduler& source, Scheduler& target, SimDuration delay);
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(TaskHandle handle) const;
+		void await_resume() const noexcept {}
+
+	private:
+		Scheduler& source;
+		Scheduler& target;
+		SimDuration delay;
+	};
+
+	Scheduler();											// Simulated time starts at the current wall-clock time
+	explicit Scheduler(std::chrono::time_point<std::chrono::system_clock> epoch);	// Simulated time starts at the given timestamp
+	~Scheduler();											// Destroys all coroutines still owned by the scheduler
+
+	Scheduler(const Scheduler& other) = delete;				// Copy constructor
+	Scheduler& operator=(const Scheduler& other) = delete;	// Copy assignment
+
+	void stop();													// Stop the event loop after the current event
+	void spawn(Task&& task, std::uint64_t key);						// Take ownership of a task and make it ready to run
+	TaskHandle adopt(Task&& task, std::uint64_t key);				// Take ownership of a task without scheduling it
+	void schedule(TaskHandle handle, SimDuration at);				// Resume a coroutine at the given simulated time
+	void post(TaskHandle handle, SimDuration at);					// Thread-safe hand-over of a coroutine from another scheduler
+	std::size_t runFor(SimDuration duration);						// Run the event loop; returns the number of events processed
+	std::size_t runUntil(SimDuration horizon);						// Run all events strictly before the horizon
+	void acceptPosted();											// Move coroutines posted by other schedulers onto the timeline
+	void setHorizon(SimDuration horizon);							// Set the end of the window other schedulers may not post into
+	void setElapsed(SimDuration elapsed);							// Move the simulated clock of an idle scheduler, when resuming a checkpoint
+
+	Delay sleepFor(SimDuration duration);							// Awaitable that suspends the caller for a simulated duration
+	Transfer transferTo(Scheduler& target, SimDuration delay);		// Awaitable that resumes the caller on another scheduler
+
+	static std::uint64_t makeKey(TaskGroup group, std::size_t index);	// Build a task key unique across groups
+
+	SimDuration elapsed() const;									// Simulated time elapsed since the start of the simulation
+	SimDuration nextEventTime() const;								// Simulated time of the earliest event, or max() if idle
+	std::size_t pendingEvents() const;								// Number of coroutines waiting on the timeline
+	std::vector<PendingEvent> getPendingEvents() const;				// Coroutines waiting on the timeline or posted to it, in no particular order
+	std::size_t getProcessedEvents() const;							// Events processed so far, safe to read from any thread
+	std::chrono::time_point<std::chrono::system_clock> now() const;	// Simulated time expressed as a wall-clock timestamp
+	std::chrono::time_point<std::chrono::system_clock> getEpoch() const;	// Wall-clock timestamp of simulated time zero
+
+	static Scheduler* current();									// Scheduler running on the calling thread, if any
+
+private:
+	struct Event {
+		SimDuration at;								// Simulated time at which the coroutine is resumed
+		std::uint64_t key;							// Key of the task, orders events at the same time
+		std::uint64_t sequence;						// Insertion order, breaks any remaining ties
+		TaskHandle handle;							// Coroutine to resume
+	};
+
+	void rethrowFailures() const;					// Rethrow the first exception raised by an owned task
+
+	struct Later {
+		bool operator()(const Event& lhs, const Event& rhs) const;
+	};
+
+	bool stopped;																// Flag to stop the event loop
+	SimDuration clock;															// Current simulated time
+	std::uint64_t sequence;														// Counter used to order simultaneous events
+	std::atomic<std::size_t> processedEvents;									// Events processed over the lifetime of the scheduler
+	std::vector<Task> tasks;													// Tasks owned by the scheduler
+	std::chrono::time_point<std::chrono::system_clock> epoch;					// Wall-clock timestamp of simulated time zero
+	std::priority_queue<Event, std::vector<Event>, Later> timeline;				// Suspended coroutines ordered by wake-up time
+
+	SimDuration horizon;														// Posts must not land before this simulated time
+	std::mutex postedMtx;														// Mutex to control access to posted events
+	std::vector<Event> posted;													// Coroutines handed over by other schedulers
+
+	static thread_local Scheduler* active;										// Scheduler currently running on this thread
+};
+
+
+/*
+* Manual-reset event for coroutines. Awaiting an event that is not set suspends the caller;
+* set() resumes every waiter at the current simulated time of the scheduler it suspended on.
+* The event stays set until reset() is called.
+*/
+class SimEvent {
+public:
+	// Awaitable produced by co_await on the event; refers back to the event rather than copying it
+	class Awaiter {
+	public:
+		explicit Awaiter(SimEvent& event);
+
+		bool await_ready() const noexcept;
+		void await_suspend(Scheduler::TaskHandle handle) const;
+		void await_resume() const noexcept {}
+
+	private:
+		SimEvent& event;
+	};
+
+	SimEvent();
+
+	SimEvent(const SimEvent& other) = delete;				// Copy constructor
+	SimEvent& operator=(const SimEvent& other) = delete;	// Copy assignment
+
+	void set();												// Signal the event and wake all waiters
+	void addWaiter(Scheduler& scheduler, Scheduler::TaskHandle handle);	// Suspend a coroutine on the event as if it had awaited it on the scheduler
+	void reset();											// Clear the signal
+	bool isSet() const;										// Check if the event is signalled
+
+	Awaiter operator co_await();							// Suspend the caller until the event is signalled
+
+private:
+	struct Waiter {
+		Scheduler* scheduler;								// Scheduler the coroutine suspended on
+		Scheduler::TaskHandle handle;						// Coroutine waiting on the event
+	};
+
+	bool signalled;											// Signal state of the event
+	std::vector<Waiter> waiters;							// Coroutines suspended on this event
+};
@@ -0,0 +1,196 @@
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+
+#include "ScopeTimers.h"
+
+
+namespace {
+	constexpr const char* ScopeNames[TimedScopeCount] = { "battery", "requests", "queues", "charging", "logging", "summaries", "waiting" };
+
+	struct Counters {
+		std::atomic<std::uint64_t> calls{ 0 };
+		std::atomic<std::uint64_t> totalTicks{ 0 };
+		std::atomic<std::uint64_t> selfTicks{ 0 };
+	};
+
+	using CounterSet = std::array<Counters, TimedScopeCount>;
+
+	// Counters of the threads alive, and those of the threads that have exited
+	struct Registry {
+		std::mutex registryMtx;
+		std::vector<CounterSet*> threads;
+		CounterSet retired;
+	};
+
+	Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+
+	// Counters of one thread, registered on its first scope and folded into the retired ones when it exits
+	struct ThreadCounters {
+		CounterSet counters;
+
+		ThreadCounters() {
+			Registry& shared = registry();
+			std::lock_guard<std::mutex> lock(shared.registryMtx);
+			shared.threads.push_back(&counters);
+		}
+
+		~ThreadCounters() {
+			Registry& shared = registry();
+			std::lock_guard<std::mutex> lock(shared.registryMtx);
+
+			for (std::size_t i = 0; i < TimedScopeCount; ++i) {
+				shared.retired[i].calls.fetch_add(counters[i].calls.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				shared.retired[i].totalTicks.fetch_add(counters[i].totalTicks.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				shared.retired[i].selfTicks.fetch_add(counters[i].selfTicks.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+
+			shared.threads.erase(std::find(shared.threads.begin(), shared.threads.end(), &counters));
+		}
+	};
+
+	thread_local ThreadCounters threadCounters;
+	thread_local ScopeTimer* openScope = nullptr;
+
+	// The ticks are measured against the steady clock over the whole life of the process
+	const std::uint64_t startTicks = ScopeTimer::ticks();
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	void add(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+		// Only the owning thread writes its counters; readers may see a sum one scope behind
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+}
+
+
+ScopeTimer::ScopeTimer(TimedScope scope) noexcept :
+	scope(scope),
+	parent(openScope),
+	start(ticks()),
+	children(0)
+{
+	openScope = this;
+}
+
+
+ScopeTimer::~ScopeTimer() {
+	std::uint64_t total = ticks() - start;
+
+	openScope = parent;
+	if (parent != nullptr) parent->children += total;
+
+	ScopeTimers::record(scope, total, (total > children) ? total - children : 0);
+}
+
+
+bool ScopeTimers::isCompiledIn() {
+#ifdef EVSIM_SCOPE_TIMERS
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+std::array<ScopeTime, TimedScopeCount> ScopeTimers::times() {
+	std::array<ScopeTime, TimedScopeCount> times{};
+	double tick = secondsPerTick();
+
+	Registry& shared = registry();
+	std::lock_guard<std::mutex> lock(shared.registryMtx);
+
+	for (std::size_t i = 0; i < TimedScopeCount; ++i) {
+		std::uint64_t calls = shared.retired[i].calls.load(std::memory_order_relaxed);
+		std::uint64_t totalTicks = shared.retired[i].totalTicks.load(std::memory_order_relaxed);
+		std::uint64_t selfTicks = shared.retired[i].selfTicks.load(std::memory_order_relaxed);
+
+		for (const CounterSet* thread : shared.threads) {
+			calls += (*thread)[i].calls.load(std::memory_order_relaxed);
+			totalTicks += (*thread)[i].totalTicks.load(std::memory_order_relaxed);
+			selfTicks += (*thread)[i].selfTicks.load(std::memory_order_relaxed);
+		}
+
+		times[i] = ScopeTime{ ScopeNames[i], calls, static_cast<double>(totalTicks) * tick, static_cast<double>(selfTicks) * tick };
+	}
+
+	return times;
+}
+
+
+void ScopeTimers::reset() {
+	// Meant for between runs; a scope closing at the same time on another thread may survive the reset
+	Registry& shared = registry();
+	std::lock_guard<std::mutex> lock(shared.registryMtx);
+
+	auto clear = [](CounterSet& counters) {
+		for (Counters& counter : counters) {
+			counter.calls.store(0, std::memory_order_relaxed);
+			counter.totalTicks.store(0, std::memory_order_relaxed);
+			counter.selfTicks.store(0, std::memory_order_relaxed);
+		}
+	};
+
+	clear(shared.retired);
+	for (CounterSet* thread : shared.threads) clear(*thread);
+}
+
+
+void ScopeTimers::printReport(std::ostream& out) {
+	if (!ScopeTimers::isCompiledIn()) {
+		out << "Timed scopes are compiled out; build with -p:EvsimScopeTimers=true to time them" << "\n";
+		return;
+	}
+
+	std::array<ScopeTime, TimedScopeCount> scopes = ScopeTimers::times();
+
+	double selfSeconds = 0.0;
+	for (const ScopeTime& scope : scopes) selfSeconds += scope.selfSeconds;
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::left << std::setw(12) << "Scope" << std::right << std::setw(14) << "Calls" << std::setw(14) << "Total (ms)"
+		<< std::setw(14) << "Self (ms)" << std::setw(10) << "Self %" << std::setw(16) << "Self/call (ns)" << "\n";
+
+	out << std::fixed;
+	for (const ScopeTime& scope : scopes) {
+		double perCall = (scope.calls > 0) ? scope.selfSeconds * 1e9 / static_cast<double>(scope.calls) : 0.0;
+
+		out << std::left << std::setw(12) << scope.scope << std::right << std::setw(14) << scope.calls
+			<< std::setprecision(2) << std::setw(14) << scope.totalSeconds * 1000.0 << std::setw(14) << scope.selfSeconds * 1000.0
+			<< std::setprecision(1) << std::setw(10) << ((selfSeconds > 0.0) ? 100.0 * scope.selfSeconds / selfSeconds : 0.0)
+			<< std::setprecision(0) << std::setw(16) << perCall << "\n";
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+
+void ScopeTimers::record(TimedScope scope, std::uint64_t total, std::uint64_t self) noexcept {
+	Counters& counter = threadCounters.counters[static_cast<std::size_t>(scope)];
+
+	add(counter.calls, 1);
+	add(counter.totalTicks, total);
+	add(counter.selfTicks, self);
+}
+
+
+double ScopeTimers::secondsPerTick() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	// A few milliseconds of both clocks are enough for a report taken right after start-up
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	while (now - startTime < std::chrono::milliseconds(20)) now = std::chrono::steady_clock::now();
+
+	std::uint64_t elapsedTicks = ScopeTimer::ticks() - startTicks;
+	return std::chrono::duration<double>(now - startTime).count() / static_cast<double>(std::max<std::uint64_t>(elapsedTicks, 1));
+#else
+	return std::chrono::duration<double>(std::chrono::steady_clock::duration(1)).count();
+#endif
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+/*
+* Timed scopes on the hot paths of the simulator.
+*
+* A TIMED_SCOPE placed in a block measures it with the time-stamp counter, from the start of the block to
+* its end. Scopes nest: the time of a scope is its total, and what remains after the scopes opened inside
+* it is its self time, so logging done while creating a request counts as logging and not twice.
+*
+* Every thread adds to counters of its own, written with relaxed stores and no read-modify-write, and the
+* counters of a thread are folded into the totals when it exits; reading the breakdown sums them all. The
+* counters are process-wide, so concurrent simulations add up. A sharded run only times its coordinator.
+*
+* A scope must not span a co_await: a coroutine may resume on another thread, and the time it spends
+* suspended is not time of the scope. Blocking waits inside a scope of the real-time mode are timed as
+* Waiting instead, which keeps the self time of the scope to the work done.
+*
+* The scopes are compiled in only when EVSIM_SCOPE_TIMERS is defined; otherwise TIMED_SCOPE expands to
+* nothing and the breakdown is empty. Both projects define it when built with the EvsimScopeTimers
+* property, "msbuild SimpleSimulator.sln -p:Configuration=Release -p:EvsimScopeTimers=true", which
+* rebuilds every file whose defines change.
+*/
+
+enum class TimedScope : std::size_t {
+	BatteryUpdate,			// Battery drained at the end of a flight
+	RequestCreation,		// Charging request created, routed and queued
+	QueueHandling,			// Request taken from the queue of a vertiport by a charger
+	Charging,				// Charge completed and the aircraft handed back
+	Logging,				// Records written to the log
+	Summary,				// Session summary written to the log
+	Waiting					// Blocked on a condition variable or the timer wheel inside another scope
+};
+
+constexpr std::size_t TimedScopeCount = 7;
+
+
+struct ScopeTime {
+	const char* scope;						// Name of the scope
+	std::uint64_t calls;					// Times the scope was entered
+	double totalSeconds;					// Time from entering to leaving the scope
+	double selfSeconds;						// Total less the time of the scopes opened inside it
+};
+
+
+class ScopeTimer {
+public:
+	explicit ScopeTimer(TimedScope scope) noexcept;			// Start timing; the scope opened last on this thread becomes the parent
+	~ScopeTimer();											// Charge the time to the scope and to its parent
+
+	ScopeTimer(const ScopeTimer& other) = delete;			// Copy constructor
+	ScopeTimer& operator=(const ScopeTimer& other) = delete;	// Copy assignment
+
+	static std::uint64_t ticks() noexcept;					// Time-stamp counter, or a steady clock where there is none
+
+private:
+	TimedScope scope;										// Scope being timed
+	ScopeTimer* parent;										// Scope this one was opened in, if any
+	std::uint64_t start;									// Ticks when the scope was entered
+	std::uint64_t children;									// Ticks of the scopes opened inside this one
+};
+
+
+class ScopeTimers {
+public:
+	static bool isCompiledIn();												// Check if the simulator was built with the scopes
+	static std::array<ScopeTime, TimedScopeCount> times();					// Counters of all scopes, summed over the threads
+	static void reset();													// Zero the counters of all threads
+	static void printReport(std::ostream& out);								// Print calls, total and self time of every scope
+
+private:
+	friend class ScopeTimer;
+
+	static void record(TimedScope scope, std::uint64_t total, std::uint64_t self) noexcept;	// Add to the counters of this thread
+	static double secondsPerTick();											// Length of a tick, measured against the steady clock
+};
+
+
+inline std::uint64_t ScopeTimer::ticks() noexcept {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+
+#ifdef EVSIM_SCOPE_TIMERS
+#define TIMED_SCOPE_NAME(line) timedScope##line
+#define TIMED_SCOPE_AT(scope, line) ScopeTimer TIMED_SCOPE_NAME(line)(TimedScope::scope)
+#define TIMED_SCOPE(scope) TIMED_SCOPE_AT(scope, __LINE__)
+#else
+#define TIMED_SCOPE(scope) ((void)0)
+#endif
@@ -0,0 +1,279 @@
+#include <cstdio>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "MappedFile.h"
+#include "SegmentedLog.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+
+namespace {
+
+	constexpr std::size_t BufferBytes = 1 << 20;		// Write buffer of the open segment
+	constexpr const char* LockName = "writer.lock";		// Lock file of the simulation writing into a directory
+
+}
+
+
+SegmentedLog::SegmentedLog(const std::filesystem::path& directory, std::optional<std::uint64_t> resumedRun) :
+	directory(directory),
+	writerLock(-1),
+	run(0),
+	nextSegment(0),
+	segmentOpen(false),
+	segmentBytes(0)
+{
+	/*
+	* The segments already in the directory stay where they are: they may belong to a run that is still to
+	* be resumed, or that someone wants to read. The new segments are numbered after all of them, so the
+	* order of the names stays the order of writing across runs.
+	*/
+
+	std::filesystem::create_directories(directory);
+	lockDirectory();
+
+	try {
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+			std::size_t number = segmentNumber(entry.path());
+			if (number != SIZE_MAX) nextSegment = std::max(nextSegment, number + 1);
+		}
+	}
+	catch (...) {
+		unlockDirectory();
+		throw;
+	}
+
+	run = resumedRun.value_or(nextSegment);
+}
+
+
+SegmentedLog::~SegmentedLog() {
+	try {
+		seal();
+	}
+	catch (const std::exception&) {
+		// Nothing can be reported from here; seal() the log before destroying it to see the failure
+	}
+
+	unlockDirectory();
+}
+
+
+void SegmentedLog::append(std::size_t aircraft, LogRecordKind kind, const std::string& label, const std::string& record) {
+	std::lock_guard<std::mutex> lock(logMtx);
+
+	if (!segmentOpen) openSegment();
+
+	std::uint64_t offset = segmentBytes + label.size() + 1;
+	segment << label << '\t' << record << '\n';
+	if (!segment) throw std::runtime_error("Unable to write to the log in " + directory.string());
+
+	entries.push_back(LogIndexEntry{ static_cast<std::uint32_t>(aircraft), static_cast<std::uint32_t>(kind), offset, record.size() });
+	segmentBytes = offset + record.size() + 1;
+
+	if (segmentBytes >= SegmentBytes) {
+		writeIndex();
+		segmentOpen = false;
+	}
+}
+
+
+void SegmentedLog::seal() {
+	std::lock_guard<std::mutex> lock(logMtx);
+
+	if (!segmentOpen) return;
+
+	writeIndex();
+	segmentOpen = false;
+}
+
+
+std::uint64_t SegmentedLog::getRun() const {
+	return run;
+}
+
+
+void SegmentedLog::read(const std::filesystem::path& directory, std::size_t aircraft, const Visitor& visit) {
+	if (!std::filesystem::is_directory(directory)) throw std::runtime_error(directory.string() + " is not a log directory.");
+
+	// Only sealed segments are read; the numbers are zero-padded, so the order of the names is that of writing
+	std::vector<std::filesystem::path> indexes;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+		if (entry.path().extension() == ".idx" && segmentNumber(entry.path()) != SIZE_MAX) indexes.push_back(entry.path());
+	}
+	std::sort(indexes.begin(), indexes.end());
+	if (indexes.empty()) return;
+
+	auto headerOf = [](const MappedFile& index, const std::filesystem::path& indexPath) {
+		const LogIndexHeader* header = static_cast<const LogIndexHeader*>(index.data());
+		if (index.size() < offsetof(LogIndexHeader, segmentBytes) || std::memcmp(header->magic, LogIndexHeader::Magic, sizeof(header->magic)) != 0) {
+			throw std::runtime_error(indexPath.string() + " is not a log index.");
+		}
+		return header;
+	};
+
+	auto isCurrent = [](const MappedFile& index, const LogIndexHeader* header) {
+		return header->version == LogIndexHeader::Version && header->headerSize == sizeof(LogIndexHeader) && index.size() >= sizeof(LogIndexHeader);
+	};
+
+	// The latest run is the one that wrote the last index; the indexes of earlier runs are passed over, whatever version wrote them
+	std::uint64_t latestRun;
+	{
+		MappedFile index(indexes.back());
+		const LogIndexHeader* header = headerOf(index, indexes.back());
+		if (!isCurrent(index, header)) throw std::runtime_error(indexes.back().string() + " was written by another version of the simulator.");
+		latestRun = header->run;
+	}
+
+	for (const std::filesystem::path& indexPath : indexes) {
+		MappedFile index(indexPath);
+
+		const LogIndexHeader* header = headerOf(index, indexPath);
+		if (!isCurrent(index, header) || header->run != latestRun) continue;
+		if (header->entryCount > (index.size() - sizeof(LogIndexHeader)) / sizeof(LogIndexEntry)) throw std::runtime_error(indexPath.string() + " is truncated.");
+
+		const LogIndexEntry* first = reinterpret_cast<const LogIndexEntry*>(header + 1);
+		const LogIndexEntry* last = first + header->entryCount;
+		auto [from, to] = std::equal_range(first, last, LogIndexEntry{ static_cast<std::uint32_t>(aircraft), 0, 0, 0 },
+			[](const LogIndexEntry& a, const LogIndexEntry& b) { return a.aircraft < b.aircraft; });
+
+		if (from == to) continue;
+
+		std::filesystem::path segmentFile = indexPath;
+		MappedFile records(segmentFile.replace_extension(".log"));
+		if (records.size() < header->segmentBytes) throw std::runtime_error(segmentFile.string() + " is truncated.");
+
+		const char* bytes = static_cast<const char*>(records.data());
+		for (const LogIndexEntry* entry = from; entry != to; ++entry) {
+			if (entry->offset + entry->length > header->segmentBytes) throw std::runtime_error(indexPath.string() + " is corrupt.");
+			if (!visit(static_cast<LogRecordKind>(entry->kind), std::string_view(bytes + entry->offset, static_cast<std::size_t>(entry->length)))) return;
+		}
+	}
+}
+
+
+std::filesystem::path SegmentedLog::segmentPath(const std::filesystem::path& directory, std::size_t segment, const char* extension) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "segment-%06zu%s", segment, extension);
+	return directory / name;
+}
+
+
+std::size_t SegmentedLog::segmentNumber(const std::filesystem::path& path) {
+	std::string stem = path.stem().string();
+	std::string extension = path.extension().string();
+
+	if ((extension != ".log" && extension != ".idx") || stem.size() <= 8 || stem.compare(0, 8, "segment-") != 0) return SIZE_MAX;
+	if (!std::all_of(stem.begin() + 8, stem.end(), [](char c) { return c >= '0' && c <= '9'; })) return SIZE_MAX;
+
+	return static_cast<std::size_t>(std::stoull(stem.substr(8)));
+}
+
+
+void SegmentedLog::openSegment() {
+	// A large buffer turns the short records into few large writes
+	buffer.resize(BufferBytes);
+	segment.clear();
+	segment.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+	segment.open(segmentPath(directory, nextSegment, ".log"), std::ios::binary | std::ios::trunc);
+	if (!segment.is_open()) throw std::runtime_error("Unable to create a log segment in " + directory.string());
+
+	++nextSegment;
+	segmentBytes = 0;
+	segmentOpen = true;
+}
+
+
+void SegmentedLog::writeIndex() {
+	/*
+	* Entries are appended in order of writing, so sorting them by aircraft alone with a stable sort keeps
+	* the records of every aircraft in order, and a reader finds them all with one binary search.
+	*/
+
+	segment.close();
+	if (!segment) throw std::runtime_error("Unable to write to the log in " + directory.string());
+
+	std::stable_sort(entries.begin(), entries.end(), [](const LogIndexEntry& a, const LogIndexEntry& b) { return a.aircraft < b.aircraft; });
+
+	std::filesystem::path path = segmentPath(directory, nextSegment - 1, ".idx");
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) throw std::runtime_error("Unable to create log index " + path.string());
+
+	LogIndexHeader header{};
+	std::memcpy(header.magic, LogIndexHeader::Magic, sizeof(header.magic));
+	header.version = LogIndexHeader::Version;
+	header.headerSize = static_cast<std::uint32_t>(sizeof(LogIndexHeader));
+	header.segmentBytes = segmentBytes;
+	header.entryCount = entries.size();
+	header.run = run;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(LogIndexEntry)));
+
+	file.close();
+	if (!file) throw std::runtime_error("Unable to write log index " + path.string());
+
+	entries.clear();
+	entries.shrink_to_fit();
+}
+
+
+#ifdef _WIN32
+
+void SegmentedLog::lockDirectory() {
+	// A file nobody else may open is the lock; it goes away with the handle, even if the process dies
+	HANDLE file = CreateFileW((directory / LockName).c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE) {
+		if (GetLastError() == ERROR_SHARING_VIOLATION) throw std::runtime_error("Log directory " + directory.string() + " is in use by another simulation.");
+		throw std::runtime_error("Unable to lock log directory " + directory.string());
+	}
+
+	writerLock = reinterpret_cast<std::intptr_t>(file);
+}
+
+
+void SegmentedLog::unlockDirectory() {
+	if (writerLock == -1) return;
+
+	CloseHandle(reinterpret_cast<HANDLE>(writerLock));
+	writerLock = -1;
+}
+
+#else
+
+void SegmentedLog::lockDirectory() {
+	// The lock belongs to the open file, so a second simulation of the same process is refused as well; it goes away with the process
+	int descriptor = open((directory / LockName).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (descriptor < 0) throw std::runtime_error("Unable to lock log directory " + directory.string());
+
+	if (flock(descriptor, LOCK_EX | LOCK_NB) != 0) {
+		close(descriptor);
+		throw std::runtime_error("Log directory " + directory.string() + " is in use by another simulation.");
+	}
+
+	writerLock = descriptor;
+}
+
+
+void SegmentedLog::unlockDirectory() {
+	if (writerLock == -1) return;
+
+	close(static_cast<int>(writerLock));
+	writerLock = -1;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <functional>
+#include <filesystem>
+#include <string_view>
+
+#include "MemoryAccounting.h"
+
+
+/*
+* Log of all aircraft of a run in a few large segment files.
+*
+* Every record is appended to the open segment as one line, "<model number>\t<record>", whatever aircraft
+* it belongs to, so the number of files of a run grows with the volume of the log and not with the size
+* of the fleet. A segment is sealed once it passes SegmentBytes, at a checkpoint and at the end of the run;
+* sealing writes its index next to it, the position of every record sorted by aircraft, and the next
+* record opens another segment.
+*
+* The records of one aircraft are read back through the indexes alone, without scanning the segments:
+*
+*   segment-000000.log		records of all aircraft, in order of writing
+*   segment-000000.idx		LogIndexHeader, then entryCount x LogIndexEntry sorted by aircraft
+*   writer.lock				held by the simulation writing into the directory
+*
+* A directory keeps the segments of every run written into it. A new run numbers its segments after the
+* ones already there and is known by the number of its first segment, which every index records; reading
+* a directory returns the records of its latest run. A run resumed from a checkpoint carries on under the
+* run it continues. Only one simulation at a time writes into a directory: opening a log whose directory
+* is locked by another fails, however many simulations the process runs.
+*/
+
+enum class LogRecordKind : std::uint32_t {
+	Event,					// Timestamped line of the aircraft or of the chargers serving it
+	Session					// Performance summary of a completed flight session, as a JSON object
+};
+
+
+struct LogIndexHeader {
+	static constexpr char Magic[8] = { 'E', 'V', 'T', 'O', 'L', 'L', 'O', 'G' };
+	static constexpr std::uint32_t Version = 2;
+
+	char magic[8];						// Identifies a log index
+	std::uint32_t version;				// Layout version of the file
+	std::uint32_t headerSize;			// sizeof(LogIndexHeader) of the writer
+	std::uint64_t segmentBytes;			// Size of the segment the index covers
+	std::uint64_t entryCount;			// Entries following the header
+	std::uint64_t run;					// First segment of the run that wrote the segment
+};
+
+
+struct LogIndexEntry {
+	std::uint32_t aircraft;				// Position of the aircraft in the fleet
+	std::uint32_t kind;					// LogRecordKind of the record
+	std::uint64_t offset;				// First byte of the record in the segment
+	std::uint64_t length;				// Bytes of the record, without the label and the newline
+};
+
+
+class SegmentedLog {
+public:
+	static constexpr std::uint64_t SegmentBytes = 64ull << 20;		// Size a segment is sealed at
+	using Visitor = std::function<bool(LogRecordKind kind, std::string_view record)>;
+
+	// Continue a run of the directory, or start a new one; the segments of other runs are kept
+	SegmentedLog(const std::filesystem::path& directory, std::optional<std::uint64_t> resumedRun);
+	~SegmentedLog();													// Seals the open segment and releases the directory
+
+	SegmentedLog(const SegmentedLog& other) = delete;					// Copy constructor
+	SegmentedLog& operator=(const SegmentedLog& other) = delete;		// Copy assignment
+
+	void append(std::size_t aircraft, LogRecordKind kind, const std::string& label, const std::string& record);	// Add a record of an aircraft
+	void seal();														// Write the index of the open segment and close it
+	std::uint64_t getRun() const;										// Run the segments are written under
+
+	// Call visit for every record of an aircraft in the latest run of a log directory, in order of writing, until it returns false
+	static void read(const std::filesystem::path& directory, std::size_t aircraft, const Visitor& visit);
+
+private:
+	using IndexList = TrackedVector<LogIndexEntry, MemorySubsystem::Logging>;
+
+	static std::filesystem::path segmentPath(const std::filesystem::path& directory, std::size_t segment, const char* extension);
+	static std::size_t segmentNumber(const std::filesystem::path& path);	// Number of a segment or index file, SIZE_MAX for other files
+	void lockDirectory();												// Take the writer lock of the directory, throws if another simulation holds it
+	void unlockDirectory();												// Release the writer lock
+	void openSegment();													// Open the next segment for writing
+	void writeIndex();													// Sort and write the entries of the open segment
+
+	std::mutex logMtx;													// Mutex to serialise the writers
+	std::filesystem::path directory;									// Directory holding the segments
+	std::intptr_t writerLock;											// Handle or descriptor of the lock file, -1 if not held
+	std::uint64_t run;													// Run the segments are written under
+	std::size_t nextSegment;											// Number the next segment is opened with
+	bool segmentOpen;													// Flag to indicate that a segment takes records
+	std::ofstream segment;												// Open segment
+	std::vector<char> buffer;											// Write buffer of the open segment
+	std::uint64_t segmentBytes;											// Bytes written to the open segment
+	IndexList entries;													// Records of the open segment, in order of writing
+};
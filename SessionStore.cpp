@@ -0,0 +1,299 @@
+#include <cmath>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SessionStore.h"
+
+
+/* ----------------- SessionColumns ----------------- */
+
+std::size_t SessionColumns::size() const {
+	return start.size();
+}
+
+
+void SessionColumns::append(const SessionColumns& other) {
+	start.insert(start.end(), other.start.begin(), other.start.end());
+	end.insert(end.end(), other.end.begin(), other.end.end());
+	airTime.insert(airTime.end(), other.airTime.begin(), other.airTime.end());
+	miles.insert(miles.end(), other.miles.begin(), other.miles.end());
+	passengerMiles.insert(passengerMiles.end(), other.passengerMiles.begin(), other.passengerMiles.end());
+	faults.insert(faults.end(), other.faults.begin(), other.faults.end());
+	manufacturer.insert(manufacturer.end(), other.manufacturer.begin(), other.manufacturer.end());
+	aircraft.insert(aircraft.end(), other.aircraft.begin(), other.aircraft.end());
+}
+
+
+const std::vector<double>& SessionColumns::column(SessionField field) const {
+	switch (field) {
+	case SessionField::AirTime: return airTime;
+	case SessionField::Miles: return miles;
+	case SessionField::PassengerMiles: return passengerMiles;
+	default: return faults;
+	}
+}
+
+
+/* ----------------- SessionQuery ----------------- */
+
+SessionQuery::SessionQuery(const SessionColumns& columns) :
+	columns(columns),
+	from(std::numeric_limits<std::int64_t>::min()),
+	to(std::numeric_limits<std::int64_t>::max()),
+	manufacturerFilter(-1),
+	aircraftFilter(-1),
+	evaluated(false)
+{}
+
+
+SessionQuery& SessionQuery::manufacturer(std::size_t index) {
+	manufacturerFilter = static_cast<std::int64_t>(index);
+	evaluated = false;
+	return *this;
+}
+
+
+SessionQuery& SessionQuery::aircraft(std::size_t aircraftID) {
+	aircraftFilter = static_cast<std::int64_t>(aircraftID);
+	evaluated = false;
+	return *this;
+}
+
+
+SessionQuery& SessionQuery::startedBetween(std::int64_t from, std::int64_t to) {
+	this->from = from;
+	this->to = to;
+	evaluated = false;
+	return *this;
+}
+
+
+std::size_t SessionQuery::count() const {
+	const std::vector<std::uint8_t>& selected = selection();
+	std::size_t total = 0;
+
+	for (std::size_t i = 0; i < selected.size(); ++i) total += selected[i];
+
+	return total;
+}
+
+
+double SessionQuery::sum(SessionField field) const {
+	/*
+	* Non-matching rows are multiplied by zero instead of skipped. Four independent partial sums
+	* let the compiler keep several lanes in flight without reassociating a single accumulator.
+	*/
+
+	const std::vector<std::uint8_t>& selected = selection();
+	const double* values = columns.column(field).data();
+	const std::uint8_t* keep = selected.data();
+	std::size_t n = selected.size();
+
+	double partial[4] = { 0.0, 0.0, 0.0, 0.0 };
+	std::size_t i = 0;
+
+	for (; i + 4 <= n; i += 4) {
+		partial[0] += values[i] * keep[i];
+		partial[1] += values[i + 1] * keep[i + 1];
+		partial[2] += values[i + 2] * keep[i + 2];
+		partial[3] += values[i + 3] * keep[i + 3];
+	}
+	for (; i < n; ++i) partial[0] += values[i] * keep[i];
+
+	return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+
+double SessionQuery::mean(SessionField field) const {
+	std::size_t matching = count();
+	if (matching == 0) return std::nan("");
+
+	return sum(field) / matching;
+}
+
+
+double SessionQuery::percentile(SessionField field, double p) const {
+	const std::vector<std::uint8_t>& selected = selection();
+	const std::vector<double>& values = columns.column(field);
+
+	std::vector<double> matching;
+	matching.reserve(selected.size());
+	for (std::size_t i = 0; i < selected.size(); ++i) {
+		if (selected[i]) matching.push_back(values[i]);
+	}
+
+	return nearestRank(matching, p);
+}
+
+
+std::vector<std::size_t> SessionQuery::countByManufacturer(std::size_t numManufacturers) const {
+	const std::vector<std::uint8_t>& selected = selection();
+	std::vector<std::size_t> counts(numManufacturers, 0);
+
+	for (std::size_t i = 0; i < selected.size(); ++i) {
+		std::uint16_t group = columns.manufacturer[i];
+		if (group < numManufacturers) counts[group] += selected[i];
+	}
+
+	return counts;
+}
+
+
+std::vector<double> SessionQuery::sumByManufacturer(SessionField field, std::size_t numManufacturers) const {
+	const std::vector<std::uint8_t>& selected = selection();
+	const std::vector<double>& values = columns.column(field);
+	std::vector<double> sums(numManufacturers, 0.0);
+
+	for (std::size_t i = 0; i < selected.size(); ++i) {
+		std::uint16_t group = columns.manufacturer[i];
+		if (group < numManufacturers) sums[group] += values[i] * selected[i];
+	}
+
+	return sums;
+}
+
+
+std::vector<double> SessionQuery::percentileByManufacturer(SessionField field, double p, std::size_t numManufacturers) const {
+	const std::vector<std::uint8_t>& selected = selection();
+	const std::vector<double>& values = columns.column(field);
+
+	// A single scatter pass over the columns, then one selection per group
+	std::vector<std::size_t> counts = countByManufacturer(numManufacturers);
+	std::vector<std::vector<double>> groups(numManufacturers);
+	for (std::size_t group = 0; group < numManufacturers; ++group) groups[group].reserve(counts[group]);
+
+	for (std::size_t i = 0; i < selected.size(); ++i) {
+		std::uint16_t group = columns.manufacturer[i];
+		if (selected[i] && group < numManufacturers) groups[group].push_back(values[i]);
+	}
+
+	std::vector<double> percentiles(numManufacturers);
+	for (std::size_t group = 0; group < numManufacturers; ++group) {
+		percentiles[group] = nearestRank(groups[group], p);
+	}
+
+	return percentiles;
+}
+
+
+double SessionQuery::nearestRank(std::vector<double>& values, double p) {
+	if (values.empty()) return std::nan("");
+
+	double rank = std::ceil(std::clamp(p, 0.0, 100.0) / 100.0 * values.size());
+	std::size_t index = rank < 1.0 ? 0 : static_cast<std::size_t>(rank) - 1;
+
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+
+const std::vector<std::uint8_t>& SessionQuery::selection() const {
+	if (evaluated) return mask;
+
+	std::size_t n = columns.size();
+	const std::int64_t* start = columns.start.data();
+	const std::uint16_t* manufacturers = columns.manufacturer.data();
+	const std::uint32_t* aircraft = columns.aircraft.data();
+
+	mask.assign(n, 1);
+	std::uint8_t* keep = mask.data();
+
+	// One pass per active filter; each is a branch-free compare over a single column
+	if (from != std::numeric_limits<std::int64_t>::min() || to != std::numeric_limits<std::int64_t>::max()) {
+		for (std::size_t i = 0; i < n; ++i) keep[i] &= static_cast<std::uint8_t>((start[i] >= from) & (start[i] < to));
+	}
+	if (manufacturerFilter >= 0) {
+		for (std::size_t i = 0; i < n; ++i) keep[i] &= static_cast<std::uint8_t>(manufacturers[i] == manufacturerFilter);
+	}
+	if (aircraftFilter >= 0) {
+		for (std::size_t i = 0; i < n; ++i) keep[i] &= static_cast<std::uint8_t>(aircraft[i] == aircraftFilter);
+	}
+
+	evaluated = true;
+	return mask;
+}
+
+
+/* ----------------- SessionStore ----------------- */
+
+SessionStore::SessionStore() {}
+
+
+void SessionStore::append(std::size_t manufacturer, std::size_t aircraft,
+	std::chrono::time_point<std::chrono::system_clock> start, std::chrono::time_point<std::chrono::system_clock> end,
+	double airTime, double miles, double passengerMiles, double faults)
+{
+	SessionColumns& buffer = buffers.local();
+
+	buffer.start.push_back(std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count());
+	buffer.end.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end.time_since_epoch()).count());
+	buffer.airTime.push_back(airTime);
+	buffer.miles.push_back(miles);
+	buffer.passengerMiles.push_back(passengerMiles);
+	buffer.faults.push_back(faults);
+	buffer.manufacturer.push_back(static_cast<std::uint16_t>(manufacturer));
+	buffer.aircraft.push_back(static_cast<std::uint32_t>(aircraft));
+}
+
+
+const SessionColumns& SessionStore::columns() {
+	/*
+	* Buffers are drained into the merged columns rather than copied, so each session is moved at most
+	* once however often the store is queried. The first non-empty buffer is taken over without a copy.
+	*/
+
+	std::lock_guard<std::mutex> lock(mergedMtx);
+
+	buffers.forEach([this](SessionColumns& buffer) {
+		if (merged.size() == 0) std::swap(merged, buffer);
+		else merged.append(buffer);
+
+		buffer = SessionColumns{};
+		});
+
+	return merged;
+}
+
+
+void SessionStore::restore(SessionColumns&& sessions) {
+	std::lock_guard<std::mutex> lock(mergedMtx);
+
+	std::size_t recorded = merged.size();
+	buffers.forEach([&recorded](const SessionColumns& buffer) { recorded += buffer.size(); });
+
+	if (recorded != 0) throw std::logic_error("Sessions can only be restored into an empty store.");
+	merged = std::move(sessions);
+}
+
+
+SessionQuery SessionStore::query() {
+	return SessionQuery(columns());
+}
+
+
+void SessionStore::printReport(std::ostream& out, const std::vector<std::string>& manufacturers) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	SessionQuery all = query();
+	std::size_t sessions = all.count();
+	std::vector<std::size_t> counts = all.countByManufacturer(manufacturers.size());
+	std::vector<double> airTimes = all.sumByManufacturer(SessionField::AirTime, manufacturers.size());
+
+	std::vector<double> medians = all.percentileByManufacturer(SessionField::AirTime, 50.0, manufacturers.size());
+	std::vector<double> tails = all.percentileByManufacturer(SessionField::AirTime, 95.0, manufacturers.size());
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+
+	out << "\n" << "Session store: " << sessions << " sessions, queried in " << std::fixed << std::setprecision(2) << elapsed.count() << " ms" << "\n";
+	out << std::left << std::setw(14) << "Manufacturer" << std::right << std::setw(10) << "Sessions"
+		<< std::setw(20) << "Mean flight (min)" << std::setw(20) << "p50 flight (min)" << std::setw(20) << "p95 flight (min)" << "\n";
+
+	for (std::size_t i = 0; i < manufacturers.size(); ++i) {
+		double meanFlight = counts[i] == 0 ? std::nan("") : airTimes[i] / counts[i];
+
+		out << std::left << std::setw(14) << manufacturers[i] << std::right << std::setw(10) << counts[i]
+			<< std::setw(20) << meanFlight / 60.0 << std::setw(20) << medians[i] / 60.0 << std::setw(20) << tails[i] / 60.0 << "\n";
+	}
+	out << std::defaultfloat;
+}
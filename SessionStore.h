@@ -0,0 +1,106 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+#include "ThreadSlots.h"
+
+
+/*
+* Column-oriented store of all completed flight sessions.
+*
+* Each field lives in its own contiguous array, so a query over one field streams through exactly
+* the memory it needs and the inner loops vectorize. Sessions are appended to a buffer owned by the
+* completing thread, found through the slot of the thread (ThreadSlots.h) without a lock or a search;
+* the buffers are drained into one set of columns when the store is queried.
+*/
+
+enum class SessionField {
+	AirTime,				// Airtime in seconds
+	Miles,					// Miles flown
+	PassengerMiles,			// Passenger miles flown
+	Faults					// Expected faults
+};
+
+
+struct SessionColumns {
+	std::vector<std::int64_t> start;			// Start of the flight in microseconds since the Unix epoch
+	std::vector<std::int64_t> end;				// End of the flight in microseconds since the Unix epoch
+	std::vector<double> airTime;				// Airtime in seconds
+	std::vector<double> miles;					// Miles flown
+	std::vector<double> passengerMiles;			// Passenger miles flown
+	std::vector<double> faults;					// Expected faults
+	std::vector<std::uint16_t> manufacturer;	// Index of the manufacturer
+	std::vector<std::uint32_t> aircraft;		// Position of the aircraft in the fleet
+
+	std::size_t size() const;											// Number of sessions
+	void append(const SessionColumns& other);							// Append all sessions of another set of columns
+	const std::vector<double>& column(SessionField field) const;		// Get the array of a numeric field
+};
+
+
+/*
+* Filtered aggregations over a set of columns. Filters are combined with AND and evaluated
+* once into a selection mask; every aggregation then runs branch-free over the mask.
+*/
+
+class SessionQuery {
+public:
+	explicit SessionQuery(const SessionColumns& columns);
+
+	SessionQuery& manufacturer(std::size_t index);								// Only sessions of this manufacturer
+	SessionQuery& aircraft(std::size_t aircraftID);								// Only sessions of this aircraft
+	SessionQuery& startedBetween(std::int64_t from, std::int64_t to);			// Only sessions started in [from, to)
+
+	std::size_t count() const;													// Number of matching sessions
+	double sum(SessionField field) const;										// Sum of a field over matching sessions
+	double mean(SessionField field) const;										// Mean of a field, NaN if nothing matches
+	double percentile(SessionField field, double p) const;						// Nearest-rank percentile (0-100), NaN if nothing matches
+
+	std::vector<std::size_t> countByManufacturer(std::size_t numManufacturers) const;				// Matching sessions per manufacturer
+	std::vector<double> sumByManufacturer(SessionField field, std::size_t numManufacturers) const;	// Sum of a field per manufacturer
+	std::vector<double> percentileByManufacturer(SessionField field, double p, std::size_t numManufacturers) const;	// Percentile of a field per manufacturer
+
+private:
+	const std::vector<std::uint8_t>& selection() const;							// Evaluate the filters into a 0/1 mask
+	static double nearestRank(std::vector<double>& values, double p);			// Select the nearest-rank percentile in place
+
+	const SessionColumns& columns;
+
+	std::int64_t from;															// Start of the time filter
+	std::int64_t to;															// End of the time filter
+	std::int64_t manufacturerFilter;											// Manufacturer to match, -1 for all
+	std::int64_t aircraftFilter;												// Aircraft to match, -1 for all
+
+	mutable bool evaluated;														// Flag to indicate that the mask is current
+	mutable std::vector<std::uint8_t> mask;										// 1 for matching sessions
+};
+
+
+class SessionStore {
+public:
+	SessionStore();													// Default constructor
+
+	SessionStore(const SessionStore& other) = delete;				// Copy constructor
+	SessionStore& operator=(const SessionStore& other) = delete;	// Copy assignment
+
+	void append(std::size_t manufacturer, std::size_t aircraft,
+		std::chrono::time_point<std::chrono::system_clock> start, std::chrono::time_point<std::chrono::system_clock> end,
+		double airTime, double miles, double passengerMiles, double faults);		// Record a completed session
+
+	const SessionColumns& columns();												// Drain the per-thread buffers into one set of columns; call once recording has stopped
+	void restore(SessionColumns&& sessions);										// Start from the sessions of a checkpoint; call before recording
+	SessionQuery query();															// Start a query over all sessions
+	void printReport(std::ostream& out, const std::vector<std::string>& manufacturers);	// Print the end-of-run session statistics
+
+private:
+	ThreadBuffers<SessionColumns> buffers;											// Sessions not yet drained, per thread
+	std::mutex mergedMtx;															// Mutex to control access to the merged columns
+	SessionColumns merged;															// Sessions drained from all buffers so far
+};
@@ -0,0 +1,607 @@
+#include <new>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+#include "ShardedScheduler.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <filesystem>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#endif
+
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free && std::atomic<bool>::is_always_lock_free,
+	"Atomics shared between processes must not fall back to a lock");
+
+
+/* ----------------- Shared memory ----------------- */
+
+// Fixed-size record exchanged between the coordinator and a shard
+struct ShardedScheduler::Message {
+	enum class Type : std::uint32_t {
+		ChargeRequest,							// Aircraft arriving at the charging network
+		Release,								// Aircraft leaving the charger at the end of its charge
+		Session									// Session completed by an aircraft
+	};
+
+	Type type;
+	std::uint32_t aircraft;						// Position of the aircraft in the fleet
+	std::int64_t at;							// Simulated time of the arrival or release, or the start of the session, in microseconds
+	std::int64_t end;							// End of the session in microseconds
+};
+
+
+/*
+* Single-producer, single-consumer ring. The producer only writes the tail and the consumer only the
+* head, each on its own cache line; a message is published by the release store of the tail and freed
+* by the release store of the head.
+*/
+struct alignas(64) ShardedScheduler::Ring {
+	static constexpr std::uint64_t Capacity = 4096;
+
+	alignas(64) std::atomic<std::uint64_t> head;			// Messages taken by the consumer
+	alignas(64) std::atomic<std::uint64_t> tail;			// Messages written by the producer
+	alignas(64) Message messages[Capacity];
+
+	bool push(const Message& message) {
+		std::uint64_t written = tail.load(std::memory_order_relaxed);
+		if (written - head.load(std::memory_order_acquire) == Capacity) return false;
+
+		messages[written % Capacity] = message;
+		tail.store(written + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool pop(Message& message) {
+		std::uint64_t taken = head.load(std::memory_order_relaxed);
+		if (taken == tail.load(std::memory_order_acquire)) return false;
+
+		message = messages[taken % Capacity];
+		head.store(taken + 1, std::memory_order_release);
+
+		return true;
+	}
+};
+
+
+// Written by its process before it arrives at a barrier, read by the process completing the barrier
+struct alignas(64) ShardedScheduler::Slot {
+	std::int64_t nextEvent;						// Earliest event of the process once the window has been exchanged
+	std::uint64_t processed;					// Events processed by the process in the current run
+};
+
+
+struct alignas(64) ShardedScheduler::Control {
+	enum class Command : std::uint32_t {
+		Run,									// Run up to the deadline
+		Finish									// Exit the shard processes
+	};
+
+	alignas(64) std::atomic<std::uint32_t> arrived;			// Processes waiting at the barrier
+	alignas(64) std::atomic<std::uint32_t> generation;		// Barriers passed so far
+	alignas(64) std::atomic<std::uint32_t> flushed;			// Processes that have sent all they had in the current exchange
+
+	// Written by the coordinator or by the process completing a barrier, read once the barrier has been passed
+	alignas(64) Command command;
+	std::int64_t deadline;						// End of the run, exclusive
+	std::int64_t lookahead;						// Length of a window
+	std::int64_t windowEnd;						// End of the current window
+	bool finished;								// Flag to indicate that the run has no window left
+	std::uint64_t windows;						// Windows executed by the current run
+
+	std::atomic<bool> failed;					// Flag to indicate that a process has failed
+	char failure[256];							// Message of the first failure
+};
+
+
+namespace {
+
+	/*
+	* Waits spin first, then yield, then sleep: the processes may outnumber the cores, and the shards
+	* wait at the barrier for as long as the coordinator takes to start the next run.
+	*/
+	class Backoff {
+	public:
+		bool pause() {
+			++rounds;
+			if (rounds < SpinRounds) return false;
+
+			if (rounds < YieldRounds) std::this_thread::yield();
+			else std::this_thread::sleep_for((rounds < NapRounds) ? std::chrono::microseconds(20) : std::chrono::microseconds(1000));
+
+			return rounds >= YieldRounds;
+		}
+
+	private:
+		static constexpr std::size_t SpinRounds = 256;
+		static constexpr std::size_t YieldRounds = 4096;
+		static constexpr std::size_t NapRounds = 8192;
+
+		std::size_t rounds = 0;
+	};
+
+}
+
+
+/* ----------------- Scheduler ----------------- */
+
+ShardedScheduler::ChargeRequest::ChargeRequest(ShardedScheduler& scheduler, std::size_t aircraft, Scheduler::SimDuration delay) :
+	scheduler(scheduler),
+	aircraft(aircraft),
+	delay(delay)
+{}
+
+
+void ShardedScheduler::ChargeRequest::await_suspend(Scheduler::TaskHandle handle) const {
+	if (aircraft >= scheduler.parked.size()) scheduler.parked.resize(aircraft + 1);
+	scheduler.parked[aircraft] = handle;
+
+	scheduler.outboxes[scheduler.process - 1].push_back(Message{ Message::Type::ChargeRequest, static_cast<std::uint32_t>(aircraft),
+		(scheduler.fleetScheduler.elapsed() + delay).count(), 0 });
+}
+
+
+// Both schedulers share one epoch so that simulated timestamps agree across processes
+ShardedScheduler::ShardedScheduler(std::size_t numShards) :
+	shards(numShards),
+	process(0),
+	networkScheduler(),
+	fleetScheduler(networkScheduler.getEpoch()),
+	clock(Scheduler::SimDuration::zero()),
+	windowEnd(Scheduler::SimDuration::zero()),
+	failure(nullptr),
+	shared(nullptr),
+	sharedBytes(0),
+	control(nullptr),
+	slots(nullptr),
+	rings(nullptr),
+	broken(false)
+{
+	if (numShards == 0) throw std::invalid_argument("A sharded simulation needs at least one shard.");
+
+#ifdef _WIN32
+	throw std::runtime_error("Sharded simulations need a Linux host.");
+#else
+	// Mapped before forking, so that every shard inherits the same pages
+	sharedBytes = sizeof(Control) + sizeof(Slot) * numProcesses() + sizeof(Ring) * 2 * shards;
+	shared = mmap(nullptr, sharedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		shared = nullptr;
+		throw std::system_error(errno, std::generic_category(), "Unable to map the memory shared with the shards");
+	}
+
+	std::byte* base = static_cast<std::byte*>(shared);
+	control = new (base) Control{};
+	slots = reinterpret_cast<Slot*>(base + sizeof(Control));
+	rings = reinterpret_cast<Ring*>(base + sizeof(Control) + sizeof(Slot) * numProcesses());
+
+	for (std::size_t p = 0; p < numProcesses(); ++p) new (&slots[p]) Slot{};
+	for (std::size_t r = 0; r < 2 * shards; ++r) new (&rings[r]) Ring{};
+#endif
+
+	outboxes.resize(shards);
+}
+
+
+ShardedScheduler::~ShardedScheduler() {
+	try {
+		finish();
+	}
+	catch (...) {
+		// The shards have been killed instead
+	}
+
+#ifndef _WIN32
+	if (shared != nullptr) munmap(shared, sharedBytes);
+#endif
+}
+
+
+std::size_t ShardedScheduler::numShards() const {
+	return shards;
+}
+
+
+Scheduler& ShardedScheduler::network() {
+	return networkScheduler;
+}
+
+
+Scheduler& ShardedScheduler::fleet() {
+	return fleetScheduler;
+}
+
+
+ShardedScheduler::ChargeRequest ShardedScheduler::requestCharge(std::size_t aircraft, Scheduler::SimDuration delay) {
+	return ChargeRequest(*this, aircraft, delay);
+}
+
+
+void ShardedScheduler::recordSession(std::size_t aircraft, Scheduler::SimDuration start, Scheduler::SimDuration end) {
+	outboxes[process - 1].push_back(Message{ Message::Type::Session, static_cast<std::uint32_t>(aircraft), start.count(), end.count() });
+}
+
+
+void ShardedScheduler::attach(std::size_t aircraft, Scheduler::TaskHandle handle) {
+	if (aircraft >= parked.size()) parked.resize(aircraft + 1);
+	parked[aircraft] = handle;
+}
+
+
+void ShardedScheduler::release(std::size_t aircraft, Scheduler::SimDuration at) {
+	outboxes[aircraft % shards].push_back(Message{ Message::Type::Release, static_cast<std::uint32_t>(aircraft), at.count(), 0 });
+}
+
+
+std::size_t ShardedScheduler::runFor(Scheduler::SimDuration duration, Scheduler::SimDuration lookahead) {
+	/*
+	* The coordinator publishes the deadline of the run and meets the shards at the barrier they wait at
+	* between runs. From there every process takes part in the same windows as the workers of
+	* ParallelScheduler::runFor(), each on its own scheduler. Like Scheduler::runFor(), a run continues
+	* from where the previous one ended.
+	*/
+
+	if (process != 0) throw std::logic_error("Only the coordinator runs a sharded simulation.");
+	if (lookahead <= Scheduler::SimDuration::zero()) throw std::invalid_argument("Lookahead must be positive.");
+	if (pids.empty()) throw std::logic_error("The shards are not running.");
+
+	control->command = Control::Command::Run;
+	control->deadline = (clock + duration + Scheduler::SimDuration(1)).count();	// runFor() includes events at the deadline
+	control->lookahead = lookahead.count();
+	control->windows = 0;
+
+	arriveAndWait([] {});
+
+	std::size_t processed = runWindows();
+	for (std::size_t shard = 0; shard < shards; ++shard) processed += slots[1 + shard].processed;
+
+	if (failure) std::rethrow_exception(std::exchange(failure, nullptr));
+	if (control->failed.load()) throw std::runtime_error(control->failure);
+
+	clock += duration;
+
+	return processed;
+}
+
+
+void ShardedScheduler::finish() {
+	if (process != 0 || pids.empty()) return;
+
+	if (!broken) {
+		control->command = Control::Command::Finish;
+		arriveAndWait([] {});
+	}
+
+	killShards();
+}
+
+
+std::size_t ShardedScheduler::getWindowCount() const {
+	return (control != nullptr) ? static_cast<std::size_t>(control->windows) : 0;
+}
+
+
+Scheduler::SimDuration ShardedScheduler::elapsed() const {
+	return clock;
+}
+
+
+std::size_t ShardedScheduler::runWindows() {
+	/*
+	* Every process loops over:
+	*   1. Run its scheduler up to the end of the current window.
+	*   2. Exchange the messages of the window with the other processes.
+	*   3. Publish its earliest event and meet the others at the barrier; the last to arrive picks the
+	*      next window from the earliest event of all processes.
+	* The run ends when no process has events before the deadline or a process has failed.
+	*/
+
+	Scheduler& scheduler = (process == 0) ? networkScheduler : fleetScheduler;
+	std::size_t processed = 0;
+
+	auto nextWindow = [this] {
+		std::int64_t earliest = Scheduler::SimDuration::max().count();
+		for (std::size_t p = 0; p < numProcesses(); ++p) earliest = std::min(earliest, slots[p].nextEvent);
+
+		control->finished = control->failed.load() || earliest >= control->deadline;
+		control->windowEnd = control->finished ? control->deadline : std::min(control->deadline, earliest + control->lookahead);
+		control->flushed.store(0, std::memory_order_relaxed);
+
+		if (!control->finished) ++control->windows;
+	};
+
+	slots[process].nextEvent = scheduler.nextEventTime().count();
+	slots[process].processed = 0;
+	arriveAndWait(nextWindow);
+
+	while (!control->finished) {
+		windowEnd = Scheduler::SimDuration(control->windowEnd);
+
+		try {
+			processed += scheduler.runUntil(windowEnd);
+		}
+		catch (...) {
+			fail(std::current_exception());
+		}
+
+		exchange();
+
+		slots[process].nextEvent = scheduler.nextEventTime().count();
+		slots[process].processed = processed;
+		arriveAndWait(nextWindow);
+	}
+
+	return processed;
+}
+
+
+void ShardedScheduler::exchange() {
+	/*
+	* A process counts itself flushed once everything it held back during the window is in the rings,
+	* and keeps draining its own rings until every process is flushed: nothing can arrive after that.
+	* Handling a message never sends one, so the exchange cannot feed itself.
+	*/
+
+	std::vector<std::size_t> sent(shards, 0);
+	bool flushed = false;
+
+	for (Backoff backoff;;) {
+		bool pending = false;
+		bool progress = false;
+
+		for (std::size_t shard = 0; shard < shards; ++shard) {
+			Ring& ring = (process == 0) ? toShard(shard) : toCoordinator(shard);
+			std::vector<Message>& outbox = outboxes[shard];
+
+			for (; sent[shard] < outbox.size() && ring.push(outbox[sent[shard]]); ++sent[shard]) progress = true;
+			pending = pending || sent[shard] < outbox.size();
+		}
+
+		if (!pending && !flushed) {
+			control->flushed.fetch_add(1, std::memory_order_acq_rel);
+			flushed = true;
+		}
+
+		bool complete = flushed && control->flushed.load(std::memory_order_acquire) == numProcesses();
+
+		for (std::size_t shard = 0; shard < shards; ++shard) {
+			if (process != 0 && shard != process - 1) continue;
+
+			Ring& ring = (process == 0) ? toCoordinator(shard) : toShard(shard);
+			for (Message message; ring.pop(message);) {
+				progress = true;
+
+				try {
+					handle(message);
+				}
+				catch (...) {
+					fail(std::current_exception());
+				}
+			}
+		}
+
+		if (complete) break;
+
+		if (progress) backoff = Backoff{};
+		else if (backoff.pause() && process == 0) watchShards();
+	}
+
+	for (std::vector<Message>& outbox : outboxes) outbox.clear();
+}
+
+
+void ShardedScheduler::handle(const Message& message) {
+	Scheduler::SimDuration at(message.at);
+
+	switch (message.type) {
+	case Message::Type::ChargeRequest:
+	case Message::Type::Release:
+		if (at < windowEnd) throw std::logic_error("Message between processes falls inside the current lookahead window.");
+
+		((process == 0) ? networkScheduler : fleetScheduler).schedule(parked.at(message.aircraft), at);
+		break;
+
+	case Message::Type::Session:
+		// Timestamps are built exactly as Scheduler::now() builds them, so the airtime matches a cooperative run
+		onSession(message.aircraft, networkScheduler.getEpoch() + std::chrono::duration_cast<std::chrono::system_clock::duration>(at),
+			networkScheduler.getEpoch() + std::chrono::duration_cast<std::chrono::system_clock::duration>(Scheduler::SimDuration(message.end)));
+		break;
+	}
+}
+
+
+void ShardedScheduler::fail(std::exception_ptr exception) {
+	// The coordinator rethrows its own failure as is; that of a shard only crosses over as a message
+	std::string message = "Unknown failure.";
+	try {
+		std::rethrow_exception(exception);
+	}
+	catch (const std::exception& error) {
+		message = error.what();
+	}
+	catch (...) {}
+
+	if (process == 0 && !failure) failure = exception;
+	if (process != 0) message = "Shard " + std::to_string(process - 1) + ": " + message;
+
+	if (!control->failed.exchange(true)) {
+		std::strncpy(control->failure, message.c_str(), sizeof(control->failure) - 1);
+	}
+}
+
+
+template <typename Completion>
+void ShardedScheduler::arriveAndWait(Completion completion) {
+	std::uint32_t generation = control->generation.load(std::memory_order_acquire);
+
+	if (control->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == numProcesses()) {
+		control->arrived.store(0, std::memory_order_relaxed);
+		completion();
+		control->generation.store(generation + 1, std::memory_order_release);
+		return;
+	}
+
+	for (Backoff backoff; control->generation.load(std::memory_order_acquire) == generation;) {
+		if (backoff.pause() && process == 0) watchShards();
+	}
+}
+
+
+std::size_t ShardedScheduler::numProcesses() const {
+	return shards + 1;
+}
+
+
+ShardedScheduler::Ring& ShardedScheduler::toCoordinator(std::size_t shard) {
+	return rings[shard];
+}
+
+
+ShardedScheduler::Ring& ShardedScheduler::toShard(std::size_t shard) {
+	return rings[shards + shard];
+}
+
+
+/* ----------------- Processes ----------------- */
+
+#ifdef _WIN32
+
+void ShardedScheduler::launch(const std::function<void(std::size_t shard)>&, SessionHandler) {
+	throw std::runtime_error("Sharded simulations need a Linux host.");
+}
+
+
+void ShardedScheduler::serve(std::size_t, const std::function<void(std::size_t shard)>&, int) {
+	std::terminate();
+}
+
+
+void ShardedScheduler::watchShards() {}
+
+
+void ShardedScheduler::killShards() {
+	pids.clear();
+}
+
+#else
+
+namespace {
+
+	// Threads of the calling process, 0 if /proc cannot tell
+	std::size_t threadsOfProcess() {
+		std::error_code error;
+		std::size_t threads = 0;
+
+		for (std::filesystem::directory_iterator task("/proc/self/task", error), end; !error && task != end; task.increment(error)) ++threads;
+		return error ? 0 : threads;
+	}
+
+}
+
+
+void ShardedScheduler::launch(const std::function<void(std::size_t shard)>& setup, SessionHandler onSession) {
+	/*
+	* Forked while the coordinator is still the only process, with the whole simulation built: every
+	* shard starts from the same fleet, and only spawns the coroutines of its own aircraft.
+	*
+	* fork() copies the calling thread alone. A mutex held by any other thread at that moment - of the
+	* allocator, of a stream, of another simulation - stays locked forever in the shard, so the shards
+	* are only forked from a process that runs no other thread.
+	*/
+
+	if (process != 0 || !pids.empty()) throw std::logic_error("The shards have already been launched.");
+	if (threadsOfProcess() != 1) throw std::logic_error("The shards of a sharded simulation are forked, which needs a process running no other thread.");
+
+	this->onSession = std::move(onSession);
+	const pid_t coordinator = getpid();
+
+	for (std::size_t shard = 0; shard < shards; ++shard) {
+		pid_t pid = fork();
+
+		if (pid == 0) serve(shard, setup, coordinator);
+
+		if (pid < 0) {
+			int error = errno;
+			broken = true;
+			killShards();
+			throw std::system_error(error, std::generic_category(), "Unable to fork a shard");
+		}
+
+		pids.push_back(pid);
+	}
+}
+
+
+void ShardedScheduler::serve(std::size_t shard, const std::function<void(std::size_t shard)>& setup, int coordinator) {
+	/*
+	* A shard never returns into the code of the coordinator: everything after launch() and every
+	* destructor belong to the coordinator, so the shard leaves with _exit() once it has been finished.
+	* A failure is reported to the coordinator at the end of the next window.
+	*/
+
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+	if (getppid() != coordinator) _exit(1);
+
+	process = 1 + shard;
+	pids.clear();
+
+	try {
+		setup(shard);
+	}
+	catch (...) {
+		fail(std::current_exception());
+	}
+
+	try {
+		for (;;) {
+			arriveAndWait([] {});
+			if (control->command == Control::Command::Finish) break;
+
+			runWindows();
+		}
+	}
+	catch (...) {
+		_exit(1);
+	}
+
+	_exit(0);
+}
+
+
+void ShardedScheduler::watchShards() {
+	for (std::size_t shard = 0; shard < pids.size(); ++shard) {
+		if (waitpid(pids[shard], nullptr, WNOHANG) != pids[shard]) continue;
+
+		pids.erase(pids.begin() + static_cast<std::ptrdiff_t>(shard));
+		broken = true;
+		killShards();
+
+		throw std::runtime_error("Shard " + std::to_string(shard) + " exited in the middle of the simulation.");
+	}
+}
+
+
+void ShardedScheduler::killShards() {
+	// Shards that were finished are exiting already
+	for (pid_t pid : pids) {
+		if (broken) kill(pid, SIGKILL);
+		waitpid(pid, nullptr, 0);
+	}
+
+	pids.clear();
+}
+
+#endif
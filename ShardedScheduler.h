@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <functional>
+
+#include "Scheduler.h"
+
+
+/*
+* Conservative parallel discrete-event simulation over processes.
+*
+* For fleets beyond what one process handles comfortably, the aircraft are split over several shard
+* processes on the same host. Every shard flies its slice of the fleet on a Scheduler of its own, while
+* the process that created them - the coordinator - runs the charging network. Aircraft i flies in
+* shard i modulo the number of shards.
+*
+* The processes share nothing but one block of anonymous shared memory, mapped before the shards are
+* forked: a control block for the barrier and the windows, and per shard a pair of single-producer,
+* single-consumer ring buffers that carry charge requests and completed sessions to the coordinator and
+* the end of every charge back to the shard.
+*
+* Simulated time advances in the windows of the ParallelScheduler. An aircraft only reaches the charging
+* network a full flight after it took off, and only leaves it a full charge after a charger took it, so
+* nothing sent during a window [t, t + lookahead) can land inside it. Messages are kept in the sender
+* during a window and exchanged between windows, when every process drains its rings.
+*
+* The coordinator records the sessions the shards complete as they arrive, so the metrics, sessions,
+* logs and export of the run all end up in the coordinator, exactly as in a cooperative run of the same
+* seed. Shards are forked with fork() and die with the coordinator, which needs a Linux host. Forking
+* is refused while the process runs any other thread, whose locks the shards would inherit held.
+*/
+
+class ShardedScheduler {
+public:
+	using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
+	using SessionHandler = std::function<void(std::size_t aircraft, TimePoint start, TimePoint end)>;
+
+	// Awaitable returned by requestCharge(): sends the aircraft to the network and parks it until it is released
+	class ChargeRequest {
+	public:
+		ChargeRequest(ShardedScheduler& scheduler, std::size_t aircraft, Scheduler::SimDuration delay);
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(Scheduler::TaskHandle handle) const;
+		void await_resume() const noexcept {}
+
+	private:
+		ShardedScheduler& scheduler;
+		std::size_t aircraft;
+		Scheduler::SimDuration delay;
+	};
+
+	explicit ShardedScheduler(std::size_t numShards);						// Map the shared memory of the given number of shards
+	~ShardedScheduler();													// Finishes the shards and waits for them
+
+	ShardedScheduler(const ShardedScheduler& other) = delete;				// Copy constructor
+	ShardedScheduler& operator=(const ShardedScheduler& other) = delete;	// Copy assignment
+
+	std::size_t numShards() const;											// Number of shard processes
+	Scheduler& network();													// Scheduler of the charging network, run by the coordinator
+	Scheduler& fleet();														// Scheduler of the aircraft of a shard, run by the shard
+
+	// Fork the shards; each runs setup with its index and then serves the runs of the coordinator, which alone returns
+	void launch(const std::function<void(std::size_t shard)>& setup, SessionHandler onSession);
+
+	ChargeRequest requestCharge(std::size_t aircraft, Scheduler::SimDuration delay);	// In a shard: fly to the network and wait there for the release
+	void recordSession(std::size_t aircraft, Scheduler::SimDuration start, Scheduler::SimDuration end);	// In a shard: send a completed session to the coordinator
+	void attach(std::size_t aircraft, Scheduler::TaskHandle handle);					// In the coordinator: coroutine resumed when the aircraft arrives
+	void release(std::size_t aircraft, Scheduler::SimDuration at);						// In the coordinator: send the aircraft back at the end of its charge
+
+	std::size_t runFor(Scheduler::SimDuration duration, Scheduler::SimDuration lookahead);	// Run all processes; returns the number of events processed
+	void finish();															// Stop the shards and wait for them to exit
+	std::size_t getWindowCount() const;										// Number of windows executed by the last run
+	Scheduler::SimDuration elapsed() const;									// Simulated time covered by all runs so far
+
+private:
+	struct Message;
+	struct Ring;
+	struct Slot;
+	struct Control;
+
+	[[noreturn]] void serve(std::size_t shard, const std::function<void(std::size_t shard)>& setup, int coordinator);	// Body of a shard process
+	std::size_t runWindows();												// Take part in the windows of one run
+	void exchange();														// Flush the outboxes and drain the inboxes between two windows
+	void handle(const Message& message);									// Apply a message received from another process
+	void fail(std::exception_ptr failure);									// Record the first failure of any process
+	void watchShards();														// Throw if a shard has exited, killing the others
+	void killShards();														// Kill the shards and wait for them
+
+	template <typename Completion>
+	void arriveAndWait(Completion completion);								// Barrier of all processes; the last to arrive runs the completion
+
+	std::size_t numProcesses() const;										// Shards and coordinator
+	Ring& toCoordinator(std::size_t shard);									// Ring a shard writes into
+	Ring& toShard(std::size_t shard);										// Ring the coordinator writes into for a shard
+
+	std::size_t shards;														// Number of shard processes
+	std::size_t process;													// Index of this process: 0 for the coordinator, 1 + shard for a shard
+	Scheduler networkScheduler;												// Charging network, only ever run in the coordinator
+	Scheduler fleetScheduler;												// Aircraft of a shard, only ever run in that shard
+	Scheduler::SimDuration clock;											// Simulated time covered by all runs so far
+	Scheduler::SimDuration windowEnd;										// End of the window being run, as read after the last barrier
+	std::exception_ptr failure;												// Failure of this process in the current run
+
+	void* shared;															// Shared memory block of all processes
+	std::size_t sharedBytes;												// Size of the shared memory block
+	Control* control;														// Barrier, windows and failures
+	Slot* slots;															// Next event and events processed of every process
+	Ring* rings;															// Rings to the coordinator, then rings to the shards
+
+	std::vector<int> pids;													// Process IDs of the shards, in the coordinator
+	bool broken;															// Flag to indicate that a shard died and the barrier cannot be trusted
+	std::vector<std::vector<Message>> outboxes;								// Messages held back until the end of the window, per destination ring
+	std::vector<Scheduler::TaskHandle> parked;								// Coroutine of every aircraft waiting on another process
+	SessionHandler onSession;												// Recorder of the sessions arriving at the coordinator
+};
@@ -1,12 +1,18 @@
 // SimpleSimulator.cpp : This file contains the 'main' function. Program execution begins and ends there.
 
-#include "evTOL.h"
-#include "DataLogger.h"
-#include "FleetManager.h"
-#include "RequestManager.h"
-#include "ChargingStation.h"
+#include "SimulatorAPI.h"
 
+#include <mutex>
+#include <cctype>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
 #include <iostream>
+#include <condition_variable>
 
 
 /*
@@ -21,7 +27,87 @@
 * The aircrafts are initialized on individual threads that log data during operation and charging.
 * At the end of each airborne session, the aircrafts also log the performance summary.
 * 
-* All the relevant files can be found under the "Logs" and "Summary" folder.
+* All the relevant files can be found under the "Logs" folder, or the one given by "--log-dir": the records
+* of every aircraft, including a JSON summary of each of its sessions, in a few large segment files with an
+* index per segment. "--read-log <aircraft>" prints the records of one aircraft in the latest run, numbered
+* by its position in the fleet.
+* 
+* Passing "--cooperative" runs the same fleet as coroutines on a single-threaded scheduler instead.
+* The simulated clock then jumps from event to event, so the simulated duration below is covered
+* as fast as the events can be processed rather than in wall-clock time.
+* 
+* Passing "--parallel <workers>" spreads the aircraft over several scheduler partitions, one per worker
+* thread, with the chargers on the first one. For a given "--seed" the result is identical to the
+* cooperative run; "--bench-parallel <workers>" checks this and reports the scaling from 1 to N workers.
+* "--bench-batch <runs>" runs that many independent cooperative simulations side by side in this process.
+* 
+* Passing "--shards <n>" on a Linux host splits the fleet over n forked shard processes, each flying its
+* slice of the aircraft, while this process runs the charging network. Charge requests and completed
+* sessions cross over through ring buffers in shared memory, and for a given "--seed" the result is again
+* identical to the cooperative run.
+* 
+* Passing "--sites <n>" spreads the chargers over several vertiports, each with its own queue. Aircraft
+* needing a charge are routed to the vertiport with the shortest expected wait.
+* 
+* Passing "--catalog <path>" reads the manufacturers from another file. "--compile-catalog <output>"
+* validates the catalog and writes it in a binary form that later runs map into memory without parsing;
+* pass that file to "--catalog" to use it. "--catalog builtin" uses the manufacturers compiled into the
+* program, whose session metrics are constants known at build time. "--check-builtin <json>" compares
+* them with a json, which the build does against Manufacturer.json after linking.
+* "--bench-metrics <passes>" measures the cost of the per-session summary over a finished fleet.
+* 
+* Passing "--checkpoint <path>" to an event-driven run writes a snapshot of the whole simulation at the end
+* of the run, or every "--checkpoint-every <hours>" of simulated time. "--restore <path>" continues from a
+* snapshot up to "--hours" in total, with the fleet and chargers of the snapshot; the result is the same
+* as that of the uninterrupted run.
+* 
+* Passing "--replay <trace>" feeds the chargers from a trace of charging requests instead of a fleet and
+* reports the requests/sec and queue latency they sustain, either as fast as possible or at
+* "--acceleration <x>" times real time. The tickets of an "--export" replay as a trace as well.
+* "--generate-trace <path>" writes a synthetic trace of "--arrivals <n>" requests at "--arrival-rate
+* <per hour>", by default 90% of what the chargers can serve.
+* 
+* Passing "--timeline <path>" records a timeline of the run in the Chrome trace-event format, to be opened
+* in ui.perfetto.dev: a track per charger with its charges, a track per aircraft with its Airborne, Queued
+* and Charging phases, and the queue depth of every vertiport.
+* 
+* Passing "--memory-report" prints the memory held by the fleet, requests, chargers, loggers and summaries
+* at the end of the run, next to the peak resident set of the process; "--memory-report <seconds>" also
+* prints it every that many seconds of wall-clock time while the simulation runs.
+* 
+* Passing "--scope-report" prints how the time of the run splits over battery updates, request creation,
+* queue handling, charging, logging and session summaries: calls, total and self time of every timed
+* scope. The scopes are only compiled in when the simulator is built with EVSIM_SCOPE_TIMERS defined,
+* which building with the EvsimScopeTimers property does: "msbuild SimpleSimulator.sln -p:EvsimScopeTimers=true".
+* 
+* Passing "--trips-per-hour <n>" to a cooperative run has the fleet serve passenger trips over a square
+* service area of "--service-area <miles>" instead of flying until the battery is depleted: each trip is
+* matched with the nearest idle aircraft that has the seats and the range for it, and passenger miles
+* are those of the trips served. Trips wait at most "--max-trip-wait <minutes>" for an aircraft.
+* 
+* Passing "--sample-every <minutes>" to an event-driven run samples the battery level and phase of every
+* aircraft and the busy chargers and queue of every vertiport at that interval of simulated time, kept
+* delta-encoded in memory; "--samples <path>" writes them to a file at the end of the run. "--read-samples
+* <path>" prints the fleet totals of every sample of such a file between "--from <hours>" and "--to <hours>".
+* 
+* Passing "--charger-schedule <hour:chargers,...>" to an event-driven run resizes the charger pool by time of
+* day, e.g. "0:3,7:8,20:4" for 3 chargers from midnight, 8 from 7:00 and 4 from 20:00 of every simulated
+* day. "--scale-at-wait <minutes>" adds a charger to a vertiport whenever its expected wait exceeds that,
+* up to "--max-chargers <n>" (twice "--chargers" by default), checked every "--scale-check <minutes>". A
+* retired charger finishes the charge it is on. The report shows the chargers added and retired and how
+* long the queues took to empty after chargers were added.
+* 
+* Passing "--result-cache <directory>" keeps the results of seeded event-driven runs in that directory.
+* Rerunning the same configuration, catalog, seed and duration then prints the stored results at once;
+* runs that write logs, an export or a timeline are always simulated, so pair it with "--quiet".
+* 
+* Passing "--charger-cores <list>" and "--worker-cores <list>" pins the charger threads and the simulation
+* workers (aircraft threads, or the workers of "--parallel") to cores, given as "0-7,16" or as a NUMA node
+* "node1". The core and the migrations of every thread are printed at the end of the run, also for
+* unpinned threads with "--placement-report".
+* 
+* The simulator itself is a library with a C interface (see SimulatorAPI.h); this program is one of its
+* clients and only translates the command line into calls to it.
 */
 
 
@@ -31,14 +117,470 @@ std::size_t numberOfChargers = 3;
 // Assign the number of aircrafts needed in the fleet
 std::size_t numberOfAircrafts = 20;
 
-int main() {    
+// Assign the number of vertiports the chargers are spread over
+std::size_t numberOfSites = 1;
+
+// Assign the simulated duration of a cooperative simulation
+std::chrono::hours simulatedDuration(24);
+
+
+enum class SimulationMode {
+    Run,                // A single simulation in the mode of the configuration
+    ScalingBenchmark,   // Serial versus 1..N worker runs of the same scenario
+    BatchBenchmark,     // Independent cooperative runs side by side in one process
+    MetricsBenchmark,   // Cost of the per-session summary, virtual versus inlined
+    ReplayBenchmark     // Chargers fed from a trace of charging requests
+};
+
+
+int main(int argc, char* argv[]) {    
+
+    /*
+    * Command line:
+    *   --cooperative               run on a single-threaded scheduler
+    *   --parallel <workers>        run on a parallel scheduler with the given number of worker threads
+    *   --shards <n>                split the fleet over n shard processes (Linux only)
+    *   --bench-parallel <workers>  compare the serial run with 1..workers parallel runs
+    *   --bench-batch <runs>        run independent simulations concurrently, one per core
+    *   --bench-metrics <passes>    time the per-session summary over the fleet that many times
+    *   --aircraft <n>, --chargers <n>, --sites <n>, --hours <n>, --seed <n>
+    *   --trips-per-hour <n>        serve passenger trips at this rate instead of flying until depleted
+    *   --service-area <miles>      side of the square area the trips are spread over (default 20)
+    *   --max-trip-wait <minutes>   time a trip waits for an aircraft before it is dropped (default 15)
+    *   --quiet                     do not write logs and summaries
+    *   --log-dir <directory>       folder the logs are written to and read from (default Logs)
+    *   --read-log <aircraft>       print the log records of an aircraft in the latest run and exit
+    *   --live-stats [name]         publish live statistics to a shared memory segment (see LiveStatsViewer)
+    *   --export <directory>        export sessions and charging tickets for analysis
+    *   --export-format <format>    columnar (default) or csv
+    *   --timeline <path>           record a Chrome trace-event timeline of the run
+    *   --memory-report [seconds]   report memory per subsystem at the end, and periodically if given
+    *   --scope-report              report the time spent in every timed scope at the end
+    *   --sample-every <minutes>    sample the state of the fleet and the chargers at this simulated interval
+    *   --samples <path>            write the samples to a file at the end of the run
+    *   --read-samples <path>       print the samples of a file and exit
+    *   --from <hours>, --to <hours> time range of the samples printed (default all)
+    *   --charger-schedule <list>   chargers of the network by hour of the day, e.g. "0:3,7:8,20:4"
+    *   --scale-at-wait <minutes>   add a charger to a vertiport whose expected wait exceeds this
+    *   --max-chargers <n>          chargers the network may scale up to (default twice --chargers)
+    *   --scale-check <minutes>     simulated time between two checks of the queues (default 5)
+    *   --result-cache <directory>  reuse the results of identical seeded runs from a cache directory
+    *   --charger-cores <list>      pin charger threads to cores, e.g. "0-3" or "node0"
+    *   --worker-cores <list>       pin aircraft threads and parallel workers to cores
+    *   --placement-report          report the core migrations of every thread at the end
+    *   --catalog <path>            manufacturer json, compiled catalog or "builtin" (default Manufacturer.json)
+    *   --compile-catalog <output>  write the catalog in compiled form and exit
+    *   --check-builtin <json>      check that the built-in catalog matches a manufacturer json and exit
+    *   --checkpoint <path>         write a snapshot of an event-driven run when it ends
+    *   --checkpoint-every <hours>  write the snapshot periodically instead
+    *   --restore <path>            continue from a snapshot
+    *   --replay <trace>            replay a trace or exported tickets against the chargers
+    *   --acceleration <x>          replay at x times real time (default 0, as fast as possible)
+    *   --generate-trace <path>     write a synthetic trace and exit
+    *   --arrivals <n>              requests in the synthetic trace (default 10000)
+    *   --arrival-rate <per hour>   arrival rate of the synthetic trace (default 90% of the charger capacity)
+    */
+
+    SimulationMode mode = SimulationMode::Run;
+    std::size_t runs = 1;
+    bool quiet = false;
+    std::string liveStatsName{};
+    std::string exportDirectory{};
+    std::string timelinePath{};
+    bool memoryReport = false;
+    std::size_t memoryReportSeconds = 0;
+    bool scopeReport = false;
+    double sampleMinutes = 0.0;
+    std::string samplesPath{};
+    std::string readSamples{};
+    std::string logDirectory = "Logs";
+    long long readLog = -1;
+    double fromHours = 0.0;
+    double toHours = 1e12;
+    std::vector<evsim_capacity_step> capacitySteps{};
+    double scaleAtWait = 0.0;
+    std::size_t maxChargers = 0;
+    double scaleCheckMinutes = 5.0;
+    std::string resultCache{};
+    std::string chargerCores{};
+    std::string workerCores{};
+    bool placementReport = false;
+    std::string catalogPath = "Manufacturer.json";
+    std::string compiledCatalog{};
+    std::string checkedCatalog{};
+    std::string checkpointPath{};
+    std::string restorePath{};
+    std::size_t checkpointHours = 0;
+    std::string tracePath{};
+    std::string generatedTrace{};
+    double acceleration = 0.0;
+    std::size_t arrivals = 10000;
+    double arrivalRate = 0.0;
+    evsim_export_format exportFormat = EVSIM_EXPORT_COLUMNAR;
+
+    evsim_config config;
+    evsim_default_config(&config);
+    config.mode = EVSIM_MODE_THREADED;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--cooperative") config.mode = EVSIM_MODE_COOPERATIVE;
+        else if (arg == "--parallel" && hasValue) { config.mode = EVSIM_MODE_PARALLEL; config.workers = std::stoul(argv[++i]); }
+        else if (arg == "--shards" && hasValue) { config.mode = EVSIM_MODE_SHARDED; config.workers = std::stoul(argv[++i]); }
+        else if (arg == "--bench-parallel" && hasValue) { mode = SimulationMode::ScalingBenchmark; config.workers = std::stoul(argv[++i]); }
+        else if (arg == "--bench-batch" && hasValue) { mode = SimulationMode::BatchBenchmark; runs = std::stoul(argv[++i]); }
+        else if (arg == "--bench-metrics" && hasValue) { mode = SimulationMode::MetricsBenchmark; runs = std::stoul(argv[++i]); }
+        else if (arg == "--quiet") quiet = true;
+        else if (arg == "--log-dir" && hasValue) logDirectory = argv[++i];
+        else if (arg == "--read-log" && hasValue) readLog = std::stoll(argv[++i]);
+        else if (arg == "--export" && hasValue) exportDirectory = argv[++i];
+        else if (arg == "--timeline" && hasValue) timelinePath = argv[++i];
+        else if (arg == "--trips-per-hour" && hasValue) config.trips_per_hour = std::stod(argv[++i]);
+        else if (arg == "--service-area" && hasValue) config.service_area_miles = std::stod(argv[++i]);
+        else if (arg == "--max-trip-wait" && hasValue) config.max_trip_wait_minutes = std::stod(argv[++i]);
+        else if (arg == "--sample-every" && hasValue) sampleMinutes = std::stod(argv[++i]);
+        else if (arg == "--samples" && hasValue) samplesPath = argv[++i];
+        else if (arg == "--read-samples" && hasValue) readSamples = argv[++i];
+        else if (arg == "--from" && hasValue) fromHours = std::stod(argv[++i]);
+        else if (arg == "--to" && hasValue) toHours = std::stod(argv[++i]);
+        else if (arg == "--charger-schedule" && hasValue) {
+            std::istringstream steps(argv[++i]);
+            for (std::string step; std::getline(steps, step, ',');) {
+                std::size_t colon = step.find(':');
+                if (colon == std::string::npos) {
+                    std::cerr << "Capacity steps are written as hour:chargers, not " << step << "\n";
+                    return 1;
+                }
+                capacitySteps.push_back(evsim_capacity_step{ std::stod(step.substr(0, colon)), static_cast<std::uint32_t>(std::stoul(step.substr(colon + 1))) });
+            }
+        }
+        else if (arg == "--scale-at-wait" && hasValue) scaleAtWait = std::stod(argv[++i]);
+        else if (arg == "--max-chargers" && hasValue) maxChargers = std::stoul(argv[++i]);
+        else if (arg == "--scale-check" && hasValue) scaleCheckMinutes = std::stod(argv[++i]);
+        else if (arg == "--result-cache" && hasValue) resultCache = argv[++i];
+        else if (arg == "--charger-cores" && hasValue) { chargerCores = argv[++i]; placementReport = true; }
+        else if (arg == "--worker-cores" && hasValue) { workerCores = argv[++i]; placementReport = true; }
+        else if (arg == "--placement-report") placementReport = true;
+        else if (arg == "--scope-report") scopeReport = true;
+        else if (arg == "--memory-report") {
+            memoryReport = true;
+            if (hasValue && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) memoryReportSeconds = std::stoul(argv[++i]);
+        }
+        else if (arg == "--catalog" && hasValue) catalogPath = argv[++i];
+        else if (arg == "--compile-catalog" && hasValue) compiledCatalog = argv[++i];
+        else if (arg == "--check-builtin" && hasValue) checkedCatalog = argv[++i];
+        else if (arg == "--checkpoint" && hasValue) checkpointPath = argv[++i];
+        else if (arg == "--checkpoint-every" && hasValue) checkpointHours = std::stoul(argv[++i]);
+        else if (arg == "--restore" && hasValue) restorePath = argv[++i];
+        else if (arg == "--replay" && hasValue) { mode = SimulationMode::ReplayBenchmark; tracePath = argv[++i]; }
+        else if (arg == "--acceleration" && hasValue) acceleration = std::stod(argv[++i]);
+        else if (arg == "--generate-trace" && hasValue) generatedTrace = argv[++i];
+        else if (arg == "--arrivals" && hasValue) arrivals = std::stoul(argv[++i]);
+        else if (arg == "--arrival-rate" && hasValue) arrivalRate = std::stod(argv[++i]);
+        else if (arg == "--export-format" && hasValue) exportFormat = (std::string(argv[++i]) == "csv") ? EVSIM_EXPORT_CSV : EVSIM_EXPORT_COLUMNAR;
+        else if (arg == "--live-stats") liveStatsName = (hasValue && argv[i + 1][0] == '/') ? argv[++i] : EVSIM_LIVE_STATS_DEFAULT_NAME;
+        else if (hasValue && (arg == "--aircraft" || arg == "--chargers" || arg == "--sites" || arg == "--hours" || arg == "--seed")) {
+            std::string value = argv[++i];
+
+            if (arg == "--aircraft") numberOfAircrafts = std::stoul(value);
+            else if (arg == "--chargers") numberOfChargers = std::stoul(value);
+            else if (arg == "--sites") numberOfSites = std::stoul(value);
+            else if (arg == "--hours") simulatedDuration = std::chrono::hours(std::stoul(value));
+            else { config.seed = std::stoull(value); config.has_seed = 1; }
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    config.aircraft = static_cast<std::uint32_t>(numberOfAircrafts);
+    config.chargers = static_cast<std::uint32_t>(numberOfChargers);
+    config.sites = static_cast<std::uint32_t>(numberOfSites);
+    config.live_stats_name = liveStatsName.empty() ? nullptr : liveStatsName.c_str();
+    config.catalog_path = catalogPath.c_str();
+    config.log_directory = logDirectory.c_str();
+
+    if (!compiledCatalog.empty()) {
+        if (evsim_compile_catalog(catalogPath.c_str(), compiledCatalog.c_str()) != 0) {
+            std::cerr << "Unable to compile the catalog: " << evsim_last_error() << "\n";
+            return 1;
+        }
+
+        std::cout << "Catalog " << catalogPath << " compiled to " << compiledCatalog << "\n";
+        return 0;
+    }
+
+    if (!checkedCatalog.empty()) {
+        if (evsim_check_builtin_catalog(checkedCatalog.c_str()) != 0) {
+            std::cerr << "The built-in catalog is out of date: " << evsim_last_error() << "\n";
+            return 1;
+        }
+
+        std::cout << "Built-in catalog matches " << checkedCatalog << "\n";
+        return 0;
+    }
+
+    if (!generatedTrace.empty()) {
+        if (evsim_generate_trace(&config, generatedTrace.c_str(), static_cast<std::uint32_t>(arrivals), arrivalRate) != 0) {
+            std::cerr << "Unable to generate the trace: " << evsim_last_error() << "\n";
+            return 1;
+        }
+
+        std::cout << "Trace of " << arrivals << " arrivals written to " << generatedTrace << "\n";
+        return 0;
+    }
+
+    if (!readSamples.empty()) {
+        // One line per sample with the fleet totals; the per-aircraft values are there for library clients
+        std::cout << "hours,idle,flying,queued,charging,mean_battery,busy_chargers,queued_requests" << "\n";
+
+        evsim_sample_visitor printSample = [](const evsim_sample_frame* frame, void*) {
+            std::uint32_t phases[4] = {};
+            std::uint64_t battery = 0;
+            for (std::uint32_t a = 0; a < frame->num_aircraft; ++a) {
+                ++phases[frame->phases[a] & 3];
+                battery += frame->battery_levels[a];
+            }
+
+            std::uint64_t busy = 0;
+            std::uint64_t queued = 0;
+            for (std::uint32_t s = 0; s < frame->num_sites; ++s) {
+                busy += frame->busy_chargers[s];
+                queued += frame->queued_requests[s];
+            }
+
+            std::cout << frame->time_seconds / 3600.0 << "," << phases[EVSIM_PHASE_IDLE] << "," << phases[EVSIM_PHASE_FLYING] << ","
+                << phases[EVSIM_PHASE_QUEUED] << "," << phases[EVSIM_PHASE_CHARGING] << ","
+                << static_cast<double>(battery) / std::max<std::uint32_t>(frame->num_aircraft, 1) << "," << busy << "," << queued << "\n";
+            return 0;
+        };
+
+        if (evsim_read_sample_file(readSamples.c_str(), fromHours * 3600.0, toHours * 3600.0, printSample, nullptr) != 0) {
+            std::cerr << "Unable to read the samples: " << evsim_last_error() << "\n";
+            return 1;
+        }
+        return 0;
+    }
 
-    ChargingStation::InitializeChargers(numberOfChargers);
-	FleetManager::InitializeFleet(numberOfAircrafts);
-	std::this_thread::sleep_for(std::chrono::minutes(10));
-	FleetManager::stopSimulation();
+    if (readLog >= 0) {
+        evsim_log_visitor printRecord = [](const evsim_log_record* record, void*) {
+            std::cout << std::string(record->text, record->length) << "\n";
+            return 0;
+        };
+
+        if (evsim_read_aircraft_log(logDirectory.c_str(), static_cast<std::uint32_t>(readLog), printRecord, nullptr) != 0) {
+            std::cerr << "Unable to read the log: " << evsim_last_error() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (config.mode == EVSIM_MODE_THREADED && (!checkpointPath.empty() || !restorePath.empty())) {
+        std::cerr << "Checkpoints need --cooperative or --parallel" << "\n";
+        return 1;
+    }
+
+    // The shards are forked on the first run, which a reporter thread running beside it would prevent
+    if (config.mode == EVSIM_MODE_SHARDED && memoryReportSeconds > 0) {
+        std::cerr << "The periodic memory report cannot run beside --shards; use --memory-report without an interval" << "\n";
+        return 1;
+    }
+
+    if (evsim_set_thread_placement(chargerCores.c_str(), workerCores.c_str()) != 0) {
+        std::cerr << "Invalid thread placement: " << evsim_last_error() << "\n";
+        return 1;
+    }
+    evsim_set_placement_report(placementReport ? 1 : 0);
+
+    double simulatedSeconds = std::chrono::duration<double>(simulatedDuration).count();
+
+    if (mode != SimulationMode::Run) {
+        int result = (mode == SimulationMode::ScalingBenchmark) ? evsim_benchmark_scaling(&config, simulatedSeconds, config.workers)
+            : (mode == SimulationMode::BatchBenchmark) ? evsim_benchmark_batch(&config, simulatedSeconds, static_cast<std::uint32_t>(runs))
+            : (mode == SimulationMode::ReplayBenchmark) ? evsim_benchmark_replay(&config, tracePath.c_str(), acceleration)
+            : evsim_benchmark_metrics(&config, simulatedSeconds, static_cast<std::uint32_t>(runs));
+        if (result < 0) std::cerr << evsim_last_error() << "\n";
+
+        return result < 0 ? 1 : result;
+    }
+
+    evsim_simulation* simulation = restorePath.empty() ? evsim_create(&config) : evsim_restore(&config, restorePath.c_str());
+    if (simulation == nullptr) {
+        std::cerr << "Unable to create the simulation: " << evsim_last_error() << "\n";
+        return 1;
+    }
+
+    if (quiet) evsim_set_logging(simulation, 0);
+
+    if (!resultCache.empty() && evsim_set_result_cache(simulation, resultCache.c_str()) != 0) {
+        std::cerr << "Result cache disabled: " << evsim_last_error() << "\n";
+    }
+
+    if (!checkpointPath.empty() && checkpointHours > 0
+        && evsim_set_checkpoints(simulation, checkpointPath.c_str(), std::chrono::duration<double>(std::chrono::hours(checkpointHours)).count()) != 0) {
+        std::cerr << "Unable to schedule checkpoints: " << evsim_last_error() << "\n";
+        evsim_destroy(simulation);
+        return 1;
+    }
+
+    if (sampleMinutes > 0.0 && evsim_set_sampling(simulation, sampleMinutes * 60.0) != 0) {
+        std::cerr << "Unable to sample the simulation: " << evsim_last_error() << "\n";
+        evsim_destroy(simulation);
+        return 1;
+    }
+
+    if (!capacitySteps.empty() || scaleAtWait > 0.0) {
+        evsim_charger_pool pool{};
+        pool.size = sizeof(pool);
+        pool.num_steps = static_cast<std::uint32_t>(capacitySteps.size());
+        pool.steps = capacitySteps.data();
+        pool.scale_up_wait_minutes = scaleAtWait;
+        pool.max_chargers = static_cast<std::uint32_t>((maxChargers > 0) ? maxChargers : 2 * numberOfChargers);
+        pool.check_interval_minutes = scaleCheckMinutes;
+
+        if (evsim_set_charger_pool(simulation, &pool) != 0) {
+            std::cerr << "Unable to resize the charger pool: " << evsim_last_error() << "\n";
+            evsim_destroy(simulation);
+            return 1;
+        }
+    }
+
+    if (!exportDirectory.empty() && evsim_export_start(simulation, exportDirectory.c_str(), exportFormat) != 0) {
+        std::cerr << "Export disabled: " << evsim_last_error() << "\n";
+        exportDirectory.clear();
+    }
+
+    if (!timelinePath.empty() && evsim_timeline_start(simulation, timelinePath.c_str()) != 0) {
+        std::cerr << "Timeline disabled: " << evsim_last_error() << "\n";
+        timelinePath.clear();
+    }
+
+    // Threaded aircraft fly in wall-clock time, so that mode runs for a fixed real duration instead
+    double runSeconds = (config.mode == EVSIM_MODE_THREADED)
+        ? std::chrono::duration<double>(std::chrono::minutes(10)).count()
+        : simulatedSeconds;
+
+    if (!restorePath.empty()) {
+        // A restored run has already covered part of the simulated duration
+        evsim_results restored;
+        restored.size = sizeof(restored);
+        evsim_get_results(simulation, &restored);
+        runSeconds = std::max(0.0, runSeconds - restored.simulated_seconds);
+    }
+
+    bool finalCheckpoint = !checkpointPath.empty() && checkpointHours == 0;
+
+    auto printMemoryReport = [] {
+        std::vector<char> text(evsim_format_memory_report(nullptr, 0) + 1);
+        evsim_format_memory_report(text.data(), text.size());
+        std::cout << text.data();
+    };
+
+    // The periodic memory report runs beside the simulation until it has been stopped
+    std::mutex reporterMtx;
+    std::condition_variable reporterCV;
+    bool runFinished = false;
+    std::thread reporter;
+
+    if (memoryReportSeconds > 0) {
+        reporter = std::thread([&] {
+            std::unique_lock<std::mutex> lock(reporterMtx);
+            while (!reporterCV.wait_for(lock, std::chrono::seconds(memoryReportSeconds), [&] { return runFinished; })) printMemoryReport();
+            });
+    }
+
+    bool failed = evsim_run_for(simulation, runSeconds) != 0 || (finalCheckpoint && evsim_checkpoint(simulation, checkpointPath.c_str()) != 0)
+        || evsim_stop(simulation) != 0;
+
+    if (reporter.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(reporterMtx);
+            runFinished = true;
+        }
+        reporterCV.notify_all();
+        reporter.join();
+    }
+
+    if (failed) {
+        std::cerr << "Simulation failed: " << evsim_last_error() << "\n";
+        evsim_destroy(simulation);
+        return 1;
+    }
+
+    evsim_results results;
+    results.size = sizeof(results);
+    evsim_get_results(simulation, &results);
+
+    if (results.cached) std::cout << "Results of an identical run served from " << resultCache << "\n";
+
+    std::cout << "Fleet of " << results.aircraft << " aircraft ready to fly in " << std::fixed << std::setprecision(1)
+        << results.startup_seconds * 1000.0 << " ms" << std::defaultfloat << "\n";
+
+    if (config.mode == EVSIM_MODE_COOPERATIVE) {
+        std::cout << "Processed " << results.events << " events over " << simulatedDuration.count() << " simulated hours" << "\n";
+    }
+    else if (config.mode == EVSIM_MODE_PARALLEL) {
+        std::cout << "Processed " << results.events << " events in " << results.windows << " windows on "
+            << config.workers << " workers over " << simulatedDuration.count() << " simulated hours" << "\n";
+    }
+    else if (config.mode == EVSIM_MODE_SHARDED) {
+        std::cout << "Processed " << results.events << " events in " << results.windows << " windows on "
+            << config.workers << " shards over " << simulatedDuration.count() << " simulated hours" << "\n";
+    }
+
+    if (config.mode != EVSIM_MODE_THREADED) {
+        // Single greppable line compared across runs and modes
+        std::ostringstream line;
+        line << "RESULT events=" << results.events
+            << " sessions=" << results.sessions
+            << " airtime=" << std::setprecision(17) << results.air_time
+            << " seconds=" << std::setprecision(6) << results.wall_seconds;
+
+        std::cout << line.str() << "\n";
+    }
 
     std::cout<< "Simulation for evTOLs has been stopped" << "\n";
+
+    if (!exportDirectory.empty()) {
+        evsim_export_finish(simulation);
+        std::cout << "Sessions and charging tickets exported to " << exportDirectory << "\n";
+    }
+
+    if (!timelinePath.empty()) {
+        evsim_timeline_finish(simulation);
+        std::cout << "Timeline written to " << timelinePath << "\n";
+    }
+
+    if (!samplesPath.empty()) {
+        if (evsim_write_samples(simulation, samplesPath.c_str()) == 0) std::cout << results.samples << " samples written to " << samplesPath << "\n";
+        else std::cerr << "Samples not written: " << evsim_last_error() << "\n";
+    }
+
+    std::vector<char> report(evsim_format_report(simulation, nullptr, 0) + 1);
+    evsim_format_report(simulation, report.data(), report.size());
+    std::cout << report.data();
+
+    if (memoryReport) {
+        std::cout << "\n";
+        printMemoryReport();
+    }
+
+    if (scopeReport) {
+        std::vector<char> scopes(evsim_format_scope_report(nullptr, 0) + 1);
+        evsim_format_scope_report(scopes.data(), scopes.size());
+        std::cout << "\n" << scopes.data();
+    }
+
+    if (placementReport) {
+        std::vector<char> placement(evsim_format_placement_report(nullptr, 0) + 1);
+        evsim_format_placement_report(placement.data(), placement.size());
+        std::cout << "\n" << placement.data();
+    }
+
+    evsim_destroy(simulation);
     
 	
     return 0;
@@ -0,0 +1,176 @@
+#include <stdexcept>
+
+#include "evTOL.h"
+#include "Timeline.h"
+#include "Vertiport.h"
+#include "DataLogger.h"
+#include "DataExport.h"
+#include "TimerWheel.h"
+#include "Simulation.h"
+#include "ChargerPool.h"
+#include "FleetManager.h"
+#include "SegmentedLog.h"
+#include "RequestManager.h"
+#include "ChargingStation.h"
+
+
+/* ----------------- Simulation ----------------- */
+
+Simulation::Simulation(std::shared_ptr<const FleetCatalog> catalog) :
+    catalog(std::move(catalog)),
+    randomSeed(std::nullopt),
+    fleetRetired(false),
+    startupTime(0.0),
+    chargersStopped(false),
+    chargingScheduler(nullptr),
+    requestsStopped(false),
+    logging(false),
+    logDirectory("Logs"),
+    resumed(false)
+{
+    if (!this->catalog) throw std::invalid_argument("A simulation needs a fleet catalog.");
+}
+
+
+Simulation::~Simulation() {
+    // Threads of a real-time run must be joined before the objects they use go away
+    FleetManager::stopSimulation(*this);
+
+    // Rows and events still buffered are written once nothing records any more
+    finishTimeline();
+
+    try {
+        finishExport();
+    }
+    catch (const std::exception&) {
+        // A failure to write the export can only be reported by finishing it before the simulation goes away
+    }
+}
+
+
+void Simulation::setSeed(std::uint64_t seed) {
+    randomSeed = seed;
+}
+
+
+void Simulation::setTripDemand(const TripDemandConfig& config) {
+    tripDemand = config;
+}
+
+
+void Simulation::setLogging(bool enabled) {
+    logging.store(enabled, std::memory_order_relaxed);
+}
+
+
+void Simulation::setLogDirectory(const std::filesystem::path& directory) {
+    if (log) throw std::logic_error("The log of the simulation is already open.");
+    logDirectory = directory;
+}
+
+
+void Simulation::startExport(const std::filesystem::path& directory, ExportFormat format) {
+    if (dataExport) throw std::logic_error("The simulation is already exporting.");
+    dataExport = std::make_unique<DataExport>(directory, format);
+}
+
+
+void Simulation::finishExport() {
+    if (dataExport) dataExport->finish();
+}
+
+
+void Simulation::startTimeline(const std::filesystem::path& path) {
+    if (timeline) throw std::logic_error("The simulation is already recording a timeline.");
+    timeline = std::make_unique<Timeline>(path);
+}
+
+
+void Simulation::finishTimeline() {
+    if (timeline) timeline->finish();
+}
+
+
+const FleetCatalog& Simulation::getCatalog() const {
+    return *catalog;
+}
+
+
+const std::vector<std::string>& Simulation::getManufacturerNames() const {
+    return catalog->getManufacturerNames();
+}
+
+
+const Simulation::FleetList& Simulation::getFleet() const {
+    return fleet;
+}
+
+
+std::chrono::duration<double> Simulation::getStartupTime() const {
+    return startupTime;
+}
+
+
+std::size_t Simulation::getSiteCount() const {
+    return sites.size();
+}
+
+
+Vertiport& Simulation::getSite(std::size_t siteID) const {
+    return *sites.at(siteID);
+}
+
+
+Scheduler& Simulation::getChargingScheduler() const {
+    if (chargingScheduler == nullptr) throw std::runtime_error("Chargers have not been initialized on a scheduler.");
+    return *chargingScheduler;
+}
+
+
+FleetMetrics& Simulation::getMetrics() {
+    return metrics;
+}
+
+
+const FleetMetrics& Simulation::getMetrics() const {
+    return metrics;
+}
+
+
+SessionStore& Simulation::getSessions() {
+    return sessions;
+}
+
+
+const TripDispatcher* Simulation::getDispatcher() const {
+    return dispatcher.get();
+}
+
+
+bool Simulation::isLogging() const {
+    return logging.load(std::memory_order_relaxed);
+}
+
+
+const std::filesystem::path& Simulation::getLogDirectory() const {
+    return logDirectory;
+}
+
+
+bool Simulation::isExporting() const {
+    return dataExport != nullptr;
+}
+
+
+bool Simulation::isRecordingTimeline() const {
+    return timeline != nullptr;
+}
+
+
+TimerWheel& Simulation::getTimerWheel() {
+    std::call_once(timerWheelCreated, [this] {
+        timerWheel = std::make_unique<TimerWheel>();
+        });
+
+    return *timerWheel;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "Scheduler.h"
+#include "FleetCatalog.h"
+#include "FleetMetrics.h"
+#include "SessionStore.h"
+#include "TripDispatcher.h"
+#include "MemoryAccounting.h"
+
+
+class evTOL;
+class Vertiport;
+class DataLogger;
+class DataExport;
+class Timeline;
+class SegmentedLog;
+class TimerWheel;
+class FleetManager;
+class RequestManager;
+class ChargingStation;
+class ChargerPool;
+class Checkpoint;
+enum class ExportFormat;
+
+/*
+* Context of one simulation run.
+*
+* Everything a run creates or shares between its aircraft, chargers and requests lives here rather than
+* in static members, so a process can run several independent simulations at the same time (one per
+* core, say) and start new ones without re-launching. Every aircraft, charger and vertiport keeps a
+* reference to the simulation it belongs to; the static entry points of those classes take it explicitly.
+*
+* A simulation is initialized once and stopped once. Running another scenario means creating another
+* Simulation, which can reuse the parsed catalog.
+*
+* The outputs of a run - its log, data export and timeline - belong to it as well, and are off until they
+* are asked for, so concurrent simulations never write into each other's files. A simulation logs into the
+* segments of its own log directory, "Logs" unless set otherwise; a directory takes one writer at a time.
+*/
+
+class Simulation {
+public:
+	explicit Simulation(std::shared_ptr<const FleetCatalog> catalog);	// Parametrized constructor
+	~Simulation();														// Stops the simulation if it is still running
+
+	Simulation(const Simulation& other) = delete;				// Copy constructor
+	Simulation& operator=(const Simulation& other) = delete;	// Copy assignment
+
+	// Containers that grow with the run, each charged to its subsystem in the memory accounting
+	using FleetList = TrackedVector<std::shared_ptr<evTOL>, MemorySubsystem::Fleet>;
+	using FleetSizeMap = TrackedMap<std::string, std::size_t, MemorySubsystem::Fleet>;
+	using SiteList = TrackedVector<std::unique_ptr<Vertiport>, MemorySubsystem::Chargers>;
+	using ChargerList = TrackedVector<std::unique_ptr<ChargingStation>, MemorySubsystem::Chargers>;
+	using StatusMap = TrackedMap<std::string, std::atomic<bool>, MemorySubsystem::Requests>;
+	using RequestMap = TrackedMap<std::string, std::shared_ptr<RequestManager>, MemorySubsystem::Requests>;
+	using LoggerMap = TrackedMap<std::string, std::shared_ptr<DataLogger>, MemorySubsystem::Logging>;
+
+	void setSeed(std::uint64_t seed);							// Seed the random fleet composition for reproducible runs
+	void setTripDemand(const TripDemandConfig& config);			// Fly passenger trips instead of full batteries; cooperative runs only
+	void setLogging(bool enabled);								// Write the log and the session summaries of this simulation
+	void setLogDirectory(const std::filesystem::path& directory);	// Folder of the log segments; call before the simulation starts
+
+	void startExport(const std::filesystem::path& directory, ExportFormat format);	// Export sessions and tickets; call before the simulation starts
+	void finishExport();										// Flush and close the export; call once the simulation has stopped
+	void startTimeline(const std::filesystem::path& path);		// Record a timeline; call before the simulation starts
+	void finishTimeline();										// Flush and close the timeline; call once the simulation has stopped
+
+	const FleetCatalog& getCatalog() const;										// Get the manufacturer input data
+	const std::vector<std::string>& getManufacturerNames() const;				// Get the manufacturer names in input order
+	const FleetList& getFleet() const;											// Get all aircraft in the fleet
+	std::chrono::duration<double> getStartupTime() const;						// Get the wall-clock time the fleet took to get ready to fly
+	std::size_t getSiteCount() const;											// Get the number of vertiports in the network
+	Vertiport& getSite(std::size_t siteID) const;								// Get a vertiport by ID
+	Scheduler& getChargingScheduler() const;									// Get the scheduler the charger coroutines run on
+
+	FleetMetrics& getMetrics();									// Per-manufacturer statistics of this simulation
+	const FleetMetrics& getMetrics() const;
+	SessionStore& getSessions();								// Completed flight sessions of this simulation
+	TimerWheel& getTimerWheel();								// Timer wheel of the real-time threads, created by the real-time initializers
+	const TripDispatcher* getDispatcher() const;				// Dispatcher of the trip demand, null without demand
+	bool isLogging() const;										// Check if the log and the session summaries are written
+	const std::filesystem::path& getLogDirectory() const;		// Get the folder of the log segments
+	bool isExporting() const;									// Check if sessions and tickets are exported
+	bool isRecordingTimeline() const;							// Check if a timeline is recorded
+
+private:
+	friend class evTOL;
+	friend class Checkpoint;
+	friend class Vertiport;
+	friend class DataLogger;
+	friend class FleetManager;
+	friend class RequestManager;
+	friend class ChargingStation;
+	friend class ChargerPool;
+	friend class TripDispatcher;
+
+	std::shared_ptr<const FleetCatalog> catalog;				// Manufacturer input data
+
+	/* ----------------- Fleet ----------------- */
+	std::once_flag fleetInitialized;									// Flag to ensure that the fleet is initialized only once
+	std::optional<std::uint64_t> randomSeed;							// Seed for the fleet composition, random device if unset
+	std::vector<std::thread> fleetThreads;								// Vector of threads to manage the fleet
+	FleetList fleet;													// Vector of all aircraft in the fleet
+	FleetSizeMap fleetSizes;											// Map to record fleet sizes
+	std::atomic<bool> fleetRetired;										// Flag to indicate that the aircraft have to stop
+	std::condition_variable aircraftCV;									// Condition variable to notify the aircraft
+	std::chrono::duration<double> startupTime;							// Time from the start of the fleet initialization until every aircraft was spawned
+
+	/* ----------------- Trip demand ----------------- */
+	std::optional<TripDemandConfig> tripDemand;							// Demand the fleet serves, full-battery flights if unset
+	std::unique_ptr<TripDispatcher> dispatcher;							// Dispatcher of the demand, created with the fleet
+
+	/* ----------------- Charging network ----------------- */
+	std::once_flag chargersInitialized;									// Flag to ensure that the chargers are initialized only once
+	std::atomic<bool> chargersStopped;									// Flag to indicate that the chargers have to stop
+	SiteList sites;														// All vertiports of the charging network
+	ChargerList chargerInstances;										// Vector of unique pointers to charging stations
+	Scheduler* chargingScheduler;										// Scheduler of the charger coroutines, null when running on threads
+	std::unique_ptr<ChargerPool> chargerPool;							// Controller resizing the chargers, null if the pool is only resized by hand
+
+	/* ----------------- Charging requests ----------------- */
+	std::atomic<bool> requestsStopped;													// Flag to indicate that request monitoring has to stop
+	std::mutex updatesMtx;																// Mutex to control access to map for status updates
+	StatusMap processedRequests;														// Map to indicate the status of charging
+	std::mutex instancesMtx;															// Mutex to control access to the map of requests
+	RequestMap requests;																// Map to record all instances created for charging request
+	std::condition_variable chargingComplete;											// Condition variable to receive notification from chargers
+
+	/* ----------------- Logging and results ----------------- */
+	std::atomic<bool> logging;															// Flag to write the log and the session summaries
+	std::mutex loggersMtx;																// Mutex to lock the loggers map
+	LoggerMap loggers;																	// Map to store the loggers of the aircraft
+	std::filesystem::path logDirectory;													// Folder of the log segments
+	std::once_flag logOpened;															// Flag to open the log only once
+	std::unique_ptr<SegmentedLog> log;													// Segments all loggers write into, opened on the first record
+	bool resumed;																		// Flag to indicate that the run continues a checkpoint
+	std::optional<std::uint64_t> resumedLogRun;											// Log run continued from the checkpoint, a new run if unset
+	FleetMetrics metrics;																// Per-manufacturer statistics
+	SessionStore sessions;																// Completed flight sessions
+	std::unique_ptr<DataExport> dataExport;												// Export of sessions and tickets, null if not exporting
+	std::unique_ptr<Timeline> timeline;													// Timeline of the run, null if not recording one
+
+	std::once_flag timerWheelCreated;													// Flag to create the timer wheel only once
+	std::unique_ptr<TimerWheel> timerWheel;												// Timer wheel of the real-time threads
+};
@@ -0,0 +1,1231 @@
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <functional>
+#include <unordered_map>
+
+#include "evTOL.h"
+#include "Benchmark.h"
+#include "Scheduler.h"
+#include "Vertiport.h"
+#include "Checkpoint.h"
+#include "ChargerPool.h"
+#include "FleetCatalog.h"
+#include "LiveStats.h"
+#include "Timeline.h"
+#include "ResultCache.h"
+#include "ScopeTimers.h"
+#include "FleetSampler.h"
+#include "MemoryAccounting.h"
+#include "ThreadPlacement.h"
+#include "DataLogger.h"
+#include "SegmentedLog.h"
+#include "DataExport.h"
+#include "Simulation.h"
+#include "SimulatorAPI.h"
+#include "ChargingTrace.h"
+#include "FleetManager.h"
+#include "ChargingStation.h"
+#include "ParallelScheduler.h"
+#include "ShardedScheduler.h"
+
+
+/*
+* State behind one handle of the C interface. The simulation is initialized on the first evsim_run_for(),
+* once the schedulers exist, and stopped exactly once by evsim_stop() or evsim_destroy().
+*
+* The schedulers are declared after the simulation so that they are destroyed first, before the
+* simulation stops whatever they leave behind.
+*/
+
+struct evsim_simulation {
+	evsim_simulation(const evsim_config& config, std::shared_ptr<const FleetCatalog> catalog);
+
+	evsim_config config;											// Copy of the configuration, without the strings
+	std::string liveStatsName;										// Segment to publish live statistics to, empty if none
+	Simulation simulation;											// Context of the run
+
+	std::unique_ptr<Scheduler> scheduler;							// Scheduler of the cooperative mode
+	std::unique_ptr<ParallelScheduler> parallelScheduler;			// Scheduler of the parallel mode
+	std::unique_ptr<ShardedScheduler> shardedScheduler;				// Scheduler of the sharded mode
+
+	bool started;													// Flag to indicate that the fleet has been initialized
+	bool stopped;													// Flag to indicate that the simulation has been stopped
+	std::unique_ptr<LiveStats> liveStats;							// Publisher of the live statistics, null if not publishing
+	std::uint64_t events;											// Events processed by all runs
+	std::chrono::microseconds simulated;							// Simulated time covered by all runs
+	std::chrono::duration<double> wallTime;							// Wall-clock time spent running
+
+	std::string checkpointPath;										// Snapshot written while running, empty if none
+	std::chrono::microseconds checkpointInterval;					// Simulated time between snapshots
+
+	std::chrono::microseconds sampleInterval;						// Simulated time between samples of the fleet, zero if not sampling
+	std::unique_ptr<FleetSampler> sampler;							// Samples taken so far, created with the fleet
+
+	bool builtinCatalog;											// Flag to indicate that the catalog is compiled into the program
+	std::unique_ptr<ResultCache> resultCache;						// Cache the results are served from and stored in, null if none
+	bool cacheable;													// Flag to indicate that the results are stored in the result cache
+	bool cached;													// Flag to indicate that the results were served from the result cache
+	evsim_results cachedResults;									// Results served from the cache
+	std::string cachedReport;										// Report served from the cache
+};
+
+
+namespace {
+
+	thread_local std::string lastError;								// Message of the last failure on this thread
+
+	static_assert(static_cast<int>(FlightPhase::Start) == EVSIM_PHASE_IDLE && static_cast<int>(FlightPhase::Flying) == EVSIM_PHASE_FLYING
+		&& static_cast<int>(FlightPhase::Queued) == EVSIM_PHASE_QUEUED && static_cast<int>(FlightPhase::Charging) == EVSIM_PHASE_CHARGING,
+		"Sampled phases are handed out as evsim_phase");
+
+	std::mutex catalogsMtx;																	// Mutex to control access to the catalog cache
+	std::unordered_map<std::string, std::shared_ptr<const FleetCatalog>> catalogs;			// Parsed catalogs by path
+
+	std::atomic<std::size_t> activeSimulations{ 0 };										// Simulations started and not yet stopped
+
+
+	int fail(const std::string& message) {
+		lastError = message;
+		return -1;
+	}
+
+
+	std::shared_ptr<const FleetCatalog> loadCatalog(const char* path) {
+		// Batch tools create many simulations from the same input; it is loaded on the first one only
+		std::string key = (path != nullptr) ? path : "Manufacturer.json";
+
+		std::lock_guard<std::mutex> lock(catalogsMtx);
+
+		std::shared_ptr<const FleetCatalog>& catalog = catalogs[key];
+		if (!catalog) catalog = FleetCatalog::load(key);
+
+		return catalog;
+	}
+
+
+	void validate(const evsim_config* config) {
+		if (config == nullptr) throw std::invalid_argument("Configuration is null.");
+		if (config->size < sizeof(evsim_config)) throw std::invalid_argument("Configuration was built against an unknown header version.");
+		if (config->mode < EVSIM_MODE_THREADED || config->mode > EVSIM_MODE_SHARDED) throw std::invalid_argument("Unknown simulation mode.");
+		if (config->aircraft == 0 || config->chargers == 0 || config->sites == 0) throw std::invalid_argument("Aircraft, chargers and sites must be positive.");
+		if (config->mode == EVSIM_MODE_PARALLEL && config->workers == 0) throw std::invalid_argument("A parallel simulation needs at least one worker.");
+		if (config->mode == EVSIM_MODE_SHARDED && config->workers == 0) throw std::invalid_argument("A sharded simulation needs at least one shard.");
+		if (!(config->trips_per_hour >= 0.0)) throw std::invalid_argument("Trip demand must not be negative.");
+		if (config->trips_per_hour > 0.0 && config->mode != EVSIM_MODE_COOPERATIVE) throw std::invalid_argument("Trip demand needs a cooperative simulation.");
+		if (config->trips_per_hour > 0.0 && (!(config->service_area_miles > 0.0) || !(config->max_trip_wait_minutes > 0.0))) {
+			throw std::invalid_argument("Trip demand needs a positive service area and maximum wait.");
+		}
+	}
+
+
+	std::chrono::microseconds toSimDuration(double seconds) {
+		if (!(seconds >= 0.0)) throw std::invalid_argument("Duration must not be negative.");
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>(seconds));
+	}
+
+
+	std::int64_t toSampleTime(double seconds) {
+		// Open-ended ranges are passed as a huge upper bound, which is clamped rather than converted
+		if (!(seconds >= 0.0)) throw std::invalid_argument("Sample times must not be negative.");
+		if (seconds >= 9.0e12) return std::numeric_limits<std::int64_t>::max();
+
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::duration<double>(seconds)).count();
+	}
+
+
+	void visitSamples(const TimeSeriesStore& store, double fromSeconds, double toSeconds, evsim_sample_visitor visitor, void* context) {
+		if (visitor == nullptr) throw std::invalid_argument("Sample visitor is null.");
+
+		store.decode(toSampleTime(fromSeconds), toSampleTime(toSeconds), [&](const FleetSample& sample) {
+			evsim_sample_frame frame{};
+			frame.size = sizeof(evsim_sample_frame);
+			frame.num_aircraft = static_cast<uint32_t>(sample.batteryLevels.size());
+			frame.num_sites = static_cast<uint32_t>(sample.busyChargers.size());
+			frame.time_seconds = std::chrono::duration<double>(std::chrono::microseconds(sample.time)).count();
+			frame.battery_levels = sample.batteryLevels.data();
+			frame.phases = sample.phases.data();
+			frame.busy_chargers = sample.busyChargers.data();
+			frame.queued_requests = sample.queuedRequests.data();
+
+			return visitor(&frame, context) == 0;
+			});
+	}
+
+
+	Scenario scenarioOf(const evsim_config& config, double seconds) {
+		// Benchmark runs are only comparable with each other when the fleet composition is fixed
+		return Scenario{ config.aircraft, config.chargers, config.sites, toSimDuration(seconds), config.has_seed ? config.seed : 1 };
+	}
+
+
+	std::vector<Scheduler*> partitionsOf(evsim_simulation& handle) {
+		// Chargers run on the first partition, aircraft i on partition i modulo their number; a sharded run only has the network in this process
+		std::vector<Scheduler*> partitions;
+
+		if (handle.scheduler) partitions.push_back(handle.scheduler.get());
+		else if (handle.parallelScheduler) {
+			for (std::size_t i = 0; i < handle.parallelScheduler->numPartitions(); ++i) partitions.push_back(&handle.parallelScheduler->partition(i));
+		}
+		else if (handle.shardedScheduler) partitions.push_back(&handle.shardedScheduler->network());
+
+		return partitions;
+	}
+
+
+	void start(evsim_simulation& handle, const Checkpoint* checkpoint = nullptr) {
+		/*
+		* A simulation restored from a checkpoint gets schedulers that share the simulated time zero of
+		* the original run and continue from the simulated time the snapshot was taken at.
+		*/
+
+		Simulation& simulation = handle.simulation;
+		const evsim_config& config = handle.config;
+
+		// The shards would inherit the state of every other simulation half-way through whatever it is doing
+		if (config.mode == EVSIM_MODE_SHARDED && activeSimulations.load() != 0) {
+			throw std::logic_error("A sharded simulation forks its shards, so it must be the only simulation running in the process.");
+		}
+
+		if (config.mode == EVSIM_MODE_COOPERATIVE) {
+			handle.scheduler = (checkpoint != nullptr) ? std::make_unique<Scheduler>(checkpoint->getEpoch()) : std::make_unique<Scheduler>();
+		}
+		else if (config.mode == EVSIM_MODE_PARALLEL) {
+			handle.parallelScheduler = (checkpoint != nullptr) ? std::make_unique<ParallelScheduler>(config.workers, checkpoint->getEpoch())
+				: std::make_unique<ParallelScheduler>(config.workers);
+		}
+		else if (config.mode == EVSIM_MODE_SHARDED) {
+			handle.shardedScheduler = std::make_unique<ShardedScheduler>(config.workers);
+		}
+
+		std::vector<Scheduler*> partitions = partitionsOf(handle);
+
+		// A log directory held by another simulation fails the run here, rather than the first record on an aircraft thread
+		if (checkpoint == nullptr && simulation.isLogging()) DataLogger::openLog(simulation);
+
+		if (checkpoint != nullptr) {
+			RunProgress progress = checkpoint->getProgress();
+
+			if (handle.scheduler) handle.scheduler->setElapsed(progress.simulated);
+			else handle.parallelScheduler->setElapsed(progress.simulated);
+
+			checkpoint->restore(simulation, partitions);
+			if (simulation.isLogging()) DataLogger::openLog(simulation);
+
+			handle.events = progress.events;
+			handle.simulated = progress.simulated;
+			handle.wallTime = std::chrono::duration<double>(progress.wallSeconds);
+		}
+		else if (handle.scheduler) {
+			ChargingStation::InitializeChargers(simulation, config.chargers, config.sites, *handle.scheduler);
+			FleetManager::InitializeFleet(simulation, config.aircraft, *handle.scheduler);
+		}
+		else if (handle.parallelScheduler) {
+			ChargingStation::InitializeChargers(simulation, config.chargers, config.sites, handle.parallelScheduler->partition(0));
+			FleetManager::InitializeFleet(simulation, config.aircraft, *handle.parallelScheduler);
+		}
+		else if (handle.shardedScheduler) {
+			// The shards are forked with the fleet, before the live statistics start a thread
+			ChargingStation::InitializeChargers(simulation, config.chargers, config.sites, handle.shardedScheduler->network());
+			FleetManager::InitializeFleet(simulation, config.aircraft, *handle.shardedScheduler);
+		}
+		else {
+			ChargingStation::InitializeChargers(simulation, config.chargers, config.sites);
+			FleetManager::InitializeFleet(simulation, config.aircraft);
+		}
+
+		if (handle.sampleInterval > std::chrono::microseconds::zero() && !handle.sampler) {
+			handle.sampler = std::make_unique<FleetSampler>(simulation, handle.sampleInterval, handle.simulated);
+		}
+
+		std::vector<const Scheduler*> monitored(partitions.begin(), partitions.end());
+		if (!handle.liveStatsName.empty()) handle.liveStats = LiveStats::start(handle.liveStatsName, simulation, monitored);
+		handle.started = true;
+		++activeSimulations;
+	}
+
+
+	void advance(evsim_simulation& handle, std::chrono::microseconds duration) {
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+		if (handle.scheduler) handle.events += handle.scheduler->runFor(duration);
+		else if (handle.parallelScheduler) handle.events += handle.parallelScheduler->runFor(duration, FleetManager::getLookahead(handle.simulation));
+		else if (handle.shardedScheduler) handle.events += handle.shardedScheduler->runFor(duration, FleetManager::getLookahead(handle.simulation));
+		else std::this_thread::sleep_for(duration);
+
+		handle.wallTime += std::chrono::steady_clock::now() - begin;
+		handle.simulated += duration;
+	}
+
+
+	std::chrono::time_point<std::chrono::system_clock> resizeTime(evsim_simulation& handle) {
+		/*
+		* Chargers added between runs start where the run ended. The charging partition of a parallel run
+		* may have stopped at its last event before that, with nothing left to process up to the end.
+		*/
+
+		if (handle.config.mode == EVSIM_MODE_THREADED) return std::chrono::system_clock::now();
+
+		Scheduler& network = handle.simulation.getChargingScheduler();
+		if (network.elapsed() < handle.simulated) network.setElapsed(handle.simulated);
+
+		return network.now();
+	}
+
+
+	void sampleFleet(evsim_simulation& handle) {
+		if (!handle.sampler || handle.sampleInterval == std::chrono::microseconds::zero()) return;
+
+		// Partitions of a parallel run may stop short of the end of the run, so the time is taken from the run itself
+		const Scheduler& clock = handle.scheduler ? *handle.scheduler : handle.parallelScheduler->partition(0);
+		handle.sampler->sample(handle.simulated, clock.getEpoch() + handle.simulated);
+	}
+
+
+	evsim_results resultsOf(const evsim_simulation& handle) {
+		const Simulation& context = handle.simulation;
+
+		evsim_results filled{};
+		filled.size = sizeof(evsim_results);
+		filled.mode = handle.config.mode;
+		filled.events = handle.events;
+		filled.windows = handle.parallelScheduler ? handle.parallelScheduler->getWindowCount()
+			: handle.shardedScheduler ? handle.shardedScheduler->getWindowCount() : 0;
+		filled.simulated_seconds = std::chrono::duration<double>(handle.simulated).count();
+		filled.wall_seconds = handle.wallTime.count();
+		filled.aircraft = static_cast<uint32_t>(context.getFleet().size());
+		filled.stopped = handle.stopped ? 1 : 0;
+		filled.startup_seconds = context.getStartupTime().count();
+
+		std::vector<ManufacturerTotals> totals = context.getMetrics().collect();
+		filled.num_manufacturers = static_cast<uint32_t>(totals.size());
+		filled.num_reported = static_cast<uint32_t>(std::min<std::size_t>(totals.size(), EVSIM_MAX_MANUFACTURERS));
+
+		for (std::size_t i = 0; i < filled.num_reported; ++i) {
+			evsim_manufacturer_results& manufacturer = filled.manufacturers[i];
+			std::strncpy(manufacturer.name, totals[i].manufacturer.c_str(), EVSIM_NAME_LENGTH - 1);
+			manufacturer.flights = totals[i].flights;
+			manufacturer.charges = totals[i].charges;
+			manufacturer.air_time = totals[i].airTime;
+			manufacturer.miles = totals[i].miles;
+			manufacturer.passenger_miles = totals[i].passengerMiles;
+			manufacturer.faults = totals[i].faults;
+			manufacturer.charge_time = totals[i].chargeTime;
+		}
+
+		if (handle.config.mode != EVSIM_MODE_THREADED || handle.stopped) {
+			// Summed aircraft by aircraft, exactly as the benchmarks do, so the figures compare bit for bit
+			RunDigest digest = Benchmark::digestFleet(context, handle.events, handle.wallTime.count());
+			filled.sessions = digest.sessions;
+			filled.air_time = digest.airTime;
+		}
+		else {
+			// The aircraft threads are still flying; only the metrics counters are safe to read
+			for (const ManufacturerTotals& manufacturer : totals) {
+				filled.sessions += manufacturer.flights;
+				filled.air_time += manufacturer.airTime;
+			}
+		}
+
+		if (const TripDispatcher* dispatcher = context.getDispatcher()) {
+			TripTotals trips = dispatcher->getTotals();
+			filled.trips_requested = trips.requested;
+			filled.trips_served = trips.served;
+			filled.trips_expired = trips.expired;
+			filled.trip_passenger_miles = trips.passengerMiles;
+			filled.mean_trip_wait_seconds = (trips.served > 0) ? trips.waitSeconds / static_cast<double>(trips.served) : 0.0;
+		}
+
+		if (handle.sampler) {
+			filled.samples = handle.sampler->getStore().getFrameCount();
+			filled.sample_bytes = handle.sampler->getStore().getEncodedBytes();
+		}
+
+		double drainSeconds = 0.0;
+		for (std::size_t s = 0; s < context.getSiteCount(); ++s) {
+			const Vertiport& site = context.getSite(s);
+			CapacityStats capacity = site.getCapacityStats();
+
+			filled.chargers += static_cast<uint32_t>(site.getChargerCount());
+			filled.chargers_added += capacity.added;
+			filled.chargers_retired += capacity.retired;
+			filled.queue_drains += capacity.drains;
+			filled.max_drain_seconds = std::max(filled.max_drain_seconds, capacity.maxDrainSeconds);
+			drainSeconds += capacity.drainSeconds;
+		}
+		filled.mean_drain_seconds = (filled.queue_drains > 0) ? drainSeconds / static_cast<double>(filled.queue_drains) : 0.0;
+
+		return filled;
+	}
+
+
+	std::string reportOf(evsim_simulation& handle) {
+		std::ostringstream report;
+		handle.simulation.getMetrics().printReport(report);
+		handle.simulation.getSessions().printReport(report, handle.simulation.getManufacturerNames());
+		if (const TripDispatcher* dispatcher = handle.simulation.getDispatcher()) dispatcher->printReport(report);
+		if (handle.sampler) handle.sampler->printReport(report);
+		if (ChargerPool::isResized(handle.simulation)) ChargerPool::printReport(handle.simulation, report);
+
+		return report.str();
+	}
+
+
+	ResultKey keyOf(const evsim_simulation& handle) {
+		const evsim_config& config = handle.config;
+
+		ResultKey key{};
+		key.catalogFingerprint = Checkpoint::fingerprint(handle.simulation.getCatalog());
+		key.seed = config.seed;
+		key.simulated = handle.simulated.count();
+		key.mode = static_cast<std::uint32_t>(config.mode);
+		key.workers = (config.mode == EVSIM_MODE_PARALLEL || config.mode == EVSIM_MODE_SHARDED) ? config.workers : 0;
+		key.aircraft = config.aircraft;
+		key.chargers = config.chargers;
+		key.sites = config.sites;
+		key.builtinCatalog = handle.builtinCatalog ? 1 : 0;
+		key.tripsPerHour = config.trips_per_hour;
+		key.serviceAreaMiles = (config.trips_per_hour > 0.0) ? config.service_area_miles : 0.0;
+		key.maxTripWaitMinutes = (config.trips_per_hour > 0.0) ? config.max_trip_wait_minutes : 0.0;
+
+		return key;
+	}
+
+
+	bool serveFromCache(evsim_simulation& handle, std::chrono::microseconds duration) {
+		/*
+		* Only a fresh, seeded, event-driven run is a function of its key alone. A run that writes logs, an
+		* export, a timeline, live statistics, checkpoints or samples is simulated for those, and stores its results.
+		*/
+
+		handle.cacheable = handle.config.mode != EVSIM_MODE_THREADED && handle.config.has_seed && handle.resultCache;
+
+		const Simulation& simulation = handle.simulation;
+		if (!handle.cacheable || duration == std::chrono::microseconds::zero() || simulation.isLogging() || simulation.isExporting()
+			|| simulation.isRecordingTimeline() || !handle.liveStatsName.empty() || !handle.checkpointPath.empty()
+			|| handle.sampleInterval > std::chrono::microseconds::zero()) {
+			return false;
+		}
+
+		handle.simulated = duration;
+		handle.cachedResults.size = sizeof(evsim_results);
+		handle.cached = handle.resultCache->lookup(keyOf(handle), &handle.cachedResults, sizeof(evsim_results), handle.cachedReport);
+		if (!handle.cached) handle.simulated = std::chrono::microseconds::zero();
+
+		return handle.cached;
+	}
+
+
+	void recompute(evsim_simulation& handle) {
+		// A simulation served from the cache has nothing to continue from, so it is simulated up to where it stands
+		std::chrono::microseconds covered = handle.simulated;
+
+		handle.cached = false;
+		handle.cachedReport.clear();
+		handle.simulated = std::chrono::microseconds::zero();
+
+		start(handle);
+		advance(handle, covered);
+	}
+
+
+	void writeCheckpoint(evsim_simulation& handle, const std::filesystem::path& path) {
+		if (handle.config.mode == EVSIM_MODE_THREADED) throw std::logic_error("Only event-driven simulations can be checkpointed.");
+		if (handle.config.mode == EVSIM_MODE_SHARDED) throw std::logic_error("Sharded simulations cannot be checkpointed.");
+		if (handle.stopped) throw std::logic_error("Simulation has been stopped.");
+		if (handle.cached) recompute(handle);
+		if (!handle.started) start(handle);
+
+		Checkpoint::write(path, handle.simulation, partitionsOf(handle), RunProgress{ handle.simulated, handle.events, handle.wallTime.count() });
+	}
+
+
+	void stop(evsim_simulation& handle) {
+		if (handle.stopped) return;
+
+		if (handle.liveStats) handle.liveStats->stop();
+		FleetManager::stopSimulation(handle.simulation);
+		if (handle.shardedScheduler) handle.shardedScheduler->finish();
+
+		handle.simulation.finishTimeline();
+		handle.liveStats.reset();
+		handle.stopped = true;
+		if (handle.started) --activeSimulations;
+
+		if (handle.cacheable && handle.started && handle.resultCache) {
+			try {
+				evsim_results results = resultsOf(handle);
+				handle.resultCache->store(keyOf(handle), &results, sizeof(results), reportOf(handle));
+			}
+			catch (const std::exception&) {
+				// A result that cannot be cached is simply computed again next time
+			}
+		}
+
+		// Finished last, so that an export that cannot be written is reported with the simulation stopped all the same
+		handle.simulation.finishExport();
+	}
+
+}
+
+
+evsim_simulation::evsim_simulation(const evsim_config& config, std::shared_ptr<const FleetCatalog> catalog) :
+	config(config),
+	liveStatsName((config.live_stats_name != nullptr) ? config.live_stats_name : ""),
+	simulation(std::move(catalog)),
+	started(false),
+	stopped(false),
+	events(0),
+	simulated(std::chrono::microseconds::zero()),
+	wallTime(0.0),
+	checkpointInterval(std::chrono::microseconds::zero()),
+	sampleInterval(std::chrono::microseconds::zero()),
+	builtinCatalog(config.catalog_path != nullptr && std::strcmp(config.catalog_path, FleetCatalog::BuiltinPath) == 0),
+	cacheable(false),
+	cached(false),
+	cachedResults{}
+{
+	this->config.catalog_path = nullptr;
+	this->config.live_stats_name = nullptr;
+	this->config.log_directory = nullptr;
+
+	simulation.setLogging(true);
+	if (config.log_directory != nullptr) simulation.setLogDirectory(config.log_directory);
+	if (config.has_seed) simulation.setSeed(config.seed);
+	if (config.trips_per_hour > 0.0) {
+		simulation.setTripDemand(TripDemandConfig{ config.trips_per_hour, config.service_area_miles,
+			std::chrono::duration<double, std::ratio<60>>(config.max_trip_wait_minutes) });
+	}
+}
+
+
+/* ----------------- Simulations ----------------- */
+
+uint32_t evsim_abi_version(void) {
+	return EVSIM_ABI_VERSION;
+}
+
+
+void evsim_default_config(evsim_config* config) {
+	if (config == nullptr) return;
+
+	*config = evsim_config{};
+	config->size = sizeof(evsim_config);
+	config->mode = EVSIM_MODE_COOPERATIVE;
+	config->catalog_path = "Manufacturer.json";
+	config->aircraft = 20;
+	config->chargers = 3;
+	config->sites = 1;
+	config->workers = 1;
+	config->service_area_miles = 20.0;
+	config->max_trip_wait_minutes = 15.0;
+	config->log_directory = "Logs";
+}
+
+
+evsim_simulation* evsim_create(const evsim_config* config) {
+	try {
+		validate(config);
+		return new evsim_simulation(*config, loadCatalog(config->catalog_path));
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return nullptr;
+	}
+}
+
+
+int evsim_run_for(evsim_simulation* simulation, double seconds) {
+	/*
+	* In the event-driven modes the duration is simulated time and successive calls continue where the
+	* previous one ended. In threaded mode the aircraft fly in wall-clock time on their own threads, and the
+	* call simply lets them run for that long.
+	*
+	* With periodic checkpoints or samples the run is split at every multiple of their intervals, counted from
+	* the start of the simulation, and a snapshot is written or the fleet sampled at each split. Splitting a
+	* run does not change its outcome.
+	*/
+
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		if (simulation->stopped) throw std::logic_error("Simulation has been stopped.");
+
+		std::chrono::microseconds duration = toSimDuration(seconds);
+		if (simulation->cached) recompute(*simulation);
+		else if (!simulation->started && serveFromCache(*simulation, duration)) return 0;
+		if (!simulation->started) start(*simulation);
+
+		const bool checkpoints = !simulation->checkpointPath.empty();
+		const bool sampling = simulation->sampler && simulation->sampleInterval > std::chrono::microseconds::zero();
+
+		sampleFleet(*simulation);
+
+		if ((!checkpoints && !sampling) || duration == std::chrono::microseconds::zero()) {
+			advance(*simulation, duration);
+			return 0;
+		}
+
+		const std::chrono::microseconds interval = simulation->checkpointInterval;
+		const std::chrono::microseconds end = simulation->simulated + duration;
+
+		while (simulation->simulated < end) {
+			std::chrono::microseconds next = end;
+			if (checkpoints) next = std::min(next, (simulation->simulated / interval + 1) * interval);
+			if (sampling) next = std::min(next, simulation->sampler->getNextSample());
+
+			advance(*simulation, next - simulation->simulated);
+			if (checkpoints && simulation->simulated % interval == std::chrono::microseconds::zero()) writeCheckpoint(*simulation, simulation->checkpointPath);
+			sampleFleet(*simulation);
+		}
+
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_stop(evsim_simulation* simulation) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		stop(*simulation);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_get_results(const evsim_simulation* simulation, evsim_results* results) {
+	if (simulation == nullptr || results == nullptr) return fail("Simulation or results are null.");
+	// Callers built before startup_seconds was appended get the fields they know about
+	if (results->size < offsetof(evsim_results, startup_seconds)) return fail("Results were built against an unknown header version.");
+
+	try {
+		evsim_results filled = simulation->cached ? simulation->cachedResults : resultsOf(*simulation);
+		filled.size = std::min<uint32_t>(results->size, sizeof(evsim_results));
+		filled.stopped = simulation->stopped ? 1 : 0;
+		filled.cached = simulation->cached ? 1 : 0;
+
+		std::memcpy(results, &filled, filled.size);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+size_t evsim_format_report(evsim_simulation* simulation, char* buffer, size_t capacity) {
+	/*
+	* Returns the length of the full report without the terminating null, like snprintf(). A buffer that is
+	* too small receives a truncated, null-terminated report; call again with a larger one.
+	*/
+
+	if (simulation == nullptr) {
+		fail("Simulation is null.");
+		return 0;
+	}
+	if (!simulation->stopped) {
+		fail("The report is only available once the simulation has been stopped.");
+		return 0;
+	}
+
+	try {
+		std::string text = simulation->cached ? simulation->cachedReport : reportOf(*simulation);
+		if (buffer != nullptr && capacity > 0) {
+			std::size_t length = std::min(text.size(), capacity - 1);
+			std::memcpy(buffer, text.data(), length);
+			buffer[length] = '\0';
+		}
+
+		return text.size();
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return 0;
+	}
+}
+
+
+void evsim_destroy(evsim_simulation* simulation) {
+	if (simulation == nullptr) return;
+
+	try {
+		stop(*simulation);
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+	}
+
+	delete simulation;
+}
+
+
+/* ----------------- Checkpoints ----------------- */
+
+int evsim_checkpoint(evsim_simulation* simulation, const char* path) {
+	if (simulation == nullptr || path == nullptr) return fail("Simulation or checkpoint path is null.");
+
+	try {
+		writeCheckpoint(*simulation, path);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_set_checkpoints(evsim_simulation* simulation, const char* path, double interval_seconds) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		std::chrono::microseconds interval = toSimDuration(interval_seconds);
+
+		if (path == nullptr || interval == std::chrono::microseconds::zero()) {
+			simulation->checkpointPath.clear();
+			return 0;
+		}
+		if (simulation->config.mode == EVSIM_MODE_THREADED) throw std::logic_error("Only event-driven simulations can be checkpointed.");
+		if (simulation->config.mode == EVSIM_MODE_SHARDED) throw std::logic_error("Sharded simulations cannot be checkpointed.");
+
+		simulation->checkpointPath = path;
+		simulation->checkpointInterval = interval;
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+evsim_simulation* evsim_restore(const evsim_config* config, const char* path) {
+	if (path == nullptr) {
+		fail("Checkpoint path is null.");
+		return nullptr;
+	}
+
+	try {
+		validate(config);
+		if (config->mode == EVSIM_MODE_THREADED) throw std::invalid_argument("Only event-driven simulations can be restored from a checkpoint.");
+		if (config->mode == EVSIM_MODE_SHARDED) throw std::invalid_argument("Sharded simulations cannot be restored from a checkpoint.");
+		if (config->trips_per_hour > 0.0) throw std::invalid_argument("Simulations with trip demand cannot be restored from a checkpoint.");
+
+		// The mapping is only needed until the state has been copied out of it
+		std::unique_ptr<const Checkpoint> snapshot = Checkpoint::load(path);
+		const CheckpointHeader& header = snapshot->getHeader();
+
+		evsim_config restored = *config;
+		restored.aircraft = header.numAircraft;
+		restored.chargers = header.numChargers;
+		restored.sites = header.numSites;
+		restored.seed = header.seed;
+		restored.has_seed = static_cast<int32_t>(header.hasSeed);
+
+		std::unique_ptr<evsim_simulation> simulation = std::make_unique<evsim_simulation>(restored, loadCatalog(config->catalog_path));
+		start(*simulation, snapshot.get());
+
+		return simulation.release();
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return nullptr;
+	}
+}
+
+
+/* ----------------- Samples ----------------- */
+
+int evsim_set_sampling(evsim_simulation* simulation, double interval_seconds) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		std::chrono::microseconds interval = toSimDuration(interval_seconds);
+
+		// Stopping keeps the samples taken so far readable
+		if (interval == std::chrono::microseconds::zero()) {
+			simulation->sampleInterval = interval;
+			return 0;
+		}
+		if (simulation->config.mode == EVSIM_MODE_THREADED) throw std::logic_error("Only event-driven simulations can be sampled.");
+		if (simulation->config.mode == EVSIM_MODE_SHARDED) throw std::logic_error("Sharded simulations cannot be sampled: the aircraft fly in other processes.");
+		if (simulation->sampler && simulation->sampler->getStore().getInterval() != interval) {
+			throw std::logic_error("The sampling interval cannot change once samples have been taken.");
+		}
+
+		simulation->sampleInterval = interval;
+		if (simulation->started && !simulation->sampler) {
+			simulation->sampler = std::make_unique<FleetSampler>(simulation->simulation, interval, simulation->simulated);
+		}
+
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_read_samples(const evsim_simulation* simulation, double from_seconds, double to_seconds, evsim_sample_visitor visitor, void* context) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+	if (!simulation->sampler) return fail("The simulation has not been sampled.");
+
+	try {
+		visitSamples(simulation->sampler->getStore(), from_seconds, to_seconds, visitor, context);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_write_samples(const evsim_simulation* simulation, const char* path) {
+	if (simulation == nullptr || path == nullptr) return fail("Simulation or sample path is null.");
+	if (!simulation->sampler) return fail("The simulation has not been sampled.");
+
+	try {
+		simulation->sampler->getStore().write(path);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_read_sample_file(const char* path, double from_seconds, double to_seconds, evsim_sample_visitor visitor, void* context) {
+	if (path == nullptr) return fail("Sample path is null.");
+
+	try {
+		visitSamples(TimeSeriesStore::load(path), from_seconds, to_seconds, visitor, context);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+/* ----------------- Logs ----------------- */
+
+int evsim_read_aircraft_log(const char* directory, uint32_t aircraft, evsim_log_visitor visitor, void* context) {
+	if (directory == nullptr || visitor == nullptr) return fail("Log directory or visitor is null.");
+
+	try {
+		SegmentedLog::read(directory, aircraft, [&](LogRecordKind kind, std::string_view text) {
+			evsim_log_record record{};
+			record.size = sizeof(evsim_log_record);
+			record.kind = (kind == LogRecordKind::Session) ? EVSIM_LOG_SESSION : EVSIM_LOG_EVENT;
+			record.text = text.data();
+			record.length = text.size();
+
+			return visitor(&record, context) == 0;
+			});
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+/* ----------------- Charger pool ----------------- */
+
+int evsim_set_site_chargers(evsim_simulation* simulation, uint32_t site, uint32_t chargers) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		if (simulation->stopped) throw std::logic_error("Simulation has been stopped.");
+		if (simulation->cached) recompute(*simulation);
+		if (!simulation->started) start(*simulation);
+
+		// The results no longer follow from the configuration alone
+		simulation->cacheable = false;
+
+		ChargerPool::resize(simulation->simulation, site, chargers, resizeTime(*simulation));
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_set_charger_pool(evsim_simulation* simulation, const evsim_charger_pool* pool) {
+	if (simulation == nullptr || pool == nullptr) return fail("Simulation or charger pool is null.");
+	if (pool->size < sizeof(evsim_charger_pool)) return fail("Charger pool was built against an unknown header version.");
+	if (pool->num_steps > 0 && pool->steps == nullptr) return fail("Capacity steps are null.");
+
+	try {
+		if (simulation->config.mode == EVSIM_MODE_THREADED) throw std::logic_error("Only event-driven simulations can resize their charger pool on their own.");
+		if (simulation->stopped) throw std::logic_error("Simulation has been stopped.");
+
+		ChargerPoolConfig config{};
+		for (uint32_t step = 0; step < pool->num_steps; ++step) {
+			config.schedule.push_back(CapacityStep{ toSimDuration(pool->steps[step].hour_of_day * 3600.0), pool->steps[step].chargers });
+		}
+		config.scaleUpWait = toSimDuration(pool->scale_up_wait_minutes * 60.0);
+		config.maxChargers = pool->max_chargers;
+		config.checkInterval = toSimDuration(pool->check_interval_minutes * 60.0);
+
+		if (simulation->cached) recompute(*simulation);
+		if (!simulation->started) start(*simulation);
+		simulation->cacheable = false;
+
+		// The controller takes its first look where the run ended
+		resizeTime(*simulation);
+		ChargerPool::Initialize(simulation->simulation, config);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+/* ----------------- Outputs ----------------- */
+
+int evsim_set_logging(evsim_simulation* simulation, int enabled) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	simulation->simulation.setLogging(enabled != 0);
+	return 0;
+}
+
+
+int evsim_export_start(evsim_simulation* simulation, const char* directory, int32_t format) {
+	if (simulation == nullptr || directory == nullptr) return fail("Simulation or export directory is null.");
+
+	try {
+		// Rows are only recorded from the start, and a simulation served from the cache would have none
+		if (simulation->started || simulation->cached) throw std::logic_error("The export must start before the simulation runs.");
+
+		simulation->simulation.startExport(directory, (format == EVSIM_EXPORT_CSV) ? ExportFormat::Csv : ExportFormat::Columnar);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_export_finish(evsim_simulation* simulation) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		if (simulation->started && !simulation->stopped) throw std::logic_error("The export is finished once the simulation has stopped.");
+
+		simulation->simulation.finishExport();
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_timeline_start(evsim_simulation* simulation, const char* path) {
+	if (simulation == nullptr || path == nullptr) return fail("Simulation or timeline path is null.");
+
+	try {
+		if (simulation->started || simulation->cached) throw std::logic_error("The timeline must start before the simulation runs.");
+
+		simulation->simulation.startTimeline(path);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_timeline_finish(evsim_simulation* simulation) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		if (simulation->started && !simulation->stopped) throw std::logic_error("The timeline is finished once the simulation has stopped.");
+
+		simulation->simulation.finishTimeline();
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_set_result_cache(evsim_simulation* simulation, const char* directory) {
+	if (simulation == nullptr) return fail("Simulation is null.");
+
+	try {
+		if (directory == nullptr) simulation->resultCache.reset();
+		else simulation->resultCache = std::make_unique<ResultCache>(directory);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+/* ----------------- Process-wide settings ----------------- */
+
+
+int evsim_compile_catalog(const char* input_path, const char* output_path) {
+	if (input_path == nullptr || output_path == nullptr) return fail("Catalog path is null.");
+
+	try {
+		FleetCatalog::compile(input_path, output_path);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_check_builtin_catalog(const char* path) {
+	if (path == nullptr) return fail("Catalog path is null.");
+
+	try {
+		FleetCatalog::checkBuiltin(path);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_set_thread_placement(const char* charger_cores, const char* worker_cores) {
+	try {
+		ThreadPlacement::configure(charger_cores != nullptr ? charger_cores : "", worker_cores != nullptr ? worker_cores : "");
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+void evsim_set_placement_report(int enabled) {
+	ThreadPlacement::setReporting(enabled != 0);
+}
+
+
+size_t evsim_format_placement_report(char* buffer, size_t capacity) {
+	// Same contract as evsim_format_report()
+	try {
+		std::ostringstream report;
+		ThreadPlacement::printReport(report);
+
+		std::string text = report.str();
+		if (buffer != nullptr && capacity > 0) {
+			std::size_t length = std::min(text.size(), capacity - 1);
+			std::memcpy(buffer, text.data(), length);
+			buffer[length] = '\0';
+		}
+
+		return text.size();
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return 0;
+	}
+}
+
+
+/* ----------------- Memory ----------------- */
+
+int evsim_get_memory_usage(evsim_memory_usage* usage) {
+	if (usage == nullptr) return fail("Memory usage is null.");
+	if (usage->size < sizeof(evsim_memory_usage)) return fail("Memory usage was built against an unknown header version.");
+
+	evsim_memory_usage filled{};
+	filled.size = sizeof(evsim_memory_usage);
+	filled.resident_bytes = MemoryAccounting::residentBytes();
+	filled.peak_resident_bytes = MemoryAccounting::peakResidentBytes();
+
+	std::array<MemoryUsage, MemorySubsystemCount> subsystems = MemoryAccounting::usage();
+	filled.num_subsystems = static_cast<uint32_t>(std::min<std::size_t>(subsystems.size(), EVSIM_MEMORY_SUBSYSTEMS));
+
+	for (std::size_t i = 0; i < filled.num_subsystems; ++i) {
+		std::strncpy(filled.subsystems[i].name, subsystems[i].subsystem, EVSIM_NAME_LENGTH - 1);
+		filled.subsystems[i].current_bytes = subsystems[i].currentBytes;
+		filled.subsystems[i].peak_bytes = subsystems[i].peakBytes;
+		filled.subsystems[i].allocations = subsystems[i].allocations;
+		filled.subsystems[i].releases = subsystems[i].releases;
+	}
+
+	std::memcpy(usage, &filled, sizeof(filled));
+	return 0;
+}
+
+
+size_t evsim_format_memory_report(char* buffer, size_t capacity) {
+	// Same contract as evsim_format_report()
+	try {
+		std::ostringstream report;
+		MemoryAccounting::printReport(report);
+
+		std::string text = report.str();
+		if (buffer != nullptr && capacity > 0) {
+			std::size_t length = std::min(text.size(), capacity - 1);
+			std::memcpy(buffer, text.data(), length);
+			buffer[length] = '\0';
+		}
+
+		return text.size();
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return 0;
+	}
+}
+
+
+/* ----------------- Timed scopes ----------------- */
+
+int evsim_get_scope_times(evsim_scope_times* times) {
+	if (times == nullptr) return fail("Scope times are null.");
+	if (times->size < sizeof(evsim_scope_times)) return fail("Scope times were built against an unknown header version.");
+
+	evsim_scope_times filled{};
+	filled.size = sizeof(evsim_scope_times);
+	filled.compiled_in = ScopeTimers::isCompiledIn() ? 1 : 0;
+
+	std::array<ScopeTime, TimedScopeCount> scopes = ScopeTimers::times();
+	filled.num_scopes = static_cast<uint32_t>(std::min<std::size_t>(scopes.size(), EVSIM_TIMED_SCOPES));
+
+	for (std::size_t i = 0; i < filled.num_scopes; ++i) {
+		std::strncpy(filled.scopes[i].name, scopes[i].scope, EVSIM_NAME_LENGTH - 1);
+		filled.scopes[i].calls = scopes[i].calls;
+		filled.scopes[i].total_seconds = scopes[i].totalSeconds;
+		filled.scopes[i].self_seconds = scopes[i].selfSeconds;
+	}
+
+	std::memcpy(times, &filled, sizeof(filled));
+	return 0;
+}
+
+
+void evsim_reset_scope_times(void) {
+	ScopeTimers::reset();
+}
+
+
+size_t evsim_format_scope_report(char* buffer, size_t capacity) {
+	// Same contract as evsim_format_report()
+	try {
+		std::ostringstream report;
+		ScopeTimers::printReport(report);
+
+		std::string text = report.str();
+		if (buffer != nullptr && capacity > 0) {
+			std::size_t length = std::min(text.size(), capacity - 1);
+			std::memcpy(buffer, text.data(), length);
+			buffer[length] = '\0';
+		}
+
+		return text.size();
+	}
+	catch (const std::exception& exception) {
+		fail(exception.what());
+		return 0;
+	}
+}
+
+
+/* ----------------- Benchmarks ----------------- */
+
+int evsim_benchmark_scaling(const evsim_config* config, double seconds, uint32_t max_workers) {
+	try {
+		validate(config);
+		return Benchmark::runParallelScaling(loadCatalog(config->catalog_path), scenarioOf(*config, seconds), max_workers);
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_benchmark_batch(const evsim_config* config, double seconds, uint32_t runs) {
+	try {
+		validate(config);
+		return Benchmark::runConcurrentBatch(loadCatalog(config->catalog_path), scenarioOf(*config, seconds), runs);
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_benchmark_metrics(const evsim_config* config, double seconds, uint32_t passes) {
+	try {
+		validate(config);
+		return Benchmark::runSessionMetrics(loadCatalog(config->catalog_path), scenarioOf(*config, seconds), passes);
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_benchmark_replay(const evsim_config* config, const char* trace_path, double acceleration) {
+	if (trace_path == nullptr) return fail("Trace path is null.");
+
+	try {
+		validate(config);
+		if (!(acceleration >= 0.0)) throw std::invalid_argument("Acceleration must not be negative.");
+
+		std::shared_ptr<const FleetCatalog> catalog = loadCatalog(config->catalog_path);
+		return Benchmark::runChargingReplay(catalog, scenarioOf(*config, 0.0), ChargingTrace::load(trace_path, *catalog), acceleration);
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+int evsim_generate_trace(const evsim_config* config, const char* path, uint32_t arrivals, double arrivals_per_hour) {
+	if (path == nullptr) return fail("Trace path is null.");
+
+	try {
+		validate(config);
+		if (arrivals == 0) throw std::invalid_argument("A trace needs at least one arrival.");
+
+		// By default the chargers are loaded to 90% of what they can serve, busy but not overrun
+		std::shared_ptr<const FleetCatalog> catalog = loadCatalog(config->catalog_path);
+		double rate = (arrivals_per_hour > 0.0) ? arrivals_per_hour : 0.9 * ChargingTrace::capacityPerHour(*catalog, config->chargers);
+
+		ChargingTrace::write(path, ChargingTrace::synthesize(*catalog, arrivals, rate, config->has_seed ? config->seed : 1), *catalog);
+		return 0;
+	}
+	catch (const std::exception& exception) {
+		return fail(exception.what());
+	}
+}
+
+
+const char* evsim_last_error(void) {
+	return lastError.c_str();
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* C interface of the simulator library.
+*
+* Tools that run many scenarios link against the library and drive simulations in-process instead of
+* launching SimpleSimulator and reading its output files:
+*
+*     evsim_config config;
+*     evsim_default_config(&config);
+*     config.aircraft = 50;
+*
+*     evsim_simulation* simulation = evsim_create(&config);
+*     evsim_run_for(simulation, 24.0 * 3600.0);
+*     evsim_stop(simulation);
+*
+*     evsim_results results;
+*     results.size = sizeof(results);
+*     evsim_get_results(simulation, &results);
+*     evsim_destroy(simulation);
+*
+* Only plain C types cross the interface. Structs carry their own size as the first member, so fields
+* can be appended in later versions without breaking callers built against an older header. Functions
+* never throw; they report failure through their return value and evsim_last_error().
+*
+* Handles are independent of each other and may be used from different threads, one thread per handle
+* at a time. The log, data export, timeline, live statistics and result cache of a simulation belong to
+* its handle; only the thread placement, memory counters and timed scopes are process-wide.
+*
+* A sharded simulation is the exception. Its first evsim_run_for() forks the shard processes, and fork()
+* copies only the calling thread: a lock held by any other thread at that moment, in the allocator, a
+* stream or another simulation, would stay held forever in the shards. That call therefore fails while the
+* process runs another thread or another simulation that has started and not stopped. Threads of the
+* caller, threaded or parallel simulations and periodic reports start after it; the live statistics of the
+* sharded simulation itself only start once its shards are running.
+*/
+
+#if defined(EVSIM_SHARED) && defined(_WIN32)
+#if defined(EVSIM_BUILD)
+#define EVSIM_API __declspec(dllexport)
+#else
+#define EVSIM_API __declspec(dllimport)
+#endif
+#elif defined(EVSIM_SHARED)
+#define EVSIM_API __attribute__((visibility("default")))
+#else
+#define EVSIM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVSIM_ABI_VERSION 4				/* Incremented whenever an existing declaration changes */
+#define EVSIM_MAX_MANUFACTURERS 16		/* Manufacturers beyond this are not reported individually */
+#define EVSIM_NAME_LENGTH 32			/* Including the terminating null */
+#define EVSIM_MEMORY_SUBSYSTEMS 6		/* Subsystems reported by evsim_get_memory_usage() */
+#define EVSIM_TIMED_SCOPES 7			/* Scopes reported by evsim_get_scope_times() */
+#define EVSIM_LIVE_STATS_DEFAULT_NAME "/evtolsim_stats"	/* Segment LiveStatsViewer attaches to by default */
+
+typedef struct evsim_simulation evsim_simulation;	/* Opaque handle of one simulation */
+
+typedef enum evsim_mode {
+	EVSIM_MODE_THREADED = 0,			/* One OS thread per aircraft and per charger, in wall-clock time */
+	EVSIM_MODE_COOPERATIVE = 1,			/* Coroutines on a single-threaded scheduler, in simulated time */
+	EVSIM_MODE_PARALLEL = 2,			/* Coroutines partitioned across worker threads, in simulated time */
+	EVSIM_MODE_SHARDED = 3				/* Fleet split across forked processes on one Linux host, in simulated time */
+} evsim_mode;
+
+typedef enum evsim_export_format {
+	EVSIM_EXPORT_COLUMNAR = 0,			/* Typed column chunks */
+	EVSIM_EXPORT_CSV = 1				/* Comma-separated text */
+} evsim_export_format;
+
+typedef enum evsim_phase {
+	EVSIM_PHASE_IDLE = 0,				/* On the ground before take-off, or waiting for a trip */
+	EVSIM_PHASE_FLYING = 1,				/* In the air */
+	EVSIM_PHASE_QUEUED = 2,				/* Waiting for a charger */
+	EVSIM_PHASE_CHARGING = 3			/* At a charger */
+} evsim_phase;
+
+typedef struct evsim_config {
+	uint32_t size;						/* sizeof(evsim_config) */
+	int32_t mode;						/* One of evsim_mode */
+	const char* catalog_path;			/* Manufacturer json, compiled catalog or "builtin", loaded once per process and path */
+	uint32_t aircraft;					/* Aircraft in the fleet */
+	uint32_t chargers;					/* Chargers in the network */
+	uint32_t sites;						/* Vertiports the chargers are spread over */
+	uint32_t workers;					/* Worker threads of the parallel mode, or shard processes of the sharded mode */
+	uint64_t seed;						/* Seed of the fleet composition, used if has_seed is set */
+	int32_t has_seed;					/* Zero draws the fleet composition from a random device */
+	const char* live_stats_name;		/* Shared memory segment to publish live statistics to, or null */
+	double trips_per_hour;				/* Passenger trips requested per hour; zero flies every aircraft until depleted (cooperative mode only) */
+	double service_area_miles;			/* Side of the square area the trips are spread over */
+	double max_trip_wait_minutes;		/* Time a trip waits for an aircraft before it is dropped */
+	const char* log_directory;			/* Folder the log segments are written to, "Logs" if null; one simulation writes into a folder at a time */
+} evsim_config;
+
+typedef struct evsim_manufacturer_results {
+	char name[EVSIM_NAME_LENGTH];		/* Name of the manufacturer */
+	uint64_t flights;					/* Completed flight sessions */
+	uint64_t charges;					/* Completed charge sessions */
+	double air_time;					/* Airtime in seconds */
+	double miles;						/* Miles flown */
+	double passenger_miles;				/* Passenger miles flown */
+	double faults;						/* Expected faults given the manufacturer's fault rate */
+	double charge_time;					/* Time spent charging in seconds */
+} evsim_manufacturer_results;
+
+typedef struct evsim_results {
+	uint32_t size;						/* sizeof(evsim_results), set by the caller */
+	int32_t mode;						/* Mode the simulation runs in */
+	uint64_t events;					/* Events processed by the scheduler(s); zero in threaded mode */
+	uint64_t windows;					/* Lock-step windows executed by the last run in parallel or sharded mode */
+	double simulated_seconds;			/* Duration covered by all evsim_run_for() calls */
+	double wall_seconds;				/* Wall-clock time spent in evsim_run_for() */
+	uint32_t aircraft;					/* Aircraft in the fleet */
+	uint32_t stopped;					/* Non-zero once evsim_stop() has been called; totals are final */
+	uint64_t sessions;					/* Flight sessions completed across the fleet */
+	double air_time;					/* Airtime in seconds accumulated across the fleet */
+	uint32_t num_manufacturers;			/* Manufacturers in the catalog */
+	uint32_t num_reported;				/* Entries filled in manufacturers[] */
+	evsim_manufacturer_results manufacturers[EVSIM_MAX_MANUFACTURERS];
+	double startup_seconds;				/* Wall-clock time to build the fleet and get it ready to fly */
+	uint32_t cached;					/* Non-zero if served from the result cache; timings are those of the run that computed them */
+	uint64_t trips_requested;			/* Passenger trips requested; the trip fields are zero without demand */
+	uint64_t trips_served;				/* Trips matched with an aircraft */
+	uint64_t trips_expired;				/* Trips dropped after the maximum wait */
+	double trip_passenger_miles;		/* Passenger miles of the served trips */
+	double mean_trip_wait_seconds;		/* Mean wait from request to dispatch of the served trips */
+	uint64_t samples;					/* Frames of the fleet state sampled so far; zero without sampling */
+	uint64_t sample_bytes;				/* Bytes the encoded frames take */
+	uint64_t chargers_added;			/* Chargers added to the network while running */
+	uint64_t chargers_retired;			/* Chargers retired from the network while running */
+	uint64_t queue_drains;				/* Queues emptied after chargers were added to their vertiport */
+	double mean_drain_seconds;			/* Mean time from adding chargers to a vertiport until its queue was empty */
+	double max_drain_seconds;			/* Longest of those drains */
+	uint32_t chargers;					/* Chargers in the network now */
+} evsim_results;
+
+typedef struct evsim_memory_subsystem {
+	char name[EVSIM_NAME_LENGTH];		/* fleet, requests, chargers, logging, summaries or samples */
+	uint64_t current_bytes;				/* Bytes allocated and not yet released */
+	uint64_t peak_bytes;				/* Highest current_bytes seen */
+	uint64_t allocations;				/* Allocations made */
+	uint64_t releases;					/* Allocations released */
+} evsim_memory_subsystem;
+
+typedef struct evsim_memory_usage {
+	uint32_t size;						/* sizeof(evsim_memory_usage), set by the caller */
+	uint32_t num_subsystems;			/* Entries filled in subsystems[] */
+	uint64_t resident_bytes;			/* Current resident set of the process, 0 if unknown */
+	uint64_t peak_resident_bytes;		/* Peak resident set of the process, 0 if unknown */
+	evsim_memory_subsystem subsystems[EVSIM_MEMORY_SUBSYSTEMS];
+} evsim_memory_usage;
+
+typedef struct evsim_scope_time {
+	char name[EVSIM_NAME_LENGTH];		/* battery, requests, queues, charging, logging, summaries or waiting */
+	uint64_t calls;						/* Times the scope was entered */
+	double total_seconds;				/* Time from entering to leaving the scope */
+	double self_seconds;				/* Total less the time of the scopes opened inside it */
+} evsim_scope_time;
+
+typedef struct evsim_scope_times {
+	uint32_t size;						/* sizeof(evsim_scope_times), set by the caller */
+	uint32_t num_scopes;				/* Entries filled in scopes[] */
+	int32_t compiled_in;				/* Non-zero if the library was built with EVSIM_SCOPE_TIMERS defined */
+	evsim_scope_time scopes[EVSIM_TIMED_SCOPES];
+} evsim_scope_times;
+
+typedef struct evsim_sample_frame {
+	uint32_t size;						/* sizeof(evsim_sample_frame) */
+	uint32_t num_aircraft;				/* Entries in battery_levels and phases */
+	uint32_t num_sites;					/* Entries in busy_chargers and queued_requests */
+	double time_seconds;				/* Simulated time of the sample, from the start of the run */
+	const uint8_t* battery_levels;		/* Battery level in percent, per aircraft */
+	const uint8_t* phases;				/* One of evsim_phase, per aircraft */
+	const uint32_t* busy_chargers;		/* Chargers charging, per vertiport */
+	const uint32_t* queued_requests;	/* Requests waiting for a charger, per vertiport */
+} evsim_sample_frame;
+
+typedef int (*evsim_sample_visitor)(const evsim_sample_frame* frame, void* context);	/* Return non-zero to stop reading */
+
+typedef enum evsim_log_kind {
+	EVSIM_LOG_EVENT = 0,				/* Timestamped line of the aircraft or of the chargers serving it */
+	EVSIM_LOG_SESSION = 1				/* Summary of a completed flight session, as a JSON object */
+} evsim_log_kind;
+
+typedef struct evsim_log_record {
+	uint32_t size;						/* sizeof(evsim_log_record) */
+	int32_t kind;						/* One of evsim_log_kind */
+	const char* text;					/* Text of the record, not null-terminated */
+	size_t length;						/* Bytes of text */
+} evsim_log_record;
+
+typedef int (*evsim_log_visitor)(const evsim_log_record* record, void* context);	/* Return non-zero to stop reading */
+
+typedef struct evsim_capacity_step {
+	double hour_of_day;					/* Hours into the simulated day the step starts at, days counted from the start of the run */
+	uint32_t chargers;					/* Chargers of the network from then on */
+} evsim_capacity_step;
+
+typedef struct evsim_charger_pool {
+	uint32_t size;						/* sizeof(evsim_charger_pool) */
+	uint32_t num_steps;					/* Entries in steps */
+	const evsim_capacity_step* steps;	/* Capacity schedule in order of time, repeated every day; none keeps the initial chargers */
+	double scale_up_wait_minutes;		/* Expected wait at a vertiport that adds a charger there; 0 does not scale on load */
+	uint32_t max_chargers;				/* Chargers the network may scale up to on load */
+	double check_interval_minutes;		/* Simulated time between two checks of the queues when scaling on load */
+} evsim_charger_pool;
+
+
+/* ----------------- Simulations ----------------- */
+EVSIM_API uint32_t evsim_abi_version(void);												/* EVSIM_ABI_VERSION of the library */
+EVSIM_API void evsim_default_config(evsim_config* config);								/* Fill a config with the defaults of SimpleSimulator */
+EVSIM_API evsim_simulation* evsim_create(const evsim_config* config);					/* Create a simulation; null on failure */
+EVSIM_API int evsim_run_for(evsim_simulation* simulation, double seconds);				/* Advance the simulation; 0 on success */
+EVSIM_API int evsim_stop(evsim_simulation* simulation);									/* Stop all aircraft and chargers; 0 on success */
+EVSIM_API int evsim_get_results(const evsim_simulation* simulation, evsim_results* results);	/* Copy the results so far; 0 on success */
+EVSIM_API size_t evsim_format_report(evsim_simulation* simulation, char* buffer, size_t capacity);	/* End-of-run report as text; returns its full length */
+EVSIM_API void evsim_destroy(evsim_simulation* simulation);								/* Stop if needed and free the simulation */
+
+/* ----------------- Checkpoints ----------------- */
+/*
+* A checkpoint is a binary snapshot of a cooperative or parallel simulation between two evsim_run_for()
+* calls. A simulation restored from it continues exactly as the original would have, in either of these
+* modes and with any number of workers. The fleet, chargers and sites come from the snapshot; the restored
+* config only chooses the mode, workers, catalog and live statistics. Simulated time is counted from the
+* start of the original run.
+*/
+EVSIM_API int evsim_checkpoint(evsim_simulation* simulation, const char* path);							/* Write a snapshot of the simulation now; 0 on success */
+EVSIM_API int evsim_set_checkpoints(evsim_simulation* simulation, const char* path, double interval_seconds);	/* Write a snapshot every interval of simulated time while running, 0 to stop; 0 on success */
+EVSIM_API evsim_simulation* evsim_restore(const evsim_config* config, const char* path);					/* Create a simulation that continues from a snapshot; null on failure */
+
+/* ----------------- Samples ----------------- */
+/*
+* An event-driven simulation can sample the battery level and phase of every aircraft and the busy chargers
+* and queued requests of every vertiport at every multiple of an interval of simulated time. The samples
+* are kept delta-encoded and bit-packed in memory, and can be read back for any time range while the
+* simulation runs or after it has stopped, or written to a file and read from there. The arrays of a
+* frame are only valid during the call of the visitor.
+*/
+EVSIM_API int evsim_set_sampling(evsim_simulation* simulation, double interval_seconds);	/* Sample every interval of simulated time, 0 to stop; 0 on success */
+EVSIM_API int evsim_read_samples(const evsim_simulation* simulation, double from_seconds, double to_seconds,
+	evsim_sample_visitor visitor, void* context);										/* Visit the frames in a time range in order; 0 on success */
+EVSIM_API int evsim_write_samples(const evsim_simulation* simulation, const char* path);	/* Write all frames to a file; 0 on success */
+EVSIM_API int evsim_read_sample_file(const char* path, double from_seconds, double to_seconds,
+	evsim_sample_visitor visitor, void* context);										/* Visit the frames of a file in a time range; 0 on success */
+
+/* ----------------- Logs ----------------- */
+/*
+* With logging enabled, a simulation writes the records of all its aircraft into a few large segment files
+* in the log_directory of its config, however large the fleet. Every segment is indexed by aircraft when it
+* is sealed - once it is full, at a checkpoint and when the simulation stops - so the records of one
+* aircraft are read back without scanning those of the others. The text of a record is only valid during
+* the call of the visitor.
+*
+* A folder keeps the segments of every run written into it, and reading it returns the latest run; a
+* simulation restored from a checkpoint continues the run of the snapshot. While a simulation writes into
+* a folder, another simulation logging there fails its first evsim_run_for(), in this process or another.
+*/
+EVSIM_API int evsim_read_aircraft_log(const char* directory, uint32_t aircraft,
+	evsim_log_visitor visitor, void* context);											/* Visit the records of an aircraft in the latest run, in order of writing; 0 on success */
+
+/* ----------------- Charger pool ----------------- */
+/*
+* The chargers of a vertiport can be added and retired while a simulation runs, in every mode. An added
+* charger takes requests at once; a retired charger finishes the charge it is on and takes no further
+* ones, so no ticket is dropped. Every vertiport keeps at least one charger. An event-driven simulation
+* can also resize its pool on its own, on a daily schedule and on the expected wait at its vertiports;
+* the report then shows how long the queues took to empty after chargers were added. Either call starts
+* the simulation if it has not been run yet. A resized pool cannot be checkpointed.
+*/
+EVSIM_API int evsim_set_site_chargers(evsim_simulation* simulation, uint32_t site, uint32_t chargers);	/* Add or retire chargers until a vertiport has that many; 0 on success */
+EVSIM_API int evsim_set_charger_pool(evsim_simulation* simulation, const evsim_charger_pool* pool);	/* Resize the pool on a schedule and on load while running; 0 on success */
+
+/* ----------------- Outputs ----------------- */
+/*
+* Every simulation has outputs of its own, so simulations running side by side never share a file. A new
+* simulation logs; the benchmarks do not. The export and the timeline are started before the first
+* evsim_run_for() and finished by evsim_stop(), or earlier by their finish calls once the simulation has stopped.
+*/
+EVSIM_API int evsim_set_logging(evsim_simulation* simulation, int enabled);				/* Enable or disable the log of a simulation; 0 on success */
+EVSIM_API int evsim_export_start(evsim_simulation* simulation, const char* directory, int32_t format);	/* Export the sessions and tickets of a simulation; 0 on success */
+EVSIM_API int evsim_export_finish(evsim_simulation* simulation);						/* Flush and close the export; 0 on success */
+EVSIM_API int evsim_timeline_start(evsim_simulation* simulation, const char* path);	/* Record a Chrome trace-event timeline of a simulation; 0 on success */
+EVSIM_API int evsim_timeline_finish(evsim_simulation* simulation);						/* Flush and close the timeline; 0 on success */
+
+/*
+* With a result cache, an event-driven simulation with a seed stores its results and report in the cache
+* directory when it is stopped. A later simulation of the same configuration, manufacturer specs and
+* duration is served from the cache by evsim_run_for() without simulating, as long as it has no output
+* of its own: logging, export, timeline, live statistics and checkpoints all bypass the cache. A served
+* simulation that is run further is simulated from the start. Simulations may share a cache directory.
+*/
+EVSIM_API int evsim_set_result_cache(evsim_simulation* simulation, const char* directory);	/* Cache the results of a simulation in a directory, null to stop; 0 on success */
+
+/* ----------------- Process-wide settings ----------------- */
+
+/*
+* Core lists are written as cores and ranges, "0-7,16", or as a NUMA node, "node1". Chargers of a real-time
+* run use the first list; aircraft threads of a real-time run and workers of a parallel run use the second.
+* An empty or null list leaves those threads to the operating system. Set before creating simulations.
+*/
+EVSIM_API int evsim_set_thread_placement(const char* charger_cores, const char* worker_cores);	/* Pin threads to cores; 0 on success */
+EVSIM_API void evsim_set_placement_report(int enabled);									/* Record migrations of unpinned threads as well */
+EVSIM_API size_t evsim_format_placement_report(char* buffer, size_t capacity);			/* Core and migrations of every recorded thread; returns its full length */
+EVSIM_API int evsim_compile_catalog(const char* input_path, const char* output_path);	/* Validate a catalog and write it for memory-mapped loading; 0 on success */
+EVSIM_API int evsim_check_builtin_catalog(const char* path);							/* 0 if a catalog holds exactly the manufacturers compiled into the library */
+
+/* ----------------- Memory ----------------- */
+/*
+* Allocations of the containers that grow with a run are counted per subsystem, across all simulations of
+* the process. The counters can be read at any time, including while a simulation runs on another thread.
+*/
+EVSIM_API int evsim_get_memory_usage(evsim_memory_usage* usage);						/* Copy the memory counters and resident set; 0 on success */
+EVSIM_API size_t evsim_format_memory_report(char* buffer, size_t capacity);			/* Memory counters as text; returns its full length */
+
+/* ----------------- Timed scopes ----------------- */
+/*
+* A library built with EVSIM_SCOPE_TIMERS defined times the hot paths of the simulator - battery updates,
+* request creation, queue handling, charging, logging and session summaries - with the time-stamp counter.
+* Every scope reports its calls, its total time and its self time, which leaves out the scopes opened
+* inside it. The counters are process-wide, like the memory counters; without the define they stay zero.
+*/
+EVSIM_API int evsim_get_scope_times(evsim_scope_times* times);							/* Copy the counters of all scopes; 0 on success */
+EVSIM_API void evsim_reset_scope_times(void);											/* Zero the counters, e.g. between two runs */
+EVSIM_API size_t evsim_format_scope_report(char* buffer, size_t capacity);				/* Breakdown of the scopes as text; returns its full length */
+
+/* ----------------- Benchmarks ----------------- */
+EVSIM_API int evsim_benchmark_scaling(const evsim_config* config, double seconds, uint32_t max_workers);	/* Serial versus 1..N worker runs, printed to stdout */
+EVSIM_API int evsim_benchmark_batch(const evsim_config* config, double seconds, uint32_t runs);			/* Independent runs side by side, printed to stdout */
+EVSIM_API int evsim_benchmark_metrics(const evsim_config* config, double seconds, uint32_t passes);		/* Cost of the session summary per dispatch, printed to stdout */
+
+/*
+* A trace lists charging requests as "arrival_seconds,manufacturer,charge_seconds" lines. Replaying it feeds
+* the chargers and sites of the config directly, without flights, and reports the sustained requests/sec
+* and the queue latency. The tickets of a data export (tickets.csv or tickets.evcol) replay as a trace too.
+*/
+EVSIM_API int evsim_benchmark_replay(const evsim_config* config, const char* trace_path, double acceleration);	/* Replay a trace at acceleration x real time, 0 as fast as possible; printed to stdout */
+EVSIM_API int evsim_generate_trace(const evsim_config* config, const char* path, uint32_t arrivals, double arrivals_per_hour);	/* Write a Poisson trace from the seed; rate 0 loads the chargers to 90%; 0 on success */
+
+EVSIM_API const char* evsim_last_error(void);											/* Message of the last failure on the calling thread */
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,700 @@
+// SimulatorChecks.cpp : Checks that runs of the simulator are reproducible and that its files round-trip.
+
+#include "../SimulatorAPI.h"
+#include "../TimerWheel.h"
+#include "../FleetSampler.h"
+#include "../ResultCache.h"
+#include "../FleetCatalog.h"
+#include "../ChargingTrace.h"
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+
+
+/*
+* Usage: SimulatorChecks [check...]
+*
+* Runs every check, or only those named, and prints PASS or FAIL with the first difference found for
+* each. The exit code is the number of checks that failed, so the program can gate a build or a CI job.
+*
+* The checks drive the library the way a caller does and compare outcomes that must be identical: the
+* same seed in every event-driven mode, also when the rings between shards overflow, and a run restored
+* from a checkpoint with the run it was taken from. The encoded fleet samples must decode to exactly the
+* frames appended, in memory and through a file, and the result cache serves an entry only as it was
+* stored. A damaged columnar export is refused as a trace instead of being read past its end. The timer
+* wheel is checked against the clock for order, cancellation and idle spells.
+*
+* They use the manufacturers compiled into the library, which the build keeps equal to Manufacturer.json,
+* and write their files into a folder of the temporary directory that is removed at the end. The sharded
+* mode is checked on Linux hosts only.
+*/
+
+namespace {
+
+	using CheckFunction = std::function<void()>;
+
+	struct Check {
+		const char* name;						// Name to select the check by
+		CheckFunction run;						// Throws on the first difference
+	};
+
+	const std::filesystem::path WorkDirectory = std::filesystem::temp_directory_path() / "SimulatorChecks";
+
+#ifdef _WIN32
+	constexpr bool ShardedMode = false;
+#else
+	constexpr bool ShardedMode = true;
+#endif
+
+
+	void expect(bool condition, const std::string& message) {
+		if (!condition) throw std::runtime_error(message);
+	}
+
+
+	evsim_config configOf(evsim_mode mode, std::uint32_t workers, std::uint64_t seed) {
+		evsim_config config;
+		evsim_default_config(&config);
+
+		config.mode = mode;
+		config.workers = workers;
+		config.seed = seed;
+		config.has_seed = 1;
+		config.catalog_path = "builtin";
+		config.log_directory = nullptr;
+
+		return config;
+	}
+
+
+	std::string nameOf(const evsim_config& config) {
+		switch (config.mode) {
+		case EVSIM_MODE_COOPERATIVE: return "cooperative";
+		case EVSIM_MODE_PARALLEL: return "parallel with " + std::to_string(config.workers) + " workers";
+		case EVSIM_MODE_SHARDED: return "sharded over " + std::to_string(config.workers) + " shards";
+		default: return "threaded";
+		}
+	}
+
+
+	evsim_results resultsOf(evsim_simulation* simulation) {
+		evsim_results results;
+		results.size = sizeof(results);
+		expect(evsim_get_results(simulation, &results) == 0, evsim_last_error());
+
+		return results;
+	}
+
+
+	// Run a new simulation without outputs for a simulated duration and stop it
+	evsim_results run(const evsim_config& config, double seconds) {
+		evsim_simulation* simulation = evsim_create(&config);
+		expect(simulation != nullptr, std::string("Unable to create the simulation: ") + evsim_last_error());
+
+		bool ran = evsim_set_logging(simulation, 0) == 0 && evsim_run_for(simulation, seconds) == 0 && evsim_stop(simulation) == 0;
+		std::string error = ran ? "" : evsim_last_error();
+
+		evsim_results results{};
+		if (ran) results = resultsOf(simulation);
+		evsim_destroy(simulation);
+
+		expect(ran, nameOf(config) + " run failed: " + error);
+		return results;
+	}
+
+
+	// Outcome of two runs, everything but their timings and the way they were executed
+	void expectSameOutcome(const evsim_results& expected, const evsim_results& actual, const std::string& what) {
+		auto same = [&](bool equal, const char* field) {
+			expect(equal, what + " differs in " + field);
+		};
+
+		same(expected.events == actual.events, "events");
+		same(expected.simulated_seconds == actual.simulated_seconds, "simulated_seconds");
+		same(expected.aircraft == actual.aircraft, "aircraft");
+		same(expected.sessions == actual.sessions, "sessions");
+		same(expected.air_time == actual.air_time, "air_time");
+		same(expected.num_reported == actual.num_reported, "num_reported");
+		same(expected.chargers == actual.chargers, "chargers");
+
+		for (std::uint32_t i = 0; i < expected.num_reported && i < EVSIM_MAX_MANUFACTURERS; ++i) {
+			const evsim_manufacturer_results& left = expected.manufacturers[i];
+			const evsim_manufacturer_results& right = actual.manufacturers[i];
+			std::string manufacturer = std::string(" of ") + left.name;
+
+			same(std::strcmp(left.name, right.name) == 0, "the order of the manufacturers");
+			same(left.flights == right.flights, ("flights" + manufacturer).c_str());
+			same(left.charges == right.charges, ("charges" + manufacturer).c_str());
+			same(left.air_time == right.air_time, ("air_time" + manufacturer).c_str());
+			same(left.miles == right.miles, ("miles" + manufacturer).c_str());
+			same(left.passenger_miles == right.passenger_miles, ("passenger_miles" + manufacturer).c_str());
+			same(left.faults == right.faults, ("faults" + manufacturer).c_str());
+			same(left.charge_time == right.charge_time, ("charge_time" + manufacturer).c_str());
+		}
+	}
+
+
+	// Frames read through the C interface, copied out of the visitor
+	std::vector<FleetSample> samplesOf(const std::function<int(evsim_sample_visitor visitor, void* context)>& read) {
+		std::vector<FleetSample> samples;
+
+		evsim_sample_visitor collect = [](const evsim_sample_frame* frame, void* context) {
+			static_cast<std::vector<FleetSample>*>(context)->push_back(FleetSample{
+				static_cast<std::int64_t>(frame->time_seconds * 1e6 + 0.5),
+				std::vector<std::uint8_t>(frame->battery_levels, frame->battery_levels + frame->num_aircraft),
+				std::vector<std::uint8_t>(frame->phases, frame->phases + frame->num_aircraft),
+				std::vector<std::uint32_t>(frame->busy_chargers, frame->busy_chargers + frame->num_sites),
+				std::vector<std::uint32_t>(frame->queued_requests, frame->queued_requests + frame->num_sites) });
+			return 0;
+		};
+
+		expect(read(collect, &samples) == 0, std::string("Unable to read the samples: ") + evsim_last_error());
+		return samples;
+	}
+
+
+	void expectSameSamples(const std::vector<FleetSample>& expected, const std::vector<FleetSample>& actual, const std::string& what) {
+		expect(expected.size() == actual.size(), what + " has " + std::to_string(actual.size()) + " frames instead of " + std::to_string(expected.size()));
+
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			std::string frame = what + " differs in frame " + std::to_string(i) + ", ";
+
+			expect(expected[i].time == actual[i].time, frame + "time");
+			expect(expected[i].batteryLevels == actual[i].batteryLevels, frame + "battery levels");
+			expect(expected[i].phases == actual[i].phases, frame + "phases");
+			expect(expected[i].busyChargers == actual[i].busyChargers, frame + "busy chargers");
+			expect(expected[i].queuedRequests == actual[i].queuedRequests, frame + "queued requests");
+		}
+	}
+
+
+	/* ----------------- Checks ----------------- */
+
+	void checkModes() {
+		/*
+		* The parallel and sharded modes only distribute the events of the cooperative run, so every mode
+		* reaches the outcome of the cooperative run of the same seed. The totals of seed 7 with the default
+		* fleet of 20 aircraft over a day are pinned as well: a change that moves them changes the model.
+		*/
+
+		const double day = 24.0 * 3600.0;
+		evsim_results serial = run(configOf(EVSIM_MODE_COOPERATIVE, 1, 7), day);
+
+		expect(serial.events == 634 && serial.sessions == 146,
+			"Seed 7 gives events=" + std::to_string(serial.events) + " sessions=" + std::to_string(serial.sessions) + " instead of events=634 sessions=146");
+		expectSameOutcome(serial, run(configOf(EVSIM_MODE_COOPERATIVE, 1, 7), day), "A second cooperative run");
+
+		std::vector<evsim_config> configs = { configOf(EVSIM_MODE_PARALLEL, 1, 7), configOf(EVSIM_MODE_PARALLEL, 3, 7), configOf(EVSIM_MODE_PARALLEL, 8, 7) };
+		if (ShardedMode) {
+			configs.push_back(configOf(EVSIM_MODE_SHARDED, 1, 7));
+			configs.push_back(configOf(EVSIM_MODE_SHARDED, 3, 7));
+		}
+
+		for (const evsim_config& config : configs) expectSameOutcome(serial, run(config, day), "The " + nameOf(config) + " run");
+
+		// A larger network, where requests are routed between vertiports
+		evsim_config network = configOf(EVSIM_MODE_COOPERATIVE, 1, 11);
+		network.aircraft = 300;
+		network.chargers = 12;
+		network.sites = 4;
+		evsim_results networkSerial = run(network, 2.0 * day);
+
+		for (evsim_config config : configs) {
+			config.seed = network.seed;
+			config.aircraft = network.aircraft;
+			config.chargers = network.chargers;
+			config.sites = network.sites;
+			expectSameOutcome(networkSerial, run(config, 2.0 * day), "The " + nameOf(config) + " run over 4 vertiports");
+		}
+	}
+
+
+	void checkShardRings() {
+		/*
+		* The first window of a large fleet sends more messages each way than a ring holds: every aircraft
+		* asks the coordinator for a charger, and the coordinator releases half of its chargers to each shard.
+		* What does not fit stays in the outboxes until the other side drains the ring, and the run must
+		* still end exactly where the cooperative run does.
+		*/
+
+		if (!ShardedMode) return;
+
+		evsim_config fleet = configOf(EVSIM_MODE_COOPERATIVE, 1, 48);
+		fleet.aircraft = 20000;
+		fleet.chargers = 10000;
+		fleet.sites = 4;
+
+		evsim_config sharded = fleet;
+		sharded.mode = EVSIM_MODE_SHARDED;
+		sharded.workers = 2;
+
+		expectSameOutcome(run(fleet, 3600.0), run(sharded, 3600.0), "The " + nameOf(sharded) + " run of 20000 aircraft");
+	}
+
+
+	void checkCheckpoints() {
+		/*
+		* A run restored from a snapshot taken after a day must end the second day exactly where a run that
+		* was never interrupted does, restored into the mode it was taken in or into another one.
+		*/
+
+		const double day = 24.0 * 3600.0;
+		const std::string path = (WorkDirectory / "day.ckpt").string();
+
+		evsim_config original = configOf(EVSIM_MODE_COOPERATIVE, 1, 7);
+		original.aircraft = 60;
+		original.chargers = 6;
+		original.sites = 2;
+		evsim_results uninterrupted = run(original, 2.0 * day);
+
+		evsim_simulation* simulation = evsim_create(&original);
+		expect(simulation != nullptr, evsim_last_error());
+
+		bool written = evsim_set_logging(simulation, 0) == 0 && evsim_run_for(simulation, day) == 0 && evsim_checkpoint(simulation, path.c_str()) == 0;
+		std::string error = written ? "" : evsim_last_error();
+		evsim_destroy(simulation);
+		expect(written, "Unable to write the checkpoint: " + error);
+
+		for (const evsim_config& config : { configOf(EVSIM_MODE_COOPERATIVE, 1, 0), configOf(EVSIM_MODE_PARALLEL, 3, 0) }) {
+			evsim_config restoredConfig = config;
+			std::string logs = (WorkDirectory / "restored-logs").string();
+			restoredConfig.log_directory = logs.c_str();
+
+			simulation = evsim_restore(&restoredConfig, path.c_str());
+			expect(simulation != nullptr, "Unable to restore into the " + nameOf(config) + " mode: " + evsim_last_error());
+
+			bool ran = evsim_run_for(simulation, day) == 0 && evsim_stop(simulation) == 0;
+			error = ran ? "" : evsim_last_error();
+
+			evsim_results restored{};
+			if (ran) restored = resultsOf(simulation);
+			evsim_destroy(simulation);
+
+			expect(ran, "The restored " + nameOf(config) + " run failed: " + error);
+			expectSameOutcome(uninterrupted, restored, "The second day restored into the " + nameOf(config) + " mode");
+		}
+	}
+
+
+	void checkTimerWheel() {
+		/*
+		* Timers spread over the first three levels of a wheel with a tick of a microsecond, a third of them
+		* cancelled right after they were scheduled. A timer whose cancel succeeded never fires; every other
+		* timer fires once, never before its delay, and in order of its deadline up to the tick it falls in. The bounds on lateness are loose on purpose: they catch a wheel that
+		* stalls or steps through an idle spell, not a busy host.
+		*/
+
+		using Clock = TimerWheel::Clock;
+		const std::chrono::microseconds tick(1);
+		const std::size_t timers = 2000;
+		const Clock::duration lateness = std::chrono::milliseconds(250);
+
+		struct Fired {
+			std::size_t timer;
+			Clock::time_point at;
+		};
+
+		std::mutex firedMtx;
+		std::condition_variable allFired;
+		std::vector<Fired> fired;
+
+		// The wheel reads the clock inside schedule(), so the deadline of a timer is only known to a range
+		std::vector<Clock::time_point> earliest(timers);
+		std::vector<Clock::time_point> latest(timers);
+		std::vector<TimerWheel::TimerID> ids(timers);
+		std::vector<bool> cancelled(timers, false);
+		std::size_t expected = 0;
+
+		{
+			TimerWheel wheel(tick);
+			std::uint64_t state = 7;
+
+			for (std::size_t i = 0; i < timers; ++i) {
+				// Delays of up to 200 ms reach the third level, which starts at 65.5 ms with this tick
+				state = state * 6364136223846793005ull + 1442695040888963407ull;
+				Clock::duration delay = std::chrono::microseconds((state >> 33) % 200000);
+
+				earliest[i] = Clock::now() + delay;
+				ids[i] = wheel.schedule(delay, [&, i] {
+					std::lock_guard<std::mutex> lock(firedMtx);
+					fired.push_back(Fired{ i, Clock::now() });
+					allFired.notify_all();
+					});
+				latest[i] = Clock::now() + delay;
+
+				if (i % 3 == 0) {
+					// Only a timer that may have expired already can refuse to be cancelled
+					cancelled[i] = wheel.cancel(ids[i]);
+					expect(cancelled[i] || Clock::now() >= earliest[i], "Cancelling pending timer " + std::to_string(i) + " failed");
+				}
+				if (!cancelled[i]) ++expected;
+			}
+
+			std::unique_lock<std::mutex> lock(firedMtx);
+			expect(allFired.wait_for(lock, std::chrono::seconds(10), [&] { return fired.size() >= expected; }),
+				std::to_string(fired.size()) + " of " + std::to_string(expected) + " timers fired within 10 s");
+			lock.unlock();
+
+			expect(wheel.pending() == 0, std::to_string(wheel.pending()) + " timers are still pending");
+			for (std::size_t i = 0; i < timers; ++i) expect(!wheel.cancel(ids[i]), "Timer " + std::to_string(i) + " could be cancelled after it fired or was cancelled");
+
+			// After an idle spell the wheel follows the clock instead of stepping through every tick missed
+			std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+			Clock::time_point idleStart = Clock::now();
+			std::atomic<bool> stop{ false };
+			expect(wheel.sleepFor(std::chrono::milliseconds(2), stop), "A sleep on the wheel was cut short");
+			expect(Clock::now() - idleStart < std::chrono::milliseconds(2) + lateness, "The first timer after an idle spell fired late");
+		}
+
+		std::vector<bool> seen(timers, false);
+		Clock::time_point firedDeadline = Clock::time_point::min();
+
+		for (const Fired& timer : fired) {
+			std::string name = "Timer " + std::to_string(timer.timer);
+
+			expect(!cancelled[timer.timer], name + " fired although it was cancelled");
+			expect(!seen[timer.timer], name + " fired twice");
+			expect(timer.at >= earliest[timer.timer], name + " fired before its delay had elapsed");
+			expect(timer.at - latest[timer.timer] < lateness, name + " fired late");
+			expect(latest[timer.timer] + tick >= firedDeadline, name + " fired after a timer with a later deadline");
+
+			seen[timer.timer] = true;
+			firedDeadline = std::max(firedDeadline, earliest[timer.timer]);
+		}
+	}
+
+
+	void checkSampleCodec() {
+		/*
+		* Synthetic frames take the codec to its limits: groups with and without a change, a partial group,
+		* jumps across the whole range of every channel, and more frames than a keyframe interval. Every
+		* time range decodes to exactly the frames appended, before and after a round trip through a file.
+		* A sampled simulation then reads back the same frames from memory and from its file, in the
+		* cooperative and the parallel mode alike.
+		*/
+
+		const std::size_t aircraft = 300;
+		const std::size_t sites = 3;
+		const std::size_t frames = 3 * TimeSeriesStore::KeyframeInterval + 5;
+
+		TimeSeriesStore store(aircraft, sites, std::chrono::seconds(60));
+		std::vector<FleetSample> appended;
+		std::uint64_t state = 46;
+
+		auto next = [&state] {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			return state >> 33;
+		};
+
+		FleetSample sample{ 0, std::vector<std::uint8_t>(aircraft, 100), std::vector<std::uint8_t>(aircraft, 0),
+			std::vector<std::uint32_t>(sites, 0), std::vector<std::uint32_t>(sites, 0) };
+
+		for (std::size_t f = 0; f < frames; ++f) {
+			sample.time = static_cast<std::int64_t>(f) * 60000000;
+
+			if (f % 7 == 3) {
+				// Every channel jumps from one end of its range to the other
+				for (std::uint8_t& level : sample.batteryLevels) level = (level < 128) ? 255 : 0;
+				for (std::uint32_t& busy : sample.busyChargers) busy = (busy < 0x80000000u) ? 0xFFFFFFFFu : 0;
+				for (std::uint32_t& queued : sample.queuedRequests) queued = (queued < 0x80000000u) ? 0xFFFFFFFFu : 0;
+			}
+			else if (f % 5 != 0) {
+				// A few aircraft of the first groups change; the last, partial group is left alone
+				for (std::size_t i = 0; i < 256; i += 1 + next() % 9) {
+					sample.batteryLevels[i] = static_cast<std::uint8_t>(next() % 101);
+					sample.phases[i] = static_cast<std::uint8_t>(next() % 4);
+				}
+				for (std::uint32_t& busy : sample.busyChargers) busy = static_cast<std::uint32_t>(next() % 16);
+				sample.queuedRequests[next() % sites] += static_cast<std::uint32_t>(next() % 1000);
+			}
+
+			store.append(sample);
+			appended.push_back(sample);
+		}
+
+		auto decoded = [](const TimeSeriesStore& from, std::int64_t first, std::int64_t last) {
+			std::vector<FleetSample> samples;
+			from.decode(first, last, [&](const FleetSample& frame) { samples.push_back(frame); return true; });
+			return samples;
+		};
+
+		auto slice = [&](std::size_t first, std::size_t last) {
+			return std::vector<FleetSample>(appended.begin() + static_cast<std::ptrdiff_t>(first), appended.begin() + static_cast<std::ptrdiff_t>(last) + 1);
+		};
+
+		const std::string path = (WorkDirectory / "codec.evts").string();
+		store.write(path);
+		TimeSeriesStore loaded = TimeSeriesStore::load(path);
+
+		for (const TimeSeriesStore* source : { &store, &loaded }) {
+			std::string what = (source == &store) ? "The decoded store" : "The store loaded from its file";
+
+			expectSameSamples(appended, decoded(*source, appended.front().time, appended.back().time), what);
+			expectSameSamples(slice(70, 140), decoded(*source, appended[70].time, appended[140].time), what + " from frame 70 to 140");
+			expectSameSamples(slice(128, 128), decoded(*source, appended[128].time - 1, appended[128].time + 1), what + " around keyframe 128");
+			expectSameSamples(slice(frames - 1, frames - 1), decoded(*source, appended.back().time, appended.back().time), what + " at its last frame");
+		}
+
+		// Frames appended after loading are encoded against the last frame of the file
+		sample.time += 60000000;
+		std::fill(sample.batteryLevels.begin(), sample.batteryLevels.end(), std::uint8_t(42));
+		loaded.append(sample);
+		appended.push_back(sample);
+		expectSameSamples(appended, decoded(loaded, appended.front().time, appended.back().time), "The loaded store with another frame");
+
+		// Sampling a simulation
+		const std::string samplesPath = (WorkDirectory / "samples.evts").string();
+		std::vector<FleetSample> cooperative;
+
+		for (const evsim_config& mode : { configOf(EVSIM_MODE_COOPERATIVE, 1, 46), configOf(EVSIM_MODE_PARALLEL, 3, 46) }) {
+			evsim_config config = mode;
+			config.aircraft = 50;
+			config.chargers = 4;
+			config.sites = 2;
+
+			evsim_simulation* simulation = evsim_create(&config);
+			expect(simulation != nullptr, evsim_last_error());
+
+			bool ran = evsim_set_logging(simulation, 0) == 0 && evsim_set_sampling(simulation, 600.0) == 0
+				&& evsim_run_for(simulation, 24.0 * 3600.0) == 0 && evsim_stop(simulation) == 0 && evsim_write_samples(simulation, samplesPath.c_str()) == 0;
+			std::string error = ran ? "" : evsim_last_error();
+
+			std::vector<FleetSample> inMemory, inRange;
+			if (ran) {
+				inMemory = samplesOf([&](evsim_sample_visitor visitor, void* context) { return evsim_read_samples(simulation, 0.0, 1e12, visitor, context); });
+				inRange = samplesOf([&](evsim_sample_visitor visitor, void* context) { return evsim_read_samples(simulation, 5.0 * 3600.0, 7.0 * 3600.0, visitor, context); });
+			}
+			evsim_destroy(simulation);
+			expect(ran, "The sampled " + nameOf(config) + " run failed: " + error);
+
+			std::vector<FleetSample> inFile = samplesOf([&](evsim_sample_visitor visitor, void* context) {
+				return evsim_read_sample_file(samplesPath.c_str(), 0.0, 1e12, visitor, context);
+				});
+
+			expect(inMemory.size() == 145, "A day sampled every 10 minutes gives " + std::to_string(inMemory.size()) + " frames instead of 145");
+			expectSameSamples(inMemory, inFile, "The sample file of the " + nameOf(config) + " run");
+			expectSameSamples(std::vector<FleetSample>(inMemory.begin() + 30, inMemory.begin() + 43), inRange, "Hours 5 to 7 of the " + nameOf(config) + " run");
+
+			if (cooperative.empty()) cooperative = inMemory;
+			else expectSameSamples(cooperative, inMemory, "The samples of the " + nameOf(config) + " run");
+		}
+	}
+
+
+	void checkResultCache() {
+		/*
+		* An entry is served with the bytes it was stored with, and only for its own key and size. Damage to
+		* any part of the file, from the magic to the last byte of the report, and a truncated file are misses.
+		* Through the C interface, a repeated run is served with the outcome of the run that computed it, a
+		* damaged entry is simulated again and replaced, and a served simulation that is run further ends
+		* where a run that was never cached does.
+		*/
+
+		const ResultCache cache(WorkDirectory / "cache");
+		const ResultKey key{ 0x0123456789ABCDEFull, 44, 86400000000, EVSIM_MODE_PARALLEL, 3, 60, 6, 2, 1, 12.0, 25.0, 15.0 };
+		const std::string report = "Report of the cached run\n";
+
+		std::vector<double> results(16);
+		for (std::size_t i = 0; i < results.size(); ++i) results[i] = 1.0 / static_cast<double>(i + 3);
+		const std::size_t resultsSize = results.size() * sizeof(double);
+
+		auto served = [&](const ResultKey& lookupKey, std::size_t size) {
+			std::vector<double> copy(results.size(), 0.0);
+			std::string copyReport;
+
+			if (!cache.lookup(lookupKey, copy.data(), size, copyReport)) return false;
+			expect(copy == results && copyReport == report, "An entry was served with other contents than it was stored with");
+			return true;
+		};
+
+		expect(!served(key, resultsSize), "An entry was served before it was stored");
+		cache.store(key, results.data(), resultsSize, report);
+		expect(served(key, resultsSize), "A stored entry was not served");
+
+		ResultKey otherSeed = key;
+		otherSeed.seed += 1;
+		ResultKey otherWorkers = key;
+		otherWorkers.workers = 1;
+		expect(!served(otherSeed, resultsSize) && !served(otherWorkers, resultsSize), "An entry was served for another key");
+		expect(!served(key, resultsSize - sizeof(double)), "An entry was served for another size of results");
+
+		const std::filesystem::path entry = cache.entryPath(key);
+		const std::uintmax_t entrySize = std::filesystem::file_size(entry);
+		const std::uintmax_t offsets[] = { 0, offsetof(ResultCacheHeader, version), offsetof(ResultCacheHeader, key) + offsetof(ResultKey, aircraft),
+			offsetof(ResultCacheHeader, checksum), sizeof(ResultCacheHeader) + 5, entrySize - 1 };
+
+		for (std::uintmax_t offset : offsets) {
+			cache.store(key, results.data(), resultsSize, report);
+
+			std::fstream file(entry, std::ios::in | std::ios::out | std::ios::binary);
+			file.seekg(static_cast<std::streamoff>(offset));
+			char byte = static_cast<char>(file.get());
+			file.seekp(static_cast<std::streamoff>(offset));
+			file.put(static_cast<char>(byte ^ 0x10));
+			file.close();
+
+			expect(!served(key, resultsSize), "An entry with byte " + std::to_string(offset) + " flipped was served");
+		}
+
+		cache.store(key, results.data(), resultsSize, report);
+		std::filesystem::resize_file(entry, entrySize - 1);
+		expect(!served(key, resultsSize), "A truncated entry was served");
+
+		// Through the C interface
+		const std::string directory = (WorkDirectory / "api-cache").string();
+		const double day = 24.0 * 3600.0;
+
+		evsim_config config = configOf(EVSIM_MODE_COOPERATIVE, 1, 44);
+		config.aircraft = 60;
+		config.chargers = 6;
+		config.sites = 2;
+
+		auto runCached = [&](double first, double second) {
+			evsim_simulation* simulation = evsim_create(&config);
+			expect(simulation != nullptr, evsim_last_error());
+
+			bool ran = evsim_set_logging(simulation, 0) == 0 && evsim_set_result_cache(simulation, directory.c_str()) == 0
+				&& evsim_run_for(simulation, first) == 0 && (second == 0.0 || evsim_run_for(simulation, second) == 0) && evsim_stop(simulation) == 0;
+			std::string error = ran ? "" : evsim_last_error();
+
+			evsim_results results{};
+			if (ran) results = resultsOf(simulation);
+			evsim_destroy(simulation);
+
+			expect(ran, "The cached run failed: " + error);
+			return results;
+		};
+
+		evsim_results computed = runCached(day, 0.0);
+		evsim_results repeated = runCached(day, 0.0);
+		expect(!computed.cached && repeated.cached, "A repeated run was not served from the cache");
+		expectSameOutcome(computed, repeated, "The run served from the cache");
+
+		for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(directory)) {
+			std::filesystem::resize_file(file.path(), file.file_size() / 2);
+		}
+
+		evsim_results recomputed = runCached(day, 0.0);
+		expect(!recomputed.cached && runCached(day, 0.0).cached, "A damaged entry was not simulated again and replaced");
+		expectSameOutcome(computed, recomputed, "The run simulated again over a damaged entry");
+
+		evsim_results continued = runCached(day, day);
+		expect(!continued.cached, "A served simulation that was run further reports itself as cached");
+		expectSameOutcome(run(config, 2.0 * day), continued, "A served simulation run for a second day");
+	}
+
+
+	void checkTraceFiles() {
+		/*
+		* The tickets of a columnar export replay as a charging trace, read in place from the mapped file.
+		* Cut at any point, or with a chunk claiming more rows than it holds, the file must be refused before
+		* a column is read, never read past its end.
+		*/
+
+		const std::string directory = (WorkDirectory / "export").string();
+
+		evsim_config config = configOf(EVSIM_MODE_COOPERATIVE, 1, 40);
+		config.aircraft = 60;
+		config.chargers = 6;
+		config.sites = 2;
+
+		evsim_simulation* simulation = evsim_create(&config);
+		expect(simulation != nullptr, evsim_last_error());
+
+		bool exported = evsim_set_logging(simulation, 0) == 0 && evsim_export_start(simulation, directory.c_str(), EVSIM_EXPORT_COLUMNAR) == 0
+			&& evsim_run_for(simulation, 24.0 * 3600.0) == 0 && evsim_stop(simulation) == 0 && evsim_export_finish(simulation) == 0;
+		std::string error = exported ? "" : evsim_last_error();
+		evsim_destroy(simulation);
+		expect(exported, "Unable to export the tickets: " + error);
+
+		const std::shared_ptr<const FleetCatalog> catalog = FleetCatalog::builtin();
+		const std::filesystem::path tickets = std::filesystem::path(directory) / "tickets.evcol";
+		const std::filesystem::path damaged = WorkDirectory / "damaged.evcol";
+
+		expect(!ChargingTrace::load(tickets, *catalog).empty(), "The exported tickets hold no arrivals");
+
+		std::ifstream input(tickets, std::ios::binary);
+		const std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		input.close();
+
+		auto refused = [&](const std::vector<char>& contents) {
+			std::ofstream(damaged, std::ios::binary | std::ios::trunc).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+			try {
+				ChargingTrace::load(damaged, *catalog);
+			}
+			catch (const std::runtime_error&) {
+				return true;
+			}
+			return false;
+		};
+
+		const std::size_t firstChunk = 64 + 6 * 32;
+		for (std::size_t length : { std::size_t{ 40 }, std::size_t{ 64 + 3 * 32 }, firstChunk + 8, firstChunk + 200, bytes.size() - 1 }) {
+			expect(refused(std::vector<char>(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(length))),
+				"Tickets cut to " + std::to_string(length) + " of " + std::to_string(bytes.size()) + " bytes were read as a trace");
+		}
+
+		std::vector<char> inflated = bytes;
+		std::uint64_t rows;
+		std::memcpy(&rows, inflated.data() + firstChunk, sizeof(rows));
+		rows += 1000000;
+		std::memcpy(inflated.data() + firstChunk, &rows, sizeof(rows));
+		expect(refused(inflated), "A chunk claiming more rows than it holds was read as a trace");
+	}
+
+
+	const std::vector<Check> Checks = {
+		{ "modes", checkModes },
+		{ "shard-rings", checkShardRings },
+		{ "checkpoints", checkCheckpoints },
+		{ "sample-codec", checkSampleCodec },
+		{ "result-cache", checkResultCache },
+		{ "trace-files", checkTraceFiles },
+		{ "timer-wheel", checkTimerWheel }
+	};
+
+}
+
+
+int main(int argc, char* argv[]) {
+	std::vector<std::string> selected(argv + 1, argv + argc);
+	int failed = 0;
+
+	std::error_code ignored;
+	std::filesystem::remove_all(WorkDirectory, ignored);
+	std::filesystem::create_directories(WorkDirectory);
+
+	for (const Check& check : Checks) {
+		if (!selected.empty() && std::find(selected.begin(), selected.end(), check.name) == selected.end()) continue;
+
+		try {
+			check.run();
+			std::cout << "PASS  " << check.name << "\n";
+		}
+		catch (const std::exception& exception) {
+			++failed;
+			std::cout << "FAIL  " << check.name << ": " << exception.what() << "\n";
+		}
+	}
+
+	std::filesystem::remove_all(WorkDirectory, ignored);
+	return failed;
+}
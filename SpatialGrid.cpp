@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "SpatialGrid.h"
+
+
+SpatialGrid::SpatialGrid(double sideLength, std::size_t cellsPerSide) :
+	cellSize(sideLength / static_cast<double>(std::max<std::size_t>(cellsPerSide, 1))),
+	cellsPerSide(std::max<std::size_t>(cellsPerSide, 1)),
+	cells(this->cellsPerSide * this->cellsPerSide),
+	count(0)
+{
+	if (!(sideLength > 0.0)) throw std::invalid_argument("A spatial grid needs a positive side length.");
+}
+
+
+void SpatialGrid::insert(std::uint32_t id, double x, double y) {
+	if (id >= locations.size()) locations.resize(static_cast<std::size_t>(id) + 1, Location{ NoEntry, 0 });
+	if (locations[id].cell != NoEntry) throw std::logic_error("Point is already in the spatial grid.");
+
+	std::size_t cell = cellIndex(y) * cellsPerSide + cellIndex(x);
+	std::vector<Entry>& bucket = cells[cell];
+
+	locations[id] = Location{ static_cast<std::uint32_t>(cell), static_cast<std::uint32_t>(bucket.size()) };
+	bucket.push_back(Entry{ x, y, id });
+	++count;
+}
+
+
+void SpatialGrid::erase(std::uint32_t id) {
+	if (!contains(id)) return;
+
+	// The last point of the bucket takes the place of the erased one
+	Location location = locations[id];
+	std::vector<Entry>& bucket = cells[location.cell];
+
+	bucket[location.slot] = bucket.back();
+	locations[bucket[location.slot].id].slot = location.slot;
+	bucket.pop_back();
+
+	locations[id].cell = NoEntry;
+	--count;
+}
+
+
+bool SpatialGrid::contains(std::uint32_t id) const {
+	return id < locations.size() && locations[id].cell != NoEntry;
+}
+
+
+std::size_t SpatialGrid::size() const {
+	return count;
+}
+
+
+std::size_t SpatialGrid::cellsFor(std::size_t expectedPoints) {
+	std::size_t side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(expectedPoints))));
+	return std::clamp<std::size_t>(side, 1, 1024);
+}
+
+
+std::size_t SpatialGrid::cellIndex(double coordinate) const {
+	double index = std::floor(coordinate / cellSize);
+	if (!(index > 0.0)) return 0;
+
+	return std::min(static_cast<std::size_t>(index), cellsPerSide - 1);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+* Uniform grid over a square area for nearest-neighbour queries on a changing set of points.
+*
+* Points are identified by small dense IDs (aircraft positions, trip slots) and kept in the bucket of
+* their cell; a per-ID back reference makes insert and erase O(1). A query searches rings of cells
+* around the query point outward and stops once the next ring cannot hold anything closer than the
+* best match so far, so with the grid sized to about one point per cell a query touches a handful of
+* cells however many points there are.
+*
+* The acceptance test is given the ID and the distance of a candidate, so a query can skip points that
+* are close but unusable (an aircraft without enough battery, a trip with too many passengers). A query
+* that finds nothing acceptable ends at the ring beyond its maximum distance rather than at the edge of
+* the grid.
+*/
+
+class SpatialGrid {
+public:
+	static constexpr std::uint32_t NoEntry = std::numeric_limits<std::uint32_t>::max();
+
+	SpatialGrid(double sideLength, std::size_t cellsPerSide);		// Grid over [0, sideLength) in both directions
+
+	void insert(std::uint32_t id, double x, double y);				// Add a point; the ID must not be in the grid
+	void erase(std::uint32_t id);									// Remove a point if it is in the grid
+	bool contains(std::uint32_t id) const;							// Check if a point is in the grid
+	std::size_t size() const;										// Number of points in the grid
+
+	// Closest point within maxDistance accepted by accept(id, distance), NoEntry if there is none
+	template <typename Accept>
+	std::uint32_t nearest(double x, double y, double maxDistance, Accept&& accept) const;
+
+	static std::size_t cellsFor(std::size_t expectedPoints);		// Cells per side for about one point per cell
+
+private:
+	struct Entry {
+		double x;									// Position of the point
+		double y;
+		std::uint32_t id;							// ID of the point
+	};
+
+	struct Location {
+		std::uint32_t cell;							// Cell holding the point, NoEntry if absent
+		std::uint32_t slot;							// Position of the point in the bucket of its cell
+	};
+
+	std::size_t cellIndex(double coordinate) const;	// Column or row of a coordinate, clamped to the grid
+
+	double cellSize;								// Side length of a cell
+	std::size_t cellsPerSide;						// Cells along each side
+	std::vector<std::vector<Entry>> cells;			// Points per cell, row by row
+	std::vector<Location> locations;				// Cell and slot of every ID
+	std::size_t count;								// Number of points in the grid
+};
+
+
+template <typename Accept>
+std::uint32_t SpatialGrid::nearest(double x, double y, double maxDistance, Accept&& accept) const {
+	/*
+	* A point in ring r + 1 lies at least r cells away from the query point, so once the best match is
+	* within r cells, or r cells lie beyond the maximum distance, no outer ring can improve on it.
+	*/
+
+	if (count == 0) return NoEntry;
+
+	const std::ptrdiff_t side = static_cast<std::ptrdiff_t>(cellsPerSide);
+	const std::ptrdiff_t cx = static_cast<std::ptrdiff_t>(cellIndex(x));
+	const std::ptrdiff_t cy = static_cast<std::ptrdiff_t>(cellIndex(y));
+
+	std::uint32_t best = NoEntry;
+	double bestDistance = std::nextafter(maxDistance, std::numeric_limits<double>::infinity());
+
+	for (std::ptrdiff_t r = 0; r < side; ++r) {
+		for (std::ptrdiff_t gy = cy - r; gy <= cy + r; ++gy) {
+			if (gy < 0 || gy >= side) continue;
+
+			// Rows at the top and bottom of the ring are scanned whole, the others only at both ends
+			std::ptrdiff_t step = (gy == cy - r || gy == cy + r) ? 1 : 2 * r;
+
+			for (std::ptrdiff_t gx = cx - r; gx <= cx + r; gx += step) {
+				if (gx < 0 || gx >= side) continue;
+
+				for (const Entry& entry : cells[static_cast<std::size_t>(gy * side + gx)]) {
+					double distance = std::hypot(entry.x - x, entry.y - y);
+					if (distance < bestDistance && accept(entry.id, distance)) {
+						best = entry.id;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+
+		if (bestDistance <= r * cellSize) break;
+	}
+
+	return best;
+}
@@ -0,0 +1,303 @@
+#include <cctype>
+#include <thread>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <exception>
+#include <stdexcept>
+
+#include "ThreadPlacement.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+
+namespace {
+	constexpr const char* RoleNames[] = { "charger", "aircraft", "worker" };
+	constexpr std::size_t MaxThreadsListed = 32;	// Threads listed individually per role; the rest are summed
+
+	std::size_t parseCore(const std::string& text, const std::string& spec) {
+		std::size_t length = 0;
+		std::size_t core = 0;
+
+		try {
+			core = std::stoul(text, &length);
+		}
+		catch (const std::exception&) {
+			length = 0;
+		}
+
+		if (text.empty() || length != text.size()) throw std::invalid_argument("Invalid core list '" + spec + "'");
+		return core;
+	}
+
+	std::vector<std::size_t> nodeCores(std::size_t node, const std::string& spec) {
+		std::vector<std::size_t> cores;
+
+#ifdef _WIN32
+		GROUP_AFFINITY affinity{};
+		if (node > 0xFFFF || !GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) {
+			throw std::invalid_argument("No NUMA node " + std::to_string(node) + " for '" + spec + "'");
+		}
+
+		for (std::size_t bit = 0; bit < 64; ++bit) {
+			if (affinity.Mask & (KAFFINITY(1) << bit)) cores.push_back(affinity.Group * 64 + bit);
+		}
+#else
+		std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!std::getline(cpulist, list) || list.empty()) throw std::invalid_argument("No NUMA node " + std::to_string(node) + " for '" + spec + "'");
+
+		cores = ThreadPlacement::parseCores(list);
+#endif
+
+		return cores;
+	}
+}
+
+
+std::vector<std::size_t> ThreadPlacement::chargerCores = {};
+std::vector<std::size_t> ThreadPlacement::workerCores = {};
+bool ThreadPlacement::reporting = false;
+
+std::mutex ThreadPlacement::recordsMtx;
+std::map<std::pair<ThreadRole, std::size_t>, ThreadPlacement::ThreadRecord> ThreadPlacement::records = {};
+
+
+void ThreadPlacement::configure(const std::string& chargerCores, const std::string& workerCores) {
+	// Both lists are parsed before either is applied, so an invalid list leaves the placement as it was
+	std::vector<std::size_t> chargers = ThreadPlacement::parseCores(chargerCores);
+	std::vector<std::size_t> workers = ThreadPlacement::parseCores(workerCores);
+
+	std::size_t numCores = std::thread::hardware_concurrency();
+	for (const std::vector<std::size_t>* cores : { &chargers, &workers }) {
+		for (std::size_t core : *cores) {
+			if (numCores > 0 && core >= numCores) throw std::invalid_argument("Core " + std::to_string(core) + " does not exist; this host has " + std::to_string(numCores));
+		}
+	}
+
+	ThreadPlacement::chargerCores = std::move(chargers);
+	ThreadPlacement::workerCores = std::move(workers);
+}
+
+
+void ThreadPlacement::setReporting(bool enabled) {
+	ThreadPlacement::reporting = enabled;
+}
+
+
+bool ThreadPlacement::isActive() {
+	return ThreadPlacement::reporting || !ThreadPlacement::chargerCores.empty() || !ThreadPlacement::workerCores.empty();
+}
+
+
+std::vector<std::size_t> ThreadPlacement::parseCores(const std::string& spec) {
+	std::vector<std::size_t> cores;
+	std::stringstream items(spec);
+	std::string item;
+
+	while (std::getline(items, item, ',')) {
+		while (!item.empty() && std::isspace(static_cast<unsigned char>(item.back()))) item.pop_back();
+		while (!item.empty() && std::isspace(static_cast<unsigned char>(item.front()))) item.erase(item.begin());
+		if (item.empty()) continue;
+
+		if (item.rfind("node", 0) == 0) {
+			std::vector<std::size_t> node = nodeCores(parseCore(item.substr(4), spec), spec);
+			cores.insert(cores.end(), node.begin(), node.end());
+			continue;
+		}
+
+		std::size_t dash = item.find('-');
+		std::size_t first = parseCore(item.substr(0, dash), spec);
+		std::size_t last = (dash == std::string::npos) ? first : parseCore(item.substr(dash + 1), spec);
+		if (last < first) throw std::invalid_argument("Invalid core range '" + item + "' in '" + spec + "'");
+
+		for (std::size_t core = first; core <= last; ++core) cores.push_back(core);
+	}
+
+	return cores;
+}
+
+
+std::size_t ThreadPlacement::coreFor(ThreadRole role, std::size_t index) {
+	const std::vector<std::size_t>& cores = (role == ThreadRole::Charger) ? ThreadPlacement::chargerCores : ThreadPlacement::workerCores;
+	return cores.empty() ? ThreadPlacement::NoCore : cores[index % cores.size()];
+}
+
+
+void ThreadPlacement::onWorkers(std::size_t count, const std::function<void(std::size_t)>& work) {
+	if (ThreadPlacement::workerCores.empty()) {
+		for (std::size_t i = 0; i < count; ++i) work(i);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	std::vector<std::exception_ptr> failures(count);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		threads.emplace_back([&, i] {
+			try {
+				ThreadPlacement::pin(ThreadPlacement::coreFor(ThreadRole::Worker, i));
+				work(i);
+			}
+			catch (...) {
+				failures[i] = std::current_exception();
+			}
+			});
+	}
+
+	for (std::thread& thread : threads) thread.join();
+
+	for (const std::exception_ptr& failure : failures) {
+		if (failure) std::rethrow_exception(failure);
+	}
+}
+
+
+void ThreadPlacement::printReport(std::ostream& out) {
+	std::lock_guard<std::mutex> lock(ThreadPlacement::recordsMtx);
+
+	out << std::left << std::setw(10) << "Thread" << std::right << std::setw(8) << "Index" << std::setw(8) << "Core"
+		<< std::setw(10) << "Last CPU" << std::setw(8) << "Runs" << std::setw(12) << "Migrations" << "\n";
+
+	std::size_t listed = 0;
+	std::size_t folded = 0;
+	std::uint64_t foldedMigrations = 0;
+	ThreadRole previous = ThreadRole::Charger;
+
+	auto flushFolded = [&](ThreadRole role) {
+		if (folded == 0) return;
+		out << std::left << std::setw(10) << RoleNames[static_cast<std::size_t>(role)] << std::right << std::setw(8)
+			<< ("+" + std::to_string(folded)) << std::setw(8) << "" << std::setw(10) << "" << std::setw(8) << "" << std::setw(12) << foldedMigrations << "\n";
+		folded = 0;
+		foldedMigrations = 0;
+	};
+
+	for (const std::pair<const std::pair<ThreadRole, std::size_t>, ThreadRecord>& entry : ThreadPlacement::records) {
+		ThreadRole role = entry.first.first;
+		const ThreadRecord& record = entry.second;
+
+		if (role != previous) {
+			flushFolded(previous);
+			listed = 0;
+			previous = role;
+		}
+
+		if (listed++ >= MaxThreadsListed) {
+			++folded;
+			foldedMigrations += record.migrations;
+			continue;
+		}
+
+		out << std::left << std::setw(10) << RoleNames[static_cast<std::size_t>(role)] << std::right << std::setw(8) << entry.first.second
+			<< std::setw(8) << (record.core == ThreadPlacement::NoCore ? std::string("-") : std::to_string(record.core))
+			<< std::setw(10) << record.lastCpu << std::setw(8) << record.runs << std::setw(12) << record.migrations << "\n";
+	}
+
+	flushFolded(previous);
+}
+
+
+bool ThreadPlacement::pin(std::size_t core) {
+	if (core == ThreadPlacement::NoCore) return false;
+
+#ifdef _WIN32
+	GROUP_AFFINITY affinity{};
+	affinity.Group = static_cast<WORD>(core / 64);
+	affinity.Mask = KAFFINITY(1) << (core % 64);
+	if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) throw std::runtime_error("Unable to pin a thread to core " + std::to_string(core));
+#else
+	if (core >= CPU_SETSIZE) throw std::runtime_error("Core " + std::to_string(core) + " is out of range");
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) throw std::runtime_error("Unable to pin a thread to core " + std::to_string(core));
+#endif
+
+	return true;
+}
+
+
+std::size_t ThreadPlacement::currentCpu() {
+#ifdef _WIN32
+	PROCESSOR_NUMBER processor{};
+	GetCurrentProcessorNumberEx(&processor);
+	return static_cast<std::size_t>(processor.Group) * 64 + processor.Number;
+#else
+	int cpu = sched_getcpu();
+	return cpu < 0 ? ThreadPlacement::NoCore : static_cast<std::size_t>(cpu);
+#endif
+}
+
+
+std::int64_t ThreadPlacement::migrationCount() {
+#ifdef _WIN32
+	return -1;
+#else
+	// Kept by the scheduler per thread: "se.nr_migrations    :    12"
+	std::ifstream sched("/proc/thread-self/sched");
+	std::string line;
+
+	while (std::getline(sched, line)) {
+		if (line.rfind("se.nr_migrations", 0) != 0) continue;
+
+		std::size_t colon = line.find(':');
+		if (colon == std::string::npos) return -1;
+		return std::stoll(line.substr(colon + 1));
+	}
+
+	return -1;
+#endif
+}
+
+
+/* ----------------- Scope ----------------- */
+
+ThreadPlacement::Scope::Scope(ThreadRole role, std::size_t index) :
+	role(role),
+	index(index),
+	core(ThreadPlacement::coreFor(role, index)),
+	active(ThreadPlacement::isActive()),
+	startCpu(ThreadPlacement::NoCore),
+	startMigrations(-1)
+{
+	if (!active) return;
+
+	try {
+		ThreadPlacement::pin(core);
+	}
+	catch (const std::exception&) {
+		// A thread that cannot be placed still runs, and shows up unpinned in the report
+		core = ThreadPlacement::NoCore;
+	}
+
+	startCpu = ThreadPlacement::currentCpu();
+	startMigrations = ThreadPlacement::migrationCount();
+}
+
+
+ThreadPlacement::Scope::~Scope() {
+	if (!active) return;
+
+	std::size_t endCpu = ThreadPlacement::currentCpu();
+	std::int64_t endMigrations = ThreadPlacement::migrationCount();
+
+	std::uint64_t migrations = (startMigrations >= 0 && endMigrations >= startMigrations)
+		? static_cast<std::uint64_t>(endMigrations - startMigrations)
+		: (endCpu != startCpu ? 1 : 0);
+
+	std::lock_guard<std::mutex> lock(ThreadPlacement::recordsMtx);
+
+	ThreadRecord& record = ThreadPlacement::records[{ role, index }];
+	record.core = core;
+	record.lastCpu = endCpu;
+	record.migrations += migrations;
+	++record.runs;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <iosfwd>
+#include <functional>
+
+
+/*
+* Placement of the simulation threads on cores.
+*
+* Two core lists are configured process-wide, one for the chargers and one for the simulation workers
+* (the aircraft threads of a real-time run and the partition workers of a parallel run). Thread i of a
+* role runs on core i modulo the length of its list. A list is written as cores and ranges, "0-7,16",
+* or as a NUMA node, "node1", which stands for the cores of that node.
+*
+* The partitions of a parallel run are built and their aircraft spawned on the worker that will run
+* them, so the schedulers and coroutine frames are first touched on the node of that worker.
+*
+* Every placed thread counts its core migrations, which the report lists at exit to confirm the
+* placement held. Where the platform keeps no migration counter, a change of core between the start
+* and the end of the thread counts as one.
+*/
+
+enum class ThreadRole : std::size_t {
+	Charger,				// Charger threads of a real-time run
+	Aircraft,				// Aircraft threads of a real-time run, placed on the worker cores
+	Worker					// Partition workers of a parallel run
+};
+
+
+class ThreadPlacement {
+public:
+	static void configure(const std::string& chargerCores, const std::string& workerCores);	// Set the core lists, empty to leave a role unpinned
+	static void setReporting(bool enabled);						// Record migrations of unpinned threads as well
+	static bool isActive();										// Check if threads are pinned or their migrations recorded
+
+	static std::vector<std::size_t> parseCores(const std::string& spec);		// Expand a core list or NUMA node into cores
+	static std::size_t coreFor(ThreadRole role, std::size_t index);				// Core of a thread, NoCore if the role is unpinned
+
+	// Run work(0 .. count - 1), each call on a thread pinned like worker i; serially on the caller when workers are unpinned
+	static void onWorkers(std::size_t count, const std::function<void(std::size_t)>& work);
+
+	static void printReport(std::ostream& out);					// Print the placement and migrations of all recorded threads
+
+	static constexpr std::size_t NoCore = static_cast<std::size_t>(-1);
+
+	// Pins the calling thread for its lifetime and records its migrations when it ends
+	class Scope {
+	public:
+		Scope(ThreadRole role, std::size_t index);
+		~Scope();
+
+		Scope(const Scope& other) = delete;				// Copy constructor
+		Scope& operator=(const Scope& other) = delete;	// Copy assignment
+
+	private:
+		ThreadRole role;						// Role of the thread
+		std::size_t index;						// Position of the thread within its role
+		std::size_t core;						// Core the thread is pinned to, NoCore if unpinned
+		bool active;							// Flag to indicate that the thread is recorded
+		std::size_t startCpu;					// Core the thread started on
+		std::int64_t startMigrations;			// Migration counter at the start, -1 if unavailable
+	};
+
+private:
+	struct ThreadRecord {
+		std::size_t core;						// Core the thread is pinned to, NoCore if unpinned
+		std::size_t lastCpu;					// Core the thread ended on
+		std::uint64_t migrations;				// Migrations over all runs of the thread
+		std::uint64_t runs;						// Times a thread of this role and index ran
+	};
+
+	static bool pin(std::size_t core);					// Pin the calling thread to a core
+	static std::size_t currentCpu();					// Core the calling thread runs on
+	static std::int64_t migrationCount();				// Migrations of the calling thread so far, -1 if unavailable
+
+	static std::vector<std::size_t> chargerCores;		// Cores of the charger threads
+	static std::vector<std::size_t> workerCores;		// Cores of the aircraft and worker threads
+	static bool reporting;								// Flag to record unpinned threads as well
+
+	static std::mutex recordsMtx;													// Mutex to control access to the records
+	static std::map<std::pair<ThreadRole, std::size_t>, ThreadRecord> records;	// Recorded threads by role and index
+};
@@ -0,0 +1,54 @@
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <functional>
+
+#include "ThreadSlots.h"
+
+
+namespace {
+
+	// Slots given back by exited threads, lowest first, and the next slot never handed out
+	struct SlotPool {
+		std::mutex poolMtx;
+		std::priority_queue<std::size_t, std::vector<std::size_t>, std::greater<std::size_t>> released;
+		std::size_t next = 0;
+	};
+
+	SlotPool& pool() {
+		// Never destroyed: threads may still exit and give their slot back after static destruction
+		static SlotPool* instance = new SlotPool();
+		return *instance;
+	}
+
+	struct ThreadSlot {
+		std::size_t slot;
+
+		ThreadSlot() {
+			SlotPool& shared = pool();
+			std::lock_guard<std::mutex> lock(shared.poolMtx);
+
+			if (shared.released.empty()) {
+				slot = shared.next++;
+			}
+			else {
+				slot = shared.released.top();
+				shared.released.pop();
+			}
+		}
+
+		~ThreadSlot() {
+			SlotPool& shared = pool();
+			std::lock_guard<std::mutex> lock(shared.poolMtx);
+			shared.released.push(slot);
+		}
+	};
+
+	thread_local ThreadSlot threadSlot;
+
+}
+
+
+std::size_t ThreadSlots::current() {
+	return threadSlot.slot;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+
+/*
+* Dense index of the calling thread, for registries that keep a shard per thread.
+*
+* A thread takes the lowest free slot the first time it asks for one and gives it back when it exits, so
+* the slots in use stay below the peak number of threads alive at once. A SlotTable maps a slot straight
+* to the shard of its thread: a lookup is two loads and never searches or locks.
+*
+* A slot given back is handed to the next thread that needs one, and that thread finds the shard the
+* previous owner left in the table. The previous owner has exited by then, so the shard has one writer
+* at a time and simply carries on with the counts of the thread before.
+*
+* ThreadBuffers keeps such a shard per thread for the subsystems that record from every thread, and
+* ChunkBuffers hands the records on one full chunk at a time. A buffer outlives its thread, so whatever a
+* finished thread left in it is still drained at the end of the run.
+*/
+
+class ThreadSlots {
+public:
+	static std::size_t current();							// Slot of the calling thread, taken on first use
+};
+
+
+template <typename T>
+class SlotTable {
+public:
+	SlotTable();											// Default constructor
+	~SlotTable();											// Frees the pages, not the items
+
+	SlotTable(const SlotTable& other) = delete;				// Copy constructor
+	SlotTable& operator=(const SlotTable& other) = delete;	// Copy assignment
+
+	T* find(std::size_t slot) const;						// Item of a slot, null if none was installed
+	void install(std::size_t slot, T* item);				// Set the item of a slot; only the thread holding the slot installs it
+
+private:
+	static constexpr std::size_t PageBits = 10;
+	static constexpr std::size_t PageSize = std::size_t{ 1 } << PageBits;
+	static constexpr std::size_t Pages = 1024;
+
+	std::atomic<std::atomic<T*>*> pages[Pages];				// Pages of slots, allocated when a slot in them is first installed
+};
+
+
+template <typename T>
+SlotTable<T>::SlotTable() {
+	for (std::atomic<std::atomic<T*>*>& page : pages) page.store(nullptr, std::memory_order_relaxed);
+}
+
+
+template <typename T>
+SlotTable<T>::~SlotTable() {
+	for (std::atomic<std::atomic<T*>*>& page : pages) delete[] page.load(std::memory_order_relaxed);
+}
+
+
+template <typename T>
+T* SlotTable<T>::find(std::size_t slot) const {
+	if ((slot >> PageBits) >= Pages) return nullptr;
+
+	std::atomic<T*>* page = pages[slot >> PageBits].load(std::memory_order_acquire);
+	return (page == nullptr) ? nullptr : page[slot & (PageSize - 1)].load(std::memory_order_acquire);
+}
+
+
+template <typename T>
+void SlotTable<T>::install(std::size_t slot, T* item) {
+	if ((slot >> PageBits) >= Pages) throw std::length_error("More threads are alive than a slot table holds.");
+
+	std::atomic<std::atomic<T*>*>& entry = pages[slot >> PageBits];
+	std::atomic<T*>* page = entry.load(std::memory_order_acquire);
+
+	if (page == nullptr) {
+		// Threads of the same page may race to allocate it; the loser frees its copy
+		std::atomic<T*>* created = new std::atomic<T*>[PageSize];
+		for (std::size_t i = 0; i < PageSize; ++i) created[i].store(nullptr, std::memory_order_relaxed);
+
+		if (entry.compare_exchange_strong(page, created, std::memory_order_acq_rel, std::memory_order_acquire)) page = created;
+		else delete[] created;
+	}
+
+	page[slot & (PageSize - 1)].store(item, std::memory_order_release);
+}
+
+
+template <typename T>
+class ThreadBuffers {
+public:
+	ThreadBuffers() = default;												// Default constructor
+
+	ThreadBuffers(const ThreadBuffers& other) = delete;						// Copy constructor
+	ThreadBuffers& operator=(const ThreadBuffers& other) = delete;			// Copy assignment
+
+	T& local();																// Buffer of the calling thread, created on first use
+
+	// Template function to call visit for the buffer of every thread that ever used one, with no buffer being created meanwhile
+	template <typename Visit>
+	void forEach(Visit&& visit);
+
+private:
+	std::mutex buffersMtx;													// Mutex to control access to the list of buffers
+	std::vector<std::unique_ptr<T>> buffers;								// Buffers of all threads, in order of creation
+	SlotTable<T> bufferSlots;												// Buffers by the slot of the thread that owns them
+};
+
+
+template <typename T>
+T& ThreadBuffers<T>::local() {
+	std::size_t slot = ThreadSlots::current();
+
+	T* buffer = bufferSlots.find(slot);
+	if (buffer != nullptr) return *buffer;
+
+	std::lock_guard<std::mutex> lock(buffersMtx);
+	buffers.emplace_back(std::make_unique<T>());
+	buffer = buffers.back().get();
+	bufferSlots.install(slot, buffer);
+
+	return *buffer;
+}
+
+
+template <typename T>
+template <typename Visit>
+void ThreadBuffers<T>::forEach(Visit&& visit) {
+	std::lock_guard<std::mutex> lock(buffersMtx);
+	for (std::unique_ptr<T>& buffer : buffers) visit(*buffer);
+}
+
+
+template <typename T>
+class ChunkBuffers {
+public:
+	explicit ChunkBuffers(std::size_t chunkSize);							// Hand records on in chunks of chunkSize
+
+	// Template function to append a record to the buffer of the calling thread and pass the buffer to write(records, count) once it is full
+	template <typename Write>
+	void record(const T& item, Write&& write);
+
+	// Template function to pass every buffer holding records to write(records, count); call once recording has stopped
+	template <typename Write>
+	void flush(Write&& write);
+
+private:
+	std::size_t chunkSize;													// Records a buffer holds before it is written
+	ThreadBuffers<std::vector<T>> buffers;									// Records not yet written, per thread
+};
+
+
+template <typename T>
+ChunkBuffers<T>::ChunkBuffers(std::size_t chunkSize) :
+	chunkSize(chunkSize)
+{
+}
+
+
+template <typename T>
+template <typename Write>
+void ChunkBuffers<T>::record(const T& item, Write&& write) {
+	std::vector<T>& buffer = buffers.local();
+	if (buffer.capacity() < chunkSize) buffer.reserve(chunkSize);
+
+	buffer.push_back(item);
+	if (buffer.size() < chunkSize) return;
+
+	write(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+
+template <typename T>
+template <typename Write>
+void ChunkBuffers<T>::flush(Write&& write) {
+	buffers.forEach([&write](std::vector<T>& buffer) {
+		if (buffer.empty()) return;
+
+		write(buffer.data(), buffer.size());
+		buffer.clear();
+		});
+}
@@ -0,0 +1,183 @@
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+#include "Timeline.h"
+
+
+namespace {
+	// Process IDs of the track groups; Perfetto lists the groups in this order
+	constexpr int ChargerGroup = 1;
+	constexpr int AircraftGroup = 2;
+	constexpr int VertiportGroup = 3;
+
+	constexpr const char* GroupNames[] = { "", "Chargers", "Aircraft", "Vertiports" };
+	constexpr const char* TrackNames[] = { "", "Charger ", "Aircraft ", "Vertiport " };
+
+	template <typename T>
+	void appendNumber(std::string& text, T value) {
+		std::array<char, 24> digits;
+		std::to_chars_result result = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+		text.append(digits.data(), result.ptr);
+	}
+
+	const char* phaseName(TimelinePhase phase) {
+		switch (phase) {
+		case TimelinePhase::Charge: return "Charge";
+		case TimelinePhase::Airborne: return "Airborne";
+		case TimelinePhase::Queued: return "Queued";
+		case TimelinePhase::Charging: return "Charging";
+		default: return "Queue depth";
+		}
+	}
+}
+
+
+/* ----------------- TimelineWriter ----------------- */
+
+TimelineWriter::TimelineWriter(const std::filesystem::path& path) :
+	file(path, std::ios::binary | std::ios::trunc),
+	named(VertiportGroup + 1)
+{
+	if (!file.is_open()) throw std::runtime_error("Unable to open timeline " + path.string());
+
+	text = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (int group = ChargerGroup; group <= VertiportGroup; ++group) {
+		text += (group == ChargerGroup) ? "\n" : ",\n";
+		text += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":";
+		appendNumber(text, group);
+		text += ",\"args\":{\"name\":\"";
+		text += GroupNames[group];
+		text += "\"}},\n{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":";
+		appendNumber(text, group);
+		text += ",\"args\":{\"sort_index\":";
+		appendNumber(text, group);
+		text += "}}";
+	}
+
+	file.write(text.data(), text.size());
+}
+
+
+void TimelineWriter::writeChunk(const TimelineEvent* events, std::size_t count) {
+	text.clear();
+
+	for (std::size_t i = 0; i < count; ++i) {
+		const TimelineEvent& event = events[i];
+
+		if (event.phase == TimelinePhase::QueueDepth) {
+			text += ",\n{\"name\":\"";
+			text += TrackNames[VertiportGroup];
+			appendNumber(text, event.track);
+			text += " queue\",\"ph\":\"C\",\"pid\":";
+			appendNumber(text, VertiportGroup);
+			text += ",\"ts\":";
+			appendNumber(text, event.time);
+			text += ",\"args\":{\"waiting\":";
+			appendNumber(text, event.value);
+			text += "}}";
+			continue;
+		}
+
+		int group = (event.phase == TimelinePhase::Charge) ? ChargerGroup : AircraftGroup;
+		nameTrack(group, event.track);
+
+		text += ",\n{\"name\":\"";
+		text += phaseName(event.phase);
+		text += "\",\"ph\":\"X\",\"pid\":";
+		appendNumber(text, group);
+		text += ",\"tid\":";
+		appendNumber(text, event.track);
+		text += ",\"ts\":";
+		appendNumber(text, event.time);
+		text += ",\"dur\":";
+		appendNumber(text, event.value);
+		text += ",\"args\":{";
+		if (group == ChargerGroup) {
+			text += "\"aircraft\":";
+			appendNumber(text, event.aircraft);
+			text += ",";
+		}
+		text += "\"manufacturer\":";
+		appendNumber(text, event.manufacturer);
+		text += "}}";
+	}
+
+	file.write(text.data(), text.size());
+}
+
+
+void TimelineWriter::close() {
+	if (!file.is_open()) return;
+
+	file << "\n]}\n";
+	file.close();
+}
+
+
+void TimelineWriter::nameTrack(int group, std::uint32_t track) {
+	// Tracks are numbered by their charger or aircraft, and sorted that way rather than by first event
+	std::vector<bool>& seen = named[group];
+	if (track < seen.size() && seen[track]) return;
+	if (track >= seen.size()) seen.resize(track + 1, false);
+	seen[track] = true;
+
+	text += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":";
+	appendNumber(text, group);
+	text += ",\"tid\":";
+	appendNumber(text, track);
+	text += ",\"args\":{\"name\":\"";
+	text += TrackNames[group];
+	appendNumber(text, track);
+	text += "\"}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":";
+	appendNumber(text, group);
+	text += ",\"tid\":";
+	appendNumber(text, track);
+	text += ",\"args\":{\"sort_index\":";
+	appendNumber(text, track);
+	text += "}}";
+}
+
+
+/* ----------------- Timeline ----------------- */
+
+Timeline::Timeline(const std::filesystem::path& path) :
+	events(Timeline::ChunkEvents),
+	finished(false)
+{
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+
+	writer = std::make_unique<TimelineWriter>(path);
+}
+
+
+void Timeline::finish() {
+	std::lock_guard<std::mutex> lock(finishMtx);
+	if (finished) return;
+
+	events.flush([this](const TimelineEvent* chunk, std::size_t count) { write(chunk, count); });
+
+	writer->close();
+	finished = true;
+}
+
+
+void Timeline::recordSpan(TimelinePhase phase, std::uint32_t track, std::int64_t start, std::int64_t end, std::uint32_t aircraft, std::uint16_t manufacturer) {
+	record({ start, end - start, track, aircraft, manufacturer, phase });
+}
+
+
+void Timeline::recordQueueDepth(std::uint32_t site, std::int64_t time, std::size_t depth) {
+	record({ time, static_cast<std::int64_t>(depth), site, 0, 0, TimelinePhase::QueueDepth });
+}
+
+
+void Timeline::record(const TimelineEvent& event) {
+	events.record(event, [this](const TimelineEvent* chunk, std::size_t count) { write(chunk, count); });
+}
+
+
+void Timeline::write(const TimelineEvent* chunk, std::size_t count) {
+	std::lock_guard<std::mutex> lock(writerMtx);
+	writer->writeChunk(chunk, count);
+}
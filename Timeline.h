@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+
+#include "ThreadSlots.h"
+
+
+/*
+* Timeline of a simulation in the Chrome trace-event JSON format, for chrome://tracing or ui.perfetto.dev.
+*
+* The timeline has three groups of tracks:
+*   - Chargers:    one track per charger, with a span for every charge it served;
+*   - Aircraft:    one track per aircraft, with its Airborne, Queued and Charging phases;
+*   - Vertiports:  one counter track per vertiport with the number of requests waiting for a charger.
+*
+* Like the data export, events are buffered per recording thread and formatted one chunk at a time,
+* so recording an event costs a branch and a store into the buffer of the calling thread. Every
+* simulation records its own timeline.
+*
+* Timestamps are microseconds since the Unix epoch (simulated time when running on a scheduler).
+*/
+
+enum class TimelinePhase : std::uint8_t {
+	Charge,					// Charger track: a charge from pickup to release
+	Airborne,				// Aircraft track: a flight session
+	Queued,					// Aircraft track: waiting in the queue of a vertiport
+	Charging,				// Aircraft track: connected to a charger
+	QueueDepth				// Vertiport counter: requests waiting for a charger
+};
+
+
+struct TimelineEvent {
+	std::int64_t time;						// Start of a span, or time of a counter sample
+	std::int64_t value;						// Duration of a span, or value of a counter sample
+	std::uint32_t track;					// Charger, aircraft or vertiport the event belongs to
+	std::uint32_t aircraft;					// Aircraft charged, on charger tracks
+	std::uint16_t manufacturer;				// Index of the manufacturer of the aircraft
+	TimelinePhase phase;					// Kind of event
+};
+
+
+class TimelineWriter {
+public:
+	explicit TimelineWriter(const std::filesystem::path& path);		// Open the file and write the group names
+
+	void writeChunk(const TimelineEvent* events, std::size_t count);	// Append a chunk of events
+	void close();														// Finish the JSON document
+
+private:
+	void nameTrack(int group, std::uint32_t track);		// Name a track and keep it in numeric order, the first time it is seen
+
+	std::ofstream file;							// Output file
+	std::string text;							// Scratch buffer for one formatted chunk
+	std::vector<std::vector<bool>> named;		// Tracks already named, per group
+};
+
+
+class Timeline {
+public:
+	explicit Timeline(const std::filesystem::path& path);		// Open the timeline; call before the simulation starts
+
+	Timeline(const Timeline& other) = delete;					// Copy constructor
+	Timeline& operator=(const Timeline& other) = delete;		// Copy assignment
+
+	void finish();												// Flush all buffered events and close the file
+	void recordSpan(TimelinePhase phase, std::uint32_t track, std::int64_t start, std::int64_t end,
+		std::uint32_t aircraft, std::uint16_t manufacturer);	// Record a span on a charger or aircraft track
+	void recordQueueDepth(std::uint32_t site, std::int64_t time, std::size_t depth);	// Record a sample of the queue of a vertiport
+
+	static constexpr std::size_t ChunkEvents = 8192;			// Events buffered per thread
+
+private:
+	void record(const TimelineEvent& event);					// Append an event to the buffer of the calling thread
+	void write(const TimelineEvent* chunk, std::size_t count);	// Write a chunk of events to the file
+
+	std::mutex writerMtx;										// Mutex to control access to the file
+	std::unique_ptr<TimelineWriter> writer;						// Output file
+
+	ChunkBuffers<TimelineEvent> events;							// Events not yet written, per thread
+	std::mutex finishMtx;										// Mutex to close the file once
+	bool finished;												// Flag to indicate that the file has been closed
+};
@@ -0,0 +1,295 @@
+#include <limits>
+#include <algorithm>
+
+#include "TimerWheel.h"
+
+
+TimerWheel::TimerWheel(std::chrono::microseconds tick) :
+	tick(std::chrono::duration_cast<Clock::duration>(tick)),
+	origin(Clock::now()),
+	stopping(false),
+	currentTick(0),
+	wakeTick(std::numeric_limits<std::uint64_t>::max()),
+	count(0),
+	freeList(None)
+{
+	std::fill(std::begin(heads), std::end(heads), None);
+	std::fill(std::begin(occupied), std::end(occupied), 0);
+
+	timerThread = std::thread(&TimerWheel::run, this);
+}
+
+
+TimerWheel::~TimerWheel() {
+	{
+		std::lock_guard<std::mutex> lock(wheelMtx);
+		stopping = true;
+	}
+	wakeup.notify_all();
+
+	if (timerThread.joinable()) timerThread.join();
+}
+
+
+TimerWheel::TimerID TimerWheel::schedule(Clock::duration delay, Callback callback) {
+	// Round up so that a timer never fires before its delay has elapsed
+	Clock::duration elapsed = Clock::now() + delay - origin;
+	std::uint64_t expiry = static_cast<std::uint64_t>(std::max<Clock::rep>(0, (elapsed + tick - Clock::duration(1)) / tick));
+
+	std::lock_guard<std::mutex> lock(wheelMtx);
+
+	// An empty wheel has nothing to cascade, so the first timer after an idle spell is placed from the present
+	if (count == 0) currentTick = std::max(currentTick, ticksAt(Clock::now()));
+
+	std::uint32_t index = acquire();
+	nodes[index].expiry = expiry;
+	nodes[index].callback = std::move(callback);
+	link(index);
+	++count;
+
+	if (expiry < wakeTick) wakeup.notify_one();
+
+	return TimerID{ index, nodes[index].generation };
+}
+
+
+bool TimerWheel::cancel(TimerID id) {
+	std::lock_guard<std::mutex> lock(wheelMtx);
+
+	if (id.index >= nodes.size()) return false;
+	if (nodes[id.index].generation != id.generation || nodes[id.index].bucket == None) return false;
+
+	unlink(id.index);
+	release(id.index);
+	--count;
+
+	return true;
+}
+
+
+void TimerWheel::expireAll() {
+	std::vector<Callback> expired;
+
+	{
+		std::lock_guard<std::mutex> lock(wheelMtx);
+
+		for (std::size_t bucket = 0; bucket < Levels * Slots; ++bucket) {
+			while (heads[bucket] != None) {
+				std::uint32_t index = heads[bucket];
+				expired.push_back(std::move(nodes[index].callback));
+				unlink(index);
+				release(index);
+			}
+		}
+
+		count = 0;
+	}
+
+	for (Callback& callback : expired) callback();
+}
+
+
+std::size_t TimerWheel::pending() const {
+	std::lock_guard<std::mutex> lock(wheelMtx);
+	return count;
+}
+
+
+bool TimerWheel::sleepFor(Clock::duration delay, const std::atomic<bool>& stop) {
+	/*
+	* The calling thread parks on its own condition variable; the timer thread wakes it on expiry.
+	* Shutdown is signalled by raising stop and calling expireAll(), which wakes every sleeper early.
+	*/
+
+	struct Sleeper {
+		std::mutex sleeperMtx;
+		std::condition_variable expired;
+		bool fired = false;
+	} sleeper;
+
+	if (stop.load()) return false;
+
+	TimerID id = schedule(delay, [&sleeper] {
+		std::lock_guard<std::mutex> lock(sleeper.sleeperMtx);
+		sleeper.fired = true;
+		sleeper.expired.notify_one();
+		});
+
+	std::unique_lock<std::mutex> lock(sleeper.sleeperMtx);
+	sleeper.expired.wait(lock, [&] { return sleeper.fired || stop.load(); });
+
+	if (!sleeper.fired && !cancel(id)) {
+		// The callback is already running and still refers to the sleeper
+		sleeper.expired.wait(lock, [&] { return sleeper.fired; });
+	}
+
+	return sleeper.fired && !stop.load();
+}
+
+
+void TimerWheel::run() {
+	std::vector<Callback> expired;
+	std::unique_lock<std::mutex> lock(wheelMtx);
+
+	while (!stopping) {
+		if (count == 0) {
+			// Keep up with the clock while idle, or the next timer would make advance() step through every tick missed
+			currentTick = std::max(currentTick, ticksAt(Clock::now()));
+			wakeTick = std::numeric_limits<std::uint64_t>::max();
+			wakeup.wait(lock);
+			continue;
+		}
+
+		std::uint64_t now = ticksAt(Clock::now());
+		if (now > currentTick) advance(now, expired);
+
+		if (!expired.empty()) {
+			// Callbacks may schedule or cancel timers, so they run without the wheel lock
+			lock.unlock();
+			for (Callback& callback : expired) callback();
+			expired.clear();
+			lock.lock();
+			continue;
+		}
+
+		wakeTick = nextWakeTick();
+		wakeup.wait_until(lock, origin + tick * static_cast<Clock::rep>(wakeTick));
+	}
+}
+
+
+void TimerWheel::advance(std::uint64_t target, std::vector<Callback>& expired) {
+	while (currentTick < target) {
+		std::uint64_t now = currentTick + 1;
+
+		// Entering a slot of a coarser level moves its timers down; they all expire within that slot's span
+		for (std::size_t level = Levels - 1; level >= 1; --level) {
+			std::uint64_t span = std::uint64_t{ 1 } << (SlotBits * level);
+			if (now % span != 0) continue;
+
+			std::size_t bucket = level * Slots + ((now >> (SlotBits * level)) & (Slots - 1));
+			while (heads[bucket] != None) {
+				std::uint32_t index = heads[bucket];
+				unlink(index);
+				link(index);
+			}
+		}
+
+		// Level 0 timers are only ever linked within 256 ticks of their expiry, so the whole slot is due
+		std::size_t bucket = now & (Slots - 1);
+		std::uint32_t index = heads[bucket];
+		while (index != None) {
+			std::uint32_t next = nodes[index].next;
+
+			expired.push_back(std::move(nodes[index].callback));
+			unlink(index);
+			release(index);
+			--count;
+
+			index = next;
+		}
+
+		currentTick = now;
+	}
+}
+
+
+std::uint64_t TimerWheel::nextWakeTick() const {
+	/*
+	* The earliest occupied level 0 slot, or the next cascade boundary if that comes first:
+	* timers on coarser levels only become visible at level 0 once their slot is entered.
+	*/
+
+	std::uint64_t base = currentTick + 1;
+	std::uint64_t boundary = (base + Slots - 1) / Slots * Slots;
+	std::size_t start = base & (Slots - 1);
+
+	for (std::size_t distance = 0; distance < Slots; ++distance) {
+		std::size_t slot = (start + distance) & (Slots - 1);
+		std::uint64_t word = occupied[slot / 64];
+
+		if ((word >> (slot % 64)) == 0) {
+			// Nothing left in this word; continue at the start of the next one
+			distance += 63 - (slot % 64);
+			continue;
+		}
+		if ((word >> (slot % 64)) & 1) return std::min(base + distance, boundary);
+	}
+
+	return boundary;
+}
+
+
+void TimerWheel::link(std::uint32_t index) {
+	/*
+	* Place the timer relative to the next tick to be processed. A timer d ticks away goes to the level whose
+	* slots are 256^level ticks wide with d < 256^(level+1); the slot is the matching digit of its expiry.
+	*/
+
+	Node& node = nodes[index];
+	std::uint64_t base = currentTick + 1;
+	std::uint64_t expiry = std::max(node.expiry, base);
+	std::uint64_t distance = expiry - base;
+
+	std::size_t level = 0;
+	while (level < Levels - 1 && distance >= (std::uint64_t{ 1 } << (SlotBits * (level + 1)))) ++level;
+
+	if (distance >= (std::uint64_t{ 1 } << (SlotBits * Levels))) {
+		expiry = base + (std::uint64_t{ 1 } << (SlotBits * Levels)) - 1;
+	}
+
+	std::size_t slot = (expiry >> (SlotBits * level)) & (Slots - 1);
+	std::uint32_t bucket = static_cast<std::uint32_t>(level * Slots + slot);
+
+	node.bucket = bucket;
+	node.prev = None;
+	node.next = heads[bucket];
+	if (node.next != None) nodes[node.next].prev = index;
+	heads[bucket] = index;
+
+	if (level == 0) occupied[slot / 64] |= std::uint64_t{ 1 } << (slot % 64);
+}
+
+
+void TimerWheel::unlink(std::uint32_t index) {
+	Node& node = nodes[index];
+
+	if (node.prev != None) nodes[node.prev].next = node.next;
+	else heads[node.bucket] = node.next;
+	if (node.next != None) nodes[node.next].prev = node.prev;
+
+	if (node.bucket < Slots && heads[node.bucket] == None) {
+		occupied[node.bucket / 64] &= ~(std::uint64_t{ 1 } << (node.bucket % 64));
+	}
+
+	node.bucket = None;
+}
+
+
+void TimerWheel::release(std::uint32_t index) {
+	Node& node = nodes[index];
+
+	node.callback = nullptr;
+	node.bucket = None;
+	++node.generation;
+
+	node.next = freeList;
+	freeList = index;
+}
+
+
+std::uint32_t TimerWheel::acquire() {
+	if (freeList != None) {
+		std::uint32_t index = freeList;
+		freeList = nodes[index].next;
+		return index;
+	}
+
+	nodes.push_back(Node{ 0, nullptr, None, None, None, 0 });
+	return static_cast<std::uint32_t>(nodes.size() - 1);
+}
+
+
+std::uint64_t TimerWheel::ticksAt(Clock::time_point time) const {
+	return static_cast<std::uint64_t>(std::max<Clock::rep>(0, (time - origin) / tick));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+
+/*
+* Hierarchical timing wheel serviced by a single timer thread.
+*
+* Deadlines are kept in four levels of 256 slots each; level L covers 256^(L+1) ticks. A timer goes into the
+* coarsest level its distance requires and moves down one level each time the wheel enters its slot, so
+* inserting and cancelling a timer are O(1) regardless of how many timers are pending. Timer nodes live in a
+* pool and are linked into their slot through indices; a timer ID carries a generation so cancelling a timer
+* that has already fired is detected and ignored.
+*
+* The timer thread sleeps until the next occupied slot and runs expired callbacks outside the wheel lock.
+* While no timer is pending the wheel follows the clock instead of ticking, so an idle spell costs nothing
+* when the next timer arrives.
+*
+* In the threaded mode the wheel replaces the sleeps and polling loops, not the threads: every aircraft and
+* charger keeps its thread and parks it on the wheel for a deadline. A fleet that must not cost a thread per
+* aircraft runs in the cooperative or parallel modes, where aircraft and chargers are coroutines.
+*/
+
+class TimerWheel {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Callback = std::function<void()>;
+
+	struct TimerID {
+		std::uint32_t index;								// Slot of the timer in the node pool
+		std::uint32_t generation;							// Generation of the node when the timer was scheduled
+	};
+
+	explicit TimerWheel(std::chrono::microseconds tick = std::chrono::microseconds(10));	// Start the timer thread
+	~TimerWheel();																		// Stop the timer thread; pending timers do not fire
+
+	TimerWheel(const TimerWheel& other) = delete;				// Copy constructor
+	TimerWheel& operator=(const TimerWheel& other) = delete;	// Copy assignment
+
+	TimerID schedule(Clock::duration delay, Callback callback);		// Run the callback on the timer thread once the delay has elapsed
+	bool cancel(TimerID id);										// Cancel a pending timer; false if it has fired or is firing
+	void expireAll();												// Fire every pending timer now
+	std::size_t pending() const;									// Number of pending timers
+
+	bool sleepFor(Clock::duration delay, const std::atomic<bool>& stop);	// Block until the delay elapsed (true) or stop was raised (false)
+
+private:
+	static constexpr std::size_t Levels = 4;
+	static constexpr std::size_t SlotBits = 8;
+	static constexpr std::size_t Slots = std::size_t{ 1 } << SlotBits;
+	static constexpr std::uint32_t None = 0xFFFFFFFF;
+
+	struct Node {
+		std::uint64_t expiry;								// Tick at which the timer fires
+		Callback callback;									// Function run on expiry
+		std::uint32_t prev;									// Previous node in the slot
+		std::uint32_t next;									// Next node in the slot, or in the free list
+		std::uint32_t bucket;								// Slot the node is linked into, None if free
+		std::uint32_t generation;							// Bumped each time the node is released
+	};
+
+	void run();												// Body of the timer thread
+	void advance(std::uint64_t tick, std::vector<Callback>& expired);		// Process every tick up to the given one
+	std::uint64_t nextWakeTick() const;										// Tick of the earliest slot that may hold timers
+
+	void link(std::uint32_t index);							// Put a node into the slot of its expiry
+	void unlink(std::uint32_t index);						// Remove a node from its slot
+	void release(std::uint32_t index);						// Return a node to the free list
+	std::uint32_t acquire();								// Take a node from the free list
+	std::uint64_t ticksAt(Clock::time_point time) const;	// Convert a time point into wheel ticks
+
+	const Clock::duration tick;								// Duration of one tick
+	const Clock::time_point origin;							// Time of tick zero
+
+	mutable std::mutex wheelMtx;							// Mutex to control access to the wheel
+	std::condition_variable wakeup;							// Wakes the timer thread for earlier deadlines or shutdown
+	bool stopping;											// Flag to stop the timer thread
+
+	std::uint64_t currentTick;								// Last tick processed
+	std::uint64_t wakeTick;									// Tick the timer thread is sleeping until
+	std::size_t count;										// Number of pending timers
+	std::vector<Node> nodes;								// Node pool
+	std::uint32_t freeList;									// First free node
+	std::uint32_t heads[Levels * Slots];					// First node of each slot
+	std::uint64_t occupied[Slots / 64];						// Occupancy bitmap of the level 0 slots
+
+	std::thread timerThread;								// Thread servicing the wheel
+};
@@ -0,0 +1,303 @@
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+#include "evTOL.h"
+#include "Simulation.h"
+#include "TripDispatcher.h"
+
+
+namespace {
+	// Party sizes from 1 to 4 passengers, smaller parties being more common
+	constexpr double PartySizeWeights[] = { 0.50, 0.30, 0.15, 0.05 };
+	constexpr std::size_t MaxPartySize = std::size(PartySizeWeights);
+
+	// Bands of trip length the open trips are split into, from zero to the diagonal of the service area
+	constexpr std::size_t LengthBands = 8;
+}
+
+
+double Trip::miles() const {
+	return std::hypot(destinationX - originX, destinationY - originY);
+}
+
+
+TripDispatcher::TripDispatcher(Simulation& simulation, const TripDemandConfig& config, std::uint64_t seed) :
+	simulation(simulation),
+	scheduler(nullptr),
+	config(config),
+	random(seed),
+	bandMiles(config.areaMiles * std::sqrt(2.0) / LengthBands),
+	positions(simulation.getFleet().size()),
+	maxRange(0.0),
+	assignments(simulation.getFleet().size()),
+	assigned(std::make_unique<SimEvent[]>(simulation.getFleet().size()))
+{
+	if (!(config.tripsPerHour > 0.0) || !(config.areaMiles > 0.0) || !(config.maxWait.count() > 0.0)) {
+		throw std::invalid_argument("Trip demand needs a positive rate, service area and maximum wait.");
+	}
+
+	// The fleet starts spread uniformly over the service area
+	std::uniform_real_distribution<double> coordinate(0.0, config.areaMiles);
+	for (Position& position : positions) position = Position{ coordinate(random), coordinate(random) };
+
+	// The fleet starts fully charged, so this is the farthest any aircraft can ever fly
+	for (const auto& aircraft : simulation.getFleet()) maxRange = std::max(maxRange, aircraft->getRange());
+
+	// Each seat class gets a grid sized for its share of the fleet
+	std::vector<std::size_t> classSizes(MaxPartySize + 1, 0);
+	for (std::size_t id = 0; id < positions.size(); ++id) ++classSizes[seatClass(id)];
+
+	idleAircraft.reserve(classSizes.size());
+	for (std::size_t size : classSizes) idleAircraft.emplace_back(config.areaMiles, SpatialGrid::cellsFor(size));
+
+	// About as many trips are open as arrive within the maximum wait
+	std::size_t expectedOpen = static_cast<std::size_t>(config.tripsPerHour * config.maxWait.count() / 60.0);
+
+	openTrips.reserve(LengthBands);
+	for (std::size_t band = 0; band < LengthBands; ++band) openTrips.emplace_back(config.areaMiles, SpatialGrid::cellsFor(expectedOpen / LengthBands));
+}
+
+
+void TripDispatcher::Initialize(Simulation& simulation, Scheduler& scheduler) {
+	/*
+	* The demand draws from its own generator, derived from the seed of the fleet composition, so that
+	* the same seed gives the same fleet whether or not the simulation has demand.
+	*/
+
+	std::random_device rd;
+	std::uint64_t seed = simulation.randomSeed.has_value() ? (*simulation.randomSeed ^ 0x9E3779B97F4A7C15ull) : rd();
+
+	simulation.dispatcher = std::make_unique<TripDispatcher>(simulation, *simulation.tripDemand, seed);
+	simulation.dispatcher->scheduler = &scheduler;
+
+	scheduler.spawn(simulation.dispatcher->demandTask(scheduler), Scheduler::makeKey(TaskGroup::Demand, 0));
+}
+
+
+bool TripDispatcher::requestTrip(std::size_t aircraftID) {
+	expireTrips(scheduler->elapsed());
+
+	const evTOL& aircraft = *simulation.getFleet()[aircraftID];
+	const Position& position = positions[aircraftID];
+
+	// A band only holds trips the aircraft can fly if the shortest of them leaves range for the empty leg
+	std::uint32_t slot = timed([&] {
+		std::uint32_t best = SpatialGrid::NoEntry;
+		double bestDistance = std::numeric_limits<double>::infinity();
+		double range = aircraft.getRange();
+
+		for (std::size_t band = 0; band < openTrips.size(); ++band) {
+			double reach = std::min(range - static_cast<double>(band) * bandMiles, bestDistance);
+			if (reach < 0.0) break;
+
+			std::uint32_t match = openTrips[band].nearest(position.x, position.y, reach, [&](std::uint32_t candidate, double emptyMiles) {
+				return aircraft.canServe(trips[candidate].passengers, emptyMiles + trips[candidate].miles());
+				});
+
+			if (match == SpatialGrid::NoEntry) continue;
+
+			best = match;
+			bestDistance = std::hypot(trips[match].originX - position.x, trips[match].originY - position.y);
+		}
+
+		return best;
+		});
+
+	if (slot == SpatialGrid::NoEntry) {
+		assigned[aircraftID].reset();
+		idleAircraft[seatClass(aircraftID)].insert(static_cast<std::uint32_t>(aircraftID), position.x, position.y);
+		return false;
+	}
+
+	Trip trip = trips[slot];
+	openTrips[lengthBand(trip)].erase(slot);
+	freeSlots.push_back(slot);
+
+	assign(aircraftID, trip, std::hypot(trip.originX - position.x, trip.originY - position.y));
+	return true;
+}
+
+
+SimEvent& TripDispatcher::tripAssigned(std::size_t aircraftID) {
+	return assigned[aircraftID];
+}
+
+
+const TripAssignment& TripDispatcher::getAssignment(std::size_t aircraftID) const {
+	return assignments[aircraftID];
+}
+
+
+void TripDispatcher::tripCompleted(std::size_t aircraftID) {
+	const Trip& trip = assignments[aircraftID].trip;
+	positions[aircraftID] = Position{ trip.destinationX, trip.destinationY };
+}
+
+
+TripTotals TripDispatcher::getTotals() const {
+	TripTotals current = totals;
+	current.open = 0;
+	for (const SpatialGrid& band : openTrips) current.open += band.size();
+	return current;
+}
+
+
+void TripDispatcher::printReport(std::ostream& out) const {
+	TripTotals current = getTotals();
+	double served = static_cast<double>(std::max<std::uint64_t>(current.served, 1));
+	double matches = static_cast<double>(std::max<std::uint64_t>(current.matches, 1));
+	double flown = std::max(current.tripMiles + current.emptyMiles, 1e-9);
+
+	out << "\n" << "Trip demand over a " << config.areaMiles << " x " << config.areaMiles << " mile area at " << config.tripsPerHour << " trips/hour" << "\n";
+	out << std::left << std::setw(12) << "Requested" << std::setw(12) << "Served" << std::setw(12) << "Expired" << std::setw(12) << "Open"
+		<< std::setw(16) << "Mean wait min" << std::setw(16) << "Max wait min" << "\n";
+	out << std::setw(12) << current.requested << std::setw(12) << current.served << std::setw(12) << current.expired << std::setw(12) << current.open
+		<< std::fixed << std::setprecision(2) << std::setw(16) << current.waitSeconds / served / 60.0 << std::setw(16) << current.maxWaitSeconds / 60.0 << "\n";
+
+	out << std::setw(16) << "Trip miles" << std::setw(16) << "Empty miles" << std::setw(12) << "Empty %" << std::setw(20) << "Passenger miles"
+		<< std::setw(16) << "Match mean us" << std::setw(16) << "Match max us" << "\n";
+	out << std::setw(16) << current.tripMiles << std::setw(16) << current.emptyMiles << std::setw(12) << 100.0 * current.emptyMiles / flown
+		<< std::setw(20) << current.passengerMiles << std::setw(16) << 1e6 * current.matchSeconds / matches << std::setw(16) << 1e6 * current.maxMatchSeconds
+		<< std::defaultfloat << std::right << "\n";
+}
+
+
+Task TripDispatcher::demandTask(Scheduler& scheduler) {
+	std::exponential_distribution<double> interarrival(config.tripsPerHour / 3600.0);
+	std::uniform_real_distribution<double> coordinate(0.0, config.areaMiles);
+	std::discrete_distribution<std::uint32_t> partySize(std::begin(PartySizeWeights), std::end(PartySizeWeights));
+
+	std::chrono::duration<double> next(0.0);
+
+	while (!simulation.fleetRetired.load()) {
+		next += std::chrono::duration<double>(interarrival(random));
+		co_await scheduler.sleepFor(std::chrono::duration_cast<Scheduler::SimDuration>(next) - scheduler.elapsed());
+
+		Trip trip{};
+		trip.originX = coordinate(random);
+		trip.originY = coordinate(random);
+		trip.destinationX = coordinate(random);
+		trip.destinationY = coordinate(random);
+		trip.passengers = partySize(random) + 1;
+		trip.sequence = totals.requested++;
+		trip.requested = scheduler.elapsed();
+
+		tripRequested(trip);
+	}
+}
+
+
+void TripDispatcher::tripRequested(const Trip& trip) {
+	expireTrips(trip.requested);
+
+	double tripMiles = trip.miles();
+	const Simulation::FleetList& fleet = simulation.getFleet();
+
+	// Every class with enough seats is searched, each only as far as the best match in the classes before it
+	std::uint32_t aircraftID = timed([&] {
+		std::uint32_t best = SpatialGrid::NoEntry;
+		double reach = maxRange - tripMiles;
+
+		for (std::size_t seats = trip.passengers; seats < idleAircraft.size(); ++seats) {
+			std::uint32_t match = idleAircraft[seats].nearest(trip.originX, trip.originY, reach, [&](std::uint32_t candidate, double emptyMiles) {
+				return fleet[candidate]->canServe(trip.passengers, emptyMiles + tripMiles);
+				});
+
+			if (match == SpatialGrid::NoEntry) continue;
+
+			best = match;
+			reach = std::hypot(trip.originX - positions[match].x, trip.originY - positions[match].y);
+		}
+
+		return best;
+		});
+
+	if (aircraftID != SpatialGrid::NoEntry) {
+		const Position& position = positions[aircraftID];
+		idleAircraft[seatClass(aircraftID)].erase(aircraftID);
+
+		assign(aircraftID, trip, std::hypot(trip.originX - position.x, trip.originY - position.y));
+		assigned[aircraftID].set();
+		return;
+	}
+
+	std::uint32_t slot;
+	if (freeSlots.empty()) {
+		slot = static_cast<std::uint32_t>(trips.size());
+		trips.push_back(trip);
+	}
+	else {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+		trips[slot] = trip;
+	}
+
+	openTrips[lengthBand(trip)].insert(slot, trip.originX, trip.originY);
+	pending.push_back(Pending{ slot, trip.sequence });
+}
+
+
+void TripDispatcher::expireTrips(Scheduler::SimDuration now) {
+	// Trips are requested in order, so the oldest open ones are at the front; served ones are skipped over
+	Scheduler::SimDuration maxWait = std::chrono::duration_cast<Scheduler::SimDuration>(config.maxWait);
+
+	while (!pending.empty()) {
+		const Pending& oldest = pending.front();
+		const Trip& trip = trips[oldest.slot];
+		bool open = trip.sequence == oldest.sequence && openTrips[lengthBand(trip)].contains(oldest.slot);
+
+		if (open && trip.requested + maxWait > now) break;
+
+		if (open) {
+			openTrips[lengthBand(trip)].erase(oldest.slot);
+			freeSlots.push_back(oldest.slot);
+			++totals.expired;
+		}
+
+		pending.pop_front();
+	}
+}
+
+
+void TripDispatcher::assign(std::size_t aircraftID, const Trip& trip, double emptyMiles) {
+	double waitSeconds = std::chrono::duration<double>(scheduler->elapsed() - trip.requested).count();
+	double tripMiles = trip.miles();
+
+	assignments[aircraftID] = TripAssignment{ trip, emptyMiles };
+
+	++totals.served;
+	totals.waitSeconds += waitSeconds;
+	totals.maxWaitSeconds = std::max(totals.maxWaitSeconds, waitSeconds);
+	totals.tripMiles += tripMiles;
+	totals.emptyMiles += emptyMiles;
+	totals.passengerMiles += tripMiles * trip.passengers;
+}
+
+
+std::size_t TripDispatcher::seatClass(std::size_t aircraftID) const {
+	int seats = simulation.getFleet()[aircraftID]->getPassengerCount();
+	return std::min(static_cast<std::size_t>(std::max(seats, 0)), MaxPartySize);
+}
+
+
+std::size_t TripDispatcher::lengthBand(const Trip& trip) const {
+	return std::min(static_cast<std::size_t>(trip.miles() / bandMiles), LengthBands - 1);
+}
+
+
+template <typename Query>
+std::uint32_t TripDispatcher::timed(Query&& query) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	std::uint32_t match = query();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+	++totals.matches;
+	totals.matchSeconds += seconds;
+	totals.maxMatchSeconds = std::max(totals.maxMatchSeconds, seconds);
+
+	return match;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "Scheduler.h"
+#include "SpatialGrid.h"
+
+
+class evTOL;
+class Simulation;
+
+/*
+* Passenger trip demand and its dispatch to the fleet.
+*
+* Without demand every aircraft flies from a full battery until it is depleted, so its passenger miles are
+* an upper bound. With demand, trips with an origin, a destination and a party of passengers arrive as a
+* Poisson process spread uniformly over a square service area, and the aircraft only fly to serve them:
+* an idle aircraft flies empty to the origin of its trip, carries the party to the destination and waits
+* there for its next trip. Passenger miles are those of the trips actually served. An aircraft below its
+* charge reserve after a trip goes to the charging network and is topped up before it is idle again.
+*
+* Idle aircraft and open trips are kept in spatial grids. A new trip is matched with the nearest idle
+* aircraft that has the seats and the battery for the empty leg and the trip; an aircraft becoming idle
+* takes the nearest open trip it can serve. Trips not matched within the maximum wait are dropped.
+* Idle aircraft are indexed per seat class, so a large party only searches the aircraft that can seat
+* it instead of scanning past every smaller one. Open trips are indexed per band of trip length, so an
+* aircraft low on battery searches the short trips it can still fly within the range left after them
+* rather than every trip within its range. No search goes farther than the aircraft could fly.
+*
+* Dispatch runs on the cooperative scheduler, so for a given seed the demand, the matches and the
+* results are reproducible.
+*/
+
+struct TripDemandConfig {
+	double tripsPerHour;									// Trip requests per simulated hour
+	double areaMiles;										// Side length of the square service area
+	std::chrono::duration<double, std::ratio<60>> maxWait;	// Time a trip waits for an aircraft before it is dropped
+};
+
+
+struct Trip {
+	double originX;						// Pick-up point, miles from the corner of the service area
+	double originY;
+	double destinationX;				// Drop-off point
+	double destinationY;
+	std::uint32_t passengers;			// Size of the party
+	std::uint64_t sequence;				// Number of the trip in order of request
+	Scheduler::SimDuration requested;	// Simulated time of the request
+
+	double miles() const;				// Distance from origin to destination
+};
+
+
+struct TripAssignment {
+	Trip trip;							// Trip the aircraft serves
+	double emptyMiles;					// Distance flown without passengers to the origin
+};
+
+
+struct TripTotals {
+	std::uint64_t requested = 0;		// Trips requested
+	std::uint64_t served = 0;			// Trips matched with an aircraft
+	std::uint64_t expired = 0;			// Trips dropped after the maximum wait
+	std::uint64_t open = 0;				// Trips still waiting
+	double waitSeconds = 0.0;			// Wait from request to dispatch, summed over served trips
+	double maxWaitSeconds = 0.0;		// Longest wait of a served trip
+	double tripMiles = 0.0;				// Miles flown with passengers
+	double emptyMiles = 0.0;			// Miles flown empty to the origins
+	double passengerMiles = 0.0;		// Passenger miles of the served trips
+	std::uint64_t matches = 0;			// Nearest-neighbour queries made
+	double matchSeconds = 0.0;			// Wall-clock time spent in those queries
+	double maxMatchSeconds = 0.0;		// Slowest query
+};
+
+
+class TripDispatcher {
+public:
+	TripDispatcher(Simulation& simulation, const TripDemandConfig& config, std::uint64_t seed);	// Place the idle fleet over the service area
+
+	TripDispatcher(const TripDispatcher& other) = delete;				// Copy constructor
+	TripDispatcher& operator=(const TripDispatcher& other) = delete;	// Copy assignment
+
+	// Create the dispatcher of a simulation with demand and start generating trips on the scheduler
+	static void Initialize(Simulation& simulation, Scheduler& scheduler);
+
+	bool requestTrip(std::size_t aircraftID);						// Match an idle aircraft; false if it has to wait for tripAssigned()
+	SimEvent& tripAssigned(std::size_t aircraftID);					// Event signalled once a waiting aircraft has been matched
+	const TripAssignment& getAssignment(std::size_t aircraftID) const;	// Trip an aircraft has been matched with
+	void tripCompleted(std::size_t aircraftID);						// Move the aircraft to the destination of its trip
+
+	TripTotals getTotals() const;									// Counters of the demand so far
+	void printReport(std::ostream& out) const;						// Print the end-of-run demand report
+
+private:
+	struct Position {
+		double x;
+		double y;
+	};
+
+	struct Pending {
+		std::uint32_t slot;					// Slot of the trip
+		std::uint64_t sequence;				// Trip the slot held when it was requested
+	};
+
+	Task demandTask(Scheduler& scheduler);							// Generate trips as a Poisson process
+	void tripRequested(const Trip& trip);							// Match a new trip or leave it open
+	void expireTrips(Scheduler::SimDuration now);					// Drop open trips older than the maximum wait
+	void assign(std::size_t aircraftID, const Trip& trip, double emptyMiles);	// Hand a trip to an aircraft
+	std::size_t seatClass(std::size_t aircraftID) const;			// Grid of idle aircraft an aircraft is kept in
+	std::size_t lengthBand(const Trip& trip) const;					// Grid of open trips a trip is kept in
+
+	template <typename Query>
+	std::uint32_t timed(Query&& query);								// Run a nearest-neighbour query and account its time
+
+	Simulation& simulation;											// Simulation the dispatcher belongs to
+	Scheduler* scheduler;											// Scheduler the demand and the fleet run on
+	TripDemandConfig config;										// Rate, area and maximum wait of the demand
+	std::mt19937_64 random;											// Random source of the demand
+
+	std::vector<SpatialGrid> idleAircraft;							// Idle aircraft by position, per number of seats up to the largest party
+	std::vector<SpatialGrid> openTrips;								// Open trips by origin, per band of trip length
+	double bandMiles;												// Width of a band of trip length
+	std::vector<Position> positions;								// Position of every aircraft
+	double maxRange;												// Range of the fleet on a full battery, bounding every search
+	std::vector<TripAssignment> assignments;						// Current trip of every aircraft
+	std::unique_ptr<SimEvent[]> assigned;							// Assignment event of every aircraft
+
+	std::vector<Trip> trips;										// Open trips by slot
+	std::vector<std::uint32_t> freeSlots;							// Slots of trips no longer open
+	std::deque<Pending> pending;									// Open trips in order of request, to expire them
+
+	TripTotals totals;												// Counters of the demand
+};
@@ -0,0 +1,249 @@
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Vertiport.h"
+#include "DataLogger.h"
+#include "DataExport.h"
+#include "Timeline.h"
+#include "Simulation.h"
+#include "RequestManager.h"
+
+
+std::size_t Vertiport::getSiteID() const {
+	return siteID;
+}
+
+
+std::size_t Vertiport::getChargerCount() const {
+	return chargers.load(std::memory_order_relaxed);
+}
+
+
+std::size_t Vertiport::getQueueDepth() const {
+	return queued.load(std::memory_order_relaxed);
+}
+
+
+std::size_t Vertiport::getBusyChargers() const {
+	return busy.load(std::memory_order_relaxed);
+}
+
+
+Scheduler::SimDuration Vertiport::getExpectedWait() const {
+	/*
+	* A request arriving now is served immediately if a charger is idle. Otherwise it waits for
+	* the work already queued or in progress to drain, spread evenly across the site's chargers.
+	*/
+
+	std::size_t numChargers = getChargerCount();
+	if (numChargers == 0) return Scheduler::SimDuration::max();
+	if (getBusyChargers() + getQueueDepth() < numChargers) return Scheduler::SimDuration::zero();
+
+	return Scheduler::SimDuration(pendingWork.load(std::memory_order_relaxed) / static_cast<std::int64_t>(numChargers));
+}
+
+
+void Vertiport::addCharger() {
+	chargers.fetch_add(1);
+}
+
+
+void Vertiport::removeCharger() {
+	chargers.fetch_sub(1);
+}
+
+
+void Vertiport::recordResize(std::size_t added, std::size_t retired, std::chrono::time_point<std::chrono::system_clock> now) {
+	/*
+	* A drain is timed from the first scale-up that finds requests waiting until the queue is empty
+	* again; further scale-ups before then belong to the same drain.
+	*/
+
+	std::lock_guard<std::mutex> lock(capacityMtx);
+	capacity.added += added;
+	capacity.retired += retired;
+
+	if (added > 0 && getQueueDepth() > 0) {
+		std::int64_t notDraining = NotDraining;
+		drainingSince.compare_exchange_strong(notDraining, std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count());
+	}
+}
+
+
+CapacityStats Vertiport::getCapacityStats() const {
+	std::lock_guard<std::mutex> lock(capacityMtx);
+	return capacity;
+}
+
+
+void Vertiport::enqueue(const std::shared_ptr<RequestManager>& request) {
+	std::shared_ptr<DataLogger> logger = DataLogger::getInstance(request->getAircraft());
+	std::size_t depth;
+
+	{
+		std::lock_guard<std::mutex> lock(requestsMtx);
+		incomingRequests.push(request);
+		depth = queued.fetch_add(1, std::memory_order_relaxed) + 1;
+		pendingWork.fetch_add(request->getAircraft()->getChargeDuration().count(), std::memory_order_relaxed);
+
+		logger->logData("Request with ticket number: " + request->getTicketNumber() + " has been added to the queue of vertiport " + std::to_string(siteID) + ".");
+		requestNotification.notify_all();
+		logger->logData("Notification sent to the charging station.");
+	}
+
+	if (simulation.timeline) {
+		simulation.timeline->recordQueueDepth(static_cast<std::uint32_t>(siteID),
+			std::chrono::duration_cast<std::chrono::microseconds>(request->getRequestTime().time_since_epoch()).count(), depth);
+	}
+
+	if (scheduler != nullptr) requestAvailable.set();
+}
+
+
+std::size_t Vertiport::newRequestAvailable() {
+	std::lock_guard<std::mutex> lock(requestsMtx);
+	return incomingRequests.size();
+}
+
+
+std::shared_ptr<RequestManager> Vertiport::fetchFirstInLine() {
+	std::shared_ptr<RequestManager> firstInLine;
+	std::size_t depth;
+
+	{
+		std::lock_guard<std::mutex> lock(requestsMtx);
+		if (incomingRequests.empty()) throw std::runtime_error("No requests in the queue.");
+		firstInLine = incomingRequests.front();
+		incomingRequests.pop();
+
+		depth = queued.fetch_sub(1, std::memory_order_relaxed) - 1;
+		busy.fetch_add(1, std::memory_order_relaxed);
+		requestNotification.notify_all();
+	}
+
+	firstInLine->updateStartTime();
+
+	if (depth == 0 && drainingSince.load(std::memory_order_relaxed) != NotDraining) {
+		std::int64_t since = drainingSince.exchange(NotDraining);
+		std::int64_t drained = std::chrono::duration_cast<std::chrono::microseconds>(firstInLine->getStartTime().time_since_epoch()).count();
+
+		if (since != NotDraining) {
+			double seconds = std::chrono::duration<double>(std::chrono::microseconds(drained - since)).count();
+
+			std::lock_guard<std::mutex> lock(capacityMtx);
+			++capacity.drains;
+			capacity.drainSeconds += seconds;
+			capacity.maxDrainSeconds = std::max(capacity.maxDrainSeconds, seconds);
+		}
+	}
+
+	if (simulation.timeline) {
+		simulation.timeline->recordQueueDepth(static_cast<std::uint32_t>(siteID),
+			std::chrono::duration_cast<std::chrono::microseconds>(firstInLine->getStartTime().time_since_epoch()).count(), depth);
+	}
+
+	return firstInLine;
+}
+
+
+void Vertiport::chargingFinished(const std::shared_ptr<RequestManager>& request, std::size_t chargerID) {
+	std::shared_ptr<evTOL> aircraft = request->getAircraft();
+	Scheduler::SimDuration chargeDuration = aircraft->getChargeDuration();
+
+	pendingWork.fetch_sub(chargeDuration.count(), std::memory_order_relaxed);
+	busy.fetch_sub(1, std::memory_order_relaxed);
+
+	simulation.metrics.recordCharge(aircraft->getManufacturerIndex(), std::chrono::duration<double>(chargeDuration).count());
+
+	if (!simulation.dataExport && !simulation.timeline) return;
+
+	std::int64_t requested = std::chrono::duration_cast<std::chrono::microseconds>(request->getRequestTime().time_since_epoch()).count();
+	std::int64_t started = std::chrono::duration_cast<std::chrono::microseconds>(request->getStartTime().time_since_epoch()).count();
+	std::int64_t finished = std::chrono::duration_cast<std::chrono::microseconds>(request->getEndTime().time_since_epoch()).count();
+	std::uint32_t aircraftID = static_cast<std::uint32_t>(aircraft->getAircraftID());
+	std::uint16_t manufacturer = static_cast<std::uint16_t>(aircraft->getManufacturerIndex());
+
+	if (simulation.dataExport) {
+		simulation.dataExport->recordTicket({ requested, started, finished, aircraftID, manufacturer, static_cast<std::uint16_t>(siteID) });
+	}
+
+	if (simulation.timeline) {
+		simulation.timeline->recordSpan(TimelinePhase::Charge, static_cast<std::uint32_t>(chargerID), started, finished, aircraftID, manufacturer);
+		simulation.timeline->recordSpan(TimelinePhase::Queued, aircraftID, requested, started, aircraftID, manufacturer);
+		simulation.timeline->recordSpan(TimelinePhase::Charging, aircraftID, started, finished, aircraftID, manufacturer);
+	}
+}
+
+
+std::mutex& Vertiport::getChargerMutex() {
+	return chargerMtx;
+}
+
+
+std::condition_variable& Vertiport::getRequestNotification() {
+	return requestNotification;
+}
+
+
+SimEvent& Vertiport::getRequestAvailable() {
+	return requestAvailable;
+}
+
+
+Scheduler* Vertiport::getScheduler() const {
+	return scheduler;
+}
+
+
+void Vertiport::InitializeNetwork(Simulation& simulation, std::size_t numSites, Scheduler* scheduler) {
+	if (numSites == 0) throw std::invalid_argument("The charging network needs at least one vertiport.");
+
+	simulation.sites.reserve(numSites);
+	for (std::size_t site = 0; site < numSites; ++site) {
+		simulation.sites.emplace_back(std::make_unique<Vertiport>(site, simulation, scheduler));
+	}
+}
+
+
+void Vertiport::notifyAll(Simulation& simulation) {
+	for (std::unique_ptr<Vertiport>& site : simulation.sites) {
+		site->requestNotification.notify_all();
+	}
+}
+
+
+Vertiport& Vertiport::route(Simulation& simulation) {
+	/*
+	* Least-loaded routing: shortest expected wait first, then shortest queue, then lowest ID.
+	* Only the atomic load counters are read, so routing never blocks on a site's locks.
+	*/
+
+	if (simulation.sites.empty()) throw std::runtime_error("The charging network has not been initialized.");
+
+	Vertiport* best = simulation.sites.front().get();
+	std::tuple<Scheduler::SimDuration, std::size_t> bestLoad{ best->getExpectedWait(), best->getQueueDepth() };
+
+	for (std::unique_ptr<Vertiport>& site : simulation.sites) {
+		std::tuple<Scheduler::SimDuration, std::size_t> load{ site->getExpectedWait(), site->getQueueDepth() };
+		if (load < bestLoad) {
+			best = site.get();
+			bestLoad = load;
+		}
+	}
+
+	return *best;
+}
+
+
+Vertiport::Vertiport(std::size_t siteID, Simulation& simulation, Scheduler* scheduler) :
+	siteID(siteID),
+	simulation(simulation),
+	scheduler(scheduler)
+{
+	chargers.store(0);
+	queued.store(0);
+	busy.store(0);
+	pendingWork.store(0);
+	drainingSince.store(NotDraining);
+}
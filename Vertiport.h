@@ -0,0 +1,102 @@
+#pragma once
+
+#include <deque>
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <condition_variable>
+
+#include "Scheduler.h"
+#include "MemoryAccounting.h"
+
+
+class Simulation;
+class Checkpoint;
+class RequestManager;
+
+/*
+* A charging site of the network. Every vertiport has its own pool of chargers, its own queue of
+* incoming requests and its own locks, so chargers at different sites never contend with each other.
+*
+* The load of a site (queued requests, busy chargers and outstanding charge work) is kept in atomics
+* so that aircraft can pick the least-loaded site without taking any of the site locks.
+*
+* The pool of a site can grow and shrink while the simulation runs (see ChargerPool). When chargers are
+* added to a site with requests waiting, the site times how long it takes until its queue is empty.
+*/
+
+struct CapacityStats {
+	std::size_t added = 0;					// Chargers added while running
+	std::size_t retired = 0;				// Chargers retired while running
+	std::size_t drains = 0;					// Queues emptied after chargers were added
+	double drainSeconds = 0.0;				// Time from adding chargers to an empty queue, summed over drains
+	double maxDrainSeconds = 0.0;			// Slowest of those drains
+};
+
+
+class Vertiport {
+public:
+	using RequestQueue = std::queue<std::shared_ptr<RequestManager>, std::deque<std::shared_ptr<RequestManager>,
+		TrackedAllocator<std::shared_ptr<RequestManager>, MemorySubsystem::Requests>>>;	// Requests waiting for a charger
+
+	// Vertiport public APIs
+	std::size_t getSiteID() const;										// Get the ID of the vertiport
+	std::size_t getChargerCount() const;								// Get the number of chargers at the vertiport
+	std::size_t getQueueDepth() const;									// Get the number of requests waiting for a charger
+	std::size_t getBusyChargers() const;								// Get the number of chargers currently charging
+	Scheduler::SimDuration getExpectedWait() const;						// Estimate the wait of a request arriving now
+
+	void addCharger();																	// Register a charger with the vertiport
+	void removeCharger();																// Unregister a charger that has been retired
+	void recordResize(std::size_t added, std::size_t retired, std::chrono::time_point<std::chrono::system_clock> now);	// Count a resize of the pool and time the queue after a scale-up
+	CapacityStats getCapacityStats() const;												// Get the resizes of the pool so far
+	void enqueue(const std::shared_ptr<RequestManager>& request);						// Add a request to the queue of the vertiport
+	std::size_t newRequestAvailable();													// Check if new request is available
+	std::shared_ptr<RequestManager> fetchFirstInLine();									// Fetch the first request in the queue
+	void chargingFinished(const std::shared_ptr<RequestManager>& request, std::size_t chargerID);	// Release the charger used by a request
+
+	std::mutex& getChargerMutex();										// Mutex the chargers of the vertiport wait on
+	std::condition_variable& getRequestNotification();					// Condition variable to notify the chargers of incoming requests
+	SimEvent& getRequestAvailable();									// Event to wake charger coroutines on incoming requests
+	Scheduler* getScheduler() const;									// Scheduler of the charger coroutines, null when running on threads
+
+	// Static member functions
+	static void InitializeNetwork(Simulation& simulation, std::size_t numSites, Scheduler* scheduler);	// Create the vertiports of the charging network
+	static void notifyAll(Simulation& simulation);														// Wake all chargers of all vertiports
+	static Vertiport& route(Simulation& simulation);													// Pick the vertiport with the shortest expected wait
+
+	Vertiport(std::size_t siteID, Simulation& simulation, Scheduler* scheduler);	// Parametrized constructor
+
+	Vertiport(const Vertiport& other) = delete;						// Copy constructor
+	Vertiport& operator= (const Vertiport& other) = delete;			// Copy assignment operator
+
+private:
+	friend class Checkpoint;
+
+	static constexpr std::int64_t NotDraining = std::numeric_limits<std::int64_t>::min();	// drainingSince while no drain is being timed
+
+	std::size_t siteID;														// Unique ID for each vertiport
+	Simulation& simulation;													// Simulation the vertiport belongs to
+	Scheduler* scheduler;													// Scheduler driving the chargers, null when running on threads
+
+	std::atomic<std::size_t> chargers;										// Number of chargers at the vertiport
+	std::atomic<std::size_t> queued;										// Number of requests waiting in the queue
+	std::atomic<std::size_t> busy;											// Number of chargers currently charging
+	std::atomic<std::int64_t> pendingWork;									// Charge time in simulated microseconds queued or in progress
+	std::atomic<std::int64_t> drainingSince;								// Time chargers were added to a non-empty queue, NotDraining if not timing
+
+	mutable std::mutex capacityMtx;											// Mutex to control access to the capacity statistics
+	CapacityStats capacity;													// Resizes of the pool so far
+
+	std::mutex requestsMtx;													// Mutex to control access to queue for incoming requests
+	RequestQueue incomingRequests;											// Queue to store incoming requests
+
+	std::mutex chargerMtx;													// Mutex the chargers wait on
+	std::condition_variable requestNotification;							// Condition variable to notify the chargers of incoming requests
+	SimEvent requestAvailable;												// Event to wake charger coroutines on incoming requests
+};
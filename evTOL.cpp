@@ -2,31 +2,44 @@
 #include <thread>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <condition_variable>
 
 #include "evTOL.h"
 #include "DataLogger.h"
+#include "DataExport.h"
+#include "Timeline.h"
+#include "TimerWheel.h"
+#include "Simulation.h"
+#include "ScopeTimers.h"
 #include "RequestManager.h"
+#include "ChargingStation.h"
+#include "ThreadPlacement.h"
+#include "TripDispatcher.h"
+#include "ShardedScheduler.h"
 
 
-std::atomic<bool> evTOL::simulationComplete{ false };
-std::condition_variable evTOL::aircraftCV;
-
 /* ----------------- Constructors ----------------- */
 
-evTOL::evTOL(const json& InputData) :
-    ManufacturerName(InputData.at("Name").get<std::string>()),
-    CruiseSpeed(InputData.at("Cruise_Speed").get<int>()),
-    maxPassengerCount(InputData.at("Passenger_Count").get<int>()),
-    BatteryCapacity(InputData.at("Battery_Capacity").get<int>()),
-    CruisingPowerConsumption(InputData.at("Energy_use_at_Cruise").get<double>()),
-    FaultsPerHour(InputData.at("Probability_of_fault_per_hour").get<double>()),
-    TimeToCharge(std::chrono::duration<double, std::ratio<3600>>(InputData.at("Time_to_Charge").get<double>()))
+evTOL::evTOL(const ManufacturerSpec& spec, std::size_t manufacturerIndex, std::size_t aircraftID, Simulation* simulation, std::size_t fleetSize) :
+    simulation(simulation),
+    ManufacturerName(spec.name),
+    ManufacturerIndex(manufacturerIndex),
+    AircraftID(aircraftID),
+    Profile(AircraftProfile::of(spec, fleetSize)),
+    BatteryCapacity(spec.batteryCapacity),
+    CruisingPowerConsumption(spec.energyUseAtCruise),
+    TimeToCharge(std::chrono::duration<double, std::ratio<3600>>(spec.timeToCharge))
 {
     this->currentBatteryLevel = 100;                        // Initialize current battery level to 100%
     this->chargingStatus.store(false);                      // Initialize the charging status to false
 
     this->airTime = std::chrono::duration<double>::zero();                            // Initialize airTime to 0
+    this->totalAirTime = std::chrono::duration<double>::zero();                       // Initialize accumulated airTime to 0
+    this->completedSessions = 0;                                                      // Initialize completed sessions to 0
+    this->flightPhase = FlightPhase::Start;                                           // Initialize the flight cycle to before take-off
+    this->batteryEnergy = spec.batteryCapacity;                                       // Initialize the battery to full
+    this->chargeShare = 1.0;                                                          // Initialize charges to full charges
 	this->EndOperationTime = std::chrono::time_point<std::chrono::system_clock>();    // Initialize end time to 0
     this->StartOperationTime = std::chrono::time_point<std::chrono::system_clock>();  // Initialize start time to 0	
 }
@@ -42,24 +55,19 @@ void evTOL::startAircraft() {
 
 
 void evTOL::updateBatteryLevel() {
+    TIMED_SCOPE(BatteryUpdate);
     std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->shared_from_this());
 
     if (!chargingStatus.load()) {
-        double NetConsumptionPerHour = CruiseSpeed * CruisingPowerConsumption;
-        double ConsumptionPerSecond = NetConsumptionPerHour / (60 * 60);
-
-        double accumulatedConsumption = 0.0;
-        double OnePercent = BatteryCapacity * 0.01;
-
-        while (currentBatteryLevel > 0 && !simulationComplete.load()) {
-            std::this_thread::sleep_for(std::chrono::microseconds(1));
-            accumulatedConsumption += ConsumptionPerSecond;
+        bool depleted = false;
+        std::chrono::microseconds timeToDeplete = getTimeToDeplete();
 
-            if (accumulatedConsumption >= OnePercent) {
-                accumulatedConsumption -= OnePercent;
-                currentBatteryLevel--;
-            }
+        // The aircraft thread parks on the timer wheel until the battery has drained, instead of polling every simulated second
+        {
+            TIMED_SCOPE(Waiting);
+            depleted = simulation->getTimerWheel().sleepFor(timeToDeplete, simulation->fleetRetired);
         }
+        if (depleted) currentBatteryLevel = 0;
 
 		logger->logData("Battery level of aircraft has drained to : " + std::to_string(currentBatteryLevel) + " %.");
     }
@@ -82,25 +90,80 @@ std::string evTOL::requestCharge(std::shared_ptr<evTOL>& aircraft) {
 }
 
 
+void evTOL::recordSession() {
+    /*
+    * Fleet metrics are per aircraft: passenger miles are those flown by this aircraft alone,
+    * and faults are the expected number given the manufacturer's fault rate.
+    */
+
+    recordSession(Profile.miles(airTime.count()), Profile.passengerMiles(airTime.count()));
+}
+
+
+void evTOL::recordSession(double miles, double passengerMiles) {
+    double faults = Profile.faults(airTime.count());
+
+    totalAirTime += airTime;
+    ++completedSessions;
+
+    simulation->metrics.recordSession(ManufacturerIndex, airTime.count(), miles, passengerMiles, faults);
+
+    simulation->sessions.append(ManufacturerIndex, AircraftID, StartOperationTime, EndOperationTime, airTime.count(),
+        miles, passengerMiles, faults);
+
+    if (simulation->dataExport) {
+        simulation->dataExport->recordSession({
+            std::chrono::duration_cast<std::chrono::microseconds>(StartOperationTime.time_since_epoch()).count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(EndOperationTime.time_since_epoch()).count(),
+            airTime.count(), miles, passengerMiles, faults,
+            static_cast<std::uint32_t>(AircraftID), static_cast<std::uint16_t>(ManufacturerIndex) });
+    }
+
+    if (simulation->timeline) {
+        simulation->timeline->recordSpan(TimelinePhase::Airborne, static_cast<std::uint32_t>(AircraftID),
+            std::chrono::duration_cast<std::chrono::microseconds>(StartOperationTime.time_since_epoch()).count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(EndOperationTime.time_since_epoch()).count(),
+            static_cast<std::uint32_t>(AircraftID), static_cast<std::uint16_t>(ManufacturerIndex));
+    }
+}
+
+
+Scheduler::SimDuration evTOL::getFlightDuration() const {
+    /*
+    * Closed form of the drain loop in updateBatteryLevel(): the battery loses one percent
+    * every OnePercent / ConsumptionPerSecond seconds of cruise until it reaches 0%.
+    */
+
+    double NetConsumptionPerHour = Profile.cruiseSpeed * CruisingPowerConsumption;
+    double ConsumptionPerSecond = NetConsumptionPerHour / (60 * 60);
+    double OnePercent = BatteryCapacity * 0.01;
+
+    std::chrono::duration<double> flightTime(currentBatteryLevel * OnePercent / ConsumptionPerSecond);
+
+    return std::chrono::duration_cast<Scheduler::SimDuration>(flightTime);
+}
+
+
 void evTOL::receiveFromCharger(const std::string& ticketNumber) {
     bool aircraftReceived = false;
-	std::shared_ptr<RequestManager> request = RequestManager::getRequest(ticketNumber);
+	std::shared_ptr<RequestManager> request = RequestManager::getRequest(*simulation, ticketNumber);
     std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->shared_from_this());
 
     while (chargingStatus.load()) {
         std::unique_lock<std::mutex> rxLock(aircraftMtx);
-        evTOL::aircraftCV.wait(rxLock, [&] {
+        simulation->aircraftCV.wait(rxLock, [&] {
             if(request) aircraftReceived = request->thankyou();
-            return (aircraftReceived && chargingStatus.load()) || simulationComplete.load();
+            return (aircraftReceived && chargingStatus.load()) || simulation->fleetRetired.load();
             });
 
         if (aircraftReceived && request) {
 			logger->performanceSummary(this->shared_from_this());
+            recordSession();
             chargingStatus.store(false);
             currentBatteryLevel = 100;
             logger->logData("Aircraft received from charging station.");
         }
-        else if (simulationComplete.load()) {
+        else if (simulation->fleetRetired.load()) {
             logger->logData("Simulation complete");
             break;
         }
@@ -126,11 +189,13 @@ void evTOL::startSimulation() {
     *   5. repeat steps 1 - 5.
     */
 
+    ThreadPlacement::Scope placement(ThreadRole::Aircraft, AircraftID);
+
 	std::string ticketNumber{};
     std::shared_ptr<evTOL> aircraft = this->shared_from_this();
     std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->shared_from_this());
 
-    while (!simulationComplete.load()) {
+    while (!simulation->fleetRetired.load()) {
         if (!chargingStatus.load()) {
             if (currentBatteryLevel <= 1) {
                 logger->logData("Battery level is less than 1%. Preparing to dispatch to charger network.");
@@ -148,22 +213,225 @@ void evTOL::startSimulation() {
         }
     }
 
+    // The stop may arrive right after a charge was requested; the helper thread is woken by the same stop
+    if (chargerThread.joinable()) chargerThread.join();
+}
+
+
+Task evTOL::flightTask(Scheduler& scheduler, FlightPhase resumeAt) {
+    /*
+    * Cooperative counterpart of startSimulation(). The same fly -> charge -> fly cycle is written
+    * as a straight-line script: every wait is a co_await on the scheduler instead of a sleeping
+    * thread, a condition variable or a helper thread. Timestamps are taken from the simulated clock.
+    *
+    * The events the aircraft waits on are:
+    *   1. Battery depleted  : the aircraft arrives at the charging network once the flight duration has elapsed.
+    *   2. Charger assigned  : a charger coroutine has taken the ticket out of the queue.
+    *   3. Charge complete   : the charge end is fixed once a charger is assigned, so the aircraft returns to
+    *                          its own scheduler and resumes exactly when the charger releases it.
+    *
+    * The aircraft only moves between schedulers with a delay of a full flight or a full charge, which is
+    * what allows a ParallelScheduler to run the fleet and the charging network on different threads.
+    *
+    * flightPhase records which of these waits the aircraft is suspended at. A coroutine rebuilt from a
+    * checkpoint is started with that phase and its first resumption continues right after the wait.
+    */
+
+    std::shared_ptr<evTOL> aircraft = this->shared_from_this();
+    std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
+    Scheduler& chargingNetwork = simulation->getChargingScheduler();
+
+    while (resumeAt != FlightPhase::Start || !simulation->fleetRetired.load()) {
+        if (resumeAt == FlightPhase::Start) {
+            logger->logData("Starting the aircraft.");
+            StartOperationTime = scheduler.now();
+
+            flightPhase = FlightPhase::Flying;
+            co_await scheduler.transferTo(chargingNetwork, getFlightDuration());
+        }
+
+        if (resumeAt <= FlightPhase::Flying) {
+            {
+                // Timed in blocks that end before the next co_await, as the coroutine may resume on another thread
+                TIMED_SCOPE(BatteryUpdate);
+                currentBatteryLevel = 0;
+                logger->logData("Battery level of aircraft has drained to : " + std::to_string(currentBatteryLevel) + " %.");
+
+                EndOperationTime = chargingNetwork.now();
+                airTime = getEndOperationTime() - getStartOperationTime();
+                logger->logData("This aircraft has requested to be charged. Setting Charging status to : TRUE.");
+                chargingStatus.store(true);
+            }
+
+            std::shared_ptr<RequestManager> request = RequestManager::queueChargingRequest(aircraft, chargingNetwork);
+
+            flightPhase = FlightPhase::Queued;
+            co_await request->chargerAssigned();
+        }
+
+        if (resumeAt <= FlightPhase::Queued) {
+            flightPhase = FlightPhase::Charging;
+            co_await chargingNetwork.transferTo(scheduler, getChargeDuration());
+        }
+
+        logger->performanceSummary(aircraft);
+        recordSession();
+        chargingStatus.store(false);
+        currentBatteryLevel = 100;
+        logger->logData("Aircraft received from charging station.");
+
+        flightPhase = FlightPhase::Start;
+        resumeAt = FlightPhase::Start;
+    }
+}
+
+
+Task evTOL::tripTask(Scheduler& scheduler, TripDispatcher& dispatcher) {
+    /*
+    * Counterpart of flightTask() for a simulation with trip demand. The aircraft waits where it landed
+    * until the dispatcher matches it with a trip, flies empty to the origin and on to the destination in
+    * one session, and only carries passengers on the second leg. Below the charge reserve it queues at
+    * the charging network, and the charge takes the share of a full charge the battery is missing.
+    */
+
+    std::shared_ptr<evTOL> aircraft = this->shared_from_this();
+    std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
+    Scheduler& chargingNetwork = simulation->getChargingScheduler();
+
+    while (!simulation->fleetRetired.load()) {
+        if (!dispatcher.requestTrip(AircraftID)) co_await dispatcher.tripAssigned(AircraftID);
+
+        const TripAssignment& assignment = dispatcher.getAssignment(AircraftID);
+        double tripMiles = assignment.trip.miles();
+        double miles = assignment.emptyMiles + tripMiles;
+        std::uint32_t passengers = assignment.trip.passengers;
+
+        logger->logData("Dispatched to a trip of " + std::to_string(passengers) + " passengers over " + std::to_string(tripMiles) + " miles.");
+        StartOperationTime = scheduler.now();
+
+        flightPhase = FlightPhase::Flying;
+        co_await scheduler.sleepFor(std::chrono::duration_cast<Scheduler::SimDuration>(std::chrono::duration<double, std::ratio<3600>>(miles / Profile.cruiseSpeed)));
+
+        {
+            TIMED_SCOPE(BatteryUpdate);
+            EndOperationTime = scheduler.now();
+            airTime = getEndOperationTime() - getStartOperationTime();
+            batteryEnergy = std::max(0.0, batteryEnergy - miles * CruisingPowerConsumption);
+            currentBatteryLevel = static_cast<int>(100.0 * batteryEnergy / BatteryCapacity);
+        }
+
+        dispatcher.tripCompleted(AircraftID);
+        recordSession(Profile.miles(airTime.count()), tripMiles * passengers);
+        logger->logData("Trip completed. Battery level of aircraft is : " + std::to_string(currentBatteryLevel) + " %.");
+
+        if (batteryEnergy < TripChargeReserve * BatteryCapacity) {
+            chargeShare = 1.0 - batteryEnergy / BatteryCapacity;
+            chargingStatus.store(true);
+
+            std::shared_ptr<RequestManager> request = RequestManager::queueChargingRequest(aircraft, chargingNetwork);
+
+            flightPhase = FlightPhase::Queued;
+            co_await request->chargerAssigned();
+
+            flightPhase = FlightPhase::Charging;
+            co_await chargingNetwork.transferTo(scheduler, getChargeDuration());
+
+            chargingStatus.store(false);
+            batteryEnergy = BatteryCapacity;
+            currentBatteryLevel = 100;
+            chargeShare = 1.0;
+            logger->logData("Aircraft received from charging station.");
+        }
+
+        flightPhase = FlightPhase::Start;
+    }
+}
+
+
+Task evTOL::shardTask(ShardedScheduler& scheduler) {
+    /*
+    * Flying half of flightTask() in a shard process. Once the battery is depleted the aircraft is handed
+    * to the charging network of the coordinator and stays suspended until the coordinator releases it at
+    * the end of its charge. The session is sent to the coordinator, which records it.
+    */
+
+    std::shared_ptr<DataLogger> logger = DataLogger::getInstance(this->shared_from_this());
+    Scheduler& fleet = scheduler.fleet();
+
+    while (!simulation->fleetRetired.load()) {
+        logger->logData("Starting the aircraft.");
+        Scheduler::SimDuration start = fleet.elapsed();
+        Scheduler::SimDuration flight = getFlightDuration();
+
+        flightPhase = FlightPhase::Flying;
+        co_await scheduler.requestCharge(AircraftID, flight);
+
+        logger->logData("Aircraft received from charging station.");
+        scheduler.recordSession(AircraftID, start, start + flight);
+    }
 }
 
 
-void evTOL::retireSimulation() {
-	simulationComplete.store(true);
-	evTOL::aircraftCV.notify_all();
+Task evTOL::networkTask(ShardedScheduler& scheduler) {
+    /*
+    * Charging half of flightTask() in the coordinator. The coroutine is resumed whenever the aircraft
+    * arrives from its shard, queues it like flightTask() does, and sends it back to the shard once a
+    * charger has taken it; the charge ends a full charge later, in the shard.
+    */
+
+    std::shared_ptr<evTOL> aircraft = this->shared_from_this();
+    std::shared_ptr<DataLogger> logger = DataLogger::getInstance(aircraft);
+    Scheduler& network = scheduler.network();
+
+    while (!simulation->fleetRetired.load()) {
+        currentBatteryLevel = 0;
+        logger->logData("This aircraft has requested to be charged. Setting Charging status to : TRUE.");
+        chargingStatus.store(true);
+
+        std::shared_ptr<RequestManager> request = RequestManager::queueChargingRequest(aircraft, network);
+
+        flightPhase = FlightPhase::Queued;
+        co_await request->chargerAssigned();
+
+        flightPhase = FlightPhase::Charging;
+        scheduler.release(AircraftID, network.elapsed() + getChargeDuration());
+
+        // Resumed by the scheduler when the aircraft arrives again
+        co_await std::suspend_always{};
+    }
+}
+
+
+void evTOL::mergeSession(std::chrono::time_point<std::chrono::system_clock> start, std::chrono::time_point<std::chrono::system_clock> end) {
+    // The figures the aircraft would have recorded itself in a cooperative run, from the same timestamps
+    StartOperationTime = start;
+    EndOperationTime = end;
+    airTime = getEndOperationTime() - getStartOperationTime();
+
+    std::shared_ptr<evTOL> aircraft = this->shared_from_this();
+    DataLogger::getInstance(aircraft)->performanceSummary(aircraft);
+    recordSession();
+
+    chargingStatus.store(false);
+    currentBatteryLevel = 100;
+    flightPhase = FlightPhase::Flying;
+}
+
+
+void evTOL::retireSimulation(Simulation& simulation) {
+	simulation.fleetRetired.store(true);
+	simulation.aircraftCV.notify_all();
+	if (simulation.timerWheel) simulation.timerWheel->expireAll();
 }
 
 
 int evTOL::getCruiseSpeed() const {
-    return CruiseSpeed;
+    return Profile.cruiseSpeed;
 }
 
 
 int evTOL::getMaxPassengerCount() const {
-	return maxPassengerCount;
+	return Profile.passengerCount;
 }
 
 
@@ -172,8 +440,69 @@ std::string evTOL::get_manufacturer() const {
 }
 
 
+bool evTOL::getChargingStatus() const {
+    return chargingStatus.load(std::memory_order_relaxed);
+}
+
+
+bool evTOL::canServe(std::uint32_t passengers, double miles) const {
+    return static_cast<int>(passengers) <= Profile.passengerCount && miles * CruisingPowerConsumption <= batteryEnergy;
+}
+
+
+double evTOL::getRange() const {
+    return batteryEnergy / CruisingPowerConsumption;
+}
+
+
+int evTOL::getPassengerCount() const {
+    return Profile.passengerCount;
+}
+
+
+FlightPhase evTOL::getFlightPhase() const {
+    return flightPhase;
+}
+
+
+int evTOL::getBatteryLevelAt(std::chrono::time_point<std::chrono::system_clock> now) const {
+    /*
+    * currentBatteryLevel is only updated when the aircraft lands, so in flight the level is interpolated
+    * from the take-off time at the same drain rate as getFlightDuration().
+    */
+
+    if (flightPhase != FlightPhase::Flying) return currentBatteryLevel;
+
+    double ConsumptionPerSecond = Profile.cruiseSpeed * CruisingPowerConsumption / (60 * 60);
+    double OnePercent = BatteryCapacity * 0.01;
+    double drained = std::chrono::duration<double>(now - StartOperationTime).count() * ConsumptionPerSecond / OnePercent;
+
+    return std::clamp(static_cast<int>(std::ceil(currentBatteryLevel - drained)), 0, 100);
+}
+
+
+std::size_t evTOL::getManufacturerIndex() const {
+    return ManufacturerIndex;
+}
+
+
+std::size_t evTOL::getAircraftID() const {
+    return AircraftID;
+}
+
+
+double evTOL::getFaultsPerHour() const {
+    return Profile.faultsPerHour;
+}
+
+
+Simulation& evTOL::getSimulation() const {
+    return *simulation;
+}
+
+
 std::condition_variable& evTOL::getAircraftCV() {
-    return aircraftCV;
+    return simulation->aircraftCV;
 }
 
 
@@ -182,11 +511,31 @@ std::chrono::microseconds evTOL::getTimeToCharge() const {
 }
 
 
+std::chrono::microseconds evTOL::getTimeToDeplete() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(getFlightDuration()) / 1000000;
+}
+
+
+Scheduler::SimDuration evTOL::getChargeDuration() const {
+    return std::chrono::duration_cast<Scheduler::SimDuration>(TimeToCharge * chargeShare);
+}
+
+
 std::chrono::duration<double> evTOL::getAirTime() const {
     return airTime;
 }
 
 
+std::chrono::duration<double> evTOL::getTotalAirTime() const {
+    return totalAirTime;
+}
+
+
+std::size_t evTOL::getCompletedSessions() const {
+    return completedSessions;
+}
+
+
 std::chrono::time_point<std::chrono::system_clock> evTOL::getEndOperationTime() const {
     return EndOperationTime;
 }
@@ -5,49 +5,77 @@
 #include <chrono>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
 #include <condition_variable>
-#include <nlohmann/json.hpp>
 
-using json = nlohmann::json;
+#include "Scheduler.h"
+#include "FleetCatalog.h"
+#include "AircraftProfile.h"
 
 
+class Simulation;
+class Checkpoint;
+class TripDispatcher;
+class ShardedScheduler;
+
+// Point of the flight cycle at which a cooperative aircraft is suspended
+enum class FlightPhase : std::uint8_t {
+    Start,          // Not yet taken off
+    Flying,         // In flight until the battery is depleted
+    Queued,         // Waiting at the charging network for a charger
+    Charging        // At a charger until it releases the aircraft
+};
+
 class evTOL : public std::enable_shared_from_this<evTOL> {
 private:
-	// Static data members
-    static std::atomic<bool> simulationComplete;		        	// Flag to indicate that the simulation is complete
-    static std::condition_variable aircraftCV;                      // Condition variable to notify the aircraft
+    Simulation* simulation;                                          // Simulation the aircraft belongs to
 
     // Constant parameters that are pre-set by manufacturer
     std::string ManufacturerName;                                    // Name of the manufacturer
-    int CruiseSpeed;                                                 // Maximum speed at which aircraft can cruise
-    int maxPassengerCount;                                           // Maximum passengers aircraft can transport
+    std::size_t ManufacturerIndex;                                   // Position of the manufacturer in the input data
+    std::size_t AircraftID;                                          // Position of the aircraft in the fleet
+    AircraftProfile Profile;                                         // Cruise speed, passengers, fault rate and fleet size for the session metrics
     int BatteryCapacity;                                             // Net capacity of the battery 
     double CruisingPowerConsumption;                                 // power used while cruising at cruise speed
-    double FaultsPerHour;                                            // Probability of faults = > % increase in the consumption of battery kWh value per hour => reduced airtime
     std::chrono::duration<double, std::ratio<3600>> TimeToCharge;    // Time in hours required to charge the battery back to 100%
 
     // Metrics and flags for craft operations
     int currentBatteryLevel;                                                // Indicator for the curent battery level. Starts at 100%
     std::atomic<bool> chargingStatus;                                       // Flag for the current charging status of the aircraft
     std::chrono::duration<double> airTime;									// Total airtime in seconds for aircraft
+    std::chrono::duration<double> totalAirTime;								// Airtime in seconds accumulated over all completed sessions
+    std::size_t completedSessions;											// Number of flight sessions completed by the aircraft
+    FlightPhase flightPhase;												// Point of the flight cycle the coroutine is suspended at
+    double batteryEnergy;                                                   // Energy left in the battery in kWh, tracked when serving trips
+    double chargeShare;                                                     // Share of a full charge the next charge takes
     std::chrono::time_point<std::chrono::system_clock> StartOperationTime;	// Timestamp of beginning of flight in seconds
     std::chrono::time_point<std::chrono::system_clock> EndOperationTime;	// Timestamp of ending of flight in seconds
 	
 	std::mutex aircraftMtx;                                                 // Mutex to lock the aircraft
 	std::thread chargerThread;                                              // Thread object that would manage the receiving of aircraft from the charger
 
+    static constexpr double TripChargeReserve = 0.2;                        // Share of the battery below which an aircraft serving trips charges
+
+    friend class Checkpoint;
+
 protected:
+    std::string modelNumber;                                        // Model number of the aircraft, set by the fleet manager
+
     // Internal functionalities that all aircrafts can and must perform
     void startAircraft();										    // Starts the aircraft and records the starting time of flight
     void updateBatteryLevel();									    // Keeps track of the rate of drain in battery and updates the remaining charge
     void receiveFromCharger(const std::string& ticketNumber);       // Receives the aircraft from the charging stations
     std::string requestCharge(std::shared_ptr<evTOL>& aircraft);	// Sends the aircraft to the Charging manager to get charged
+    void recordSession();                                           // Adds the completed session to the aircraft and fleet metrics
+    void recordSession(double miles, double passengerMiles);        // Adds a completed session with the miles actually flown and carried
+    Scheduler::SimDuration getFlightDuration() const;               // Simulated time until the battery drains from its current level
 
 public:
     /* ----------------- Constructors ----------------- */
 	evTOL() = default;                                      // Default constructor
-    evTOL(const json& InputData);                           // Parametrized constructor 
+    evTOL(const ManufacturerSpec& spec, std::size_t manufacturerIndex = 0, std::size_t aircraftID = 0, Simulation* simulation = nullptr,
+        std::size_t fleetSize = 1);                         // Parametrized constructor 
 	evTOL(evTOL&& other) noexcept = default;                // Move constructor
     evTOL& operator=(evTOL&& other) noexcept = default;     // Move Assignment
     
@@ -59,23 +87,63 @@ public:
 
     /* --------------- All public APIs ---------------- */
     void startSimulation();		                            // Starts the simulation for each aircraft	
-    static void retireSimulation();					        // Marks the flag to trigger the end of simulation
+    Task flightTask(Scheduler& scheduler, FlightPhase resumeAt = FlightPhase::Start);  // Starts the simulation for the aircraft as a coroutine on the scheduler
+    Task tripTask(Scheduler& scheduler, TripDispatcher& dispatcher);  // Starts serving the trips of the dispatcher as a coroutine on the scheduler
+    Task shardTask(ShardedScheduler& scheduler);            // Flies the aircraft in its shard process, charging at the network of the coordinator
+    Task networkTask(ShardedScheduler& scheduler);          // Charges the aircraft of a shard at the network of the coordinator
+    void mergeSession(std::chrono::time_point<std::chrono::system_clock> start,
+        std::chrono::time_point<std::chrono::system_clock> end);   // Record a session the aircraft completed in its shard process
+    static void retireSimulation(Simulation& simulation);	// Marks the flag to trigger the end of simulation
 
     int getCruiseSpeed() const;                             // Get the cruise speed for the aircraft
     int getMaxPassengerCount() const;                       // Get the maximum passenger count for the aircraft
 	std::string get_manufacturer() const;				    // Get the manufacturer name for the aircraft
+    std::size_t getManufacturerIndex() const;               // Get the index of the manufacturer in the input data
+    std::size_t getAircraftID() const;                      // Get the position of the aircraft in the fleet
+    double getFaultsPerHour() const;                        // Get the probability of faults per hour of flight
+    Simulation& getSimulation() const;                      // Get the simulation the aircraft belongs to
     std::condition_variable& getAircraftCV();			    // Get the condition variable for the aircraft
     std::chrono::microseconds getTimeToCharge() const;		// Get the time required to charge the aircraft
+    Scheduler::SimDuration getChargeDuration() const;       // Get the simulated time required to charge the aircraft
+    std::chrono::microseconds getTimeToDeplete() const;     // Get the time for the battery to drain from its current level
 	
     std::chrono::duration<double> getAirTime() const;
+    std::chrono::duration<double> getTotalAirTime() const;  // Get the airtime accumulated over all completed sessions
+    std::size_t getCompletedSessions() const;               // Get the number of completed flight sessions
+    bool getChargingStatus() const;                         // Check if the aircraft is waiting for or at a charger
+    bool canServe(std::uint32_t passengers, double miles) const;  // Check if the aircraft has the seats and the battery for a flight
+    double getRange() const;                                // Get the miles the energy left in the battery covers
+    int getPassengerCount() const;                          // Get the number of passenger seats
+    FlightPhase getFlightPhase() const;                     // Get the point of the flight cycle a cooperative aircraft is at
+    int getBatteryLevelAt(std::chrono::time_point<std::chrono::system_clock> now) const;  // Get the battery level of a cooperative aircraft at a simulated time
     std::chrono::time_point<std::chrono::system_clock> getEndOperationTime() const;
     std::chrono::time_point<std::chrono::system_clock> getStartOperationTime() const;
     std::string getTimeForLogs(const std::chrono::time_point<std::chrono::system_clock>& timePoint) const;
 
-    virtual double getPassengerMiles() const = 0;
-    virtual double getMilesPerSession() const = 0;
-    virtual double getFaultsPerSession() const = 0;
-    virtual std::string getManufacturerName() const = 0;
+    // Session summary, statically dispatched so that it inlines into the logging and aggregation paths
+    double getPassengerMiles() const;                       // Get the passenger miles of the manufacturer's fleet for the session
+    double getMilesPerSession() const;                      // Get the miles of the session, rounded to 2 decimal places
+    double getFaultsPerSession() const;                     // Get the faults of the session
+    const std::string& getManufacturerName() const;         // Get the model number of the aircraft
 
 	~evTOL() = default;                                     // Destructor   
-};
\ No newline at end of file
+};
+
+
+/* ----------------- Inline session summary ----------------- */
+
+inline double evTOL::getPassengerMiles() const {
+    return Profile.fleetPassengerMiles(airTime.count());
+}
+
+inline double evTOL::getMilesPerSession() const {
+    return Profile.milesPerSession(airTime.count());
+}
+
+inline double evTOL::getFaultsPerSession() const {
+    return Profile.faultsPerSession(airTime.count());
+}
+
+inline const std::string& evTOL::getManufacturerName() const {
+    return modelNumber;
+}
\ No newline at end of file